@@ -0,0 +1,343 @@
+/*********************************************************************
+* Software License Agreement (BSD License)
+*
+*  Copyright (c) 2014, University of Texas at Austin 
+*  All rights reserved.
+*
+*  Redistribution and use in source and binary forms, with or without
+*  modification, are permitted provided that the following conditions
+*  are met:
+*
+*   * Redistributions of source code must retain the above copyright
+*     notice, this list of conditions and the following disclaimer.
+*   * Redistributions in binary form must reproduce the above
+*     copyright notice, this list of conditions and the following
+*     disclaimer in the documentation and/or other materials provided
+*     with the distribution.
+*   * Neither the name of UT Austin nor the names of its
+*     contributors may be used to endorse or promote products derived
+*     from this software without specific prior written permission.
+*
+*  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+*  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+*  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+*  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+*  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+*  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+*  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+*  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+*  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+*  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+*  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+*  POSSIBILITY OF SUCH DAMAGE.
+*********************************************************************/
+
+#ifndef BWI_INTERRUPTABLE_ACTION_SERVER_GOAL_SCHEDULER_H_
+#define BWI_INTERRUPTABLE_ACTION_SERVER_GOAL_SCHEDULER_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace bwi_interruptable_action_server {
+
+  /** Decides what a new goal does to the goal that is being pursued. */
+  enum PreemptionPolicy {
+    /* A new goal preempts the current goal, unless it is older. Pending goals never build up. */
+    LATEST_WINS,
+    /* A new goal preempts the current goal if its priority is strictly higher, and waits otherwise. Waiting goals
+     * are pursued in order of priority, and then in the order they arrived. */
+    PRIORITY,
+    /* Goals never preempt each other, and are pursued in the order they arrived. */
+    FIFO
+  };
+
+  /**
+   * \brief The goal state machine of InterruptableActionServer, without any ROS.
+   *
+   * At most one goal is active at a time, and it is always running on the low level action server. Goals waiting
+   * their turn are kept in a bounded queue, ranked by the preemption policy, and are only accepted once they become
+   * active. Pausing the active goal pushes it onto a bounded stack of paused goals and moves on to the next waiting
+   * goal, if any. Resuming preempts the active goal with the most recently paused one.
+   *
+   * Every event returns the actions that carry it out, in order. A goal gets at most one terminal action (SUCCEED,
+   * ABORT or CANCEL), after which the scheduler forgets about it. Every START carries a run number, which the
+   * matching done() event has to quote, so that results of runs that were stopped since are ignored.
+   *
+   * Goal only needs to be copyable and comparable with ==, e.g. an actionlib GoalHandle.
+   */
+  template <class Goal>
+  class GoalScheduler {
+    public:
+
+      /** How a run of the active goal on the low level action server ended. */
+      enum Outcome { SUCCEEDED, FAILED, CANCELED };
+
+      struct Action {
+        enum Type {
+          ACCEPT,   // accept the goal, as it is about to be pursued for the first time
+          START,    // send the goal to the low level action server
+          STOP,     // cancel the goal on the low level action server
+          SUCCEED,
+          ABORT,
+          CANCEL
+        };
+
+        Type type;
+        Goal goal;
+        /** for CANCEL, why the goal was canceled */
+        std::string reason;
+        /** for START, the run number */
+        uint64_t run;
+
+        Action(Type type, const Goal& goal, const std::string& reason = "", uint64_t run = 0) :
+          type(type), goal(goal), reason(reason), run(run) {}
+      };
+
+      typedef std::vector<Action> Actions;
+
+      GoalScheduler(PreemptionPolicy policy = LATEST_WINS,
+                    int max_attempts = 1,
+                    size_t max_pending_goals = 10,
+                    size_t max_paused_goals = 10) :
+          policy_(policy),
+          max_attempts_(max_attempts),
+          max_pending_goals_(max_pending_goals),
+          max_paused_goals_(max_paused_goals),
+          has_active_(false),
+          attempts_(0),
+          run_(0),
+          sequence_(0) {}
+
+      /** \brief a new goal. stamp is only used by LATEST_WINS, to cancel goals older than the active one. */
+      void goal(const Goal& goal, int priority, double stamp, Actions& actions) {
+        Entry entry(goal, priority, stamp, ++sequence_);
+        if (!has_active_) {
+          // Nothing waits while nothing is active.
+          actions.push_back(Action(Action::ACCEPT, goal));
+          start(entry, actions);
+          return;
+        }
+
+        bool preempt = false;
+        if (policy_ == LATEST_WINS) {
+          if (stamp < active_.stamp) {
+            actions.push_back(Action(Action::CANCEL, goal, "This goal was canceled as a newer goal is being pursued."));
+            return;
+          }
+          preempt = true;
+        } else if (policy_ == PRIORITY) {
+          preempt = priority > active_.priority;
+        }
+
+        if (preempt) {
+          actions.push_back(Action(Action::ACCEPT, goal));
+          actions.push_back(Action(Action::STOP, active_.goal));
+          actions.push_back(Action(Action::CANCEL, active_.goal, "This goal was preempted by a new goal."));
+          start(entry, actions);
+          return;
+        }
+
+        typename std::vector<Entry>::iterator position = pending_.begin();
+        while (position != pending_.end() && !isRankedBefore(entry, *position)) {
+          ++position;
+        }
+        pending_.insert(position, entry);
+        if (pending_.size() > max_pending_goals_) {
+          actions.push_back(Action(Action::CANCEL, pending_.back().goal,
+                                   "This goal was canceled as too many goals are waiting."));
+          pending_.pop_back();
+        }
+      }
+
+      /**
+       * \brief a request to cancel the given goal. Cancelling a paused goal also cancels whatever was started since it
+       *        was paused, i.e. the goals paused after it and the active goal.
+       */
+      void cancel(const Goal& goal, Actions& actions) {
+        if (has_active_ && active_.goal == goal) {
+          stopActive("", actions);
+          startNext(actions);
+          return;
+        }
+        for (typename std::vector<Entry>::iterator it = pending_.begin(); it != pending_.end(); ++it) {
+          if (it->goal == goal) {
+            actions.push_back(Action(Action::CANCEL, goal, ""));
+            pending_.erase(it);
+            return;
+          }
+        }
+        for (size_t i = 0; i < paused_.size(); ++i) {
+          if (paused_[i].goal == goal) {
+            if (has_active_) {
+              stopActive("This goal was canceled along with the paused goal it interrupted.", actions);
+            }
+            while (paused_.size() > i + 1) {
+              actions.push_back(Action(Action::CANCEL, paused_.back().goal,
+                                       "This goal was canceled along with the paused goal it interrupted."));
+              paused_.pop_back();
+            }
+            actions.push_back(Action(Action::CANCEL, goal, ""));
+            paused_.pop_back();
+            startNext(actions);
+            return;
+          }
+        }
+      }
+
+      /** \brief pauses the active goal. Fails if there is none, or if too many goals are paused already. */
+      bool pause(Actions& actions) {
+        if (!has_active_ || paused_.size() >= max_paused_goals_) {
+          return false;
+        }
+        actions.push_back(Action(Action::STOP, active_.goal));
+        paused_.push_back(active_);
+        has_active_ = false;
+        startNext(actions);
+        return true;
+      }
+
+      /** \brief resumes the most recently paused goal, preempting the active one. Fails if no goal is paused. */
+      bool resume(Actions& actions) {
+        if (paused_.empty()) {
+          return false;
+        }
+        if (has_active_) {
+          stopActive("This goal was preempted as a paused goal was resumed.", actions);
+        }
+        Entry entry = paused_.back();
+        paused_.pop_back();
+        start(entry, actions);
+        return true;
+      }
+
+      /** \brief the end of the given run on the low level action server. Failed runs are retried up to max_attempts. */
+      void done(uint64_t run, Outcome outcome, Actions& actions) {
+        if (!has_active_ || run != run_) {
+          return;
+        }
+        ++attempts_;
+        if (outcome == SUCCEEDED) {
+          actions.push_back(Action(Action::SUCCEED, active_.goal));
+        } else if (outcome == FAILED && attempts_ < max_attempts_) {
+          actions.push_back(Action(Action::START, active_.goal, "", ++run_));
+          return;
+        } else if (outcome == FAILED) {
+          actions.push_back(Action(Action::ABORT, active_.goal));
+        } else {
+          actions.push_back(Action(Action::CANCEL, active_.goal, ""));
+        }
+        has_active_ = false;
+        startNext(actions);
+      }
+
+      /** \brief cancels every goal, e.g. when shutting down */
+      void cancelAll(const std::string& reason, Actions& actions) {
+        if (has_active_) {
+          stopActive(reason, actions);
+        }
+        for (size_t i = 0; i < pending_.size(); ++i) {
+          actions.push_back(Action(Action::CANCEL, pending_[i].goal, reason));
+        }
+        pending_.clear();
+        while (!paused_.empty()) {
+          actions.push_back(Action(Action::CANCEL, paused_.back().goal, reason));
+          paused_.pop_back();
+        }
+      }
+
+      inline bool getActive(Goal& goal) const {
+        if (has_active_) {
+          goal = active_.goal;
+        }
+        return has_active_;
+      }
+
+      /** \brief the run number of the active goal's current run */
+      inline uint64_t getRun() const {
+        return run_;
+      }
+
+      /** \brief the number of runs of the active goal that have ended */
+      inline int getAttempts() const {
+        return attempts_;
+      }
+
+      /** \brief the waiting goals, next one first */
+      std::vector<Goal> getPending() const {
+        std::vector<Goal> goals;
+        for (size_t i = 0; i < pending_.size(); ++i) {
+          goals.push_back(pending_[i].goal);
+        }
+        return goals;
+      }
+
+      /** \brief the paused goals, most recently paused one last */
+      std::vector<Goal> getPaused() const {
+        std::vector<Goal> goals;
+        for (size_t i = 0; i < paused_.size(); ++i) {
+          goals.push_back(paused_[i].goal);
+        }
+        return goals;
+      }
+
+    private:
+
+      struct Entry {
+        Goal goal;
+        int priority;
+        double stamp;
+        uint64_t sequence;
+
+        Entry() : priority(0), stamp(0), sequence(0) {}
+        Entry(const Goal& goal, int priority, double stamp, uint64_t sequence) :
+          goal(goal), priority(priority), stamp(stamp), sequence(sequence) {}
+      };
+
+      bool isRankedBefore(const Entry& a, const Entry& b) const {
+        if (policy_ == PRIORITY && a.priority != b.priority) {
+          return a.priority > b.priority;
+        }
+        return a.sequence < b.sequence;
+      }
+
+      void start(const Entry& entry, Actions& actions) {
+        active_ = entry;
+        has_active_ = true;
+        attempts_ = 0;
+        actions.push_back(Action(Action::START, entry.goal, "", ++run_));
+      }
+
+      void stopActive(const std::string& reason, Actions& actions) {
+        actions.push_back(Action(Action::STOP, active_.goal));
+        actions.push_back(Action(Action::CANCEL, active_.goal, reason));
+        has_active_ = false;
+      }
+
+      void startNext(Actions& actions) {
+        if (!has_active_ && !pending_.empty()) {
+          Entry entry = pending_.front();
+          pending_.erase(pending_.begin());
+          actions.push_back(Action(Action::ACCEPT, entry.goal));
+          start(entry, actions);
+        }
+      }
+
+      PreemptionPolicy policy_;
+      int max_attempts_;
+      size_t max_pending_goals_;
+      size_t max_paused_goals_;
+
+      bool has_active_;
+      Entry active_;
+      int attempts_;
+      uint64_t run_;
+      uint64_t sequence_;
+
+      std::vector<Entry> pending_;
+      std::vector<Entry> paused_;
+  };
+
+}
+
+#endif
@@ -35,14 +35,21 @@
 #ifndef BWI_INTERRUPTABLE_ACTION_SERVER_H_
 #define BWI_INTERRUPTABLE_ACTION_SERVER_H_
 
-#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
+#include <deque>
 #include <ros/ros.h>
 #include <actionlib/server/action_server.h>
 #include <actionlib/client/simple_action_client.h>
 #include <actionlib/action_definition.h>
+#include <bwi_interruptable_action_server/goal_scheduler.h>
 #include <std_srvs/Empty.h>
 
 namespace bwi_interruptable_action_server {
+
+  /* Goals, cancel requests, pause and resume calls arrive on the thread that spins the node's callback queue, and
+   * low level results and feedback on the action client's own spin thread. Each of them updates the scheduler under
+   * lock_ and queues what the scheduler decided. The queue is carried out in order with lock_ released, since the
+   * action server and client call back into this class while holding their own locks. */
   template <class ActionSpec>
   class InterruptableActionServer {
     public:
@@ -52,12 +59,18 @@ namespace bwi_interruptable_action_server {
       typedef typename actionlib::ActionServer<ActionSpec>::GoalHandle GoalHandle;
       typedef boost::function<void(const ResultConstPtr&, const actionlib::SimpleClientGoalState&, int)> ResultCallback;
       typedef boost::function<void(const GoalConstPtr&)> NewGoalCallback;
+      typedef boost::function<int(const GoalConstPtr&)> PriorityCallback;
+      typedef GoalScheduler<GoalHandle> Scheduler;
       
       InterruptableActionServer(ros::NodeHandle n, 
                                 std::string name, 
                                 int max_attempts = 1, 
                                 NewGoalCallback new_goal_callback = 0,
-                                ResultCallback result_callback = 0);
+                                ResultCallback result_callback = 0,
+                                PreemptionPolicy policy = LATEST_WINS,
+                                size_t max_pending_goals = 10,
+                                size_t max_paused_goals = 10,
+                                PriorityCallback priority_callback = 0);
       ~InterruptableActionServer();
 
       void spin();
@@ -68,8 +81,25 @@ namespace bwi_interruptable_action_server {
       bool resume(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res);
       void goalCallback(GoalHandle goal);
       void cancelCallback(GoalHandle preempt);
+      void doneCallback(uint64_t run, const actionlib::SimpleClientGoalState& state, const ResultConstPtr& result);
+
+      void publishFeedback(uint64_t run, const FeedbackConstPtr& feedback);
+
+      /* Queues the scheduler's actions. result is what the low level server returned for the run that just ended,
+       * if any. Must be called with lock_ held. */
+      void apply(const typename Scheduler::Actions& actions, const ResultConstPtr& result = ResultConstPtr());
+
+      /* Carries out the queued actions, unless another thread already is, in which case that thread carries these
+       * out too. Must be called with lock_ released. */
+      void flush();
 
-      void publishFeedback(const FeedbackConstPtr& feedback);
+      struct PendingAction {
+        typename Scheduler::Action action;
+        ResultConstPtr result;
+
+        PendingAction(const typename Scheduler::Action& action, const ResultConstPtr& result) :
+          action(action), result(result) {}
+      };
 
       ros::NodeHandle n_;
 
@@ -79,23 +109,18 @@ namespace bwi_interruptable_action_server {
       boost::shared_ptr<actionlib::ActionServer<ActionSpec> > as_;
       boost::shared_ptr<actionlib::SimpleActionClient<ActionSpec> > ac_;
 
-      boost::recursive_mutex lock_;
+      boost::mutex lock_;
 
       std::string interruptable_server_name_;
 
-      GoalHandle current_goal_, original_goal_, next_goal_;
-
-      bool original_goal_available_;
-      bool switch_to_original_goal_;
-      bool next_goal_available_;
-      bool pursue_current_goal_;
-      bool pursuing_current_goal_;
+      Scheduler scheduler_;
 
-      int max_attempts_;
-      int current_attempts_;
       ResultCallback result_callback_;
-
       NewGoalCallback new_goal_callback_;
+      PriorityCallback priority_callback_;
+
+      std::deque<PendingAction> pending_;
+      bool flushing_;
   };
 };
 
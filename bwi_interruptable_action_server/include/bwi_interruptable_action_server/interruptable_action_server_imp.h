@@ -42,16 +42,17 @@ namespace bwi_interruptable_action_server {
                                                                    std::string name,
                                                                    int max_attempts,
                                                                    NewGoalCallback new_goal_callback,
-                                                                   ResultCallback result_callback) :
+                                                                   ResultCallback result_callback,
+                                                                   PreemptionPolicy policy,
+                                                                   size_t max_pending_goals,
+                                                                   size_t max_paused_goals,
+                                                                   PriorityCallback priority_callback) :
       n_(n),
-      original_goal_available_(false),
-      switch_to_original_goal_(false),
-      next_goal_available_(false),
-      pursue_current_goal_(false),
-      pursuing_current_goal_(false),
-      max_attempts_(max_attempts),
+      scheduler_(policy, max_attempts, max_pending_goals, max_paused_goals),
       result_callback_(result_callback),
-      new_goal_callback_(new_goal_callback) {
+      new_goal_callback_(new_goal_callback),
+      priority_callback_(priority_callback),
+      flushing_(false) {
 
     interruptable_server_name_ = name + "_interruptable";
 
@@ -76,194 +77,181 @@ namespace bwi_interruptable_action_server {
 
   template <class ActionSpec>
   InterruptableActionServer<ActionSpec>::~InterruptableActionServer() {
-    if (original_goal_available_) {
-      original_goal_.setCanceled(Result(), "The goal was cancelled as the action server is shutting down.");
-    }
-
-    if (pursuing_current_goal_ || pursue_current_goal_) {
-      current_goal_.setCanceled(Result(), "The goal was cancelled as the action server is shutting down.");
-    }
-
-    if (next_goal_available_) {
-      next_goal_.setCanceled(Result(), "The goal was cancelled as the action server is shutting down.");
+    {
+      boost::mutex::scoped_lock lock(lock_);
+      typename Scheduler::Actions actions;
+      scheduler_.cancelAll("The goal was cancelled as the action server is shutting down.", actions);
+      apply(actions);
     }
+    flush();
   }
 
   template <class ActionSpec>
   bool InterruptableActionServer<ActionSpec>::pause(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res) {
-    boost::recursive_mutex::scoped_lock lock(lock_);
-    bool ret_val = true;
-    if (original_goal_available_) {
-      ROS_ERROR_STREAM(interruptable_server_name_ + " : Already paused one goal, cannot pause another.");
-      ret_val = false;
-    } else if (!pursue_current_goal_) {
-      ROS_ERROR_STREAM(interruptable_server_name_ + " : Not currently actively pursuing a goal, cannot pause.");
-      ret_val = false;
-    } else {
-      pursue_current_goal_ = false;
-      original_goal_ = current_goal_;
-      original_goal_available_ = true;
+    {
+      boost::mutex::scoped_lock lock(lock_);
+      typename Scheduler::Actions actions;
+      if (!scheduler_.pause(actions)) {
+        ROS_ERROR_STREAM(interruptable_server_name_ + " : Not actively pursuing a goal, or too many goals are paused " +
+                         "already. Cannot pause.");
+        return false;
+      }
+      apply(actions);
     }
-    return ret_val;
+    flush();
+    return true;
   }
 
   template <class ActionSpec>
   bool InterruptableActionServer<ActionSpec>::resume(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res) {
-    boost::recursive_mutex::scoped_lock lock(lock_);
-    bool ret_val = true;
-    if (!original_goal_available_) {
-      ROS_ERROR_STREAM(interruptable_server_name_ + " : No paused goal available, cannot resume goal.");
-      ret_val = false;
-    } else {
-      // Restart the current goal again.
-      switch_to_original_goal_ = true;
+    {
+      boost::mutex::scoped_lock lock(lock_);
+      typename Scheduler::Actions actions;
+      if (!scheduler_.resume(actions)) {
+        ROS_ERROR_STREAM(interruptable_server_name_ + " : No paused goal available, cannot resume goal.");
+        return false;
+      }
+      apply(actions);
     }
-    return ret_val;
+    flush();
+    return true;
   }
 
   template <class ActionSpec>
   void InterruptableActionServer<ActionSpec>::goalCallback(GoalHandle goal) {
-    boost::recursive_mutex::scoped_lock lock(lock_);
-    // check that the timestamp is past or equal to that of the current goal and the next goal
-    if ((!current_goal_.getGoal() || goal.getGoalID().stamp >= current_goal_.getGoalID().stamp)
-        && (!next_goal_.getGoal() || goal.getGoalID().stamp >= next_goal_.getGoalID().stamp)) {
-
-      //if next_goal has not been accepted already... its going to get bumped, but we need to let the client know we're preempting
-      if (next_goal_available_) {
-        next_goal_.setCanceled(Result(), "This goal was canceled because another goal was recieved by the simple action server");
-        next_goal_available_ = false;
-      }
-
-      next_goal_ = goal;
-      next_goal_available_ = true; 
-      
-      ROS_INFO_STREAM(interruptable_server_name_ + " : Received new goal! Passing it to low level action server.");
-    } else {
-      goal.setCanceled(Result(), "This goal was canceled because another goal was recieved by the simple action server");
+    {
+      boost::mutex::scoped_lock lock(lock_);
+      int priority = priority_callback_ ? priority_callback_(goal.getGoal()) : 0;
+      ROS_INFO_STREAM(interruptable_server_name_ + " : Received new goal!");
+      typename Scheduler::Actions actions;
+      scheduler_.goal(goal, priority, goal.getGoalID().stamp.toSec(), actions);
+      apply(actions);
     }
-
+    flush();
   }
   
   template <class ActionSpec>
   void InterruptableActionServer<ActionSpec>::cancelCallback(GoalHandle goal) {
-    boost::recursive_mutex::scoped_lock lock(lock_);
-    if (goal == current_goal_) {
-      pursue_current_goal_ = false;
-    } else if (goal == next_goal_) {
-      next_goal_.setCanceled(Result());
-      next_goal_available_ = false;
-    } else if (goal == original_goal_ && original_goal_available_) {
-      // Don't need to pursue the original goal again. Since we were in paused state, we might be pursuing a goal
-      // currently. Cancel the current and next goals as well.
-      original_goal_.setCanceled(Result());
-      original_goal_available_ = false;
-      if (next_goal_available_) {
-        next_goal_.setCanceled(Result());
-        next_goal_available_ = false;
+    {
+      boost::mutex::scoped_lock lock(lock_);
+      typename Scheduler::Actions actions;
+      scheduler_.cancel(goal, actions);
+      apply(actions);
+    }
+    flush();
+  }
+
+  template <class ActionSpec>
+  void InterruptableActionServer<ActionSpec>::doneCallback(uint64_t run,
+                                                          const actionlib::SimpleClientGoalState& state,
+                                                          const ResultConstPtr& result) {
+    int attempts;
+    {
+      boost::mutex::scoped_lock lock(lock_);
+      GoalHandle active;
+      if (!scheduler_.getActive(active) || run != scheduler_.getRun()) {
+        // A run that was stopped in the meantime.
+        return;
+      }
+
+      typename Scheduler::Outcome outcome = Scheduler::CANCELED;
+      if (state == actionlib::SimpleClientGoalState::SUCCEEDED) {
+        outcome = Scheduler::SUCCEEDED;
+      } else if (state == actionlib::SimpleClientGoalState::ABORTED ||
+                 state == actionlib::SimpleClientGoalState::REJECTED) {
+        outcome = Scheduler::FAILED;
       }
-      pursue_current_goal_ = false;
+      attempts = scheduler_.getAttempts() + 1;
+
+      typename Scheduler::Actions actions;
+      scheduler_.done(run, outcome, actions);
+      apply(actions, result);
+    }
+    if (result_callback_) {
+      result_callback_(result, state, attempts);
     }
+    flush();
   }
 
   template <class ActionSpec>
-  void InterruptableActionServer<ActionSpec>::spin() {
-    as_->start();
-    ros::Rate r(30);
-    while (n_.ok()) {
-      ros::spinOnce();
-      boost::recursive_mutex::scoped_lock lock(lock_);
+  void InterruptableActionServer<ActionSpec>::apply(const typename Scheduler::Actions& actions,
+                                                    const ResultConstPtr& result) {
+    for (size_t i = 0; i < actions.size(); ++i) {
+      pending_.push_back(PendingAction(actions[i], result));
+    }
+  }
 
-      // Switch to original goal if resume was called.
-      if (switch_to_original_goal_) {
-        if (pursuing_current_goal_) {
-          current_goal_.setCanceled(Result(), "This goal was preempted as a paused goal was resumed.");
-          pursuing_current_goal_ = false;
-        }
-        if (next_goal_available_) {
-          next_goal_available_ = false;
-          next_goal_.setCanceled(Result(), "This goal was preempted as a paused goal was resumed.");
-        }
-        current_attempts_ = 0;
-        current_goal_ = original_goal_;
-        original_goal_available_ = false;
-        switch_to_original_goal_ = false;
-        pursue_current_goal_ = true;
-      } 
-      
-      // Switch to a new goal if a new goal is available.
-      if (next_goal_available_) {
-        if (pursuing_current_goal_) {
-          current_goal_.setCanceled(Result(), "This goal was preempted by a new goal");
-          pursuing_current_goal_ = false;
-        }
-        current_attempts_ = 0;
-        current_goal_ = next_goal_;
-        current_goal_.setAccepted();
-        if (new_goal_callback_) {
-          new_goal_callback_(current_goal_.getGoal());
-        }
-        pursue_current_goal_ = true;
-        next_goal_available_ = false;
-      } 
-      
-      // If we are not pursuing the current goal, and we should be, then start pursuing the current goal.
-      if (!pursuing_current_goal_ && pursue_current_goal_) {
-        // Send the current goal and hookup the feedback publisher.
-        ac_->sendGoal(*(current_goal_.getGoal()),
-                      typename actionlib::SimpleActionClient<ActionSpec>::SimpleDoneCallback(),
-                      typename actionlib::SimpleActionClient<ActionSpec>::SimpleActiveCallback(),
-                      boost::bind(&InterruptableActionServer::publishFeedback, this, _1));
-        pursuing_current_goal_ = true;
-      } else if (pursuing_current_goal_ && !pursue_current_goal_) {
-        // We were pursuing a goal that we do not need to pursue any more.
-        ac_->cancelGoal();
-        pursuing_current_goal_ = false;
-      } else if (pursuing_current_goal_ && pursue_current_goal_) {
-        // See if goal is still being pursued.
-        actionlib::SimpleClientGoalState state = ac_->getState();
-        if (state != actionlib::SimpleClientGoalState::PENDING &&
-            state != actionlib::SimpleClientGoalState::ACTIVE) {
-          // This means that the the goal is no longer being pursued. Publish the result here from whatever information
-          // we've received from the regular action client.
-          ResultConstPtr result = ac_->getResult();
-          current_attempts_ += 1;
-          if (result_callback_) {
-            result_callback_(result, state, current_attempts_);
-          }
-          if (state == actionlib::SimpleClientGoalState::SUCCEEDED) {
-            current_goal_.setSucceeded(*result);
-            // The goal should not be pursued again.
-            pursuing_current_goal_ = false;
-            pursue_current_goal_ = false;
-          } else if (state == actionlib::SimpleClientGoalState::ABORTED || 
-                     state == actionlib::SimpleClientGoalState::REJECTED) {
-            if (current_attempts_ < max_attempts_) {
-              ++current_attempts_;
-              // This wall cause the same goal to be resent.
-              pursuing_current_goal_ = false;
-            } else {
-              current_goal_.setAborted(*result);
-              // The goal should not be pursued again.
-              pursuing_current_goal_ = false;
-              pursue_current_goal_ = false;
-            }
-          } else {
-            current_goal_.setCanceled(*result);
-            // Since the goal got completed, we no longer wish to pursue this goal.
-            pursuing_current_goal_ = false;
-            pursue_current_goal_ = false;
-          }
+  template <class ActionSpec>
+  void InterruptableActionServer<ActionSpec>::flush() {
+    boost::mutex::scoped_lock lock(lock_);
+    if (flushing_) {
+      return;
+    }
+    flushing_ = true;
+    try {
+      while (!pending_.empty()) {
+        PendingAction next = pending_.front();
+        pending_.pop_front();
+        lock.unlock();
 
+        GoalHandle goal = next.action.goal;
+        Result terminal_result = next.result ? *next.result : Result();
+        switch (next.action.type) {
+          case Scheduler::Action::ACCEPT:
+            goal.setAccepted();
+            if (new_goal_callback_) {
+              new_goal_callback_(goal.getGoal());
+            }
+            break;
+          case Scheduler::Action::START:
+            // Send the goal and hookup the feedback publisher.
+            ac_->sendGoal(*(goal.getGoal()),
+                          boost::bind(&InterruptableActionServer::doneCallback, this, next.action.run, _1, _2),
+                          typename actionlib::SimpleActionClient<ActionSpec>::SimpleActiveCallback(),
+                          boost::bind(&InterruptableActionServer::publishFeedback, this, next.action.run, _1));
+            break;
+          case Scheduler::Action::STOP:
+            ac_->cancelGoal();
+            break;
+          case Scheduler::Action::SUCCEED:
+            goal.setSucceeded(terminal_result);
+            break;
+          case Scheduler::Action::ABORT:
+            goal.setAborted(terminal_result);
+            break;
+          case Scheduler::Action::CANCEL:
+            goal.setCanceled(terminal_result, next.action.reason);
+            break;
         }
+
+        lock.lock();
+      }
+    } catch (...) {
+      if (!lock.owns_lock()) {
+        lock.lock();
       }
-      r.sleep();
+      flushing_ = false;
+      throw;
     }
+    flushing_ = false;
   }
 
   template <class ActionSpec>
-  void InterruptableActionServer<ActionSpec>::publishFeedback(const FeedbackConstPtr& feedback) {
-    current_goal_.publishFeedback(*feedback);
+  void InterruptableActionServer<ActionSpec>::spin() {
+    as_->start();
+    ros::spin();
   }
 
-};
+  template <class ActionSpec>
+  void InterruptableActionServer<ActionSpec>::publishFeedback(uint64_t run, const FeedbackConstPtr& feedback) {
+    GoalHandle active;
+    {
+      boost::mutex::scoped_lock lock(lock_);
+      if (!scheduler_.getActive(active) || run != scheduler_.getRun()) {
+        return;
+      }
+    }
+    active.publishFeedback(*feedback);
+  }
 
+};
@@ -0,0 +1,416 @@
+#include <bwi_interruptable_action_server/goal_scheduler.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace bwi_interruptable_action_server;
+
+typedef GoalScheduler<std::string> Scheduler;
+
+namespace {
+
+  const char* const ACTION_NAMES[] = {"ACCEPT", "START", "STOP", "SUCCEED", "ABORT", "CANCEL"};
+
+  std::string join(const std::vector<std::string>& parts, const std::string& separator) {
+    std::string joined;
+    for (size_t i = 0; i < parts.size(); ++i) {
+      joined += (i ? separator : "") + parts[i];
+    }
+    return joined;
+  }
+
+  void describe(const Scheduler::Actions& actions, std::vector<std::string>& trace) {
+    for (size_t i = 0; i < actions.size(); ++i) {
+      std::ostringstream out;
+      out << ACTION_NAMES[actions[i].type] << " " << actions[i].goal;
+      if (actions[i].type == Scheduler::Action::START) {
+        out << " " << actions[i].run;
+      }
+      trace.push_back(out.str());
+    }
+  }
+
+  // Runs events such as "goal a 2 1.5" (name, priority, stamp), "cancel a", "pause", "resume" or
+  // "done 3 failed" (run, outcome), and describes the actions they led to.
+  std::string run(Scheduler& scheduler, const std::vector<std::string>& events) {
+    std::vector<std::string> trace;
+    for (size_t i = 0; i < events.size(); ++i) {
+      std::istringstream in(events[i]);
+      std::string event;
+      in >> event;
+      Scheduler::Actions actions;
+      if (event == "goal") {
+        std::string name;
+        int priority;
+        double stamp;
+        in >> name >> priority >> stamp;
+        scheduler.goal(name, priority, stamp, actions);
+      } else if (event == "cancel") {
+        std::string name;
+        in >> name;
+        scheduler.cancel(name, actions);
+      } else if (event == "pause" && !scheduler.pause(actions)) {
+        trace.push_back("pause refused");
+      } else if (event == "resume" && !scheduler.resume(actions)) {
+        trace.push_back("resume refused");
+      } else if (event == "done") {
+        uint64_t run;
+        std::string outcome;
+        in >> run >> outcome;
+        scheduler.done(run, (outcome == "succeeded") ? Scheduler::SUCCEEDED :
+                       (outcome == "failed") ? Scheduler::FAILED : Scheduler::CANCELED, actions);
+      } else if (event == "shutdown") {
+        scheduler.cancelAll("shutting down", actions);
+      }
+      describe(actions, trace);
+    }
+    return join(trace, ", ");
+  }
+
+  std::string describeState(const Scheduler& scheduler) {
+    std::string active;
+    scheduler.getActive(active);
+    return "active [" + active + "] pending [" + join(scheduler.getPending(), " ") + "] paused [" +
+      join(scheduler.getPaused(), " ") + "]";
+  }
+
+  struct Case {
+    const char* name;
+    PreemptionPolicy policy;
+    int max_attempts;
+    size_t max_pending_goals;
+    size_t max_paused_goals;
+    const char* events;     // separated by ';'
+    const char* actions;
+    const char* state;
+  };
+
+  std::vector<std::string> split(const std::string& events) {
+    std::vector<std::string> parts;
+    std::istringstream in(events);
+    std::string part;
+    while (std::getline(in, part, ';')) {
+      parts.push_back(part);
+    }
+    return parts;
+  }
+
+  const Case CASES[] = {
+    {"a new goal preempts the current one", LATEST_WINS, 1, 10, 10,
+     "goal a 0 1; goal b 0 2",
+     "ACCEPT a, START a 1, ACCEPT b, STOP a, CANCEL a, START b 2",
+     "active [b] pending [] paused []"},
+    {"an older goal is canceled", LATEST_WINS, 1, 10, 10,
+     "goal a 0 2; goal b 0 1",
+     "ACCEPT a, START a 1, CANCEL b",
+     "active [a] pending [] paused []"},
+    {"priorities don't matter to the latest goal", LATEST_WINS, 1, 10, 10,
+     "goal a 5 1; goal b 0 2",
+     "ACCEPT a, START a 1, ACCEPT b, STOP a, CANCEL a, START b 2",
+     "active [b] pending [] paused []"},
+    {"interrupting a goal and resuming it", LATEST_WINS, 1, 10, 10,
+     "goal a 0 1; pause; goal b 0 2; resume",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, STOP b, CANCEL b, START a 3",
+     "active [a] pending [] paused []"},
+    {"interrupting the interruption", LATEST_WINS, 1, 10, 10,
+     "goal a 0 1; pause; goal b 0 2; pause; goal c 0 3; resume; resume; done 5 succeeded",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, STOP b, ACCEPT c, START c 3, STOP c, CANCEL c, START b 4, "
+     "STOP b, CANCEL b, START a 5, SUCCEED a",
+     "active [] pending [] paused []"},
+    {"canceling a paused goal cancels what interrupted it", LATEST_WINS, 1, 10, 10,
+     "goal a 0 1; pause; goal b 0 2; pause; goal c 0 3; cancel a",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, STOP b, ACCEPT c, START c 3, STOP c, CANCEL c, CANCEL b, "
+     "CANCEL a",
+     "active [] pending [] paused []"},
+    {"canceling a paused goal leaves the goals paused before it", LATEST_WINS, 1, 10, 10,
+     "goal a 0 1; pause; goal b 0 2; pause; goal c 0 3; cancel b; resume",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, STOP b, ACCEPT c, START c 3, STOP c, CANCEL c, CANCEL b, "
+     "START a 4",
+     "active [a] pending [] paused []"},
+    {"nothing to pause or resume", LATEST_WINS, 1, 10, 10,
+     "pause; resume; goal a 0 1; done 1 succeeded; pause",
+     "pause refused, resume refused, ACCEPT a, START a 1, SUCCEED a, pause refused",
+     "active [] pending [] paused []"},
+    {"the pause stack is bounded", LATEST_WINS, 1, 10, 1,
+     "goal a 0 1; pause; goal b 0 2; pause",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, pause refused",
+     "active [b] pending [] paused [a]"},
+    {"failed runs are retried", LATEST_WINS, 3, 10, 10,
+     "goal a 0 1; done 1 failed; done 2 failed; done 3 failed",
+     "ACCEPT a, START a 1, START a 2, START a 3, ABORT a",
+     "active [] pending [] paused []"},
+    {"retries start again after resuming", LATEST_WINS, 2, 10, 10,
+     "goal a 0 1; done 1 failed; pause; resume; done 3 failed; done 4 canceled",
+     "ACCEPT a, START a 1, START a 2, STOP a, START a 3, START a 4, CANCEL a",
+     "active [] pending [] paused []"},
+    {"results of stopped runs are ignored", LATEST_WINS, 1, 10, 10,
+     "goal a 0 1; goal b 0 2; done 1 succeeded; pause; done 2 succeeded",
+     "ACCEPT a, START a 1, ACCEPT b, STOP a, CANCEL a, START b 2, STOP b",
+     "active [] pending [] paused [b]"},
+    {"goals wait their turn", FIFO, 1, 10, 10,
+     "goal a 5 1; goal b 0 2; goal c 9 3; done 1 succeeded; done 2 failed",
+     "ACCEPT a, START a 1, SUCCEED a, ACCEPT b, START b 2, ABORT b, ACCEPT c, START c 3",
+     "active [c] pending [] paused []"},
+    {"the queue is bounded", FIFO, 1, 2, 10,
+     "goal a 0 1; goal b 0 2; goal c 0 3; goal d 0 4",
+     "ACCEPT a, START a 1, CANCEL d",
+     "active [a] pending [b c] paused []"},
+    {"pausing moves on to the next goal", FIFO, 1, 10, 10,
+     "goal a 0 1; goal b 0 2; goal c 0 3; pause; resume",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, STOP b, CANCEL b, START a 3",
+     "active [a] pending [c] paused []"},
+    {"canceling waiting and active goals", FIFO, 1, 10, 10,
+     "goal a 0 1; goal b 0 2; goal c 0 3; cancel b; cancel a; cancel z",
+     "ACCEPT a, START a 1, CANCEL b, STOP a, CANCEL a, ACCEPT c, START c 2",
+     "active [c] pending [] paused []"},
+    {"higher priorities preempt", PRIORITY, 1, 10, 10,
+     "goal a 1 1; goal b 0 2; goal c 1 3; goal d 2 4; goal e 1 5",
+     "ACCEPT a, START a 1, ACCEPT d, STOP a, CANCEL a, START d 2",
+     "active [d] pending [c e b] paused []"},
+    {"waiting goals go by priority", PRIORITY, 1, 10, 10,
+     "goal a 1 1; goal b 0 2; goal c 1 3; done 1 succeeded; done 2 canceled",
+     "ACCEPT a, START a 1, SUCCEED a, ACCEPT c, START c 2, CANCEL c, ACCEPT b, START b 3",
+     "active [b] pending [] paused []"},
+    {"the lowest priority goal is dropped from a full queue", PRIORITY, 1, 2, 10,
+     "goal a 5 1; goal b 0 2; goal c 1 3; goal d 2 4; goal e 0 5",
+     "ACCEPT a, START a 1, CANCEL b, CANCEL e",
+     "active [a] pending [d c] paused []"},
+    {"resuming beats priorities", PRIORITY, 1, 10, 10,
+     "goal a 0 1; pause; goal b 9 2; resume",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, STOP b, CANCEL b, START a 3",
+     "active [a] pending [] paused []"},
+    {"shutting down cancels everything", PRIORITY, 1, 10, 10,
+     "goal a 0 1; pause; goal b 0 2; goal c 0 3; shutdown",
+     "ACCEPT a, START a 1, STOP a, ACCEPT b, START b 2, STOP b, CANCEL b, CANCEL c, CANCEL a",
+     "active [] pending [] paused []"},
+  };
+
+} /* namespace */
+
+TEST(GoalScheduler, Cases) {
+  for (size_t i = 0; i < sizeof(CASES) / sizeof(CASES[0]); ++i) {
+    const Case& c = CASES[i];
+    SCOPED_TRACE(c.name);
+    Scheduler scheduler(c.policy, c.max_attempts, c.max_pending_goals, c.max_paused_goals);
+    EXPECT_EQ(c.actions, run(scheduler, split(c.events)));
+    EXPECT_EQ(c.state, describeState(scheduler));
+  }
+}
+
+namespace {
+
+  // What the action server and the low level client see of the actions, with the rules they have to follow.
+  struct Model {
+    enum Status { WAITING, ACCEPTED, FINISHED };
+    std::map<std::string, Status> status;
+    std::map<std::string, int> priority;
+    std::map<std::string, int> arrival;
+    std::string running;  // on the low level server, empty if nothing is
+    uint64_t last_run;
+
+    Model() : last_run(0) {}
+
+    // finished is the goal whose run just ended, if any
+    ::testing::AssertionResult apply(const Scheduler::Actions& actions, const std::string& finished) {
+      for (size_t i = 0; i < actions.size(); ++i) {
+        const Scheduler::Action& action = actions[i];
+        const std::string& goal = action.goal;
+        if (status.count(goal) == 0 || status[goal] == FINISHED) {
+          return ::testing::AssertionFailure() << ACTION_NAMES[action.type] << " for unknown or finished " << goal;
+        }
+        switch (action.type) {
+          case Scheduler::Action::ACCEPT:
+            if (status[goal] != WAITING) {
+              return ::testing::AssertionFailure() << "accepted " << goal << " twice";
+            }
+            status[goal] = ACCEPTED;
+            break;
+          case Scheduler::Action::START:
+            if (status[goal] != ACCEPTED || !running.empty() || action.run <= last_run) {
+              return ::testing::AssertionFailure() << "bad start of " << goal << " while running " << running;
+            }
+            running = goal;
+            last_run = action.run;
+            break;
+          case Scheduler::Action::STOP:
+            if (running != goal) {
+              return ::testing::AssertionFailure() << "stopped " << goal << " while running " << running;
+            }
+            running.clear();
+            break;
+          case Scheduler::Action::SUCCEED:
+          case Scheduler::Action::ABORT:
+            if (goal != finished) {
+              return ::testing::AssertionFailure() << ACTION_NAMES[action.type] << " for " << goal << " out of turn";
+            }
+            status[goal] = FINISHED;
+            break;
+          case Scheduler::Action::CANCEL:
+            if (running == goal) {
+              return ::testing::AssertionFailure() << "canceled " << goal << " while it is running";
+            }
+            status[goal] = FINISHED;
+            break;
+        }
+      }
+      return ::testing::AssertionSuccess();
+    }
+
+    ::testing::AssertionResult check(const Scheduler& scheduler, PreemptionPolicy policy,
+                                     size_t max_pending_goals, size_t max_paused_goals) {
+      std::string active;
+      bool has_active = scheduler.getActive(active);
+      std::vector<std::string> pending = scheduler.getPending();
+      std::vector<std::string> paused = scheduler.getPaused();
+
+      if (has_active != !running.empty() || (has_active && (active != running || scheduler.getRun() != last_run))) {
+        return ::testing::AssertionFailure() << "active " << active << " but running " << running;
+      }
+      if (!has_active && !pending.empty()) {
+        return ::testing::AssertionFailure() << "goals wait while nothing is active";
+      }
+      if (pending.size() > max_pending_goals || paused.size() > max_paused_goals) {
+        return ::testing::AssertionFailure() << "bounds exceeded";
+      }
+
+      std::set<std::string> held(pending.begin(), pending.end());
+      held.insert(paused.begin(), paused.end());
+      if (has_active) {
+        held.insert(active);
+      }
+      if (held.size() != pending.size() + paused.size() + has_active) {
+        return ::testing::AssertionFailure() << "a goal is held twice";
+      }
+      for (std::map<std::string, Status>::const_iterator it = status.begin(); it != status.end(); ++it) {
+        if ((it->second != FINISHED) != (held.count(it->first) > 0)) {
+          return ::testing::AssertionFailure() << it->first << " is lost, or held after it finished";
+        }
+      }
+      for (size_t i = 0; i < pending.size(); ++i) {
+        if (status[pending[i]] != WAITING) {
+          return ::testing::AssertionFailure() << "pending " << pending[i] << " was accepted";
+        }
+        if (i > 0) {
+          bool by_priority = policy == PRIORITY && priority[pending[i - 1]] != priority[pending[i]];
+          bool ordered = by_priority ? priority[pending[i - 1]] > priority[pending[i]] :
+            arrival[pending[i - 1]] < arrival[pending[i]];
+          if (!ordered) {
+            return ::testing::AssertionFailure() << "pending goals out of order";
+          }
+        }
+      }
+      return ::testing::AssertionSuccess();
+    }
+  };
+
+  enum Event {
+    NEW_GOAL, NEW_URGENT_GOAL, NEW_OLD_GOAL, CANCEL_ACTIVE, CANCEL_NEXT, CANCEL_TOP_PAUSED, CANCEL_BOTTOM_PAUSED,
+    PAUSE, RESUME, SUCCEED, FAIL, LOW_LEVEL_CANCEL, STALE_RESULT, NUM_EVENTS
+  };
+
+  struct Explorer {
+    PreemptionPolicy policy;
+    size_t max_pending_goals;
+    size_t max_paused_goals;
+    int max_depth;
+    size_t num_sequences;
+
+    void explore(const Scheduler& scheduler, const Model& model, int depth, int num_goals,
+                 std::vector<int>& events) {
+      ++num_sequences;
+      if (depth == max_depth) {
+        return;
+      }
+      for (int event = 0; event < NUM_EVENTS; ++event) {
+        Scheduler next = scheduler;
+        Model next_model = model;
+        Scheduler::Actions actions;
+        std::string finished;
+        std::string active;
+        next.getActive(active);
+        std::vector<std::string> pending = next.getPending();
+        std::vector<std::string> paused = next.getPaused();
+        int next_num_goals = num_goals;
+
+        if (event == NEW_GOAL || event == NEW_URGENT_GOAL || event == NEW_OLD_GOAL) {
+          std::ostringstream name;
+          name << "g" << next_num_goals++;
+          next_model.status[name.str()] = Model::WAITING;
+          next_model.priority[name.str()] = (event == NEW_URGENT_GOAL) ? 1 : 0;
+          next_model.arrival[name.str()] = next_num_goals;
+          next.goal(name.str(), next_model.priority[name.str()], (event == NEW_OLD_GOAL) ? 0 : next_num_goals,
+                    actions);
+        } else if (event == CANCEL_ACTIVE) {
+          next.cancel(active, actions);
+        } else if (event == CANCEL_NEXT && !pending.empty()) {
+          next.cancel(pending.front(), actions);
+        } else if (event == CANCEL_TOP_PAUSED && !paused.empty()) {
+          next.cancel(paused.back(), actions);
+        } else if (event == CANCEL_BOTTOM_PAUSED && !paused.empty()) {
+          next.cancel(paused.front(), actions);
+        } else if (event == PAUSE) {
+          next.pause(actions);
+        } else if (event == RESUME) {
+          next.resume(actions);
+        } else if (event == SUCCEED || event == FAIL || event == LOW_LEVEL_CANCEL) {
+          if (active.empty()) {
+            continue;
+          }
+          // The low level run ends by itself.
+          finished = active;
+          next_model.running.clear();
+          next.done(next.getRun(), (event == SUCCEED) ? Scheduler::SUCCEEDED :
+                    (event == FAIL) ? Scheduler::FAILED : Scheduler::CANCELED, actions);
+        } else if (event == STALE_RESULT) {
+          next.done(next.getRun() - 1, Scheduler::SUCCEEDED, actions);
+          if (!actions.empty()) {
+            ADD_FAILURE() << "acted on a stale result";
+          }
+        } else {
+          continue;
+        }
+
+        events.push_back(event);
+        ::testing::AssertionResult applied = next_model.apply(actions, finished);
+        ::testing::AssertionResult checked = applied ?
+          next_model.check(next, policy, max_pending_goals, max_paused_goals) : applied;
+        if (!checked) {
+          std::ostringstream sequence;
+          for (size_t i = 0; i < events.size(); ++i) {
+            sequence << events[i] << " ";
+          }
+          ADD_FAILURE() << "policy " << policy << ", events " << sequence.str() << ": " << checked.message();
+          events.pop_back();
+          return;
+        }
+        explore(next, next_model, depth + 1, next_num_goals, events);
+        events.pop_back();
+      }
+    }
+  };
+
+} /* namespace */
+
+// Every sequence of events up to a few events long, with small bounds so that they are reached.
+TEST(GoalScheduler, AllShortSequencesKeepTheInvariants) {
+  PreemptionPolicy policies[] = {LATEST_WINS, PRIORITY, FIFO};
+  for (int p = 0; p < 3; ++p) {
+    Explorer explorer = {policies[p], 2, 2, 6, 0};
+    std::vector<int> events;
+    explorer.explore(Scheduler(policies[p], 2, 2, 2), Model(), 0, 0, events);
+    EXPECT_GT(explorer.num_sequences, 100000u);
+    if (HasFailure()) {
+      break;
+    }
+  }
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -150,7 +150,7 @@ int main() {
 
     cout << "Plan" << endl;
 
-    list<unique_ptr<Action>> plan = sets[i].instantiateActions(actionMap);
+    ActionPlan plan = sets[i].instantiateActions(actionMap);
     auto pIt = plan.begin();
 
     for (int t = 1; pIt != plan.end(); ++pIt, ++t)
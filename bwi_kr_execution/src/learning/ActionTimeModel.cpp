@@ -0,0 +1,175 @@
+#include "ActionTimeModel.h"
+
+#include <ros/console.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+using namespace actasp;
+
+namespace plan_exec {
+
+const double DurationStatistics::FIRST_BUCKET = 0.1;
+
+DurationStatistics::DurationStatistics() : count(0), mean(0.), m2(0.), min(0.), max(0.) {
+  fill(buckets, buckets + NUM_BUCKETS, 0);
+}
+
+unsigned int DurationStatistics::bucketOf(double seconds) {
+  if (seconds <= FIRST_BUCKET)
+    return 0;
+
+  double index = ceil(BUCKETS_PER_OCTAVE * log2(seconds / FIRST_BUCKET));
+
+  return std::min(static_cast<unsigned int>(index), NUM_BUCKETS - 1);
+}
+
+void DurationStatistics::add(double seconds) {
+
+  if (count == 0) {
+    min = seconds;
+    max = seconds;
+  } else {
+    min = std::min(min, seconds);
+    max = std::max(max, seconds);
+  }
+
+  ++count;
+  double delta = seconds - mean;
+  mean += delta / count;
+  m2 += delta * (seconds - mean);
+
+  ++buckets[bucketOf(seconds)];
+}
+
+double DurationStatistics::variance() const {
+  return (count > 1) ? m2 / (count - 1) : 0.;
+}
+
+double DurationStatistics::quantile(double q) const {
+  if (count == 0)
+    return 0.;
+
+  unsigned long rank = static_cast<unsigned long>(ceil(q * count));
+  unsigned long seen = 0;
+
+  for (unsigned int i = 0; i < NUM_BUCKETS; ++i) {
+    seen += buckets[i];
+    if (seen >= rank && seen > 0) {
+      //upper bound of the bucket, which never exceeds the largest sample
+      double upper = FIRST_BUCKET * pow(2., static_cast<double>(i) / BUCKETS_PER_OCTAVE);
+      return std::max(min, std::min(max, upper));
+    }
+  }
+
+  return max;
+}
+
+void ActionTimeModel::addSample(const AspFluent &action, double seconds) {
+  AspFluent key(action);
+  key.setTimeStep(0);
+  stats[key].add(seconds);
+}
+
+const DurationStatistics *ActionTimeModel::statistics(const AspFluent &action) const {
+  StatisticsMap::const_iterator element = stats.find(action);
+
+  return (element == stats.end()) ? NULL : &(element->second);
+}
+
+double ActionTimeModel::expectedTime(const AspFluent &action, double defaultTime) const {
+  const DurationStatistics *s = statistics(action);
+
+  return (s == NULL || s->count == 0) ? defaultTime : s->mean;
+}
+
+void ActionTimeModel::actionStarted(const AspFluent &action) noexcept {
+  startingTimes[action] = ros::Time::now();
+}
+
+void ActionTimeModel::actionTerminated(const AspFluent &action, bool succeeded) noexcept {
+
+  auto element = startingTimes.find(action);
+
+  if (element == startingTimes.end())
+    return;
+
+  //a failed action says little about how long the action takes when it works
+  if (succeeded)
+    addSample(action, (ros::Time::now() - element->second).toSec());
+
+  startingTimes.erase(element);
+}
+
+void ActionTimeModel::readFrom(std::istream &fromStream) {
+
+  stats.clear();
+
+  string line;
+  while (getline(fromStream, line)) {
+
+    if (line.empty())
+      continue;
+
+    stringstream lineStream(line);
+    string fluentString;
+    DurationStatistics s;
+
+    lineStream >> fluentString >> s.count >> s.mean >> s.m2 >> s.min >> s.max;
+
+    unsigned int index, bucketCount;
+    char separator;
+    while (lineStream >> index >> separator >> bucketCount) {
+      if (index < DurationStatistics::NUM_BUCKETS)
+        s.buckets[index] = bucketCount;
+    }
+
+    try {
+      stats[AspFluent(fluentString)] = s;
+    } catch (std::invalid_argument &e) {
+      ROS_WARN_STREAM("ActionTimeModel: skipping malformed line: " << line);
+    }
+  }
+}
+
+void ActionTimeModel::writeTo(std::ostream &toStream) const {
+
+  StatisticsMap::const_iterator statIt = stats.begin();
+  for (; statIt != stats.end(); ++statIt) {
+    const DurationStatistics &s = statIt->second;
+
+    toStream << setprecision(10) << statIt->first.toString(0) << " " << s.count << " " << s.mean << " " << s.m2 << " "
+             << s.min << " " << s.max;
+
+    for (unsigned int i = 0; i < DurationStatistics::NUM_BUCKETS; ++i)
+      if (s.buckets[i] > 0)
+        toStream << " " << i << ":" << s.buckets[i];
+
+    toStream << endl;
+  }
+}
+
+void ActionTimeModel::writeAspCosts(std::ostream &toStream, const std::string &predicate) const {
+
+  toStream << "#program base." << endl;
+
+  StatisticsMap::const_iterator statIt = stats.begin();
+  for (; statIt != stats.end(); ++statIt) {
+
+    vector<string> params = statIt->first.getParameters();
+
+    toStream << predicate << "(" << statIt->first.getName();
+    if (!params.empty()) {
+      toStream << "(";
+      for (int i = 0, size = params.size(); i < size; ++i)
+        toStream << params[i] << ((i < size - 1) ? "," : ")");
+    }
+    toStream << "," << static_cast<long>(ceil(statIt->second.mean)) << ")." << endl;
+  }
+}
+
+}
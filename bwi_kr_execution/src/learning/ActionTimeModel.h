@@ -0,0 +1,98 @@
+#ifndef plan_exec_ActionTimeModel_h__guard
+#define plan_exec_ActionTimeModel_h__guard
+
+#include "actasp/ExecutionObserver.h"
+#include "actasp/AspFluent.h"
+
+#include <ros/time.h>
+
+#include <unordered_map>
+#include <istream>
+#include <ostream>
+#include <string>
+
+namespace plan_exec {
+
+//Streaming statistics of the duration of one ground action.
+//Mean and variance are kept with Welford's update, quantiles are
+//approximated with a histogram of logarithmically spaced buckets, so
+//every sample is O(1) in time and the memory is fixed.
+struct DurationStatistics {
+
+  static const unsigned int NUM_BUCKETS = 64;
+  static const unsigned int BUCKETS_PER_OCTAVE = 4;
+  static const double FIRST_BUCKET; //upper bound of the first bucket, in seconds
+
+  DurationStatistics();
+
+  void add(double seconds);
+
+  double variance() const;
+
+  //value below which a fraction q of the samples falls, q in [0,1]
+  double quantile(double q) const;
+
+  static unsigned int bucketOf(double seconds);
+
+  unsigned long count;
+  double mean;
+  double m2;
+  double min;
+  double max;
+  unsigned int buckets[NUM_BUCKETS];
+};
+
+//Learns how long each ground action (name and parameters, time step ignored)
+//takes by observing the executor. It replaces re-reading the files written
+//by ActionLogger: DefaultTimes, TimeReward and the planner query the same
+//in-memory store.
+class ActionTimeModel : public actasp::ExecutionObserver {
+public:
+
+  typedef std::unordered_map<actasp::AspFluent, DurationStatistics,
+                             actasp::ActionHash, actasp::ActionEquality> StatisticsMap;
+
+  void addSample(const actasp::AspFluent &action, double seconds);
+
+  //NULL if the action has never been observed
+  const DurationStatistics *statistics(const actasp::AspFluent &action) const;
+
+  //mean duration of the action, or defaultTime if it has never been observed
+  double expectedTime(const actasp::AspFluent &action, double defaultTime) const;
+
+  const StatisticsMap &allStatistics() const {
+    return stats;
+  }
+
+  void actionStarted(const actasp::AspFluent &action) noexcept;
+  void actionTerminated(const actasp::AspFluent &action, bool succeeded) noexcept;
+
+  void planTerminated(const PlanStatus status, const actasp::AspFluent &final_action,
+                      const actasp::AnswerSet &plan_remainder) noexcept {}
+  void goalChanged(const std::vector<actasp::AspRule> &newGoalRules) noexcept {}
+  void policyChanged(actasp::PartialPolicy *policy) noexcept {}
+
+  //one line per action: the action, count, mean, m2, min, max, and the non empty buckets as index:count
+  void readFrom(std::istream &fromStream);
+  void writeTo(std::ostream &toStream) const;
+
+  //writes a fact predicate(action,seconds) for each known action, with the mean rounded up to an
+  //integer so that clingo can use it in a #minimize statement such as
+  //  #minimize{ T@1,I : approach(D,I), action_time(approach(D),T) }.
+  //This is an export only: no query loads the file. The copy files of a query generator go into
+  //every query, and a #minimize there would make clingo report only improving plans instead of
+  //enumerating them.
+  void writeAspCosts(std::ostream &toStream, const std::string &predicate = "action_time") const;
+
+  virtual ~ActionTimeModel() {}
+
+private:
+
+  StatisticsMap stats;
+  std::unordered_map<actasp::AspFluent, ros::Time,
+                     actasp::ActionHash, actasp::ActionEquality> startingTimes;
+};
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 #include <actasp/AspFluent.h>
 
 #include "DefaultTimes.h"
+#include "ActionTimeModel.h"
 
 #include <iostream>
 
@@ -10,6 +11,12 @@ using namespace actasp;
 namespace plan_exec {
  
 double DefaultTimes::value(const AspFluent& action) {
+
+  if(model != NULL) {
+    const DurationStatistics *stats = model->statistics(action);
+    if(stats != NULL && stats->count > 0)
+      return -stats->mean;
+  }
   
   if(action.getName() == "approach")
     return -1;
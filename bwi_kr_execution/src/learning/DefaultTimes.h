@@ -7,9 +7,17 @@
 
 namespace plan_exec {
 
+class ActionTimeModel;
+
 struct DefaultTimes : public DefaultActionValue {
+
+  //if a model is given, actions it has observed are valued with their mean duration
+  DefaultTimes(const ActionTimeModel *model = NULL) : model(model) {}
   
   virtual double value(const actasp::AspFluent &action);
+
+private:
+  const ActionTimeModel *model;
   
 };
 
@@ -5,6 +5,7 @@
 #include "actasp/AspFluent.h"
 
 #include "RewardFunction.h"
+#include "ActionTimeModel.h"
 
 #include <map>
 
@@ -19,12 +20,16 @@ namespace plan_exec {
 template <typename State>
 class TimeReward : public RewardFunction<State>, public actasp::ExecutionObserver {
 public:
+
+  //the model, if any, provides the expected reward of actions whose start was not observed
+  TimeReward(const ActionTimeModel *model = NULL) : model(model) {}
+
   double r(const State &, const actasp::AspFluent &action, const State &) const throw() {
         
     std::map<actasp::AspFluent, ros::Time>::const_iterator element = startingTimes.find(action);
     
     if(element == startingTimes.end())
-      return 0;
+      return (model != NULL)? -model->expectedTime(action,0.) : 0;
     
     double reward = ros::Duration(ros::Time::now() -  element->second).toSec();
     
@@ -53,6 +58,7 @@ public:
   virtual ~TimeReward() {}  
 private:
   std::map<actasp::AspFluent, ros::Time, actasp::ActionComparator> startingTimes;
+  const ActionTimeModel *model;
 };
 
 }
@@ -5,6 +5,7 @@
 #include "learning/TimeReward.h"
 #include "learning/DefaultTimes.h"
 #include "learning/ActionLogger.h"
+#include "learning/ActionTimeModel.h"
 
 #include "plan_execution/ExecutePlanAction.h"
 
@@ -44,6 +45,7 @@ typedef actionlib::SimpleActionServer<plan_execution::ExecutePlanAction> Server;
 PlanExecutor *executor;
 SarsaActionSelector *selector;
 ActionLogger *action_logger;
+ActionTimeModel *time_model;
 
 struct PrintFluent {
 
@@ -131,6 +133,15 @@ void completeTask(const string& valueFileName, const ros::Time& begin, const str
   
   action_logger->taskCompleted();
 
+  ofstream timeModelOut((valueDirectory + "action_times").c_str());
+  time_model->writeTo(timeModelOut);
+  timeModelOut.close();
+
+  //for inspection and offline planning, the executor's own queries don't load it
+  ofstream timeCostsOut((valueDirectory + "action_times.asp").c_str());
+  time_model->writeAspCosts(timeCostsOut);
+  timeCostsOut.close();
+
   ofstream valueFileOut(valueFileName.c_str());
   selector->writeTo(valueFileOut);
   valueFileOut.close();
@@ -249,8 +260,13 @@ int main(int argc, char**argv) {
   
   FilteringQueryGenerator *reasoner = Clingo::getQueryGenerator("n",queryDirectory,domainDirectory,actionMapToSet(ActionFactory::actions()),20);
 
-  TimeReward<SarsaActionSelector::State> *reward = new TimeReward<SarsaActionSelector::State>();
-  DefaultActionValue *timeValue = new DefaultTimes();
+  time_model = new ActionTimeModel();
+  ifstream timeModelIn((valueDirectory + "action_times").c_str());
+  time_model->readFrom(timeModelIn);
+  timeModelIn.close();
+
+  TimeReward<SarsaActionSelector::State> *reward = new TimeReward<SarsaActionSelector::State>(time_model);
+  DefaultActionValue *timeValue = new DefaultTimes(time_model);
 
   SarsaParams params;
   params.alpha = 0.2;
@@ -275,6 +291,7 @@ int main(int argc, char**argv) {
   
   action_logger = new ActionLogger();
   executor->addExecutionObserver(action_logger);
+  executor->addExecutionObserver(time_model);
 
   Server server(privateNode, "execute_plan", boost::bind(&executePlan, _1, &server), false);
   server.start();
@@ -285,6 +302,7 @@ int main(int argc, char**argv) {
 
   delete executor;
   delete action_logger;
+  delete time_model;
   delete selector;
   delete timeValue;
   delete reward;
@@ -0,0 +1,103 @@
+#include "../src/learning/ActionTimeModel.h"
+#include "../src/learning/DefaultTimes.h"
+#include <gtest/gtest.h>
+
+#include <actasp/AspFluent.h>
+
+#include <sstream>
+#include <string>
+
+using namespace actasp;
+using namespace plan_exec;
+
+TEST(DurationStatistics, MeanAndVariance) {
+  DurationStatistics s;
+  s.add(1.);
+  s.add(2.);
+  s.add(3.);
+  s.add(4.);
+  EXPECT_EQ(4u, s.count);
+  EXPECT_DOUBLE_EQ(2.5, s.mean);
+  EXPECT_NEAR(5. / 3., s.variance(), 1e-12);
+  EXPECT_DOUBLE_EQ(1., s.min);
+  EXPECT_DOUBLE_EQ(4., s.max);
+}
+
+TEST(DurationStatistics, QuantilesStayWithinTheSamples) {
+  DurationStatistics s;
+  for (int i = 1; i <= 100; ++i) {
+    s.add(i * 0.5);
+  }
+  // buckets are a quarter octave wide, so a quantile is off by at most a factor of 2^(1/4)
+  EXPECT_GE(s.quantile(0.), 0.5);
+  EXPECT_LE(s.quantile(0.), 0.5 * 1.19);
+  EXPECT_DOUBLE_EQ(50., s.quantile(1.));
+  EXPECT_GE(s.quantile(0.5), 25.);
+  EXPECT_LE(s.quantile(0.5), 25. * 1.19);
+  EXPECT_LE(s.quantile(0.5), s.quantile(0.9));
+}
+
+TEST(ActionTimeModel, LookupsIgnoreTheTimeStep) {
+  ActionTimeModel model;
+  model.addSample(AspFluent("navigate_to(l3_414,1)"), 8.);
+  model.addSample(AspFluent("navigate_to(l3_414,4)"), 12.);
+
+  EXPECT_DOUBLE_EQ(10., model.expectedTime(AspFluent("navigate_to(l3_414,7)"), 3.));
+  EXPECT_DOUBLE_EQ(3., model.expectedTime(AspFluent("navigate_to(l3_500,7)"), 3.));
+  ASSERT_TRUE(model.statistics(AspFluent("navigate_to(l3_414,0)")) != NULL);
+  EXPECT_EQ(2u, model.statistics(AspFluent("navigate_to(l3_414,0)"))->count);
+  EXPECT_TRUE(model.statistics(AspFluent("approach(d3_414a1,0)")) == NULL);
+}
+
+TEST(DefaultTimes, PrefersObservedDurations) {
+  ActionTimeModel model;
+  model.addSample(AspFluent("approach(d3_414a1,1)"), 20.);
+
+  DefaultTimes withModel(&model);
+  EXPECT_DOUBLE_EQ(-20., withModel.value(AspFluent("approach(d3_414a1,3)")));
+  EXPECT_DOUBLE_EQ(-1., withModel.value(AspFluent("approach(d3_414a2,3)")));
+  EXPECT_DOUBLE_EQ(0., withModel.value(AspFluent("gothrough(d3_414a1,3)")));
+
+  DefaultTimes withoutModel;
+  EXPECT_DOUBLE_EQ(-1., withoutModel.value(AspFluent("approach(d3_414a1,3)")));
+}
+
+TEST(ActionTimeModel, ReadsBackWhatItWrites) {
+  ActionTimeModel model;
+  model.addSample(AspFluent("approach(d3_414a1,1)"), 2.);
+  model.addSample(AspFluent("approach(d3_414a1,2)"), 7.5);
+  model.addSample(AspFluent("gothrough(d3_414a1,3)"), 4.25);
+
+  std::stringstream stream;
+  model.writeTo(stream);
+  ActionTimeModel read;
+  read.readFrom(stream);
+
+  ASSERT_EQ(2u, read.allStatistics().size());
+  const DurationStatistics *original = model.statistics(AspFluent("approach(d3_414a1,0)"));
+  const DurationStatistics *copy = read.statistics(AspFluent("approach(d3_414a1,0)"));
+  ASSERT_TRUE(copy != NULL);
+  EXPECT_EQ(original->count, copy->count);
+  EXPECT_DOUBLE_EQ(original->mean, copy->mean);
+  EXPECT_DOUBLE_EQ(original->variance(), copy->variance());
+  EXPECT_DOUBLE_EQ(original->quantile(0.5), copy->quantile(0.5));
+  EXPECT_DOUBLE_EQ(4.25, read.expectedTime(AspFluent("gothrough(d3_414a1,0)"), 0.));
+}
+
+TEST(ActionTimeModel, WritesRoundedUpCostFacts) {
+  ActionTimeModel model;
+  model.addSample(AspFluent("approach(d3_414a1,1)"), 9.2);
+
+  std::stringstream stream;
+  model.writeAspCosts(stream);
+  EXPECT_EQ("#program base.\naction_time(approach(d3_414a1),10).\n", stream.str());
+
+  std::stringstream renamed;
+  model.writeAspCosts(renamed, "cost");
+  EXPECT_NE(std::string::npos, renamed.str().find("cost(approach(d3_414a1),10)."));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
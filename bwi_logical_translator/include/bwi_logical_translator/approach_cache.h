@@ -0,0 +1,142 @@
+/**
+ * \file  approach_cache.h
+ * \brief  Precomputed answers to "which approach point of this door can I reach, and which one is closer" and
+ *         "can I reach this object" for every cell of the map, stored compactly and cached on disk.
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+#ifndef BWI_LOGICAL_TRANSLATOR_APPROACH_CACHE_H
+#define BWI_LOGICAL_TRANSLATOR_APPROACH_CACHE_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <bwi_mapper/structures/point.h>
+#include <nav_msgs/OccupancyGrid.h>
+
+namespace bwi_logical_translator {
+
+  /**
+   * \class ApproachCache
+   * \brief Replaces the per door and per object bwi_mapper::PathFinder wavefronts with shared data that gives the
+   *        same answers.
+   *
+   * A cell can reach a target exactly when both lie in the same 4-connected component of free space, so a single
+   * component labelling of the map answers every reachability query. The only distance comparison ever made is
+   * which of a door's two approach points is closer, and that only matters where both are reachable. It is stored
+   * as one bit per cell, run length encoded as the sorted flat indices where the bit flips, which stays small
+   * because the boundary between the two sides is short.
+   */
+  class ApproachCache {
+
+    public:
+
+      static const uint32_t VERSION;
+      static const int NOT_APPROACHABLE;
+
+      /** \brief what the cache was built from. A cache on disk is only used if all of these match. */
+      struct Key {
+        uint64_t map_hash;
+        uint64_t doors_hash;
+        uint64_t objects_hash;
+
+        Key() : map_hash(0), doors_hash(0), objects_hash(0) {}
+        bool operator==(const Key& other) const {
+          return map_hash == other.map_hash && doors_hash == other.doors_hash && objects_hash == other.objects_hash;
+        }
+      };
+
+      ApproachCache();
+
+      /**
+       * \brief Computes the tables for the given targets. Cells with a value of 100 are obstacles, just as in
+       *        PathFinder.
+       * \param doors  the grid cells of approach points 0 and 1 of each door.
+       * \param objects  the grid cell of the approach pose of each object.
+       */
+      void build(const nav_msgs::OccupancyGrid& map,
+                 const std::map<std::string, std::pair<bwi_mapper::Point2d, bwi_mapper::Point2d> >& doors,
+                 const std::map<std::string, bwi_mapper::Point2d>& objects);
+
+      /** \brief writes the tables, replacing the file atomically. */
+      bool save(const std::string& filename, const Key& key) const;
+
+      /** \brief reads tables written by save, failing if the file is missing, damaged, or built from other data. */
+      bool load(const std::string& filename, const Key& key);
+
+      inline bool hasDoor(const std::string& door_name) const {
+        return doors_.find(door_name) != doors_.end();
+      }
+
+      inline bool hasObject(const std::string& object_name) const {
+        return objects_.find(object_name) != objects_.end();
+      }
+
+      /**
+       * \brief which approach point of the door BwiLogicalTranslator::getApproachPoint picks from the given cell: the
+       *        reachable one, or the closer one if both are (point 1 on a tie), or NOT_APPROACHABLE.
+       */
+      int getApproachPointIdx(const std::string& door_name, const bwi_mapper::Point2d& pt) const;
+
+      bool isObjectApproachable(const std::string& object_name, const bwi_mapper::Point2d& pt) const;
+
+      /** \brief FNV-1a, for building keys */
+      static uint64_t hash(const void* data, size_t size, uint64_t seed = 14695981039346656037ULL);
+      static uint64_t hashMap(const nav_msgs::OccupancyGrid& map);
+      /** \brief hashes the file contents. A missing file hashes like an empty one. */
+      static uint64_t hashFile(const std::string& filename);
+
+    private:
+
+      struct DoorEntry {
+        int32_t approach_idx[2];
+        /** \brief flat indices where "approach point 0 is strictly closer" flips, starting from false */
+        std::vector<uint32_t> closer_to_0_flips;
+      };
+
+      int32_t getComponent(const bwi_mapper::Point2d& pt) const;
+      int32_t getComponent(int32_t idx) const;
+      void labelComponents(const nav_msgs::OccupancyGrid& map);
+      void computeDistances(int32_t start_idx, std::vector<int32_t>& distances, std::vector<int32_t>& queue) const;
+
+      uint32_t width_;
+      uint32_t height_;
+      /** \brief free space component of every cell, -1 for obstacles */
+      std::vector<int32_t> components_;
+      std::map<std::string, DoorEntry> doors_;
+      std::map<std::string, int32_t> objects_;
+
+  }; /* ApproachCache */
+
+} /* bwi_logical_translator */
+
+#endif /* end of include guard: BWI_LOGICAL_TRANSLATOR_APPROACH_CACHE_H */
@@ -41,12 +41,18 @@
 
 #include <ros/ros.h>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
+#include <bwi_logical_translator/approach_cache.h>
+#include <bwi_logical_translator/door_openness.h>
+#include <bwi_logical_translator/level_catalogue.h>
 #include <bwi_mapper/path_finder.h>
 #include <bwi_planning_common/structures.h>
 #include <bwi_planning_common/utils.h>
 #include <bwi_tools/point.h>
 #include <nav_msgs/GetPlan.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <tf/transform_datatypes.h>
 
 #include <pcl/point_cloud.h>
 #include <pcl/kdtree/kdtree_flann.h>
@@ -61,8 +67,16 @@ namespace bwi_logical_translator {
 
       bool initialize();
 
+      /* Switches to a level that has already been read, without going back to disk for anything but the approach
+       * cache. */
+      bool initialize(const LevelCatalogue::Level& level);
+
       bool isDoorOpen(const std::string &door_name);
 
+      /* Hands over the latest local obstacle grid, which isDoorOpen looks at instead of asking the planner.
+       * global_to_grid takes points from the global frame into the frame of the grid. */
+      void updateObstacleGrid(const nav_msgs::OccupancyGrid::ConstPtr& grid, const tf::Transform& global_to_grid);
+
       bool getApproachPoint(const std::string &door_name,
                             const bwi::Point2f &current_location,
                             bwi::Point2f &point, float &yaw);
@@ -172,6 +186,11 @@ namespace bwi_logical_translator {
 
       std::map<std::string, boost::shared_ptr<bwi_mapper::PathFinder> > location_approachable_space_;
 
+      /* Answers approach queries for every door and object without a PathFinder each. The lazily created
+       * PathFinders above are only used when it is disabled. */
+      ApproachCache approach_cache_;
+      void initializeApproachCache(const std::string& map_file, uint64_t doors_hash, uint64_t objects_hash);
+
       nav_msgs::OccupancyGrid map_;
       nav_msgs::OccupancyGrid map_with_doors_;
       nav_msgs::OccupancyGrid inflated_map_with_doors_;
@@ -186,6 +205,19 @@ namespace bwi_logical_translator {
       void initializeStaticCostmapToggleService();
       void enableStaticCostmap(bool value);
 
+      bool isDoorOpenUsingPlanner(const std::string &door_name);
+      bool estimateDoorOpen(const std::string &door_name, const ros::Time& now, bool &open);
+
+      DoorOpennessEstimator door_openness_estimator_;
+      /* Door queries can come from several spinner threads at once. Cleared whenever the level changes. */
+      boost::mutex door_state_cache_mutex_;
+      DoorStateCache door_state_cache_;
+      bool use_door_openness_estimator_;
+      double max_obstacle_grid_age_;
+      boost::mutex obstacle_grid_mutex_;
+      nav_msgs::OccupancyGrid::ConstPtr obstacle_grid_;
+      tf::Transform global_to_obstacle_grid_;
+
       bool initialized_;
 
   }; /* BwiLogicalTranslator */
@@ -0,0 +1,153 @@
+/**
+ * \file  door_openness.h
+ * \brief  Estimates whether a door is open by looking at an obstacle grid across the doorway, without asking the
+ *         global planner.
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+#ifndef BWI_LOGICAL_TRANSLATOR_DOOR_OPENNESS_H
+#define BWI_LOGICAL_TRANSLATOR_DOOR_OPENNESS_H
+
+#include <map>
+#include <string>
+
+#include <bwi_tools/point.h>
+#include <nav_msgs/OccupancyGrid.h>
+
+namespace bwi_logical_translator {
+
+  /**
+   * \class DoorOpennessEstimator
+   * \brief Walks the segment between the two door corners through an obstacle grid (usually the local costmap)
+   *        and measures how much of the doorway is free.
+   *
+   * Every sample along the doorway looks at a short band of cells across the segment, so that a door leaf or a
+   * person standing just inside the doorway also blocks it. The door is open when the widest free stretch is wide
+   * enough for the robot to pass and enough of the whole doorway is free.
+   */
+  class DoorOpennessEstimator {
+
+    public:
+
+      struct Params {
+        /** \brief grid values at or above this are obstacles. 100 is lethal in a costmap. */
+        int obstacle_threshold;
+        /** \brief the narrowest free stretch the robot fits through (m) */
+        float min_gap_width;
+        /** \brief the least fraction of the doorway that has to be free */
+        float min_open_ratio;
+        /** \brief how far on each side of the door segment to look for obstacles (m) */
+        float band_depth;
+        /** \brief how much of the segment to ignore at each corner, where the door frame is (m) */
+        float corner_margin;
+        /** \brief above this fraction of unknown samples, no estimate is given */
+        float max_unknown_ratio;
+
+        Params() : obstacle_threshold(100), min_gap_width(0.5f), min_open_ratio(0.5f), band_depth(0.1f),
+                   corner_margin(0.05f), max_unknown_ratio(0.5f) {}
+      };
+
+      struct Estimate {
+        /** \brief false if the doorway is mostly outside the grid or unknown. Nothing else is valid then. */
+        bool known;
+        bool open;
+        /** \brief free fraction of the doorway */
+        float traversable_ratio;
+        /** \brief length of the widest free stretch (m) */
+        float widest_gap;
+
+        Estimate() : known(false), open(false), traversable_ratio(0), widest_gap(0) {}
+      };
+
+      DoorOpennessEstimator(const Params& params = Params()) : params_(params) {}
+
+      /** \brief the door corners have to be in the frame of the grid */
+      Estimate estimate(const nav_msgs::OccupancyGrid& grid,
+                        const bwi::Point2f& corner_0, const bwi::Point2f& corner_1) const;
+
+      inline const Params& getParams() const {
+        return params_;
+      }
+
+    private:
+
+      Params params_;
+
+  }; /* DoorOpennessEstimator */
+
+  /**
+   * \class DoorStateCache
+   * \brief Remembers the last sensed state of every door for a while, so that repeated queries about the same door
+   *        don't sense it again. Times are in seconds.
+   */
+  class DoorStateCache {
+
+    public:
+
+      DoorStateCache(double ttl = 0) : ttl_(ttl) {}
+
+      inline void setTTL(double ttl) {
+        ttl_ = ttl;
+      }
+
+      inline bool lookup(const std::string& door_name, double now, bool& open) const {
+        std::map<std::string, Entry>::const_iterator entry = entries_.find(door_name);
+        if (entry == entries_.end() || now < entry->second.stamp || now - entry->second.stamp > ttl_) {
+          return false;
+        }
+        open = entry->second.open;
+        return true;
+      }
+
+      inline void store(const std::string& door_name, bool open, double now) {
+        Entry& entry = entries_[door_name];
+        entry.open = open;
+        entry.stamp = now;
+      }
+
+      inline void clear() {
+        entries_.clear();
+      }
+
+    private:
+
+      struct Entry {
+        bool open;
+        double stamp;
+      };
+
+      double ttl_;
+      std::map<std::string, Entry> entries_;
+
+  }; /* DoorStateCache */
+
+} /* bwi_logical_translator */
+
+#endif /* end of include guard: BWI_LOGICAL_TRANSLATOR_DOOR_OPENNESS_H */
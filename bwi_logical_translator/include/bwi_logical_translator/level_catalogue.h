@@ -0,0 +1,185 @@
+/**
+ * \file  level_catalogue.h
+ * \brief  Reads every level of a multi-level map once, and switches between them without going back to disk.
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+
+#ifndef BWI_LOGICAL_TRANSLATOR_LEVEL_CATALOGUE_H
+#define BWI_LOGICAL_TRANSLATOR_LEVEL_CATALOGUE_H
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <bwi_planning_common/structures.h>
+#include <geometry_msgs/Pose.h>
+#include <nav_msgs/OccupancyGrid.h>
+
+namespace bwi_logical_translator {
+
+  /**
+   * \class LevelCatalogue
+   * \brief The parsed data of every level of a multi-level map.
+   *
+   * update() reads the levels of a multimap into immutable Levels, and only reads a level again once one of its
+   * files has changed. Files whose modification time and size are unchanged are not opened at all, and files that
+   * were merely touched are recognised by their contents hash. activate() switches the active level without any
+   * file I/O by swapping a pointer atomically, so readers on other threads always see one whole level.
+   */
+  class LevelCatalogue {
+
+    public:
+
+      /** \brief where a level is read from: a multi_level_map_msgs::LevelMetaData with its paths resolved */
+      struct Source {
+        std::string level_id;
+        std::string map_file;
+        std::string data_directory;
+
+        Source() {}
+        Source(const std::string& level_id, const std::string& map_file, const std::string& data_directory) :
+          level_id(level_id), map_file(map_file), data_directory(data_directory) {}
+        bool operator==(const Source& other) const {
+          return level_id == other.level_id && map_file == other.map_file && data_directory == other.data_directory;
+        }
+      };
+
+      /**
+       * \class Level
+       * \brief Everything BwiLogicalTranslator reads from the files of one level. It never changes once it has been
+       *        loaded.
+       */
+      class Level {
+
+        public:
+
+          Source source;
+          /** \brief the frame of the level, from multi_level_map::frameIdFromLevelId */
+          std::string frame_id;
+
+          nav_msgs::OccupancyGrid map;
+          nav_msgs::OccupancyGrid map_with_doors;
+          std::vector<bwi_planning_common::Door> doors;
+          std::vector<std::string> locations;
+          std::vector<int32_t> location_map;
+          std::map<std::string, geometry_msgs::Pose> object_approach_map;
+
+          /** \brief contents hashes of the doors and objects files, for ApproachCache keys */
+          uint64_t doors_hash;
+          uint64_t objects_hash;
+
+          /** \brief the first door with the given name, or NULL */
+          const bwi_planning_common::Door* getDoor(const std::string& door_name) const;
+          bool hasLocation(const std::string& location_name) const;
+
+        private:
+
+          friend class LevelCatalogue;
+          std::map<std::string, size_t> door_idx_;
+          std::map<std::string, size_t> location_idx_;
+      };
+
+      typedef boost::shared_ptr<const Level> LevelConstPtr;
+
+      /**
+       * \brief reads a level from disk, throwing std::runtime_error as the bwi_planning_common readers and
+       *        bwi_mapper::loadMapFile do
+       */
+      static LevelConstPtr loadLevel(const Source& source);
+
+      LevelCatalogue();
+
+      /**
+       * \brief makes the catalogue hold exactly the given levels, reading those that are new or have changed on
+       *        disk. If one of them can't be read, the exception is passed on and the catalogue is left as it was.
+       * \return the number of levels that were read
+       */
+      size_t update(const std::vector<Source>& sources);
+
+      /** \brief the level with the given id, or a NULL pointer */
+      LevelConstPtr getLevel(const std::string& level_id) const;
+      LevelConstPtr getLevelFromFrameId(const std::string& frame_id) const;
+
+      /** \brief the level containing the given location, or a NULL pointer. Levels are searched in order of id. */
+      LevelConstPtr findLevelWithLocation(const std::string& location_name) const;
+
+      std::vector<std::string> getLevelIds() const;
+
+      /** \brief switches to the given level. Returns false if it isn't in the catalogue. */
+      bool activate(const std::string& level_id);
+
+      /** \brief the active level, which update() replaces if it is read again. NULL until a level is activated. */
+      LevelConstPtr getActiveLevel() const;
+
+    private:
+
+      struct FileSignature {
+        std::string filename;
+        bool exists;
+        uint64_t size;
+        int64_t mtime_sec;
+        int64_t mtime_nsec;
+        uint64_t hash;
+      };
+
+      struct Entry {
+        LevelConstPtr level;
+        std::vector<FileSignature> files;
+      };
+
+      struct Index {
+        std::map<std::string, Entry> levels;
+        std::map<std::string, std::string> location_to_level;
+      };
+
+      static std::vector<std::string> getLevelFiles(const Source& source);
+      static void statFile(const std::string& filename, FileSignature& signature);
+      static std::vector<FileSignature> signFiles(const Source& source);
+
+      /* Whether none of the files have changed since they were signed. Files that were touched without changing
+       * get their new modification time, so that they aren't hashed again the next time. */
+      static bool isUnchanged(std::vector<FileSignature>& files);
+
+      /* Only ever replaced as a whole, using boost::atomic_load and boost::atomic_store. */
+      boost::shared_ptr<const Index> index_;
+      LevelConstPtr active_level_;
+
+      /* Serializes update() and activate(), so that neither loses the other's change to active_level_. */
+      boost::mutex update_mutex_;
+
+  }; /* LevelCatalogue */
+
+} /* bwi_logical_translator */
+
+#endif /* end of include guard: BWI_LOGICAL_TRANSLATOR_LEVEL_CATALOGUE_H */
@@ -0,0 +1,151 @@
+/**
+ * \file  map_synchronizer.h
+ * \brief  Publishes navigation maps one at a time and lets callers wait until the costmap has taken them in.
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+#ifndef BWI_LOGICAL_TRANSLATOR_MAP_SYNCHRONIZER_H
+#define BWI_LOGICAL_TRANSLATOR_MAP_SYNCHRONIZER_H
+
+#include <stdint.h>
+
+#include <boost/function.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/thread_time.hpp>
+
+namespace bwi_logical_translator {
+
+  /**
+   * \class MapSynchronizer
+   * \brief A generation counter handshake between whoever changes the navigation map and the costmap that uses it.
+   *
+   * Every request gets the next generation number. At most one map is outstanding: a request made while the last
+   * published map is unacknowledged replaces any request still waiting, and the latest one is published once the
+   * outstanding map is acknowledged or times out. A burst of door updates thus results in a single publish of the
+   * latest state, and a request is done once a map published after it was made is acknowledged.
+   *
+   * The costmap callbacks check what they received against the pending key, the key of the last map published, and
+   * acknowledge it only if it matches, so a costmap that still shows an older map never completes a request.
+   *
+   * Maps are identified by a key chosen by the caller, which has to change whenever the map contents do.
+   */
+  class MapSynchronizer {
+
+    public:
+
+      /** \brief publishes the map with the given key, tagged with the given generation. It is called with the
+       *         synchronizer locked, from the thread that made the request, acknowledged the previous map or noticed
+       *         it timed out, so it must not wait for the acknowledgement itself. */
+      typedef boost::function<void (uint64_t key, uint64_t generation)> PublishFunction;
+
+      /**
+       * \class Future
+       * \brief The outcome of a request: ready once the costmap has the requested map, or a later one.
+       */
+      class Future {
+
+        public:
+
+          Future() : synchronizer_(NULL), generation_(0) {}
+
+          inline uint64_t getGeneration() const {
+            return generation_;
+          }
+
+          bool ready() const;
+
+          /** \brief waits for the costmap to take the map in. Returns false on a timeout. */
+          bool wait(double timeout) const;
+
+        private:
+
+          friend class MapSynchronizer;
+          Future(MapSynchronizer* synchronizer, uint64_t generation) :
+            synchronizer_(synchronizer), generation_(generation) {}
+
+          MapSynchronizer* synchronizer_;
+          uint64_t generation_;
+      };
+
+      /**
+       * \param publish called for every map that goes out
+       * \param timeout seconds after which an unacknowledged map no longer holds later requests back
+       */
+      MapSynchronizer(const PublishFunction& publish, double timeout = 2.0);
+      ~MapSynchronizer();
+
+      /** \brief asks for the map with the given key to be published, even if it was published before */
+      Future request(uint64_t key);
+
+      /** \brief the key of the last map published if the costmap hasn't acknowledged it yet, otherwise false */
+      bool getPendingKey(uint64_t& key) const;
+
+      /**
+       * \brief to be called from the costmap callbacks with the key of the map the costmap was found to show.
+       *        Only acknowledges the last map published: returns false if key isn't pending.
+       */
+      bool acknowledge(uint64_t key);
+
+      uint64_t getAcknowledgedGeneration() const;
+
+    private:
+
+      /* Publishes the latest request. Needs mutex_. */
+      void publishLocked();
+
+      /* Stops the outstanding map from holding later requests back once it timed out. */
+      void watchTimeouts();
+
+      PublishFunction publish_;
+      boost::posix_time::time_duration timeout_;
+
+      mutable boost::mutex mutex_;
+      boost::condition_variable acknowledged_condition_;
+      boost::condition_variable published_condition_;
+
+      uint64_t requested_;
+      uint64_t requested_key_;
+      uint64_t published_;
+      uint64_t published_key_;
+      uint64_t acknowledged_;
+      // whether the last map published is unacknowledged and hasn't timed out
+      bool outstanding_;
+      boost::system_time deadline_;
+      bool stopped_;
+
+      boost::thread timeout_thread_;
+
+  }; /* MapSynchronizer */
+
+} /* bwi_logical_translator */
+
+#endif /* end of include guard: BWI_LOGICAL_TRANSLATOR_MAP_SYNCHRONIZER_H */
@@ -0,0 +1,402 @@
+/**
+ * \file  approach_cache.cpp
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <bwi_logical_translator/approach_cache.h>
+
+namespace bwi_logical_translator {
+
+  // Bump whenever the file layout changes.
+  const uint32_t ApproachCache::VERSION = 1;
+  const int ApproachCache::NOT_APPROACHABLE = -1;
+
+  namespace {
+
+    const char MAGIC[8] = {'B', 'W', 'I', 'A', 'P', 'P', 'R', 'C'};
+
+    template <typename T>
+    inline void write(std::ostream& out, const T& value) {
+      out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename T>
+    inline bool read(std::istream& in, T& value) {
+      return bool(in.read(reinterpret_cast<char*>(&value), sizeof(T)));
+    }
+
+    inline void writeString(std::ostream& out, const std::string& value) {
+      write(out, (uint32_t) value.size());
+      out.write(value.data(), value.size());
+    }
+
+    inline bool readString(std::istream& in, std::string& value) {
+      uint32_t size;
+      if (!read(in, size) || size > (1u << 16)) {
+        return false;
+      }
+      value.resize(size);
+      return size == 0 || bool(in.read(&value[0], size));
+    }
+
+    // Guards against allocating absurd sizes when reading a damaged file
+    inline bool readCount(std::istream& in, uint32_t& count, uint32_t limit) {
+      return read(in, count) && count <= limit;
+    }
+
+  } /* namespace */
+
+  ApproachCache::ApproachCache() : width_(0), height_(0) {}
+
+  int32_t ApproachCache::getComponent(int32_t idx) const {
+    if (idx < 0 || idx >= (int32_t) components_.size()) {
+      return -1;
+    }
+    return components_[idx];
+  }
+
+  int32_t ApproachCache::getComponent(const bwi_mapper::Point2d& pt) const {
+    if (pt.x < 0 || pt.y < 0 || pt.x >= (int) width_ || pt.y >= (int) height_) {
+      return -1;
+    }
+    return components_[pt.y * width_ + pt.x];
+  }
+
+  void ApproachCache::labelComponents(const nav_msgs::OccupancyGrid& map) {
+    components_.assign(width_ * height_, -1);
+    std::vector<int32_t> queue;
+    queue.reserve(components_.size());
+    int32_t num_components = 0;
+    for (uint32_t idx = 0; idx < components_.size(); ++idx) {
+      if (components_[idx] != -1 || map.data[idx] == 100) {
+        continue;
+      }
+      queue.clear();
+      queue.push_back(idx);
+      components_[idx] = num_components;
+      for (size_t head = 0; head < queue.size(); ++head) {
+        int32_t current = queue[head];
+        int32_t col = current % width_, row = current / width_;
+        int32_t neighbors[] = {col > 0 ? current - 1 : -1,
+                               col + 1 < (int32_t) width_ ? current + 1 : -1,
+                               row > 0 ? current - (int32_t) width_ : -1,
+                               row + 1 < (int32_t) height_ ? current + (int32_t) width_ : -1};
+        for (int n = 0; n < 4; ++n) {
+          int32_t neighbor = neighbors[n];
+          if (neighbor >= 0 && components_[neighbor] == -1 && map.data[neighbor] != 100) {
+            components_[neighbor] = num_components;
+            queue.push_back(neighbor);
+          }
+        }
+      }
+      ++num_components;
+    }
+  }
+
+  void ApproachCache::computeDistances(int32_t start_idx, std::vector<int32_t>& distances,
+                                       std::vector<int32_t>& queue) const {
+    // A breadth first search inside the start's component gives the same distances as PathFinder's relaxation.
+    int32_t component = components_[start_idx];
+    queue.clear();
+    queue.push_back(start_idx);
+    distances[start_idx] = 0;
+    for (size_t head = 0; head < queue.size(); ++head) {
+      int32_t current = queue[head];
+      int32_t col = current % width_, row = current / width_;
+      int32_t neighbors[] = {col > 0 ? current - 1 : -1,
+                             col + 1 < (int32_t) width_ ? current + 1 : -1,
+                             row > 0 ? current - (int32_t) width_ : -1,
+                             row + 1 < (int32_t) height_ ? current + (int32_t) width_ : -1};
+      for (int n = 0; n < 4; ++n) {
+        int32_t neighbor = neighbors[n];
+        if (neighbor >= 0 && distances[neighbor] < 0 && components_[neighbor] == component) {
+          distances[neighbor] = distances[current] + 1;
+          queue.push_back(neighbor);
+        }
+      }
+    }
+  }
+
+  void ApproachCache::build(const nav_msgs::OccupancyGrid& map,
+                            const std::map<std::string, std::pair<bwi_mapper::Point2d, bwi_mapper::Point2d> >& doors,
+                            const std::map<std::string, bwi_mapper::Point2d>& objects) {
+    width_ = map.info.width;
+    height_ = map.info.height;
+    labelComponents(map);
+
+    std::vector<int32_t> distances_0(components_.size(), -1), distances_1(components_.size(), -1);
+    std::vector<int32_t> queue_0, queue_1;
+    queue_0.reserve(components_.size());
+    queue_1.reserve(components_.size());
+
+    doors_.clear();
+    for (std::map<std::string, std::pair<bwi_mapper::Point2d, bwi_mapper::Point2d> >::const_iterator door =
+         doors.begin(); door != doors.end(); ++door) {
+      DoorEntry& entry = doors_[door->first];
+      const bwi_mapper::Point2d* approach_pts[2] = {&door->second.first, &door->second.second};
+      for (int i = 0; i < 2; ++i) {
+        entry.approach_idx[i] = (getComponent(*approach_pts[i]) >= 0) ?
+          approach_pts[i]->y * width_ + approach_pts[i]->x : -1;
+      }
+      int32_t component = getComponent(entry.approach_idx[0]);
+      if (component < 0 || component != getComponent(entry.approach_idx[1])) {
+        // At most one side is reachable from anywhere, the components decide.
+        continue;
+      }
+
+      computeDistances(entry.approach_idx[0], distances_0, queue_0);
+      computeDistances(entry.approach_idx[1], distances_1, queue_1);
+
+      // Both searches covered exactly this component. Cells outside it never look at the bit, so the flips only
+      // need to be right at the cells visited here.
+      std::sort(queue_0.begin(), queue_0.end());
+      bool closer_to_0 = false;
+      for (size_t i = 0; i < queue_0.size(); ++i) {
+        int32_t idx = queue_0[i];
+        bool bit = distances_0[idx] < distances_1[idx];
+        if (bit != closer_to_0) {
+          entry.closer_to_0_flips.push_back(idx);
+          closer_to_0 = bit;
+        }
+      }
+
+      for (size_t i = 0; i < queue_0.size(); ++i) {
+        distances_0[queue_0[i]] = -1;
+      }
+      for (size_t i = 0; i < queue_1.size(); ++i) {
+        distances_1[queue_1[i]] = -1;
+      }
+    }
+
+    objects_.clear();
+    for (std::map<std::string, bwi_mapper::Point2d>::const_iterator object = objects.begin();
+         object != objects.end(); ++object) {
+      objects_[object->first] = (getComponent(object->second) >= 0) ?
+        object->second.y * width_ + object->second.x : -1;
+    }
+  }
+
+  int ApproachCache::getApproachPointIdx(const std::string& door_name, const bwi_mapper::Point2d& pt) const {
+    std::map<std::string, DoorEntry>::const_iterator door = doors_.find(door_name);
+    int32_t component = getComponent(pt);
+    if (door == doors_.end() || component < 0) {
+      return NOT_APPROACHABLE;
+    }
+    const DoorEntry& entry = door->second;
+    bool reaches_0 = getComponent(entry.approach_idx[0]) == component;
+    bool reaches_1 = getComponent(entry.approach_idx[1]) == component;
+    if (reaches_0 && reaches_1) {
+      // The bit at idx is set when an odd number of flips happened at or before it.
+      uint32_t idx = pt.y * width_ + pt.x;
+      size_t flips = std::upper_bound(entry.closer_to_0_flips.begin(), entry.closer_to_0_flips.end(), idx) -
+        entry.closer_to_0_flips.begin();
+      return (flips % 2 == 1) ? 0 : 1;
+    }
+    if (reaches_0) {
+      return 0;
+    }
+    if (reaches_1) {
+      return 1;
+    }
+    return NOT_APPROACHABLE;
+  }
+
+  bool ApproachCache::isObjectApproachable(const std::string& object_name, const bwi_mapper::Point2d& pt) const {
+    std::map<std::string, int32_t>::const_iterator object = objects_.find(object_name);
+    if (object == objects_.end()) {
+      return false;
+    }
+    int32_t component = getComponent(pt);
+    return component >= 0 && component == getComponent(object->second);
+  }
+
+  bool ApproachCache::save(const std::string& filename, const Key& key) const {
+    std::string sidecar = filename + ".tmp";
+    {
+      std::ofstream out(sidecar.c_str(), std::ios::binary | std::ios::trunc);
+      if (!out) {
+        return false;
+      }
+      out.write(MAGIC, sizeof(MAGIC));
+      write(out, VERSION);
+      write(out, key.map_hash);
+      write(out, key.doors_hash);
+      write(out, key.objects_hash);
+      write(out, width_);
+      write(out, height_);
+
+      // Components as (label, run length) pairs, since labels are constant over whole rooms
+      std::vector<std::pair<int32_t, uint32_t> > runs;
+      for (size_t idx = 0; idx < components_.size(); ++idx) {
+        if (runs.empty() || runs.back().first != components_[idx]) {
+          runs.push_back(std::make_pair(components_[idx], 0u));
+        }
+        ++runs.back().second;
+      }
+      write(out, (uint32_t) runs.size());
+      for (size_t i = 0; i < runs.size(); ++i) {
+        write(out, runs[i].first);
+        write(out, runs[i].second);
+      }
+
+      write(out, (uint32_t) doors_.size());
+      for (std::map<std::string, DoorEntry>::const_iterator door = doors_.begin(); door != doors_.end(); ++door) {
+        writeString(out, door->first);
+        write(out, door->second.approach_idx[0]);
+        write(out, door->second.approach_idx[1]);
+        write(out, (uint32_t) door->second.closer_to_0_flips.size());
+        if (!door->second.closer_to_0_flips.empty()) {
+          out.write(reinterpret_cast<const char*>(&door->second.closer_to_0_flips[0]),
+                    door->second.closer_to_0_flips.size() * sizeof(uint32_t));
+        }
+      }
+
+      write(out, (uint32_t) objects_.size());
+      for (std::map<std::string, int32_t>::const_iterator object = objects_.begin(); object != objects_.end();
+           ++object) {
+        writeString(out, object->first);
+        write(out, object->second);
+      }
+
+      out.flush();
+      if (!out) {
+        std::remove(sidecar.c_str());
+        return false;
+      }
+    }
+    return std::rename(sidecar.c_str(), filename.c_str()) == 0;
+  }
+
+  bool ApproachCache::load(const std::string& filename, const Key& key) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    char magic[sizeof(MAGIC)];
+    uint32_t version;
+    Key stored;
+    if (!in || !in.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        !read(in, version) || version != VERSION ||
+        !read(in, stored.map_hash) || !read(in, stored.doors_hash) || !read(in, stored.objects_hash) ||
+        !(stored == key)) {
+      return false;
+    }
+
+    uint32_t width, height, num_runs;
+    if (!read(in, width) || !read(in, height) || (uint64_t) width * height > (1u << 30) ||
+        !readCount(in, num_runs, width * height)) {
+      return false;
+    }
+    std::vector<int32_t> components;
+    components.reserve(width * height);
+    for (uint32_t i = 0; i < num_runs; ++i) {
+      int32_t label;
+      uint32_t length;
+      if (!read(in, label) || !read(in, length) || length > width * height - components.size()) {
+        return false;
+      }
+      components.insert(components.end(), length, label);
+    }
+    if (components.size() != width * height) {
+      return false;
+    }
+
+    std::map<std::string, DoorEntry> doors;
+    uint32_t num_doors;
+    if (!readCount(in, num_doors, 1u << 16)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_doors; ++i) {
+      std::string name;
+      uint32_t num_flips;
+      if (!readString(in, name)) {
+        return false;
+      }
+      DoorEntry& entry = doors[name];
+      if (!read(in, entry.approach_idx[0]) || !read(in, entry.approach_idx[1]) ||
+          !readCount(in, num_flips, width * height)) {
+        return false;
+      }
+      entry.closer_to_0_flips.resize(num_flips);
+      if (num_flips != 0 && !in.read(reinterpret_cast<char*>(&entry.closer_to_0_flips[0]),
+                                     num_flips * sizeof(uint32_t))) {
+        return false;
+      }
+    }
+
+    std::map<std::string, int32_t> objects;
+    uint32_t num_objects;
+    if (!readCount(in, num_objects, 1u << 16)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < num_objects; ++i) {
+      std::string name;
+      int32_t idx;
+      if (!readString(in, name) || !read(in, idx)) {
+        return false;
+      }
+      objects[name] = idx;
+    }
+
+    width_ = width;
+    height_ = height;
+    components_.swap(components);
+    doors_.swap(doors);
+    objects_.swap(objects);
+    return true;
+  }
+
+  uint64_t ApproachCache::hash(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t value = seed;
+    for (size_t i = 0; i < size; ++i) {
+      value = (value ^ bytes[i]) * 1099511628211ULL;
+    }
+    return value;
+  }
+
+  uint64_t ApproachCache::hashMap(const nav_msgs::OccupancyGrid& map) {
+    uint32_t size[2] = {map.info.width, map.info.height};
+    double origin[3] = {map.info.origin.position.x, map.info.origin.position.y, map.info.resolution};
+    uint64_t value = hash(size, sizeof(size));
+    value = hash(origin, sizeof(origin), value);
+    return map.data.empty() ? value : hash(&map.data[0], map.data.size(), value);
+  }
+
+  uint64_t ApproachCache::hashFile(const std::string& filename) {
+    std::ifstream in(filename.c_str(), std::ios::binary);
+    std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    return hash(contents.data(), contents.size());
+  }
+
+} /* bwi_logical_translator */
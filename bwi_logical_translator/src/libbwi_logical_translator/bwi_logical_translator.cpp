@@ -44,7 +44,6 @@
 #include <boost/foreach.hpp>
 #include <boost/thread/thread.hpp>
 #include <bwi_mapper/map_inflator.h>
-#include <bwi_mapper/map_loader.h>
 #include <bwi_mapper/map_utils.h>
 #include <bwi_mapper/point_utils.h>
 
@@ -66,6 +65,16 @@ namespace bwi_logical_translator {
 
     nh_.reset(new ros::NodeHandle);
     ros::param::param<std::string>("~global_frame_id", global_frame_id_, "level_mux_map");
+
+    DoorOpennessEstimator::Params door_params;
+    ros::param::param<float>("~door_min_gap_width", door_params.min_gap_width, door_params.min_gap_width);
+    ros::param::param<float>("~door_min_open_ratio", door_params.min_open_ratio, door_params.min_open_ratio);
+    door_openness_estimator_ = DoorOpennessEstimator(door_params);
+    ros::param::param<bool>("~use_door_openness_estimator", use_door_openness_estimator_, true);
+    ros::param::param<double>("~max_obstacle_grid_age", max_obstacle_grid_age_, 2.0);
+    double door_state_ttl;
+    ros::param::param<double>("~door_state_ttl", door_state_ttl, 1.0);
+    door_state_cache_.setTTL(door_state_ttl);
   }
 
   bool BwiLogicalTranslator::initialize() {
@@ -86,25 +95,33 @@ namespace bwi_logical_translator {
       throw std::runtime_error(message);
     }
 
-    std::string door_file = bwi_planning_common::getDoorsFileLocationFromDataDirectory(data_directory);
-    ROS_INFO_STREAM("BwiLogicalTranslator: Reading door file: " + door_file);
-    bwi_planning_common::readDoorFile(door_file, doors_);
+    ROS_INFO_STREAM("BwiLogicalTranslator: Reading level data from " + data_directory);
+    LevelCatalogue::LevelConstPtr level =
+      LevelCatalogue::loadLevel(LevelCatalogue::Source("", map_file, data_directory));
+    return initialize(*level);
+  }
+
+  bool BwiLogicalTranslator::initialize(const LevelCatalogue::Level& level) {
+
+    {
+      // Door names are per level, so states seen on the previous one mean nothing here
+      boost::mutex::scoped_lock lock(door_state_cache_mutex_);
+      door_state_cache_.clear();
+    }
+
+    doors_ = level.doors;
+    name_to_door.clear();
     for (const auto& door: doors_) {
         name_to_door.insert({door.name, door});
     }
 
-    std::string region_file = bwi_planning_common::getLocationsFileLocationFromDataDirectory(data_directory);
-    ROS_INFO_STREAM("BwiLogicalTranslator: Reading regions file: " + region_file);
-    bwi_planning_common::readLocationFile(region_file, regions_, region_map_);
+    regions_ = level.locations;
+    region_map_ = level.location_map;
+    location_approach_map_ = level.object_approach_map;
 
-    std::string location_file = bwi_planning_common::getObjectsFileLocationFromDataDirectory(data_directory);
-    ROS_INFO_STREAM("BwiLogicalTranslator: Checking if locations file exists: " + location_file);
-    if (boost::filesystem::exists(location_file)) {
-      ROS_INFO_STREAM("BwiLogicalTranslator:   Locations file exists. Reading now!");
-      bwi_planning_common::readObjectApproachFile(location_file, location_approach_map_);
-    }
     int i = 0;
     location_points = pcl::PointCloud<pcl::PointXY>::Ptr(new pcl::PointCloud<pcl::PointXY>);
+    index_to_name.clear();
     for (const auto& door: doors_) {
       pcl::PointXY point = {door.door_center.x, door.door_center.y};
       location_points->push_back(point);
@@ -121,15 +138,12 @@ namespace bwi_logical_translator {
     }
     location_tree.setInputCloud(location_points);
 
-    bwi_mapper::MapLoader mapper(map_file);
-    mapper.getMap(map_);
+    map_ = level.map;
     map_.header.stamp = ros::Time::now();
     map_.header.frame_id = global_frame_id_;
     info_ = map_.info;
 
-    std::string map_with_doors_file = bwi_planning_common::getDoorsMapLocationFromDataDirectory(data_directory);
-    mapper = bwi_mapper::MapLoader(map_with_doors_file);
-    mapper.getMap(map_with_doors_);
+    map_with_doors_ = level.map_with_doors;
     map_with_doors_.header.stamp = ros::Time::now();
     map_with_doors_.header.frame_id = global_frame_id_;
 
@@ -142,10 +156,53 @@ namespace bwi_logical_translator {
     door_approachable_space_2_.clear();
     location_approachable_space_.clear();
 
+    bool use_approach_cache;
+    ros::param::param<bool>("~use_approach_cache", use_approach_cache, true);
+    if (use_approach_cache) {
+      initializeApproachCache(level.source.map_file, level.doors_hash, level.objects_hash);
+    }
+
     initialized_ = true;
     return true;
   }
 
+  void BwiLogicalTranslator::initializeApproachCache(const std::string& map_file, uint64_t doors_hash,
+                                                     uint64_t objects_hash) {
+
+    // The grid points are computed with the frame of the original map, so that is part of the key as well.
+    ApproachCache::Key key;
+    double frame[3] = {info_.origin.position.x, info_.origin.position.y, info_.resolution};
+    key.map_hash = ApproachCache::hash(frame, sizeof(frame), ApproachCache::hashMap(inflated_map_with_doors_));
+    key.doors_hash = doors_hash;
+    key.objects_hash = objects_hash;
+
+    std::string cache_file = boost::filesystem::path(map_file).replace_extension(".approach_cache").string();
+    if (approach_cache_.load(cache_file, key)) {
+      ROS_INFO_STREAM("BwiLogicalTranslator: Loaded approachable space from " << cache_file);
+      return;
+    }
+
+    ROS_INFO_STREAM("BwiLogicalTranslator: Precomputing approachable space for all doors and objects...");
+    std::map<std::string, std::pair<bwi_mapper::Point2d, bwi_mapper::Point2d> > door_cells;
+    for (const auto& door: doors_) {
+      door_cells[door.name] = std::make_pair(bwi_mapper::Point2d(bwi_mapper::toGrid(door.approach_points[0], info_)),
+                                             bwi_mapper::Point2d(bwi_mapper::toGrid(door.approach_points[1], info_)));
+    }
+    std::map<std::string, bwi_mapper::Point2d> object_cells;
+    for (const auto& location: location_approach_map_) {
+      bwi_mapper::Point2f approach_pt(location.second.position.x, location.second.position.y);
+      object_cells[location.first] = bwi_mapper::Point2d(bwi_mapper::toGrid(approach_pt, info_));
+    }
+    approach_cache_.build(inflated_map_with_doors_, door_cells, object_cells);
+
+    if (approach_cache_.save(cache_file, key)) {
+      ROS_INFO_STREAM("BwiLogicalTranslator: Wrote approachable space to " << cache_file);
+    } else {
+      ROS_WARN_STREAM("BwiLogicalTranslator: Unable to write approachable space to " << cache_file <<
+                      ", it will be recomputed on the next start.");
+    }
+  }
+
   bool BwiLogicalTranslator::isDoorOpen(const std::string &door_name) {
 
     if (!initialized_) {
@@ -159,6 +216,64 @@ namespace bwi_logical_translator {
         return false;
     }
 
+    ros::Time now = ros::Time::now();
+    bool open;
+    {
+      boost::mutex::scoped_lock lock(door_state_cache_mutex_);
+      if (door_state_cache_.lookup(door_name, now.toSec(), open)) {
+        return open;
+      }
+    }
+
+    // Fall back to the planner whenever the obstacle grid can't tell, e.g. if it is old or doesn't cover the door.
+    if (!use_door_openness_estimator_ || !estimateDoorOpen(door_name, now, open)) {
+      open = isDoorOpenUsingPlanner(door_name);
+    }
+    boost::mutex::scoped_lock lock(door_state_cache_mutex_);
+    door_state_cache_.store(door_name, open, now.toSec());
+    return open;
+  }
+
+  void BwiLogicalTranslator::updateObstacleGrid(const nav_msgs::OccupancyGrid::ConstPtr& grid,
+                                                const tf::Transform& global_to_grid) {
+    boost::mutex::scoped_lock lock(obstacle_grid_mutex_);
+    obstacle_grid_ = grid;
+    global_to_obstacle_grid_ = global_to_grid;
+  }
+
+  bool BwiLogicalTranslator::estimateDoorOpen(const std::string &door_name, const ros::Time& now, bool &open) {
+
+    nav_msgs::OccupancyGrid::ConstPtr grid;
+    tf::Transform global_to_grid;
+    {
+      boost::mutex::scoped_lock lock(obstacle_grid_mutex_);
+      grid = obstacle_grid_;
+      global_to_grid = global_to_obstacle_grid_;
+    }
+    if (!grid || (now - grid->header.stamp).toSec() > max_obstacle_grid_age_) {
+      return false;
+    }
+
+    const auto& door = name_to_door[door_name];
+    bwi::Point2f corners[2];
+    for (int i = 0; i < 2; ++i) {
+      tf::Vector3 corner = global_to_grid * tf::Vector3(door.door_corners[i].x, door.door_corners[i].y, 0);
+      corners[i] = bwi::Point2f(corner.x(), corner.y());
+    }
+
+    DoorOpennessEstimator::Estimate estimate = door_openness_estimator_.estimate(*grid, corners[0], corners[1]);
+    if (!estimate.known) {
+      ROS_INFO_STREAM("BwiLogicalTranslator: obstacle grid doesn't show door " << door_name << ", asking the planner.");
+      return false;
+    }
+    ROS_INFO_STREAM("BwiLogicalTranslator: door " << door_name << " is " << 100 * estimate.traversable_ratio <<
+                    "% free, with a widest gap of " << estimate.widest_gap << "m.");
+    open = estimate.open;
+    return true;
+  }
+
+  bool BwiLogicalTranslator::isDoorOpenUsingPlanner(const std::string &door_name) {
+
     enableStaticCostmap(false);
     // TODO: this should not be necesary, since we make service calls 
     boost::this_thread::sleep(boost::posix_time::milliseconds(250));
@@ -260,6 +375,17 @@ namespace bwi_logical_translator {
       return false;
     }
     const auto& door = name_to_door[door_name];
+    if (approach_cache_.hasDoor(door_name)) {
+      const bwi_mapper::Point2d grid(bwi_mapper::toGrid(current_location, info_));
+      int approach_idx = approach_cache_.getApproachPointIdx(door_name, grid);
+      if (approach_idx == ApproachCache::NOT_APPROACHABLE) {
+        return false;
+      }
+      point = door.approach_points[approach_idx];
+      yaw = door.approach_yaw[approach_idx];
+      return true;
+    }
+
     // See if we've calculated the approachable space for this door.
     if (door_approachable_space_1_.find(door_name) == door_approachable_space_1_.end()) {
 
@@ -299,6 +425,11 @@ namespace bwi_logical_translator {
       return false;
     }
 
+    if (approach_cache_.hasObject(object_name)) {
+      const bwi_mapper::Point2d grid_pt(bwi_mapper::toGrid(current_location, info_));
+      return approach_cache_.isObjectApproachable(object_name, grid_pt);
+    }
+
     if (location_approachable_space_.find(object_name) == location_approachable_space_.end()) {
       const geometry_msgs::Pose& object_pose = location_approach_map_[object_name];
       const bwi_mapper::Point2d approach_pt(bwi_mapper::toGrid(bwi_mapper::Point2f(object_pose.position.x,
@@ -0,0 +1,107 @@
+/**
+ * \file  door_openness.cpp
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+#include <algorithm>
+#include <cmath>
+
+#include <bwi_logical_translator/door_openness.h>
+
+namespace bwi_logical_translator {
+
+  namespace {
+
+    enum SampleState { FREE, BLOCKED, UNKNOWN };
+
+    inline SampleState getCellState(const nav_msgs::OccupancyGrid& grid, float x, float y, int obstacle_threshold) {
+      int col = (int) std::floor((x - grid.info.origin.position.x) / grid.info.resolution);
+      int row = (int) std::floor((y - grid.info.origin.position.y) / grid.info.resolution);
+      if (col < 0 || row < 0 || col >= (int) grid.info.width || row >= (int) grid.info.height) {
+        return UNKNOWN;
+      }
+      int value = grid.data[row * grid.info.width + col];
+      if (value < 0) {
+        return UNKNOWN;
+      }
+      return (value >= obstacle_threshold) ? BLOCKED : FREE;
+    }
+
+  } /* namespace */
+
+  DoorOpennessEstimator::Estimate DoorOpennessEstimator::estimate(const nav_msgs::OccupancyGrid& grid,
+                                                                  const bwi::Point2f& corner_0,
+                                                                  const bwi::Point2f& corner_1) const {
+    Estimate estimate;
+    float resolution = grid.info.resolution;
+    bwi::Point2f along = corner_1 - corner_0;
+    float length = bwi::getMagnitude(along);
+    float doorway = length - 2 * params_.corner_margin;
+    if (resolution <= 0 || grid.data.size() != grid.info.width * grid.info.height || doorway <= 0) {
+      return estimate;
+    }
+    along *= 1.0f / length;
+    bwi::Point2f across(-along.y, along.x);
+
+    // Half a cell apart, so that no cell the segment crosses is skipped.
+    int num_samples = std::max(1, (int) std::ceil(doorway / (0.5f * resolution)));
+    float spacing = doorway / num_samples;
+    int band = (int) std::ceil(params_.band_depth / (0.5f * resolution));
+    float band_spacing = (band > 0) ? params_.band_depth / band : 0;
+
+    int num_free = 0, num_unknown = 0, run = 0, widest_run = 0;
+    for (int i = 0; i < num_samples; ++i) {
+      bwi::Point2f sample = corner_0 + along * (params_.corner_margin + (i + 0.5f) * spacing);
+      SampleState state = FREE;
+      for (int k = -band; k <= band && state != BLOCKED; ++k) {
+        bwi::Point2f pt = sample + across * (k * band_spacing);
+        SampleState cell = getCellState(grid, pt.x, pt.y, params_.obstacle_threshold);
+        if (cell != FREE) {
+          state = cell;
+        }
+      }
+      if (state == FREE) {
+        ++num_free;
+        widest_run = std::max(widest_run, ++run);
+      } else {
+        num_unknown += (state == UNKNOWN);
+        run = 0;
+      }
+    }
+
+    estimate.known = num_unknown <= params_.max_unknown_ratio * num_samples;
+    estimate.traversable_ratio = (float) num_free / num_samples;
+    estimate.widest_gap = widest_run * spacing;
+    estimate.open = estimate.known && estimate.widest_gap >= params_.min_gap_width &&
+      estimate.traversable_ratio >= params_.min_open_ratio;
+    return estimate;
+  }
+
+} /* bwi_logical_translator */
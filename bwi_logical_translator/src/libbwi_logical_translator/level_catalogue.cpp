@@ -0,0 +1,234 @@
+/**
+ * \file  level_catalogue.cpp
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+
+#include <sys/stat.h>
+
+#include <boost/filesystem.hpp>
+#include <bwi_mapper/map_loader.h>
+#include <bwi_planning_common/utils.h>
+#include <multi_level_map_utils/utils.h>
+
+#include <bwi_logical_translator/approach_cache.h>
+#include <bwi_logical_translator/level_catalogue.h>
+
+namespace bwi_logical_translator {
+
+  const bwi_planning_common::Door* LevelCatalogue::Level::getDoor(const std::string& door_name) const {
+    std::map<std::string, size_t>::const_iterator it = door_idx_.find(door_name);
+    return (it != door_idx_.end()) ? &doors[it->second] : NULL;
+  }
+
+  bool LevelCatalogue::Level::hasLocation(const std::string& location_name) const {
+    return location_idx_.find(location_name) != location_idx_.end();
+  }
+
+  LevelCatalogue::LevelConstPtr LevelCatalogue::loadLevel(const Source& source) {
+    boost::shared_ptr<Level> level(new Level);
+    level->source = source;
+    if (!source.level_id.empty()) {
+      level->frame_id = multi_level_map::frameIdFromLevelId(source.level_id);
+    }
+
+    std::string door_file = bwi_planning_common::getDoorsFileLocationFromDataDirectory(source.data_directory);
+    bwi_planning_common::readDoorFile(door_file, level->doors);
+    level->doors_hash = ApproachCache::hashFile(door_file);
+
+    std::string region_file = bwi_planning_common::getLocationsFileLocationFromDataDirectory(source.data_directory);
+    bwi_planning_common::readLocationFile(region_file, level->locations, level->location_map);
+
+    // Objects are optional.
+    std::string object_file = bwi_planning_common::getObjectsFileLocationFromDataDirectory(source.data_directory);
+    if (boost::filesystem::exists(object_file)) {
+      bwi_planning_common::readObjectApproachFile(object_file, level->object_approach_map);
+    }
+    level->objects_hash = ApproachCache::hashFile(object_file);
+
+    // Not MapLoader, which exits if it can't read a map: a broken map on another floor mustn't take the node down.
+    bwi_mapper::loadMapFile(source.map_file, level->map);
+    std::string map_with_doors_file =
+      bwi_planning_common::getDoorsMapLocationFromDataDirectory(source.data_directory);
+    bwi_mapper::loadMapFile(map_with_doors_file, level->map_with_doors);
+
+    // Keep the first of any duplicate names, as the linear searches through these lists do.
+    for (size_t i = 0; i < level->doors.size(); ++i) {
+      level->door_idx_.insert(std::make_pair(level->doors[i].name, i));
+    }
+    for (size_t i = 0; i < level->locations.size(); ++i) {
+      level->location_idx_.insert(std::make_pair(level->locations[i], i));
+    }
+    return level;
+  }
+
+  LevelCatalogue::LevelCatalogue() : index_(new Index) {}
+
+  std::vector<std::string> LevelCatalogue::getLevelFiles(const Source& source) {
+    // The images are assumed to sit next to their yaml files under the usual names, as they do in all our maps.
+    std::vector<std::string> files;
+    files.push_back(source.map_file);
+    files.push_back(boost::filesystem::path(source.map_file).replace_extension(".pgm").string());
+    files.push_back(bwi_planning_common::getDoorsMapLocationFromDataDirectory(source.data_directory));
+    files.push_back(bwi_planning_common::getDoorsMapImageLocationFromDataDirectory(source.data_directory));
+    files.push_back(bwi_planning_common::getDoorsFileLocationFromDataDirectory(source.data_directory));
+    files.push_back(bwi_planning_common::getLocationsFileLocationFromDataDirectory(source.data_directory));
+    files.push_back(bwi_planning_common::getLocationsImageFileLocationFromDataDirectory(source.data_directory));
+    files.push_back(bwi_planning_common::getObjectsFileLocationFromDataDirectory(source.data_directory));
+    return files;
+  }
+
+  void LevelCatalogue::statFile(const std::string& filename, FileSignature& signature) {
+    struct stat info;
+    signature.filename = filename;
+    signature.exists = (::stat(filename.c_str(), &info) == 0);
+    signature.size = signature.exists ? info.st_size : 0;
+    signature.mtime_sec = signature.exists ? info.st_mtim.tv_sec : 0;
+    signature.mtime_nsec = signature.exists ? info.st_mtim.tv_nsec : 0;
+  }
+
+  std::vector<LevelCatalogue::FileSignature> LevelCatalogue::signFiles(const Source& source) {
+    std::vector<std::string> filenames = getLevelFiles(source);
+    std::vector<FileSignature> files(filenames.size());
+    for (size_t i = 0; i < filenames.size(); ++i) {
+      statFile(filenames[i], files[i]);
+      files[i].hash = ApproachCache::hashFile(filenames[i]);
+    }
+    return files;
+  }
+
+  bool LevelCatalogue::isUnchanged(std::vector<FileSignature>& files) {
+    for (size_t i = 0; i < files.size(); ++i) {
+      FileSignature current;
+      statFile(files[i].filename, current);
+      if (current.exists != files[i].exists) {
+        return false;
+      }
+      if (current.size == files[i].size && current.mtime_sec == files[i].mtime_sec &&
+          current.mtime_nsec == files[i].mtime_nsec) {
+        continue;
+      }
+      current.hash = ApproachCache::hashFile(files[i].filename);
+      if (current.hash != files[i].hash) {
+        return false;
+      }
+      files[i] = current;
+    }
+    return true;
+  }
+
+  size_t LevelCatalogue::update(const std::vector<Source>& sources) {
+    boost::mutex::scoped_lock lock(update_mutex_);
+    boost::shared_ptr<const Index> old_index = boost::atomic_load(&index_);
+    boost::shared_ptr<Index> index(new Index);
+
+    size_t num_read = 0;
+    for (size_t i = 0; i < sources.size(); ++i) {
+      const Source& source = sources[i];
+      Entry entry;
+      std::map<std::string, Entry>::const_iterator old = old_index->levels.find(source.level_id);
+      if (old != old_index->levels.end() && old->second.level->source == source) {
+        entry = old->second;
+        if (!isUnchanged(entry.files)) {
+          entry.level.reset();
+        }
+      }
+      if (!entry.level) {
+        // Sign the files before reading them, so that a change made while reading shows up next time.
+        entry.files = signFiles(source);
+        entry.level = loadLevel(source);
+        ++num_read;
+      }
+      index->levels[source.level_id] = entry;
+    }
+
+    for (std::map<std::string, Entry>::const_iterator it = index->levels.begin(); it != index->levels.end(); ++it) {
+      const std::vector<std::string>& locations = it->second.level->locations;
+      for (size_t i = 0; i < locations.size(); ++i) {
+        index->location_to_level.insert(std::make_pair(locations[i], it->first));
+      }
+    }
+
+    boost::atomic_store(&index_, boost::shared_ptr<const Index>(index));
+
+    // Point the active level at its new copy, if it was read again.
+    LevelConstPtr active = boost::atomic_load(&active_level_);
+    if (active) {
+      std::map<std::string, Entry>::const_iterator it = index->levels.find(active->source.level_id);
+      if (it != index->levels.end() && it->second.level != active) {
+        boost::atomic_store(&active_level_, it->second.level);
+      }
+    }
+    return num_read;
+  }
+
+  LevelCatalogue::LevelConstPtr LevelCatalogue::getLevel(const std::string& level_id) const {
+    boost::shared_ptr<const Index> index = boost::atomic_load(&index_);
+    std::map<std::string, Entry>::const_iterator it = index->levels.find(level_id);
+    return (it != index->levels.end()) ? it->second.level : LevelConstPtr();
+  }
+
+  LevelCatalogue::LevelConstPtr LevelCatalogue::getLevelFromFrameId(const std::string& frame_id) const {
+    return getLevel(multi_level_map::levelIdFromFrameId(frame_id));
+  }
+
+  LevelCatalogue::LevelConstPtr LevelCatalogue::findLevelWithLocation(const std::string& location_name) const {
+    boost::shared_ptr<const Index> index = boost::atomic_load(&index_);
+    std::map<std::string, std::string>::const_iterator it = index->location_to_level.find(location_name);
+    if (it == index->location_to_level.end()) {
+      return LevelConstPtr();
+    }
+    return index->levels.find(it->second)->second.level;
+  }
+
+  std::vector<std::string> LevelCatalogue::getLevelIds() const {
+    boost::shared_ptr<const Index> index = boost::atomic_load(&index_);
+    std::vector<std::string> level_ids;
+    for (std::map<std::string, Entry>::const_iterator it = index->levels.begin(); it != index->levels.end(); ++it) {
+      level_ids.push_back(it->first);
+    }
+    return level_ids;
+  }
+
+  bool LevelCatalogue::activate(const std::string& level_id) {
+    boost::mutex::scoped_lock lock(update_mutex_);
+    LevelConstPtr level = getLevel(level_id);
+    if (!level) {
+      return false;
+    }
+    boost::atomic_store(&active_level_, level);
+    return true;
+  }
+
+  LevelCatalogue::LevelConstPtr LevelCatalogue::getActiveLevel() const {
+    return boost::atomic_load(&active_level_);
+  }
+
+} /* bwi_logical_translator */
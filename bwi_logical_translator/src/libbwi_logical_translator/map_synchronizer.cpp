@@ -0,0 +1,139 @@
+/**
+ * \file  map_synchronizer.cpp
+ *
+ * Copyright (c) 2013, UT Austin
+
+ All rights reserved.
+
+ Redistribution and use in source and binary forms, with or without
+ modification, are permitted provided that the following conditions are met:
+ * Redistributions of source code must retain the above copyright
+ notice, this list of conditions and the following disclaimer.
+ * Redistributions in binary form must reproduce the above copyright
+ notice, this list of conditions and the following disclaimer in the
+ documentation and/or other materials provided with the distribution.
+ * Neither the name of the <organization> nor the
+ names of its contributors may be used to endorse or promote products
+ derived from this software without specific prior written permission.
+
+ THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ DISCLAIMED. IN NO EVENT SHALL <COPYRIGHT HOLDER> BE LIABLE FOR ANY
+ DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+ *
+ **/
+
+#include <boost/bind.hpp>
+
+#include <bwi_logical_translator/map_synchronizer.h>
+
+namespace bwi_logical_translator {
+
+  MapSynchronizer::MapSynchronizer(const PublishFunction& publish, double timeout) :
+      publish_(publish), timeout_(boost::posix_time::microseconds((int64_t) (timeout * 1e6))), requested_(0),
+      requested_key_(0), published_(0), published_key_(0), acknowledged_(0), outstanding_(false), stopped_(false),
+      timeout_thread_(boost::bind(&MapSynchronizer::watchTimeouts, this)) {}
+
+  MapSynchronizer::~MapSynchronizer() {
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      stopped_ = true;
+    }
+    published_condition_.notify_all();
+    timeout_thread_.join();
+  }
+
+  MapSynchronizer::Future MapSynchronizer::request(uint64_t key) {
+    boost::mutex::scoped_lock lock(mutex_);
+    uint64_t generation = ++requested_;
+    requested_key_ = key;
+    if (!outstanding_) {
+      publishLocked();
+    }
+    // Otherwise this request replaces any other made since the outstanding map was published.
+    return Future(this, generation);
+  }
+
+  void MapSynchronizer::publishLocked() {
+    published_ = requested_;
+    published_key_ = requested_key_;
+    outstanding_ = true;
+    deadline_ = boost::get_system_time() + timeout_;
+    publish_(published_key_, published_);
+    published_condition_.notify_all();
+  }
+
+  void MapSynchronizer::watchTimeouts() {
+    boost::mutex::scoped_lock lock(mutex_);
+    while (!stopped_) {
+      if (!outstanding_) {
+        published_condition_.wait(lock);
+      } else if (boost::get_system_time() < deadline_) {
+        published_condition_.timed_wait(lock, deadline_);
+      } else {
+        // Assume the acknowledgement was missed. The map can still be acknowledged if nothing replaces it.
+        outstanding_ = false;
+        if (requested_ > published_) {
+          publishLocked();
+        }
+      }
+    }
+  }
+
+  bool MapSynchronizer::getPendingKey(uint64_t& key) const {
+    boost::mutex::scoped_lock lock(mutex_);
+    key = published_key_;
+    return acknowledged_ < published_;
+  }
+
+  bool MapSynchronizer::acknowledge(uint64_t key) {
+    boost::mutex::scoped_lock lock(mutex_);
+    if (acknowledged_ == published_ || key != published_key_) {
+      // The costmap was updated for some other reason, or still shows an older map.
+      return false;
+    }
+    acknowledged_ = published_;
+    outstanding_ = false;
+    if (requested_ > published_) {
+      publishLocked();
+    }
+    acknowledged_condition_.notify_all();
+    return true;
+  }
+
+  uint64_t MapSynchronizer::getAcknowledgedGeneration() const {
+    boost::mutex::scoped_lock lock(mutex_);
+    return acknowledged_;
+  }
+
+  bool MapSynchronizer::Future::ready() const {
+    if (!synchronizer_) {
+      return true;
+    }
+    boost::mutex::scoped_lock lock(synchronizer_->mutex_);
+    return synchronizer_->acknowledged_ >= generation_;
+  }
+
+  bool MapSynchronizer::Future::wait(double timeout) const {
+    if (!synchronizer_) {
+      return true;
+    }
+    boost::system_time deadline = boost::get_system_time() +
+      boost::posix_time::microseconds((int64_t) (timeout * 1e6));
+    boost::mutex::scoped_lock lock(synchronizer_->mutex_);
+    while (synchronizer_->acknowledged_ < generation_) {
+      if (!synchronizer_->acknowledged_condition_.timed_wait(lock, deadline)) {
+        return synchronizer_->acknowledged_ >= generation_;
+      }
+    }
+    return true;
+  }
+
+} /* bwi_logical_translator */
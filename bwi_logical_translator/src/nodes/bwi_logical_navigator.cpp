@@ -37,6 +37,8 @@
 #include "bwi_logical_navigator.h"
 
 
+#include <cmath>
+
 #include <actionlib/client/simple_action_client.h>
 #include <actionlib/client/terminal_state.h>
 #include <actionlib/server/simple_action_server.h>
@@ -60,7 +62,9 @@
 
 BwiLogicalNavigator::BwiLogicalNavigator() :
     robot_x_(0), robot_y_(0), robot_yaw_(0), current_level_id_(""), execute_action_server_started_(false),
-    change_level_client_available_(false), robot_controller_available_(false) {
+    change_level_client_available_(false),
+    map_synchronizer_(boost::bind(&BwiLogicalNavigator::publishMap, this, _1, _2)), map_version_(0),
+    robot_controller_available_(false) {
 
   ROS_INFO("BwiLogicalNavigator: Advertising services!");
 
@@ -117,8 +121,23 @@ BwiLogicalNavigator::BwiLogicalNavigator() :
                                                1,
                                                &BwiLogicalNavigator::costmapUpdatesSubscriber,
                                                this);
-  global_costmap_width_ = -1;
-  full_global_costmap_update_ = false;
+
+  obstacle_grid_subscriber_ = nh_->subscribe("move_base/local_costmap/costmap",
+                                             1,
+                                             &BwiLogicalNavigator::obstacleGridHandler,
+                                             this);
+}
+
+void BwiLogicalNavigator::obstacleGridHandler(const nav_msgs::OccupancyGrid::ConstPtr &grid) {
+  // The latest transform is close enough for a grid that gets republished every few hundred milliseconds.
+  tf::StampedTransform global_to_grid;
+  try {
+    tf_->lookupTransform(grid->header.frame_id, global_frame_id_, ros::Time(0), global_to_grid);
+  } catch (const tf::TransformException &ex) {
+    ROS_DEBUG_STREAM("bwi_logical_navigator: Ignoring obstacle grid: " << ex.what());
+    return;
+  }
+  updateObstacleGrid(grid, global_to_grid);
 }
 
 void BwiLogicalNavigator::currentLevelHandler(const multi_level_map_msgs::LevelMetaData::ConstPtr &current_level) {
@@ -127,7 +146,17 @@ void BwiLogicalNavigator::currentLevelHandler(const multi_level_map_msgs::LevelM
     ros::param::set("~map_file", resolved_map_file);
     std::string resolved_data_directory = bwi_tools::resolveRosResource(current_level->data_directory);
     ros::param::set("~data_directory", resolved_data_directory);
-    if (BwiLogicalTranslator::initialize()) {
+    // Levels from the multimap have been read already. Others, e.g. when the multimap hasn't arrived yet, are read
+    // from disk.
+    bool initialized;
+    if (level_catalogue_.activate(current_level->level_id)) {
+      initialized = BwiLogicalTranslator::initialize(*level_catalogue_.getActiveLevel());
+    } else {
+      initialized = BwiLogicalTranslator::initialize();
+    }
+    if (initialized) {
+      ++map_version_;
+      updateNavigationMapCells();
       publishNavigationMap();
       // Once the translator is initialized, update the current level id.
       current_level_id_ = current_level->level_id;
@@ -135,28 +164,99 @@ void BwiLogicalNavigator::currentLevelHandler(const multi_level_map_msgs::LevelM
   }
 }
 
+void BwiLogicalNavigator::updateNavigationMapCells() {
+  boost::mutex::scoped_lock lock(navigation_map_cells_mutex_);
+  navigation_map_cells_.version = map_version_;
+  navigation_map_cells_.info = map_.info;
+  navigation_map_cells_.walls.clear();
+  navigation_map_cells_.doors.clear();
+  for (size_t i = 0; i < map_.data.size() && i < map_with_doors_.data.size(); ++i) {
+    if (map_.data[i] == 100) {
+      navigation_map_cells_.walls.push_back(i);
+    } else if (map_with_doors_.data[i] == 100) {
+      navigation_map_cells_.doors.push_back(i);
+    }
+  }
+}
+
+bool BwiLogicalNavigator::costmapShowsMap(uint64_t key,
+                                          const nav_msgs::MapMetaData &info,
+                                          const std::vector<int8_t> &data) {
+  boost::mutex::scoped_lock lock(navigation_map_cells_mutex_);
+  const NavigationMapCells &cells = navigation_map_cells_;
+  if (key / 2 != cells.version) {
+    return false;
+  }
+  // The static layer gives the global costmap the geometry of the map.
+  if (info.width != cells.info.width || info.height != cells.info.height ||
+      fabs(info.resolution - cells.info.resolution) > 1e-6 ||
+      fabs(info.origin.position.x - cells.info.origin.position.x) > 0.5 * cells.info.resolution ||
+      fabs(info.origin.position.y - cells.info.origin.position.y) > 0.5 * cells.info.resolution ||
+      data.size() != (size_t) info.width * info.height) {
+    return false;
+  }
+  // Occupied map cells are lethal, which the costmap publishes as 100.
+  for (size_t i = 0; i < cells.walls.size(); ++i) {
+    if (data[cells.walls[i]] != 100) {
+      return false;
+    }
+  }
+  if (cells.doors.empty()) {
+    return true;
+  }
+  size_t lethal_doors = 0;
+  for (size_t i = 0; i < cells.doors.size(); ++i) {
+    lethal_doors += (data[cells.doors[i]] == 100) ? 1 : 0;
+  }
+  bool with_doors = (key % 2 == 1);
+  return with_doors ? (lethal_doors == cells.doors.size()) : (lethal_doors < cells.doors.size());
+}
+
 void BwiLogicalNavigator::costmapSubscriber(const nav_msgs::OccupancyGrid::ConstPtr &costmap) {
-  global_costmap_width_ = costmap->info.width;
+  {
+    boost::mutex::scoped_lock lock(navigation_map_cells_mutex_);
+    global_costmap_info_ = costmap->info;
+  }
+  // The whole costmap is republished when a new map changes its size.
+  uint64_t key;
+  if (map_synchronizer_.getPendingKey(key) && costmapShowsMap(key, costmap->info, costmap->data)) {
+    map_synchronizer_.acknowledge(key);
+  }
 }
 
 void BwiLogicalNavigator::costmapUpdatesSubscriber(const map_msgs::OccupancyGridUpdate::ConstPtr &costmap_updates) {
-  if (global_costmap_width_ != -1 && costmap_updates->width == global_costmap_width_) {
-    full_global_costmap_update_ = true;
+  nav_msgs::MapMetaData info;
+  {
+    boost::mutex::scoped_lock lock(navigation_map_cells_mutex_);
+    info = global_costmap_info_;
+  }
+  // A new map of the same size comes as an update of the whole costmap.
+  if (costmap_updates->x != 0 || costmap_updates->y != 0 ||
+      costmap_updates->width != info.width || costmap_updates->height != info.height) {
+    return;
+  }
+  uint64_t key;
+  if (map_synchronizer_.getPendingKey(key) && costmapShowsMap(key, info, costmap_updates->data)) {
+    map_synchronizer_.acknowledge(key);
   }
 }
 
 void BwiLogicalNavigator::multimapHandler(const multi_level_map_msgs::MultiLevelMapData::ConstPtr &multimap) {
 
-  // Read in the objects for each level.
+  // Read in every level once. Levels that haven't changed on disk since the last multimap are kept as they are.
+  std::vector<bwi_logical_translator::LevelCatalogue::Source> sources;
   BOOST_FOREACH(const multi_level_map_msgs::LevelMetaData &level, multimap->levels) {
-          std::string resolved_data_directory = bwi_tools::resolveRosResource(level.data_directory);
-          std::string doors_file = resolved_data_directory + "/doors.yaml";
-          std::string locations_file = resolved_data_directory + "/locations.yaml";
-          bwi_planning_common::readDoorFile(doors_file, level_to_doors_map_[level.level_id]);
-          bwi_planning_common::readLocationFile(locations_file,
-                                                level_to_loc_names_map_[level.level_id],
-                                                level_to_loc_map_[level.level_id]);
+          sources.push_back(bwi_logical_translator::LevelCatalogue::Source(
+              level.level_id,
+              bwi_tools::resolveRosResource(level.map_file),
+              bwi_tools::resolveRosResource(level.data_directory)));
         }
+  try {
+    size_t num_read = level_catalogue_.update(sources);
+    ROS_INFO_STREAM("BwiLogicalNavigator: Read " << num_read << " of " << sources.size() << " levels from disk.");
+  } catch (const std::exception &e) {
+    ROS_ERROR_STREAM("BwiLogicalNavigator: Could not read the multimap, keeping the levels read before: " << e.what());
+  }
 
   // Start the change level service client.
   if (!change_level_client_available_) {
@@ -171,30 +271,21 @@ void BwiLogicalNavigator::multimapHandler(const multi_level_map_msgs::MultiLevel
 }
 
 void BwiLogicalNavigator::publishNavigationMap(bool publish_map_with_doors, bool wait_for_costmap_change) {
-  if (wait_for_costmap_change) {
-    full_global_costmap_update_ = false;
-  }
-  if (publish_map_with_doors) {
-    navigation_map_publisher_.publish(map_with_doors_);
-    last_map_published_with_doors_ = true;
-  } else {
-    navigation_map_publisher_.publish(map_);
-    last_map_published_with_doors_ = false;
-  }
-  if (wait_for_costmap_change) {
-    int counter = 0;
-    // TODO: Use a different sleep?
-    while (!full_global_costmap_update_ && counter < 100) {
-      boost::this_thread::sleep(boost::posix_time::milliseconds(20));
-      counter++;
-    }
-    if (counter == 100) {
-      ROS_WARN_STREAM(
-          "bwi_logical_navigator: Waited 2 seconds for move_base global costmap to change, but it did not. I'll move forward with the assumption that the map changed and I missed the notification.");
-    }
+  last_map_published_with_doors_ = publish_map_with_doors;
+  bwi_logical_translator::MapSynchronizer::Future published =
+    map_synchronizer_.request(2 * map_version_ + (publish_map_with_doors ? 1 : 0));
+  if (wait_for_costmap_change && !published.wait(2.0)) {
+    ROS_WARN_STREAM(
+        "bwi_logical_navigator: Waited 2 seconds for move_base global costmap to change, but it did not. I'll move forward with the assumption that the map changed and I missed the notification.");
   }
 }
 
+void BwiLogicalNavigator::publishMap(uint64_t key, uint64_t generation) {
+  nav_msgs::OccupancyGrid &map = (key % 2 == 1) ? map_with_doors_ : map_;
+  map.header.seq = generation;
+  navigation_map_publisher_.publish(map);
+}
+
 void BwiLogicalNavigator::senseState(bwi_msgs::LogicalNavigationState &observations) {
 
   ROS_INFO_STREAM("sensing state");
@@ -402,21 +493,12 @@ bool BwiLogicalNavigator::resolveChangeFloorRequest(const std::string &new_room,
       return false;
     }
   }
-  bool new_room_found = false;
-  typedef std::pair<std::string, std::vector<std::string> > Level2LocNamesPair;
-  BOOST_FOREACH(const Level2LocNamesPair &level_to_loc, level_to_loc_names_map_) {
-          if (std::find(level_to_loc.second.begin(), level_to_loc.second.end(), new_room) !=
-              level_to_loc.second.end()) {
-            new_room_found = true;
-            floor_name = level_to_loc.first;
-            break;
-          }
-        }
-
-  if (!new_room_found) {
+  bwi_logical_translator::LevelCatalogue::LevelConstPtr level = level_catalogue_.findLevelWithLocation(new_room);
+  if (!level) {
     error_message = "Location " + new_room + " has not been defined on any floor!";
     return false;
   }
+  floor_name = level->source.level_id;
 
   if (current_level_id_ == floor_name) {
     error_message = "The robot is already on " + floor_name + " (in which " + new_room + " exists)!";
@@ -424,20 +506,12 @@ bool BwiLogicalNavigator::resolveChangeFloorRequest(const std::string &new_room,
   }
 
   // Now find the door on this floor that corresponds to facing_door
-  bool door_found;
-  bwi_planning_common::Door door;
-  BOOST_FOREACH(const bwi_planning_common::Door &floor_door, level_to_doors_map_[floor_name]) {
-          if (floor_door.name == facing_door) {
-            door_found = true;
-            door = floor_door;
-            break;
-          }
-        }
-
-  if (!door_found) {
+  const bwi_planning_common::Door *floor_door = level->getDoor(facing_door);
+  if (!floor_door) {
     error_message = "Door " + facing_door + " has not been defined on floor " + floor_name + "!";
     return false;
   }
+  const bwi_planning_common::Door &door = *floor_door;
 
   bwi::Point2f approach_pt;
   float approach_yaw = 0;
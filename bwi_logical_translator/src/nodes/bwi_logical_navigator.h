@@ -7,7 +7,10 @@
 #include <bwi_msgs/LogicalNavigationState.h>
 #include <bwi_msgs/CheckBool.h>
 #include <bwi_logical_translator/bwi_logical_translator.h>
+#include <bwi_logical_translator/map_synchronizer.h>
 #include <actionlib/server/simple_action_server.h>
+#include <boost/thread/mutex.hpp>
+#include <nav_msgs/MapMetaData.h>
 #include <nav_msgs/Odometry.h>
 #include <multi_level_map_msgs/LevelMetaData.h>
 #include <multi_level_map_msgs/MultiLevelMapData.h>
@@ -94,20 +97,42 @@ protected:
     ros::ServiceClient change_level_client_;
     bool change_level_client_available_;
     std::vector<multi_level_map_msgs::LevelMetaData> all_levels_;
-    std::map<std::string, std::vector<bwi_planning_common::Door> > level_to_doors_map_;
-    std::map<std::string, std::vector<std::string> > level_to_loc_names_map_;
-    std::map<std::string, std::vector<int32_t> > level_to_loc_map_;
+    bwi_logical_translator::LevelCatalogue level_catalogue_;
 
     ros::Publisher navigation_map_publisher_;
     bool last_map_published_with_doors_;
 
+    // Publishes one navigation map at a time, the latest requested. The key of a map is twice the map version plus
+    // one if it has doors, and the version changes whenever a new level is loaded.
+    bwi_logical_translator::MapSynchronizer map_synchronizer_;
+    uint64_t map_version_;
+    void publishMap(uint64_t key, uint64_t generation);
+
+    // What a costmap built from the current navigation maps looks like: the cells occupied in both maps, which are
+    // lethal in it, and the door cells, which are lethal only if the map with doors was used.
+    struct NavigationMapCells {
+      uint64_t version;
+      nav_msgs::MapMetaData info;
+      std::vector<size_t> walls;
+      std::vector<size_t> doors;
+      NavigationMapCells() : version(0) {}
+    };
+    NavigationMapCells navigation_map_cells_;
+    // Guards navigation_map_cells_ and global_costmap_info_, which the spinner threads share.
+    boost::mutex navigation_map_cells_mutex_;
+    void updateNavigationMapCells();
+    bool costmapShowsMap(uint64_t key, const nav_msgs::MapMetaData& info, const std::vector<int8_t>& data);
+
     // Subscribe to costmap and costmap updates message to ensure that a published navigation map has been accepted.
     void costmapSubscriber(const nav_msgs::OccupancyGrid::ConstPtr& costmap);
     void costmapUpdatesSubscriber(const map_msgs::OccupancyGridUpdate::ConstPtr& costmap_updates);
     ros::Subscriber costmap_subscriber_;
     ros::Subscriber costmap_updates_subscriber_;
-    bool full_global_costmap_update_;
-    int global_costmap_width_;
+    nav_msgs::MapMetaData global_costmap_info_;
+
+    // The local costmap is what door sensing looks at.
+    void obstacleGridHandler(const nav_msgs::OccupancyGrid::ConstPtr& grid);
+    ros::Subscriber obstacle_grid_subscriber_;
 
     bool robot_controller_available_;
 
@@ -0,0 +1,196 @@
+#include <bwi_logical_translator/approach_cache.h>
+#include <bwi_mapper/path_finder.h>
+#include <gtest/gtest.h>
+
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <fstream>
+
+using bwi_logical_translator::ApproachCache;
+using bwi_mapper::PathFinder;
+using bwi_mapper::Point2d;
+
+typedef std::map<std::string, std::pair<Point2d, Point2d> > DoorCells;
+typedef std::map<std::string, Point2d> ObjectCells;
+
+// A row of rooms along a corridor. Every room has a door to the corridor, and neighbouring rooms share a door
+// too, so that some doors have both sides reachable and the closer side depends on where the robot is.
+static nav_msgs::OccupancyGrid makeRooms(int rooms, DoorCells& doors, ObjectCells& objects) {
+  const int room = 12;
+  nav_msgs::OccupancyGrid map;
+  map.info.width = rooms * room + 1;
+  map.info.height = 2 * room + 1;
+  map.info.resolution = 0.05;
+  map.data.assign(map.info.width * map.info.height, 0);
+  for (int x = 0; x < (int) map.info.width; ++x) {
+    for (int y = 0; y < (int) map.info.height; ++y) {
+      if (x % room == 0 || y == 0 || y == room || y == 2 * room) {
+        map.data[y * map.info.width + x] = 100;
+      }
+    }
+  }
+  for (int r = 0; r < rooms; ++r) {
+    // a corridor door for every room but the open ones in the middle
+    int door_x = r * room + room / 2;
+    std::string name = "d" + boost::lexical_cast<std::string>(r);
+    map.data[room * map.info.width + door_x] = (r % 3 == 1) ? 0 : 100;
+    doors[name] = std::make_pair(Point2d(door_x, room - 2), Point2d(door_x, room + 2));
+    objects["o" + boost::lexical_cast<std::string>(r)] = Point2d(r * room + 3, 3);
+    if (r > 0) {
+      // an open gap between neighbouring rooms on odd rooms
+      int wall_x = r * room;
+      if (r % 2 == 1) {
+        map.data[(room / 2) * map.info.width + wall_x] = 0;
+      }
+      doors["w" + boost::lexical_cast<std::string>(r)] =
+        std::make_pair(Point2d(wall_x - 2, room / 2), Point2d(wall_x + 2, room / 2));
+    }
+  }
+  // a target inside a wall, which nothing can reach
+  objects["in_wall"] = Point2d(0, 0);
+  doors["in_wall"] = std::make_pair(Point2d(room, 1), Point2d(room, 2));
+  return map;
+}
+
+static nav_msgs::OccupancyGrid makeRandom(unsigned int seed, int width, int height, int obstacle_percent,
+                                          DoorCells& doors, ObjectCells& objects) {
+  boost::random::mt19937 rng(seed);
+  boost::random::uniform_int_distribution<int> percent(0, 99), xs(0, width - 1), ys(0, height - 1);
+  nav_msgs::OccupancyGrid map;
+  map.info.width = width;
+  map.info.height = height;
+  map.info.resolution = 0.05;
+  map.data.resize(width * height);
+  for (size_t i = 0; i < map.data.size(); ++i) {
+    // unknown space isn't an obstacle for the path finder
+    int p = percent(rng);
+    map.data[i] = (p < obstacle_percent) ? 100 : (p < obstacle_percent + 5 ? -1 : 0);
+  }
+  for (int i = 0; i < 20; ++i) {
+    doors["d" + boost::lexical_cast<std::string>(i)] =
+      std::make_pair(Point2d(xs(rng), ys(rng)), Point2d(xs(rng), ys(rng)));
+    objects["o" + boost::lexical_cast<std::string>(i)] = Point2d(xs(rng), ys(rng));
+  }
+  return map;
+}
+
+// What BwiLogicalTranslator::getApproachPoint picks with one PathFinder per approach point
+static int lazyApproachPointIdx(PathFinder& space_0, PathFinder& space_1, const Point2d& pt) {
+  int distance_0 = space_0.getManhattanDistance(pt);
+  int distance_1 = space_1.getManhattanDistance(pt);
+  if (distance_0 >= 0 || distance_1 >= 0) {
+    return (distance_0 >= 0 && (distance_0 < distance_1 || distance_1 < 0)) ? 0 : 1;
+  }
+  return ApproachCache::NOT_APPROACHABLE;
+}
+
+static void expectSameAnswers(const nav_msgs::OccupancyGrid& map, const DoorCells& doors,
+                              const ObjectCells& objects, const ApproachCache& cache) {
+  for (DoorCells::const_iterator door = doors.begin(); door != doors.end(); ++door) {
+    ASSERT_TRUE(cache.hasDoor(door->first));
+    PathFinder space_0(map, door->second.first), space_1(map, door->second.second);
+    for (int y = 0; y < (int) map.info.height; ++y) {
+      for (int x = 0; x < (int) map.info.width; ++x) {
+        Point2d pt(x, y);
+        ASSERT_EQ(lazyApproachPointIdx(space_0, space_1, pt), cache.getApproachPointIdx(door->first, pt))
+          << door->first << " at " << x << ", " << y;
+      }
+    }
+  }
+  for (ObjectCells::const_iterator object = objects.begin(); object != objects.end(); ++object) {
+    ASSERT_TRUE(cache.hasObject(object->first));
+    PathFinder space(map, object->second);
+    for (int y = 0; y < (int) map.info.height; ++y) {
+      for (int x = 0; x < (int) map.info.width; ++x) {
+        Point2d pt(x, y);
+        ASSERT_EQ(space.pathExists(pt), cache.isObjectApproachable(object->first, pt))
+          << object->first << " at " << x << ", " << y;
+      }
+    }
+  }
+}
+
+TEST(ApproachCache, MatchesPathFinderOnRooms) {
+  DoorCells doors;
+  ObjectCells objects;
+  nav_msgs::OccupancyGrid map = makeRooms(7, doors, objects);
+  ApproachCache cache;
+  cache.build(map, doors, objects);
+  expectSameAnswers(map, doors, objects, cache);
+
+  EXPECT_FALSE(cache.hasDoor("nowhere"));
+  EXPECT_EQ(ApproachCache::NOT_APPROACHABLE, cache.getApproachPointIdx("nowhere", Point2d(1, 1)));
+  EXPECT_EQ(ApproachCache::NOT_APPROACHABLE, cache.getApproachPointIdx("d0", Point2d(-1, 3)));
+  EXPECT_FALSE(cache.isObjectApproachable("o0", Point2d(3, 1000)));
+}
+
+TEST(ApproachCache, MatchesPathFinderOnRandomMaps) {
+  for (unsigned int seed = 0; seed < 10; ++seed) {
+    DoorCells doors;
+    ObjectCells objects;
+    nav_msgs::OccupancyGrid map = makeRandom(seed, 37 + seed, 29, 20 + 2 * seed, doors, objects);
+    ApproachCache cache;
+    cache.build(map, doors, objects);
+    expectSameAnswers(map, doors, objects, cache);
+  }
+}
+
+TEST(ApproachCache, SavesAndLoads) {
+  DoorCells doors;
+  ObjectCells objects;
+  nav_msgs::OccupancyGrid map = makeRooms(5, doors, objects);
+  ApproachCache built;
+  built.build(map, doors, objects);
+
+  ApproachCache::Key key;
+  key.map_hash = ApproachCache::hashMap(map);
+  key.doors_hash = 1;
+  key.objects_hash = 2;
+  std::string filename =
+    (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("approach-%%%%%%%%.bin")).string();
+  ASSERT_TRUE(built.save(filename, key));
+
+  ApproachCache loaded;
+  ASSERT_TRUE(loaded.load(filename, key));
+  expectSameAnswers(map, doors, objects, loaded);
+
+  // anything built from other data is rejected
+  ApproachCache::Key stale = key;
+  stale.doors_hash = 3;
+  EXPECT_FALSE(loaded.load(filename, stale));
+  map.data[0] = 0;
+  EXPECT_NE(key.map_hash, ApproachCache::hashMap(map));
+
+  // and so is a damaged file
+  boost::filesystem::resize_file(filename, boost::filesystem::file_size(filename) - 3);
+  EXPECT_FALSE(loaded.load(filename, key));
+  boost::filesystem::remove(filename);
+  EXPECT_FALSE(loaded.load(filename, key));
+
+  // a failed load leaves the previous tables alone
+  expectSameAnswers(makeRooms(5, doors, objects), doors, objects, loaded);
+}
+
+TEST(ApproachCache, HashesFiles) {
+  std::string filename =
+    (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("doors-%%%%%%%%.yaml")).string();
+  EXPECT_EQ(ApproachCache::hash("", 0), ApproachCache::hashFile(filename));
+  {
+    std::ofstream out(filename.c_str());
+    out << "- name: d3_414a1\n";
+  }
+  uint64_t first = ApproachCache::hashFile(filename);
+  {
+    std::ofstream out(filename.c_str());
+    out << "- name: d3_414a2\n";
+  }
+  EXPECT_NE(first, ApproachCache::hashFile(filename));
+  boost::filesystem::remove(filename);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,141 @@
+#include <bwi_logical_translator/door_openness.h>
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using bwi_logical_translator::DoorOpennessEstimator;
+using bwi_logical_translator::DoorStateCache;
+
+// A 4m x 4m grid at 5cm with a wall along y = 2 and a 1m doorway from x = 1.5 to x = 2.5 in it
+class DoorOpennessTest : public ::testing::Test {
+  protected:
+    DoorOpennessTest() : corner_0(1.5f, 2.0f), corner_1(2.5f, 2.0f) {
+      grid.info.width = 80;
+      grid.info.height = 80;
+      grid.info.resolution = 0.05;
+      grid.info.origin.position.x = 0;
+      grid.info.origin.position.y = 0;
+      grid.data.assign(grid.info.width * grid.info.height, 0);
+      fill(0.0f, 1.5f, 1.95f, 2.05f, 100);
+      fill(2.5f, 4.0f, 1.95f, 2.05f, 100);
+    }
+
+    void fill(float x0, float x1, float y0, float y1, int value) {
+      for (int row = 0; row < (int) grid.info.height; ++row) {
+        for (int col = 0; col < (int) grid.info.width; ++col) {
+          float x = (col + 0.5f) * grid.info.resolution, y = (row + 0.5f) * grid.info.resolution;
+          if (x >= x0 && x < x1 && y >= y0 && y < y1) {
+            grid.data[row * grid.info.width + col] = value;
+          }
+        }
+      }
+    }
+
+    nav_msgs::OccupancyGrid grid;
+    bwi::Point2f corner_0, corner_1;
+    DoorOpennessEstimator estimator;
+};
+
+TEST_F(DoorOpennessTest, OpenDoor) {
+  DoorOpennessEstimator::Estimate estimate = estimator.estimate(grid, corner_0, corner_1);
+  EXPECT_TRUE(estimate.known);
+  EXPECT_TRUE(estimate.open);
+  EXPECT_NEAR(1.0, estimate.traversable_ratio, 1e-6);
+  EXPECT_NEAR(0.9, estimate.widest_gap, 0.03);
+
+  // the corners can be given either way round
+  EXPECT_TRUE(estimator.estimate(grid, corner_1, corner_0).open);
+}
+
+TEST_F(DoorOpennessTest, ClosedDoor) {
+  fill(1.5f, 2.5f, 1.95f, 2.05f, 100);
+  DoorOpennessEstimator::Estimate estimate = estimator.estimate(grid, corner_0, corner_1);
+  EXPECT_TRUE(estimate.known);
+  EXPECT_FALSE(estimate.open);
+  EXPECT_EQ(0.0f, estimate.traversable_ratio);
+  EXPECT_EQ(0.0f, estimate.widest_gap);
+}
+
+TEST_F(DoorOpennessTest, DoorLeafJustInsideTheRoomBlocks) {
+  // a closed door that the costmap puts a cell off the segment
+  fill(1.5f, 2.5f, 2.05f, 2.1f, 100);
+  EXPECT_FALSE(estimator.estimate(grid, corner_0, corner_1).open);
+}
+
+TEST_F(DoorOpennessTest, PartlyBlockedDoors) {
+  // a bin against one side of the frame leaves enough room. The ratios leave out the 5cm next to each corner.
+  fill(1.5f, 1.7f, 1.8f, 2.2f, 100);
+  DoorOpennessEstimator::Estimate estimate = estimator.estimate(grid, corner_0, corner_1);
+  EXPECT_TRUE(estimate.open);
+  EXPECT_NEAR(0.75 / 0.9, estimate.traversable_ratio, 0.05);
+
+  // a half open door leaf doesn't
+  fill(1.5f, 2.1f, 1.8f, 2.2f, 100);
+  estimate = estimator.estimate(grid, corner_0, corner_1);
+  EXPECT_FALSE(estimate.open);
+  EXPECT_NEAR(0.35, estimate.widest_gap, 0.03);
+}
+
+TEST_F(DoorOpennessTest, TwoNarrowGapsDontMakeAnOpenDoor) {
+  // most of the doorway is free, but there is a person in the middle of it
+  fill(1.9f, 2.1f, 1.9f, 2.1f, 100);
+  DoorOpennessEstimator::Estimate estimate = estimator.estimate(grid, corner_0, corner_1);
+  EXPECT_TRUE(estimate.known);
+  EXPECT_GT(estimate.traversable_ratio, 0.7f);
+  EXPECT_LT(estimate.widest_gap, 0.5f);
+  EXPECT_FALSE(estimate.open);
+}
+
+TEST_F(DoorOpennessTest, UnknownOrOutsideTheGrid) {
+  fill(1.5f, 2.3f, 1.9f, 2.1f, -1);
+  EXPECT_FALSE(estimator.estimate(grid, corner_0, corner_1).known);
+
+  grid.info.origin.position.x = 10;
+  EXPECT_FALSE(estimator.estimate(grid, corner_0, corner_1).known);
+}
+
+TEST_F(DoorOpennessTest, DiagonalDoor) {
+  grid.data.assign(grid.data.size(), 0);
+  // a wall along y = x with a 1m gap in the middle
+  for (int row = 0; row < (int) grid.info.height; ++row) {
+    for (int col = 0; col < (int) grid.info.width; ++col) {
+      float x = (col + 0.5f) * grid.info.resolution, y = (row + 0.5f) * grid.info.resolution;
+      float along = (x + y) / std::sqrt(2.0f);
+      if (std::fabs(x - y) < 0.08f && (along < 2.33f || along > 3.33f)) {
+        grid.data[row * grid.info.width + col] = 100;
+      }
+    }
+  }
+  bwi::Point2f diagonal_0(2.33f / std::sqrt(2.0f), 2.33f / std::sqrt(2.0f));
+  bwi::Point2f diagonal_1(3.33f / std::sqrt(2.0f), 3.33f / std::sqrt(2.0f));
+  EXPECT_TRUE(estimator.estimate(grid, diagonal_0, diagonal_1).open);
+
+  fill(1.5f, 2.5f, 1.5f, 2.5f, 100);
+  EXPECT_FALSE(estimator.estimate(grid, diagonal_0, diagonal_1).open);
+}
+
+TEST(DoorStateCache, ExpiresAfterTheTTL) {
+  DoorStateCache cache(2.0);
+  bool open = false;
+  EXPECT_FALSE(cache.lookup("d3_414a1", 10.0, open));
+
+  cache.store("d3_414a1", true, 10.0);
+  EXPECT_TRUE(cache.lookup("d3_414a1", 11.5, open));
+  EXPECT_TRUE(open);
+  EXPECT_FALSE(cache.lookup("d3_414a2", 11.5, open));
+  EXPECT_FALSE(cache.lookup("d3_414a1", 12.5, open));
+  // a clock that went backwards doesn't make old states fresh
+  EXPECT_FALSE(cache.lookup("d3_414a1", 9.0, open));
+
+  cache.store("d3_414a1", false, 12.5);
+  EXPECT_TRUE(cache.lookup("d3_414a1", 13.0, open));
+  EXPECT_FALSE(open);
+
+  cache.setTTL(0.0);
+  EXPECT_FALSE(cache.lookup("d3_414a1", 13.0, open));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,263 @@
+#include <bwi_logical_translator/level_catalogue.h>
+#include <bwi_planning_common/utils.h>
+#include <gtest/gtest.h>
+#include <multi_level_map_utils/utils.h>
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+using bwi_logical_translator::LevelCatalogue;
+
+namespace {
+
+  void writeFile(const boost::filesystem::path& filename, const std::string& contents) {
+    std::ofstream out(filename.string().c_str(), std::ios::binary);
+    out << contents;
+  }
+
+  // A binary pgm where the pixel at (col, row) is value(col, row)
+  template <typename Value>
+  void writeImage(const boost::filesystem::path& filename, int width, int height, Value value) {
+    std::ostringstream out;
+    out << "P5\n" << width << " " << height << "\n255\n";
+    for (int row = 0; row < height; ++row) {
+      for (int col = 0; col < width; ++col) {
+        out << (unsigned char) value(col, row);
+      }
+    }
+    writeFile(filename, out.str());
+  }
+
+  void writeMap(const boost::filesystem::path& yaml_file, const std::string& image, int wall) {
+    writeFile(yaml_file, "image: " + image + "\nresolution: 0.1\norigin: [0.0, 0.0, 0.0]\nnegate: 0\n"
+              "occupied_thresh: 0.65\nfree_thresh: 0.196\n");
+    struct Wall {
+      int col;
+      unsigned char operator()(int c, int r) const { return (c == col) ? 0 : 254; }
+    } walls = {wall};
+    writeImage(yaml_file.parent_path() / image, 40, 30, walls);
+  }
+
+  std::string doorEntry(const std::string& name, float x, const std::string& from_0, const std::string& from_1) {
+    std::ostringstream out;
+    out << "- name: " << name << "\n"
+        << "  door_corner_pt_1: [" << x << ", 1.0]\n"
+        << "  door_corner_pt_2: [" << x << ", 2.0]\n"
+        << "  approach:\n"
+        << "    - from: " << from_0 << "\n"
+        << "      point: [" << x - 0.5 << ", 1.5, 0.0]\n"
+        << "    - from: " << from_1 << "\n"
+        << "      point: [" << x + 0.5 << ", 1.5, 3.14]\n";
+    return out.str();
+  }
+
+  struct Regions {
+    int split;
+    unsigned char operator()(int c, int r) const { return (r < 2) ? 255 : (c < split) ? 0 : (c < 2 * split) ? 1 : 2; }
+  };
+
+  void expectSameDoor(const bwi_planning_common::Door& expected, const bwi_planning_common::Door& door) {
+    EXPECT_EQ(expected.name, door.name);
+    for (int i = 0; i < 2; ++i) {
+      EXPECT_EQ(expected.approach_names[i], door.approach_names[i]);
+      EXPECT_EQ(expected.approach_points[i], door.approach_points[i]);
+      EXPECT_EQ(expected.door_corners[i], door.door_corners[i]);
+      EXPECT_EQ(expected.approach_yaw[i], door.approach_yaw[i]);
+    }
+  }
+
+} /* namespace */
+
+// Three levels, as a multimap would list them. Every level has an elevator door of the same name in a different
+// place, and the lobby is on two of them.
+class LevelCatalogueTest : public ::testing::Test {
+  protected:
+    LevelCatalogueTest() {
+      root = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("levels-%%%%%%%%");
+      level_ids.push_back("1");
+      level_ids.push_back("2");
+      level_ids.push_back("3ne");
+      for (size_t k = 0; k < level_ids.size(); ++k) {
+        const std::string& id = level_ids[k];
+        boost::filesystem::path directory = root / id;
+        boost::filesystem::create_directories(directory);
+        writeMap(directory / (id + ".yaml"), id + ".pgm", 10 + k);
+        writeMap(directory / "doors_map.yaml", "doors_map.pgm", 20 + k);
+        writeFile(directory / "doors.yaml", doorEntry("d" + id + "_1", 1.0 + k, "l" + id + "_a", "l" + id + "_b") +
+                  doorEntry("d_elevator", 3.0 + k, "l" + id + "_b", "l" + id + "_c"));
+        std::string lobby = (k > 0) ? ", l_lobby" : "";
+        writeFile(directory / "locations.yaml",
+                  "data: locations.pgm\nlocations: [l" + id + "_a, l" + id + "_b, l" + id + "_c" + lobby + "]\n");
+        Regions regions = {(int) (8 + k)};
+        writeImage(directory / "locations.pgm", 40, 30, regions);
+        if (k == 0) {
+          writeFile(directory / "objects.yaml", "- name: o1_printer\n  point: [1.0, 2.0, 0.5]\n");
+        }
+        sources.push_back(LevelCatalogue::Source(id, (directory / (id + ".yaml")).string(), directory.string()));
+      }
+    }
+
+    ~LevelCatalogueTest() {
+      boost::filesystem::remove_all(root);
+    }
+
+    // What the bwi_planning_common readers make of the level's files
+    void readReference(const LevelCatalogue::Source& source, std::vector<bwi_planning_common::Door>& doors,
+                       std::vector<std::string>& locations, std::vector<int32_t>& location_map,
+                       std::map<std::string, geometry_msgs::Pose>& objects) {
+      bwi_planning_common::readDoorFile(
+          bwi_planning_common::getDoorsFileLocationFromDataDirectory(source.data_directory), doors);
+      bwi_planning_common::readLocationFile(
+          bwi_planning_common::getLocationsFileLocationFromDataDirectory(source.data_directory),
+          locations, location_map);
+      bwi_planning_common::readObjectApproachFile(
+          bwi_planning_common::getObjectsFileLocationFromDataDirectory(source.data_directory), objects);
+    }
+
+    boost::filesystem::path root;
+    std::vector<std::string> level_ids;
+    std::vector<LevelCatalogue::Source> sources;
+};
+
+TEST_F(LevelCatalogueTest, LevelSwitchesNeedNoFiles) {
+  LevelCatalogue catalogue;
+  EXPECT_FALSE(catalogue.getActiveLevel());
+  EXPECT_EQ(3u, catalogue.update(sources));
+  EXPECT_EQ(level_ids, catalogue.getLevelIds());
+
+  std::vector<std::vector<bwi_planning_common::Door> > doors(sources.size());
+  std::vector<std::vector<std::string> > locations(sources.size());
+  std::vector<std::vector<int32_t> > location_maps(sources.size());
+  std::vector<std::map<std::string, geometry_msgs::Pose> > objects(sources.size());
+  for (size_t k = 0; k < sources.size(); ++k) {
+    readReference(sources[k], doors[k], locations[k], location_maps[k], objects[k]);
+  }
+
+  // Nothing on disk is needed any more.
+  boost::filesystem::remove_all(root);
+
+  for (int round = 0; round < 3; ++round) {
+    for (size_t k = 0; k < sources.size(); ++k) {
+      ASSERT_TRUE(catalogue.activate(level_ids[k]));
+      LevelCatalogue::LevelConstPtr level = catalogue.getActiveLevel();
+      ASSERT_TRUE(level);
+      EXPECT_EQ(level, catalogue.getLevel(level_ids[k]));
+      EXPECT_EQ(level, catalogue.getLevelFromFrameId(multi_level_map::frameIdFromLevelId(level_ids[k])));
+      EXPECT_EQ(multi_level_map::frameIdFromLevelId(level_ids[k]), level->frame_id);
+      EXPECT_EQ(sources[k], level->source);
+
+      ASSERT_EQ(doors[k].size(), level->doors.size());
+      for (size_t i = 0; i < doors[k].size(); ++i) {
+        expectSameDoor(doors[k][i], level->doors[i]);
+        const bwi_planning_common::Door* door = level->getDoor(doors[k][i].name);
+        ASSERT_TRUE(door != NULL);
+        expectSameDoor(doors[k][i], *door);
+      }
+      EXPECT_TRUE(level->getDoor("d_nowhere") == NULL);
+
+      EXPECT_EQ(locations[k], level->locations);
+      EXPECT_EQ(location_maps[k], level->location_map);
+      for (size_t i = 0; i < locations[k].size(); ++i) {
+        EXPECT_TRUE(level->hasLocation(locations[k][i]));
+      }
+
+      ASSERT_EQ(objects[k].size(), level->object_approach_map.size());
+      for (std::map<std::string, geometry_msgs::Pose>::const_iterator it = objects[k].begin();
+           it != objects[k].end(); ++it) {
+        ASSERT_EQ(1u, level->object_approach_map.count(it->first));
+        EXPECT_EQ(it->second.position.x, level->object_approach_map.find(it->first)->second.position.x);
+        EXPECT_EQ(it->second.position.y, level->object_approach_map.find(it->first)->second.position.y);
+      }
+
+      EXPECT_EQ(40u, level->map.info.width);
+      EXPECT_EQ(30u, level->map_with_doors.info.height);
+      EXPECT_NE(level->map.data, level->map_with_doors.data);
+    }
+  }
+
+  // The elevator door is a different door on every level.
+  EXPECT_NE(catalogue.getLevel("1")->getDoor("d_elevator")->door_center,
+            catalogue.getLevel("2")->getDoor("d_elevator")->door_center);
+
+  // Locations are looked up on the levels in order of id.
+  EXPECT_EQ("2", catalogue.findLevelWithLocation("l_lobby")->source.level_id);
+  EXPECT_EQ("3ne", catalogue.findLevelWithLocation("l3ne_c")->source.level_id);
+  EXPECT_FALSE(catalogue.findLevelWithLocation("l4_a"));
+  EXPECT_FALSE(catalogue.activate("4"));
+  EXPECT_EQ("3ne", catalogue.getActiveLevel()->source.level_id);
+}
+
+TEST_F(LevelCatalogueTest, OnlyChangedLevelsAreReadAgain) {
+  LevelCatalogue catalogue;
+  EXPECT_EQ(3u, catalogue.update(sources));
+  ASSERT_TRUE(catalogue.activate("2"));
+  LevelCatalogue::LevelConstPtr level_1 = catalogue.getLevel("1");
+  LevelCatalogue::LevelConstPtr level_2 = catalogue.getLevel("2");
+  LevelCatalogue::LevelConstPtr level_3 = catalogue.getLevel("3ne");
+
+  // The same multimap again
+  EXPECT_EQ(0u, catalogue.update(sources));
+  EXPECT_EQ(level_2, catalogue.getLevel("2"));
+
+  // A file that was written again without changing
+  boost::filesystem::path doors_file = root / "2" / "doors.yaml";
+  std::time_t written = boost::filesystem::last_write_time(doors_file);
+  boost::filesystem::last_write_time(doors_file, written + 10);
+  EXPECT_EQ(0u, catalogue.update(sources));
+  EXPECT_EQ(level_2, catalogue.getLevel("2"));
+
+  // A new door on level 2
+  std::ifstream in(doors_file.string().c_str());
+  std::string contents((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  writeFile(doors_file, contents + doorEntry("d2_2", 8.0, "l2_c", "l_lobby"));
+  EXPECT_EQ(1u, catalogue.update(sources));
+  EXPECT_EQ(level_1, catalogue.getLevel("1"));
+  EXPECT_EQ(level_3, catalogue.getLevel("3ne"));
+  ASSERT_NE(level_2, catalogue.getLevel("2"));
+  EXPECT_TRUE(catalogue.getLevel("2")->getDoor("d2_2") != NULL);
+  // the old level is left untouched for whoever still holds it
+  EXPECT_TRUE(level_2->getDoor("d2_2") == NULL);
+  // and the active level is the new one
+  EXPECT_EQ(catalogue.getLevel("2"), catalogue.getActiveLevel());
+
+  // A changed location image
+  Regions regions = {3};
+  writeImage(root / "1" / "locations.pgm", 40, 30, regions);
+  EXPECT_EQ(1u, catalogue.update(sources));
+  EXPECT_NE(level_1->location_map, catalogue.getLevel("1")->location_map);
+
+  // A level that is no longer in the multimap
+  sources.pop_back();
+  EXPECT_EQ(0u, catalogue.update(sources));
+  EXPECT_FALSE(catalogue.getLevel("3ne"));
+  EXPECT_FALSE(catalogue.findLevelWithLocation("l3ne_a"));
+  EXPECT_EQ("2", catalogue.findLevelWithLocation("l_lobby")->source.level_id);
+
+  // A level that moved
+  sources[1].data_directory = (root / "1").string();
+  EXPECT_EQ(1u, catalogue.update(sources));
+  EXPECT_EQ(sources[1], catalogue.getLevel("2")->source);
+}
+
+TEST_F(LevelCatalogueTest, LevelThatFailsToReadKeepsTheOldCatalogue) {
+  LevelCatalogue catalogue;
+  EXPECT_EQ(3u, catalogue.update(sources));
+  LevelCatalogue::LevelConstPtr level_3 = catalogue.getLevel("3ne");
+
+  boost::filesystem::remove(root / "3ne" / "doors.yaml");
+  EXPECT_THROW(catalogue.update(sources), std::runtime_error);
+  EXPECT_EQ(level_3, catalogue.getLevel("3ne"));
+  EXPECT_EQ(3u, catalogue.getLevelIds().size());
+
+  // It is read again once it has been fixed.
+  writeFile(root / "3ne" / "doors.yaml", doorEntry("d_elevator", 4.0, "l3ne_b", "l3ne_c"));
+  EXPECT_EQ(1u, catalogue.update(sources));
+  EXPECT_EQ(1u, catalogue.getLevel("3ne")->doors.size());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,208 @@
+#include <bwi_logical_translator/map_synchronizer.h>
+#include <gtest/gtest.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <deque>
+#include <utility>
+#include <vector>
+
+using bwi_logical_translator::MapSynchronizer;
+
+// Stands in for move_base: takes published maps in on its own thread, some time after they were published, and
+// then reports the map it shows, like the costmap callbacks do.
+class FakeCostmap {
+  public:
+    FakeCostmap(int delay_ms, double timeout = 1.0) :
+        delay_ms_(delay_ms), drop_next_(false), stop_(false), current_(0),
+        thread_(boost::bind(&FakeCostmap::run, this)),
+        synchronizer(boost::bind(&FakeCostmap::publish, this, _1, _2), timeout) {}
+
+    ~FakeCostmap() {
+      {
+        boost::mutex::scoped_lock lock(mutex_);
+        stop_ = true;
+      }
+      condition_.notify_all();
+      thread_.join();
+    }
+
+    // Every map that was published, as (key, generation)
+    std::vector<std::pair<uint64_t, uint64_t> > published() {
+      boost::mutex::scoped_lock lock(mutex_);
+      return published_;
+    }
+
+    // The key of the map the costmap is using
+    uint64_t current() {
+      boost::mutex::scoped_lock lock(mutex_);
+      return current_;
+    }
+
+    // Loses the update for the next map, as if the notification was missed
+    void dropNext() {
+      boost::mutex::scoped_lock lock(mutex_);
+      drop_next_ = true;
+    }
+
+  private:
+    void publish(uint64_t key, uint64_t generation) {
+      boost::mutex::scoped_lock lock(mutex_);
+      published_.push_back(std::make_pair(key, generation));
+      queue_.push_back(key);
+      condition_.notify_all();
+    }
+
+    void run() {
+      while (true) {
+        uint64_t key;
+        bool drop;
+        {
+          boost::mutex::scoped_lock lock(mutex_);
+          while (queue_.empty() && !stop_) {
+            condition_.wait(lock);
+          }
+          if (stop_) {
+            return;
+          }
+          key = queue_.front();
+          queue_.pop_front();
+          drop = drop_next_;
+          drop_next_ = false;
+        }
+        boost::this_thread::sleep(boost::posix_time::milliseconds(delay_ms_));
+        {
+          boost::mutex::scoped_lock lock(mutex_);
+          current_ = key;
+        }
+        if (!drop) {
+          synchronizer.acknowledge(key);
+        }
+      }
+    }
+
+    int delay_ms_;
+    bool drop_next_;
+    bool stop_;
+    uint64_t current_;
+    std::vector<std::pair<uint64_t, uint64_t> > published_;
+    std::deque<uint64_t> queue_;
+    boost::mutex mutex_;
+    boost::condition_variable condition_;
+    boost::thread thread_;
+
+  public:
+    // Last, so that it is gone before the costmap it publishes to
+    MapSynchronizer synchronizer;
+};
+
+TEST(MapSynchronizer, WaitsForTheCostmap) {
+  FakeCostmap costmap(20);
+  MapSynchronizer::Future future = costmap.synchronizer.request(1);
+  EXPECT_EQ(1u, future.getGeneration());
+  EXPECT_FALSE(future.ready());
+  uint64_t pending;
+  EXPECT_TRUE(costmap.synchronizer.getPendingKey(pending));
+  EXPECT_EQ(1u, pending);
+  EXPECT_TRUE(future.wait(1.0));
+  EXPECT_TRUE(future.ready());
+  EXPECT_FALSE(costmap.synchronizer.getPendingKey(pending));
+  EXPECT_EQ(1u, costmap.current());
+  EXPECT_EQ(1u, costmap.synchronizer.getAcknowledgedGeneration());
+}
+
+TEST(MapSynchronizer, SameMapIsPublishedAgain) {
+  FakeCostmap costmap(10);
+  EXPECT_TRUE(costmap.synchronizer.request(1).wait(1.0));
+  MapSynchronizer::Future again = costmap.synchronizer.request(1);
+  EXPECT_EQ(2u, costmap.published().size());
+  EXPECT_TRUE(again.wait(1.0));
+  EXPECT_EQ(2u, costmap.synchronizer.getAcknowledgedGeneration());
+}
+
+TEST(MapSynchronizer, BurstIsCoalescedIntoOnePublish) {
+  FakeCostmap costmap(50);
+  MapSynchronizer::Future first = costmap.synchronizer.request(1);
+  // a burst of door state changes while the first map is on its way, none of them waited on
+  std::vector<MapSynchronizer::Future> burst;
+  for (uint64_t key = 2; key <= 6; ++key) {
+    burst.push_back(costmap.synchronizer.request(key));
+  }
+  EXPECT_EQ(1u, costmap.published().size());
+
+  EXPECT_TRUE(first.wait(1.0));
+  for (size_t i = 0; i < burst.size(); ++i) {
+    EXPECT_TRUE(burst[i].wait(1.0));
+  }
+  // once the first map is in, only the latest state goes out
+  std::vector<std::pair<uint64_t, uint64_t> > published = costmap.published();
+  ASSERT_EQ(2u, published.size());
+  EXPECT_EQ(std::make_pair(uint64_t(1), uint64_t(1)), published[0]);
+  EXPECT_EQ(std::make_pair(uint64_t(6), uint64_t(6)), published[1]);
+  EXPECT_EQ(6u, costmap.current());
+  EXPECT_EQ(6u, costmap.synchronizer.getAcknowledgedGeneration());
+}
+
+TEST(MapSynchronizer, OnlyThePendingKeyIsAcknowledged) {
+  FakeCostmap costmap(10);
+  EXPECT_TRUE(costmap.synchronizer.request(2).wait(1.0));
+
+  // a floor change whose map the costmap hasn't taken in yet: it still shows the old one
+  costmap.dropNext();
+  MapSynchronizer::Future floor_change = costmap.synchronizer.request(4);
+  EXPECT_FALSE(costmap.synchronizer.acknowledge(2));
+  EXPECT_FALSE(floor_change.wait(0.1));
+
+  EXPECT_TRUE(costmap.synchronizer.acknowledge(4));
+  EXPECT_TRUE(floor_change.ready());
+  // nothing is pending any more
+  EXPECT_FALSE(costmap.synchronizer.acknowledge(4));
+}
+
+TEST(MapSynchronizer, ConcurrentRequestsArePublishedInOrder) {
+  FakeCostmap costmap(2);
+  std::vector<boost::thread*> threads;
+  std::vector<char> results(4 * 25, false);
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(new boost::thread([&costmap, &results, t]() {
+      for (int i = 0; i < 25; ++i) {
+        results[t * 25 + i] = costmap.synchronizer.request(t * 25 + i).wait(5.0);
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) {
+    threads[t]->join();
+    delete threads[t];
+  }
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_TRUE(results[i]);
+  }
+  std::vector<std::pair<uint64_t, uint64_t> > published = costmap.published();
+  ASSERT_FALSE(published.empty());
+  EXPECT_LE(published.size(), results.size());
+  for (size_t i = 1; i < published.size(); ++i) {
+    EXPECT_LT(published[i - 1].second, published[i].second);
+  }
+  EXPECT_EQ(results.size(), published.back().second);
+  EXPECT_EQ(published.back().second, costmap.synchronizer.getAcknowledgedGeneration());
+}
+
+TEST(MapSynchronizer, MissedUpdateTimesOutWithoutBlockingLaterRequests) {
+  FakeCostmap costmap(10, 0.2);
+  costmap.dropNext();
+  MapSynchronizer::Future lost = costmap.synchronizer.request(1);
+  EXPECT_FALSE(lost.wait(0.05));
+  // held back until the lost map times out, even though nobody waits for it
+  costmap.synchronizer.request(2);
+  EXPECT_EQ(1u, costmap.published().size());
+  boost::this_thread::sleep(boost::posix_time::milliseconds(400));
+  EXPECT_EQ(2u, costmap.published().size());
+  EXPECT_EQ(2u, costmap.current());
+  // the later map being in covers the lost one too
+  EXPECT_TRUE(lost.ready());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,65 @@
+#include <bwi_manipulation/grasp_utils.h>
+
+#include "../test/grasp_fixtures.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+using namespace bwi_manipulation;
+using namespace bwi_manipulation::grasp_utils;
+
+// Candidates per second, filled into the same buffer and checked against a table, then from a cloud,
+// then the way generate_heuristic_grasps used to make them.
+// Usage: benchmark_grasp_candidates [runs]
+int main(int argc, char **argv) {
+  int runs = (argc > 1) ? atoi(argv[1]) : 2000;
+  if (runs < 10) {
+    std::cerr << "usage: " << argv[0] << " [runs >= 10]" << std::endl;
+    return 1;
+  }
+
+  Cloud::Ptr cloud = boxCloud(Eigen::Vector3f(0.4, -0.1, 0.0), Eigen::Vector3f(0.5, 0.1, 0.3), 0.005);
+  Eigen::Isometry3f cloud_to_grasp = Eigen::Isometry3f::Identity();
+  cloud_to_grasp.rotate(Eigen::AngleAxisf(0.3, Eigen::Vector3f::UnitZ()));
+  Eigen::Vector4f table(0, 0, 1, 0.01);
+
+  Eigen::Vector3f min, max;
+  transformed_bounds(*cloud, cloud_to_grasp, min, max);
+  GraspCandidates candidates;
+  std::vector<char> clear;
+  size_t kept = 0;
+  clock_t start = clock();
+  for (int i = 0; i < runs; ++i) {
+    generate_heuristic_grasps(min, max, Eigen::Quaterniond::Identity(), 0.1, 0.02, candidates);
+    checkPlaneConflicts(candidates, table, 0.05, clear);
+    kept += clear[i % clear.size()];
+  }
+  double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+  std::cout << "candidates: " << runs * heuristic_grasp_count() / seconds << " per second (" << kept << ")"
+            << std::endl;
+
+  start = clock();
+  for (int i = 0; i < runs / 10; ++i) {
+    generate_heuristic_grasps(*cloud, cloud_to_grasp, Eigen::Quaterniond::Identity(), 0.1, 0.02, candidates);
+  }
+  seconds = double(clock() - start) / CLOCKS_PER_SEC;
+  std::cout << "from a " << cloud->points.size() << " point cloud: "
+            << (runs / 10) * heuristic_grasp_count() / seconds << " candidates per second" << std::endl;
+
+  geometry_msgs::QuaternionStamped grasp_x_orientation;
+  grasp_x_orientation.header.frame_id = "arm_base";
+  grasp_x_orientation.quaternion.w = 1.0;
+  start = clock();
+  for (int i = 0; i < runs / 10; ++i) {
+    std::vector<GraspCartesianCommand> commands = legacyGrasps(cloud, cloud_to_grasp, grasp_x_orientation, 0.1, 0.02);
+    for (size_t j = 0; j < commands.size(); ++j) {
+      kept += checkPlaneConflict(commands[j], table, 0.05);
+    }
+  }
+  seconds = double(clock() - start) / CLOCKS_PER_SEC;
+  std::cout << "legacy, from the same cloud: " << (runs / 10) * heuristic_grasp_count() / seconds
+            << " candidates per second (" << kept << ")" << std::endl;
+  return 0;
+}
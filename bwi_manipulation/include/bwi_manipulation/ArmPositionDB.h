@@ -2,41 +2,98 @@
 #include <ros/ros.h>
 #include <signal.h>
 #include <iostream>
+#include <map>
+#include <string>
 #include <vector>
 #include <math.h>
 #include <cstdlib>
 #include <stdio.h>
+#include <stdint.h>
 #include <std_msgs/String.h>
 
 #include <geometry_msgs/Pose.h>
 #include <geometry_msgs/PoseStamped.h>
 
+#include <bwi_manipulation/KDTree.h>
+
 namespace bwi_manipulation {
+
+    // Named arm positions, in joint space and in tool space. They are read either from the two text files
+    // (a count, then one "name<TAB>v,v,..." line per entry) or from the binary format save_binary writes,
+    // and kept in flat arrays with a k-d tree over each space.
+    //
+    // Binary format, all little endian: the 8 bytes "ARMPOSDB", then uint32 version, joints per entry,
+    // number of joint entries and number of tool entries. Each joint entry is a uint32 name length, the
+    // name and the joint values as float32. Each tool entry is the same with x, y, z, qx, qy, qz, qw.
+    //
+    // Files that can't be read or are malformed throw std::runtime_error, and asking for a name that isn't
+    // in the database throws std::out_of_range.
     class ArmPositionDB {
 
+    public:
+
+        static const size_t NUM_JOINTS = 6;
+        static const uint32_t BINARY_VERSION = 1;
+
+        struct Match {
+            std::string name;
+            float distance;
+        };
+
     private:
-        std::map<std::string, std::vector<float> > j_positions;
-        std::map<std::string, geometry_msgs::Pose> t_positions;
+        std::vector<std::string> joint_names;
+        std::vector<float> joint_values; // NUM_JOINTS per entry
+        std::vector<std::string> tool_names;
+        std::vector<float> tool_values; // x, y, z, qx, qy, qz, qw per entry
+        std::map<std::string, size_t> joint_index;
+        std::map<std::string, size_t> tool_index;
+
+        KDTree joint_tree;
+        KDTree tool_tree;
+        float orientation_weight;
+
+        void add_joint_position(const std::string &name, const float *values);
+        void add_tool_position(const std::string &name, const float *values);
+        void build_tool_tree();
 
     public:
 
-        bool has_joint_position(const std::string &name);
+        bool has_joint_position(const std::string &name) const;
 
-        bool has_tool_position(const std::string &name);
+        bool has_tool_position(const std::string &name) const;
 
         geometry_msgs::PoseStamped get_tool_position_stamped(
                 const std::string &name,
-                const std::string &frame_id);
+                const std::string &frame_id) const;
+
+        geometry_msgs::Pose get_tool_position(const std::string &name) const;
+
+        std::vector<float> get_joint_position(const std::string &name) const;
+
+        size_t num_joint_positions() const { return joint_names.size(); }
+
+        size_t num_tool_positions() const { return tool_names.size(); }
+
+        // The k stored joint positions closest to the given one, closest first
+        std::vector<Match> nearest_joint_positions(const std::vector<float> &joints, size_t k) const;
+
+        // The k stored tool poses closest to the given one, closest first. The distance between two poses is
+        // sqrt(|p - p'|^2 + w^2 min(|q - q'|^2, |q + q'|^2)), w being the orientation weight, so that q and
+        // -q are the same orientation.
+        std::vector<Match> nearest_tool_positions(const geometry_msgs::Pose &pose, size_t k) const;
 
-        geometry_msgs::Pose get_tool_position(const std::string &name);
+        // meters that a unit of quaternion distance counts for. 1 by default.
+        void set_orientation_weight(float weight);
 
-        std::vector<float> get_joint_position(const std::string &name);
+        void save_binary(const std::string &filename) const;
 
         void print();
 
         ArmPositionDB(const std::string &joint_positions_filename,
                       const std::string &tool_positions_filename);
 
+        // Reads a database written by save_binary
+        explicit ArmPositionDB(const std::string &binary_filename);
 
     };
 }
@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace bwi_manipulation {
+
+    // A k-d tree over points of a fixed dimension, for k nearest neighbour queries under the Euclidean
+    // distance. The points are copied into one contiguous array in tree order: the median of each range
+    // sits in its middle, split along the axis in which the range is widest.
+    class KDTree {
+
+    public:
+
+        struct Neighbour {
+            size_t index; // of the point, in the order it was given
+            float distance;
+        };
+
+        KDTree() : dim(0) {}
+
+        // points holds dim floats per point
+        KDTree(const std::vector<float> &points, size_t dim);
+
+        // The (at most) k points closest to query, closest first. query holds dim floats.
+        std::vector<Neighbour> nearest(const float *query, size_t k) const;
+
+        size_t size() const { return indices.size(); }
+
+    private:
+
+        typedef std::pair<float, size_t> Candidate; // squared distance, position in the tree
+
+        void build(size_t begin, size_t end, std::vector<size_t> &order, const std::vector<float> &input);
+
+        void search(size_t begin, size_t end, const float *query, size_t k, std::vector<Candidate> &heap) const;
+
+        size_t dim;
+        std::vector<float> points;
+        std::vector<size_t> indices;
+        std::vector<unsigned char> axes;
+    };
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <Eigen/Geometry>
+#include <pcl/point_cloud.h>
+
+namespace bwi_manipulation {
+    namespace grasp_utils {
+
+        // Grasp candidates kept as one array per coordinate, so that checks over all of them are plain loops.
+        // Candidate i grasps at (x, y, z)[i] with orientation (qx, qy, qz, qw)[i], and is approached from
+        // (approach_x, approach_y, approach_z)[i] with the same orientation.
+        struct GraspCandidates {
+            std::vector<float> x, y, z;
+            std::vector<float> qx, qy, qz, qw;
+            std::vector<float> approach_x, approach_y, approach_z;
+
+            size_t size() const { return x.size(); }
+
+            // Keeps the capacity, so refilling the same buffer doesn't allocate
+            void resize(size_t n);
+
+            // Sets candidate i. As in GraspCartesianCommand::from_grasp_pose, the approach position is
+            // approach_offset back along the Z axis of the orientation.
+            void set(size_t i, const Eigen::Vector3f &position, const Eigen::Quaterniond &orientation,
+                     double approach_offset);
+        };
+
+        // Poses generated along each side of the object, and orientation steps per axis above it
+        const int HEURISTIC_LINE_POSES = 10;
+        const int HEURISTIC_ORIENTATION_STEPS = 3;
+
+        size_t heuristic_grasp_count();
+
+        // How the grasps from above vary their orientation. LEGACY_ORIENTATIONS gives the orientations
+        // generate_grasps_varying_orientation gives: only roll steps across the range, pitch is scaled and
+        // yaw is fixed, so just HEURISTIC_ORIENTATION_STEPS^2 of them differ. DISTINCT_ORIENTATIONS steps roll,
+        // pitch and yaw each across the range, so that no two grasps from above are the same, and is the default.
+        // LEGACY_ORIENTATIONS is only kept to check against the old code.
+        enum HeuristicOrientations {
+            LEGACY_ORIENTATIONS,
+            DISTINCT_ORIENTATIONS
+        };
+
+        // Bounds of the finite points of the cloud once moved by cloud_to_grasp. False if there are none.
+        template<typename T>
+        bool transformed_bounds(const pcl::PointCloud<T> &cloud, const Eigen::Isometry3f &cloud_to_grasp,
+                                Eigen::Vector3f &min, Eigen::Vector3f &max) {
+            min.setConstant(std::numeric_limits<float>::max());
+            max.setConstant(-std::numeric_limits<float>::max());
+            bool any = false;
+            for (size_t i = 0; i < cloud.points.size(); ++i) {
+                const T &p = cloud.points[i];
+                if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) {
+                    continue;
+                }
+                Eigen::Vector3f q = cloud_to_grasp * Eigen::Vector3f(p.x, p.y, p.z);
+                min = min.cwiseMin(q);
+                max = max.cwiseMax(q);
+                any = true;
+            }
+            return any;
+        }
+
+        // Heuristic grasps around an axis aligned box in the grasp frame: along the front (minimum X) face,
+        // from above with varied orientations, and along both sides. grasp_x_orientation turns the gripper
+        // to point along the X axis of the grasp frame. Fills all heuristic_grasp_count() candidates.
+        void generate_heuristic_grasps(const Eigen::Vector3f &min, const Eigen::Vector3f &max,
+                                       const Eigen::Quaterniond &grasp_x_orientation,
+                                       double approach_offset, double grasp_offset,
+                                       GraspCandidates &candidates,
+                                       HeuristicOrientations orientations = DISTINCT_ORIENTATIONS);
+
+        // Same, around the box bounding the cloud once it's moved into the grasp frame by cloud_to_grasp.
+        // The cloud isn't changed. Leaves no candidates if the cloud has no finite points.
+        template<typename T>
+        void generate_heuristic_grasps(const pcl::PointCloud<T> &cloud, const Eigen::Isometry3f &cloud_to_grasp,
+                                       const Eigen::Quaterniond &grasp_x_orientation,
+                                       double approach_offset, double grasp_offset,
+                                       GraspCandidates &candidates,
+                                       HeuristicOrientations orientations = DISTINCT_ORIENTATIONS) {
+            Eigen::Vector3f min, max;
+            if (!transformed_bounds(cloud, cloud_to_grasp, min, max)) {
+                candidates.resize(0);
+                return;
+            }
+            generate_heuristic_grasps(min, max, grasp_x_orientation, approach_offset, grasp_offset, candidates,
+                                      orientations);
+        }
+
+        // checkPlaneConflict over all candidates: clear[i] is set if neither the grasp nor the approach
+        // position of candidate i is closer than min_distance_to_plane to the plane.
+        void checkPlaneConflicts(const GraspCandidates &candidates, const Eigen::Vector4f &plane_c,
+                                 float min_distance_to_plane, std::vector<char> &clear);
+
+    }
+}
@@ -1,119 +1,420 @@
-#include <tf/LinearMath/Quaternion.h>
-#include <tf/transform_datatypes.h>
 #include "bwi_manipulation/ArmPositionDB.h"
 
-#define NUM_JOINTS_ARMONLY 6
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#define NUM_TOOL_VALUES 7
 
 using namespace std;
 namespace bwi_manipulation {
 
-    ArmPositionDB::ArmPositionDB(const string &joint_positions_filename,
-                                 const string &tool_positions_filename) {
+    const size_t ArmPositionDB::NUM_JOINTS;
+    const uint32_t ArmPositionDB::BINARY_VERSION;
 
+    namespace {
 
-        FILE *fp_j = fopen(joint_positions_filename.c_str(), "r");
+        const char BINARY_MAGIC[8] = {'A', 'R', 'M', 'P', 'O', 'S', 'D', 'B'};
 
-        //the first integer is the # of entries in the file
-        int num_entries_j = 0;
-        fscanf(fp_j, "%i\n", &num_entries_j);
+        runtime_error malformed(const string &filename, int line, const string &what) {
+            ostringstream message;
+            message << filename << ":" << line << ": " << what;
+            return runtime_error(message.str());
+        }
 
-        for (int i = 0; i < num_entries_j; i++) {
-            char name_i[80];
-            vector<float> p_i(NUM_JOINTS_ARMONLY);
+        bool is_blank(const string &line) {
+            return line.find_first_not_of(" \t\r") == string::npos;
+        }
 
-            int count = fscanf(fp_j, "%s\t%f,%f,%f,%f,%f,%f\n", name_i, &p_i[0], &p_i[1], &p_i[2], &p_i[3], &p_i[4], &p_i[5]);
+        // Reads a text positions file: the number of entries, then "name<TAB>v,v,..." per entry
+        void read_text(const string &filename, size_t num_values,
+                       vector<string> &names, vector<float> &values) {
+            ifstream in(filename.c_str());
+            if (!in) {
+                throw runtime_error("Could not open " + filename);
+            }
 
-            // Joints + name
-            if (count != NUM_JOINTS_ARMONLY + 1) {
-                ROS_ERROR("Read only %d values for entry index %d. Database will be malformed.", count, i);
+            string line;
+            int line_number = 0;
+            int num_entries = -1;
+            while (getline(in, line)) {
+                line_number++;
+                if (is_blank(line)) {
+                    continue;
+                }
+                istringstream header(line);
+                string rest;
+                if (!(header >> num_entries) || num_entries < 0 || (header >> rest)) {
+                    throw malformed(filename, line_number, "expected the number of entries");
+                }
+                break;
+            }
+            if (num_entries < 0) {
+                throw malformed(filename, line_number, "expected the number of entries");
             }
 
-            string name_i_s(name_i);
-            j_positions.emplace(name_i_s, p_i);
+            int read = 0;
+            while (getline(in, line)) {
+                line_number++;
+                if (is_blank(line)) {
+                    continue;
+                }
+                if (read == num_entries) {
+                    throw malformed(filename, line_number, "more entries than the count at the start");
+                }
+
+                istringstream entry(line);
+                string name;
+                entry >> name;
+                for (size_t j = 0; j < num_values; j++) {
+                    float v;
+                    char separator = ',';
+                    if (!(entry >> v) || (j + 1 < num_values && !(entry >> separator)) || separator != ',') {
+                        ostringstream what;
+                        what << "expected " << num_values << " comma separated values after the name";
+                        throw malformed(filename, line_number, what.str());
+                    }
+                    values.push_back(v);
+                }
+                string rest;
+                if (entry >> rest) {
+                    throw malformed(filename, line_number, "unexpected \"" + rest + "\" after the values");
+                }
+                names.push_back(name);
+                read++;
+            }
+            if (read != num_entries) {
+                ostringstream what;
+                what << "expected " << num_entries << " entries, found " << read;
+                throw malformed(filename, line_number, what.str());
+            }
         }
 
-        //load cartesean positions
-        FILE *fp_c = fopen(tool_positions_filename.c_str(), "r");
+        void put_uint32(string &out, uint32_t v) {
+            for (int i = 0; i < 4; i++) {
+                out.push_back(char((v >> (8 * i)) & 0xff));
+            }
+        }
 
-        //the first integer is the # of entries in the file
-        int num_entries_c = 0;
-        fscanf(fp_c, "%i\n", &num_entries_c);
+        void put_float(string &out, float f) {
+            uint32_t v;
+            memcpy(&v, &f, sizeof(v));
+            put_uint32(out, v);
+        }
+
+        // Bounds checked reads from the contents of a binary file
+        struct BinaryReader {
+            const string &filename;
+            const string &data;
+            size_t offset;
+
+            BinaryReader(const string &filename, const string &data) : filename(filename), data(data), offset(0) {}
+
+            void need(size_t bytes) {
+                if (data.size() - offset < bytes) {
+                    ostringstream message;
+                    message << filename << ": truncated at byte " << offset;
+                    throw runtime_error(message.str());
+                }
+            }
 
-        for (int i = 0; i < num_entries_c; i++) {
-            char name_i[80];
-            vector<float> p_i(7);
+            uint32_t get_uint32() {
+                need(4);
+                uint32_t v = 0;
+                for (int i = 0; i < 4; i++) {
+                    v |= uint32_t((unsigned char) data[offset + i]) << (8 * i);
+                }
+                offset += 4;
+                return v;
+            }
 
-            int count = fscanf(fp_c, "%s\t%f,%f,%f,%f,%f,%f,%f\n", name_i, &p_i[0], &p_i[1], &p_i[2], &p_i[3], &p_i[4], &p_i[5],
-                   &p_i[6]);
+            float get_float() {
+                uint32_t v = get_uint32();
+                float f;
+                memcpy(&f, &v, sizeof(f));
+                return f;
+            }
 
-            // 3 for position, 4 for orientation, 1 for name
-            if (count != 8) {
-                ROS_ERROR("Read only %d values for entry index %d. Database will be malformed.", count, i);
+            string get_name() {
+                uint32_t length = get_uint32();
+                need(length);
+                string name = data.substr(offset, length);
+                offset += length;
+                return name;
             }
-            geometry_msgs::Pose pose_i;
-            pose_i.position.x = p_i[0];
-            pose_i.position.y = p_i[1];
-            pose_i.position.z = p_i[2];
+        };
 
+    }
 
-            tf::Quaternion quat;
-            quat.setX(p_i[3]);
-            quat.setY(p_i[4]);
-            quat.setZ(p_i[5]);
-            quat.setW(p_i[6]);
-            quat.normalize();
-            tf::quaternionTFToMsg(quat, pose_i.orientation);
+    void ArmPositionDB::add_joint_position(const string &name, const float *values) {
+        if (!joint_index.insert(make_pair(name, joint_names.size())).second) {
+            throw runtime_error("Joint position \"" + name + "\" appears twice");
+        }
+        joint_names.push_back(name);
+        joint_values.insert(joint_values.end(), values, values + NUM_JOINTS);
+    }
 
-            string name_i_s(name_i);
-            t_positions.emplace(name_i_s, pose_i);
+    void ArmPositionDB::add_tool_position(const string &name, const float *values) {
+        if (!tool_index.insert(make_pair(name, tool_names.size())).second) {
+            throw runtime_error("Tool position \"" + name + "\" appears twice");
         }
+        tool_names.push_back(name);
+        tool_values.insert(tool_values.end(), values, values + NUM_TOOL_VALUES);
 
+        float *q = &tool_values[tool_values.size() - 4];
+        float norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+        if (!(norm > 0)) {
+            throw runtime_error("Tool position \"" + name + "\" has no valid orientation");
+        }
+        for (int i = 0; i < 4; i++) {
+            q[i] /= norm;
+        }
     }
-    bool ArmPositionDB::has_joint_position(const string &name) {
-        return j_positions.count(name) != 0;
+
+    void ArmPositionDB::build_tool_tree() {
+        vector<float> points(tool_values);
+        for (size_t i = 0; i < tool_names.size(); i++) {
+            for (size_t j = 3; j < NUM_TOOL_VALUES; j++) {
+                points[i * NUM_TOOL_VALUES + j] *= orientation_weight;
+            }
+        }
+        tool_tree = KDTree(points, NUM_TOOL_VALUES);
     }
 
-    bool ArmPositionDB::has_tool_position(const string &name) {
-        return t_positions.count(name) != 0;
+    ArmPositionDB::ArmPositionDB(const string &joint_positions_filename,
+                                 const string &tool_positions_filename) : orientation_weight(1.0) {
+
+        vector<string> names;
+        vector<float> values;
+        read_text(joint_positions_filename, NUM_JOINTS, names, values);
+        for (size_t i = 0; i < names.size(); i++) {
+            add_joint_position(names[i], &values[i * NUM_JOINTS]);
+        }
+
+        names.clear();
+        values.clear();
+        read_text(tool_positions_filename, NUM_TOOL_VALUES, names, values);
+        for (size_t i = 0; i < names.size(); i++) {
+            add_tool_position(names[i], &values[i * NUM_TOOL_VALUES]);
+        }
+
+        joint_tree = KDTree(joint_values, NUM_JOINTS);
+        build_tool_tree();
     }
 
-    vector<float> ArmPositionDB::get_joint_position(const string &name) {
-        return j_positions[name];
+    ArmPositionDB::ArmPositionDB(const string &binary_filename) : orientation_weight(1.0) {
+        ifstream in(binary_filename.c_str(), ios::binary);
+        if (!in) {
+            throw runtime_error("Could not open " + binary_filename);
+        }
+        string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+        BinaryReader reader(binary_filename, data);
+        reader.need(sizeof(BINARY_MAGIC));
+        if (data.compare(0, sizeof(BINARY_MAGIC), BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0) {
+            throw runtime_error(binary_filename + ": not an arm position database");
+        }
+        reader.offset += sizeof(BINARY_MAGIC);
+
+        uint32_t version = reader.get_uint32();
+        if (version != BINARY_VERSION) {
+            ostringstream message;
+            message << binary_filename << ": unsupported version " << version;
+            throw runtime_error(message.str());
+        }
+        uint32_t num_joints = reader.get_uint32();
+        if (num_joints != NUM_JOINTS) {
+            ostringstream message;
+            message << binary_filename << ": has " << num_joints << " joints per entry, expected " << NUM_JOINTS;
+            throw runtime_error(message.str());
+        }
+        uint32_t num_joint_entries = reader.get_uint32();
+        uint32_t num_tool_entries = reader.get_uint32();
+
+        float values[NUM_TOOL_VALUES];
+        for (uint32_t i = 0; i < num_joint_entries; i++) {
+            string name = reader.get_name();
+            for (size_t j = 0; j < NUM_JOINTS; j++) {
+                values[j] = reader.get_float();
+            }
+            add_joint_position(name, values);
+        }
+        for (uint32_t i = 0; i < num_tool_entries; i++) {
+            string name = reader.get_name();
+            for (size_t j = 0; j < NUM_TOOL_VALUES; j++) {
+                values[j] = reader.get_float();
+            }
+            add_tool_position(name, values);
+        }
+        if (reader.offset != data.size()) {
+            throw runtime_error(binary_filename + ": unexpected data after the last entry");
+        }
+
+        joint_tree = KDTree(joint_values, NUM_JOINTS);
+        build_tool_tree();
+    }
+
+    void ArmPositionDB::save_binary(const string &filename) const {
+        string out(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+        put_uint32(out, BINARY_VERSION);
+        put_uint32(out, NUM_JOINTS);
+        put_uint32(out, joint_names.size());
+        put_uint32(out, tool_names.size());
+        for (size_t i = 0; i < joint_names.size(); i++) {
+            put_uint32(out, joint_names[i].size());
+            out += joint_names[i];
+            for (size_t j = 0; j < NUM_JOINTS; j++) {
+                put_float(out, joint_values[i * NUM_JOINTS + j]);
+            }
+        }
+        for (size_t i = 0; i < tool_names.size(); i++) {
+            put_uint32(out, tool_names[i].size());
+            out += tool_names[i];
+            for (size_t j = 0; j < NUM_TOOL_VALUES; j++) {
+                put_float(out, tool_values[i * NUM_TOOL_VALUES + j]);
+            }
+        }
+
+        ofstream file(filename.c_str(), ios::binary | ios::trunc);
+        file.write(out.data(), out.size());
+        if (!file) {
+            throw runtime_error("Could not write " + filename);
+        }
+    }
+
+    bool ArmPositionDB::has_joint_position(const string &name) const {
+        return joint_index.count(name) != 0;
+    }
+
+    bool ArmPositionDB::has_tool_position(const string &name) const {
+        return tool_index.count(name) != 0;
     }
 
-    geometry_msgs::Pose ArmPositionDB::get_tool_position(const string &name) {
-        return t_positions[name];
+    vector<float> ArmPositionDB::get_joint_position(const string &name) const {
+        map<string, size_t>::const_iterator it = joint_index.find(name);
+        if (it == joint_index.end()) {
+            throw out_of_range("No joint position named \"" + name + "\"");
+        }
+        const float *values = &joint_values[it->second * NUM_JOINTS];
+        return vector<float>(values, values + NUM_JOINTS);
+    }
+
+    geometry_msgs::Pose ArmPositionDB::get_tool_position(const string &name) const {
+        map<string, size_t>::const_iterator it = tool_index.find(name);
+        if (it == tool_index.end()) {
+            throw out_of_range("No tool position named \"" + name + "\"");
+        }
+        const float *values = &tool_values[it->second * NUM_TOOL_VALUES];
+        geometry_msgs::Pose pose;
+        pose.position.x = values[0];
+        pose.position.y = values[1];
+        pose.position.z = values[2];
+        pose.orientation.x = values[3];
+        pose.orientation.y = values[4];
+        pose.orientation.z = values[5];
+        pose.orientation.w = values[6];
+        return pose;
     }
 
     geometry_msgs::PoseStamped
-    ArmPositionDB::get_tool_position_stamped(const string &name, const string &frame_id) {
+    ArmPositionDB::get_tool_position_stamped(const string &name, const string &frame_id) const {
         geometry_msgs::PoseStamped target_pose;
+        target_pose.pose = get_tool_position(name);
         target_pose.header.stamp = ros::Time::now();
         target_pose.header.frame_id = frame_id;
-        target_pose.pose = t_positions[name];
         return target_pose;
     }
 
+    vector<ArmPositionDB::Match> ArmPositionDB::nearest_joint_positions(const vector<float> &joints,
+                                                                        size_t k) const {
+        if (joints.size() != NUM_JOINTS) {
+            throw invalid_argument("Joint positions have 6 values");
+        }
+        vector<KDTree::Neighbour> neighbours = joint_tree.nearest(&joints[0], k);
+        vector<Match> matches(neighbours.size());
+        for (size_t i = 0; i < neighbours.size(); i++) {
+            matches[i].name = joint_names[neighbours[i].index];
+            matches[i].distance = neighbours[i].distance;
+        }
+        return matches;
+    }
+
+    vector<ArmPositionDB::Match> ArmPositionDB::nearest_tool_positions(const geometry_msgs::Pose &pose,
+                                                                       size_t k) const {
+        float query[NUM_TOOL_VALUES] = {
+                float(pose.position.x), float(pose.position.y), float(pose.position.z),
+                float(pose.orientation.x), float(pose.orientation.y), float(pose.orientation.z),
+                float(pose.orientation.w)};
+        float norm = sqrt(query[3] * query[3] + query[4] * query[4] + query[5] * query[5] + query[6] * query[6]);
+        if (!(norm > 0)) {
+            throw invalid_argument("Tool pose has no valid orientation");
+        }
+        for (size_t j = 3; j < NUM_TOOL_VALUES; j++) {
+            query[j] *= orientation_weight / norm;
+        }
+
+        // q and -q are the same orientation: the k closest to either contain the k closest overall
+        vector<KDTree::Neighbour> neighbours = tool_tree.nearest(query, k);
+        for (size_t j = 3; j < NUM_TOOL_VALUES; j++) {
+            query[j] = -query[j];
+        }
+        vector<KDTree::Neighbour> flipped = tool_tree.nearest(query, k);
+
+        map<size_t, float> closest;
+        for (size_t i = 0; i < neighbours.size(); i++) {
+            closest[neighbours[i].index] = neighbours[i].distance;
+        }
+        for (size_t i = 0; i < flipped.size(); i++) {
+            map<size_t, float>::iterator it = closest.find(flipped[i].index);
+            if (it == closest.end() || flipped[i].distance < it->second) {
+                closest[flipped[i].index] = flipped[i].distance;
+            }
+        }
+
+        vector<pair<float, size_t> > sorted;
+        for (map<size_t, float>::const_iterator it = closest.begin(); it != closest.end(); ++it) {
+            sorted.push_back(make_pair(it->second, it->first));
+        }
+        sort(sorted.begin(), sorted.end());
+        sorted.resize(min(k, sorted.size()));
+
+        vector<Match> matches(sorted.size());
+        for (size_t i = 0; i < sorted.size(); i++) {
+            matches[i].name = tool_names[sorted[i].second];
+            matches[i].distance = sorted[i].first;
+        }
+        return matches;
+    }
+
+    void ArmPositionDB::set_orientation_weight(float weight) {
+        orientation_weight = weight;
+        build_tool_tree();
+    }
+
     void ArmPositionDB::print() {
-        cout << "# of joint-space positions: " << j_positions.size() << "\n";
+        cout << "# of joint-space positions: " << joint_names.size() << "\n";
 
-        for (const auto &pair: j_positions) {
-            cout << "\tname:" << pair.first << "\t";
+        for (size_t i = 0; i < joint_names.size(); i++) {
+            cout << "\tname:" << joint_names[i] << "\t";
 
-            for (unsigned int j = 0; j < NUM_JOINTS_ARMONLY; j++) {
-                cout << pair.second[j];
-                if (j < NUM_JOINTS_ARMONLY - 1)
+            for (unsigned int j = 0; j < NUM_JOINTS; j++) {
+                cout << joint_values[i * NUM_JOINTS + j];
+                if (j < NUM_JOINTS - 1)
                     cout << ",";
                 else cout << "\n";
 
             }
         }
 
-        cout << "\n# of tool-space positions: " << t_positions.size() << "\n";
+        cout << "\n# of tool-space positions: " << tool_names.size() << "\n";
 
-        for (const auto &pair: t_positions) {
-            cout << "\tname:" << pair.first << "\t";
-            ROS_INFO_STREAM(pair.second);
+        for (size_t i = 0; i < tool_names.size(); i++) {
+            cout << "\tname:" << tool_names[i] << "\t";
+            ROS_INFO_STREAM(get_tool_position(tool_names[i]));
         }
     }
 
@@ -0,0 +1,110 @@
+#include "bwi_manipulation/KDTree.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+namespace bwi_manipulation {
+
+    KDTree::KDTree(const vector<float> &input, size_t dim) : dim(dim) {
+        size_t n = (dim == 0) ? 0 : input.size() / dim;
+        vector<size_t> order(n);
+        for (size_t i = 0; i < n; i++) {
+            order[i] = i;
+        }
+        axes.resize(n);
+        build(0, n, order, input);
+
+        points.resize(n * dim);
+        indices = order;
+        for (size_t i = 0; i < n; i++) {
+            copy(input.begin() + order[i] * dim, input.begin() + (order[i] + 1) * dim, points.begin() + i * dim);
+        }
+    }
+
+    void KDTree::build(size_t begin, size_t end, vector<size_t> &order, const vector<float> &input) {
+        if (end <= begin) {
+            return;
+        }
+
+        // split along the widest axis of the range
+        size_t axis = 0;
+        float widest = -1;
+        for (size_t d = 0; d < dim; d++) {
+            float low = numeric_limits<float>::max(), high = -numeric_limits<float>::max();
+            for (size_t i = begin; i < end; i++) {
+                float v = input[order[i] * dim + d];
+                low = min(low, v);
+                high = max(high, v);
+            }
+            if (high - low > widest) {
+                widest = high - low;
+                axis = d;
+            }
+        }
+
+        size_t mid = begin + (end - begin) / 2;
+        nth_element(order.begin() + begin, order.begin() + mid, order.begin() + end,
+                    [&](size_t a, size_t b) { return input[a * dim + axis] < input[b * dim + axis]; });
+        axes[mid] = axis;
+
+        build(begin, mid, order, input);
+        build(mid + 1, end, order, input);
+    }
+
+    void KDTree::search(size_t begin, size_t end, const float *query, size_t k, vector<Candidate> &heap) const {
+        if (end <= begin) {
+            return;
+        }
+
+        size_t mid = begin + (end - begin) / 2;
+        const float *p = &points[mid * dim];
+        float distance = 0;
+        for (size_t d = 0; d < dim; d++) {
+            float diff = query[d] - p[d];
+            distance += diff * diff;
+        }
+        if (heap.size() < k) {
+            heap.push_back(Candidate(distance, mid));
+            push_heap(heap.begin(), heap.end());
+        } else if (distance < heap.front().first) {
+            pop_heap(heap.begin(), heap.end());
+            heap.back() = Candidate(distance, mid);
+            push_heap(heap.begin(), heap.end());
+        }
+
+        float split = query[axes[mid]] - p[axes[mid]];
+        bool left_first = split < 0;
+        if (left_first) {
+            search(begin, mid, query, k, heap);
+        } else {
+            search(mid + 1, end, query, k, heap);
+        }
+        // the other side can only hold closer points if the splitting plane is closer than the worst one kept
+        if (heap.size() < k || split * split < heap.front().first) {
+            if (left_first) {
+                search(mid + 1, end, query, k, heap);
+            } else {
+                search(begin, mid, query, k, heap);
+            }
+        }
+    }
+
+    vector<KDTree::Neighbour> KDTree::nearest(const float *query, size_t k) const {
+        vector<Candidate> heap;
+        if (k == 0) {
+            return vector<Neighbour>();
+        }
+        heap.reserve(k);
+        search(0, indices.size(), query, k, heap);
+
+        sort_heap(heap.begin(), heap.end());
+        vector<Neighbour> neighbours(heap.size());
+        for (size_t i = 0; i < heap.size(); i++) {
+            neighbours[i].index = indices[heap[i].second];
+            neighbours[i].distance = sqrt(heap[i].first);
+        }
+        return neighbours;
+    }
+}
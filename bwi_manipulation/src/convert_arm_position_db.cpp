@@ -0,0 +1,22 @@
+#include "bwi_manipulation/ArmPositionDB.h"
+
+#include <stdexcept>
+
+// Converts the joint and tool position text files into the binary arm position database
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        std::cerr << "Usage: " << argv[0] << " <joint_positions.txt> <tool_positions.txt> <output.db>" << std::endl;
+        return 1;
+    }
+
+    try {
+        bwi_manipulation::ArmPositionDB db(argv[1], argv[2]);
+        db.save_binary(argv[3]);
+        std::cout << "Wrote " << db.num_joint_positions() << " joint positions and " << db.num_tool_positions()
+                  << " tool positions to " << argv[3] << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
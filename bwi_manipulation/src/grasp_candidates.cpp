@@ -0,0 +1,183 @@
+#include <bwi_manipulation/grasp_candidates.h>
+
+namespace bwi_manipulation {
+    namespace grasp_utils {
+
+        namespace {
+
+            // tf::Quaternion::setRPY
+            Eigen::Quaterniond quaternion_from_rpy(double roll, double pitch, double yaw) {
+                double cr = std::cos(roll * 0.5), sr = std::sin(roll * 0.5);
+                double cp = std::cos(pitch * 0.5), sp = std::sin(pitch * 0.5);
+                double cy = std::cos(yaw * 0.5), sy = std::sin(yaw * 0.5);
+                return Eigen::Quaterniond(cr * cp * cy + sr * sp * sy,
+                                          sr * cp * cy - cr * sp * sy,
+                                          cr * sp * cy + sr * cp * sy,
+                                          cr * cp * sy - sr * sp * cy);
+            }
+
+            // tf::Matrix3x3::getRPY, first solution
+            void rpy_from_quaternion(const Eigen::Quaterniond &q, double &roll, double &pitch, double &yaw) {
+                Eigen::Matrix3d m = q.normalized().toRotationMatrix();
+                if (std::fabs(m(2, 0)) >= 1) {
+                    yaw = 0;
+                    pitch = (m(2, 0) < 0) ? M_PI / 2 : -M_PI / 2;
+                    roll = std::atan2(m(2, 1), m(2, 2));
+                } else {
+                    pitch = -std::asin(m(2, 0));
+                    double c = std::cos(pitch);
+                    roll = std::atan2(m(2, 1) / c, m(2, 2) / c);
+                    yaw = std::atan2(m(1, 0) / c, m(0, 0) / c);
+                }
+            }
+
+            Eigen::Quaterniond compose(const Eigen::Quaterniond &lhs, const Eigen::Quaterniond &rhs) {
+                return (lhs * rhs).normalized();
+            }
+
+            // HEURISTIC_LINE_POSES evenly spaced from min towards, but not reaching, max
+            size_t fill_line(const Eigen::Vector3f &min, const Eigen::Vector3f &max,
+                             const Eigen::Quaterniond &orientation, double approach_offset,
+                             GraspCandidates &candidates, size_t first) {
+                Eigen::Vector3f step_size = (max - min) / HEURISTIC_LINE_POSES;
+                for (int i = 0; i < HEURISTIC_LINE_POSES; ++i) {
+                    candidates.set(first + i, min + step_size * i, orientation, approach_offset);
+                }
+                return first + HEURISTIC_LINE_POSES;
+            }
+
+            // HEURISTIC_ORIENTATION_STEPS^3 orientations around center_orientation. With LEGACY_ORIENTATIONS they
+            // are the ones generate_grasps_varying_orientation produces: only roll steps up from its minimum
+            // while pitch and yaw are scaled, and every orientation comes HEURISTIC_ORIENTATION_STEPS times.
+            size_t fill_orientations(const Eigen::Vector3f &position, const Eigen::Quaterniond &center_orientation,
+                                     double angle_radius, double approach_offset, HeuristicOrientations orientations,
+                                     GraspCandidates &candidates, size_t first) {
+                double b_r, b_p, b_y;
+                rpy_from_quaternion(center_orientation, b_r, b_p, b_y);
+                b_r -= angle_radius;
+                b_p -= angle_radius;
+                b_y -= angle_radius;
+
+                const int steps = HEURISTIC_ORIENTATION_STEPS;
+                double step_size = angle_radius * 2.0 / steps;
+
+                size_t index = first;
+                for (int i = 0; i < steps; ++i) {
+                    for (int j = 0; j < steps; ++j) {
+                        if (orientations == LEGACY_ORIENTATIONS) {
+                            Eigen::Quaterniond q = quaternion_from_rpy(b_r + i * step_size, b_p * j * step_size,
+                                                                       b_y * step_size);
+                            for (int k = 0; k < steps; ++k) {
+                                candidates.set(index++, position, q, approach_offset);
+                            }
+                            continue;
+                        }
+                        for (int k = 0; k < steps; ++k) {
+                            Eigen::Quaterniond q = quaternion_from_rpy(b_r + i * step_size, b_p + j * step_size,
+                                                                       b_y + k * step_size);
+                            candidates.set(index++, position, q, approach_offset);
+                        }
+                    }
+                }
+                return index;
+            }
+
+        }
+
+        void GraspCandidates::resize(size_t n) {
+            x.resize(n);
+            y.resize(n);
+            z.resize(n);
+            qx.resize(n);
+            qy.resize(n);
+            qz.resize(n);
+            qw.resize(n);
+            approach_x.resize(n);
+            approach_y.resize(n);
+            approach_z.resize(n);
+        }
+
+        void GraspCandidates::set(size_t i, const Eigen::Vector3f &position, const Eigen::Quaterniond &orientation,
+                                  double approach_offset) {
+            x[i] = position.x();
+            y[i] = position.y();
+            z[i] = position.z();
+            qx[i] = orientation.x();
+            qy[i] = orientation.y();
+            qz[i] = orientation.z();
+            qw[i] = orientation.w();
+
+            Eigen::Vector3d approach_axis = orientation * Eigen::Vector3d(0, 0, 1);
+            approach_x[i] = position.x() - approach_offset * approach_axis.x();
+            approach_y[i] = position.y() - approach_offset * approach_axis.y();
+            approach_z[i] = position.z() - approach_offset * approach_axis.z();
+        }
+
+        size_t heuristic_grasp_count() {
+            return 3 * HEURISTIC_LINE_POSES +
+                   HEURISTIC_ORIENTATION_STEPS * HEURISTIC_ORIENTATION_STEPS * HEURISTIC_ORIENTATION_STEPS;
+        }
+
+        void generate_heuristic_grasps(const Eigen::Vector3f &box_min, const Eigen::Vector3f &box_max,
+                                       const Eigen::Quaterniond &grasp_x_orientation,
+                                       const double approach_offset, const double grasp_offset,
+                                       GraspCandidates &candidates, HeuristicOrientations orientations) {
+            candidates.resize(heuristic_grasp_count());
+            size_t next = 0;
+
+            Eigen::Vector3f position = box_min + (box_max - box_min) / 2;
+
+            // Center of the object, but the minimum along the X axis
+            Eigen::Vector3f min = position;
+            min.x() = box_min.x() + grasp_offset;
+            min.z() = box_min.z();
+            // Vary along Z axis between object min and max
+            Eigen::Vector3f max = min;
+            max.z() = box_max.z();
+            next = fill_line(min, max, grasp_x_orientation, approach_offset, candidates, next);
+
+            Eigen::Vector3f grasp_point = position;
+            grasp_point.z() = box_max.z() - grasp_offset;
+            // Point down
+            Eigen::Quaterniond quat = compose(grasp_x_orientation, quaternion_from_rpy(0.0, M_PI, 0));
+            next = fill_orientations(grasp_point, quat, 0.25, approach_offset, orientations, candidates, next);
+
+            // Right side grasp, pointing left
+            min = position;
+            min.y() = box_min.y() + grasp_offset;
+            min.z() = box_min.z();
+            max = min;
+            max.z() = box_max.z();
+            quat = compose(grasp_x_orientation, quaternion_from_rpy(0.0, 0.0, M_PI / 2));
+            next = fill_line(min, max, quat, approach_offset, candidates, next);
+
+            // Left side grasp, pointing right
+            min = position;
+            min.y() = box_max.y() - grasp_offset;
+            min.z() = box_min.z();
+            max = min;
+            max.z() = box_max.z();
+            quat = compose(grasp_x_orientation, quaternion_from_rpy(0.0, 0.0, -M_PI / 2));
+            fill_line(min, max, quat, approach_offset, candidates, next);
+        }
+
+        void checkPlaneConflicts(const GraspCandidates &candidates, const Eigen::Vector4f &plane_c,
+                                 const float min_distance_to_plane, std::vector<char> &clear) {
+            const size_t n = candidates.size();
+            clear.resize(n);
+
+            const float a = plane_c[0], b = plane_c[1], c = plane_c[2], d = plane_c[3];
+            const float *x = candidates.x.data(), *y = candidates.y.data(), *z = candidates.z.data();
+            const float *ax = candidates.approach_x.data(), *ay = candidates.approach_y.data(),
+                    *az = candidates.approach_z.data();
+
+            // Unnormalized plane distances, as pcl::pointToPlaneDistance. No branches, so the loop vectorizes.
+            for (size_t i = 0; i < n; ++i) {
+                float grasp_distance = std::fabs(a * x[i] + b * y[i] + c * z[i] + d);
+                float approach_distance = std::fabs(a * ax[i] + b * ay[i] + c * az[i] + d);
+                clear[i] = !((approach_distance < min_distance_to_plane) | (grasp_distance < min_distance_to_plane));
+            }
+        }
+
+    }
+}
@@ -4,10 +4,11 @@
 #include <eigen_conversions/eigen_msg.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <tf/transform_listener.h>
+#include <tf_conversions/tf_eigen.h>
+#include <pcl_conversions/pcl_conversions.h>
 #include <bwi_manipulation/GraspCartesianCommand.h>
 #include <pcl/common/common.h>
 #include <pcl/sample_consensus/sac_model_plane.h>
-#include <bwi_perception/BoundingBox.h>
 #include <bwi_manipulation/grasp_utils.h>
 
 using namespace std;
@@ -112,6 +113,43 @@ namespace bwi_manipulation {
 
         };
 
+        void to_grasp_commands(const GraspCandidates &candidates, const string &frame_id,
+                               vector<GraspCartesianCommand> &commands) {
+            commands.resize(candidates.size());
+            for (size_t i = 0; i < candidates.size(); ++i) {
+                GraspCartesianCommand &command = commands[i];
+                command.grasp_pose.header.frame_id = frame_id;
+                command.grasp_pose.pose.position.x = candidates.x[i];
+                command.grasp_pose.pose.position.y = candidates.y[i];
+                command.grasp_pose.pose.position.z = candidates.z[i];
+                command.grasp_pose.pose.orientation.x = candidates.qx[i];
+                command.grasp_pose.pose.orientation.y = candidates.qy[i];
+                command.grasp_pose.pose.orientation.z = candidates.qz[i];
+                command.grasp_pose.pose.orientation.w = candidates.qw[i];
+
+                command.approach_pose = command.grasp_pose;
+                command.approach_pose.pose.position.x = candidates.approach_x[i];
+                command.approach_pose.pose.position.y = candidates.approach_y[i];
+                command.approach_pose.pose.position.z = candidates.approach_z[i];
+            }
+        }
+
+        bool lookup_cloud_transform(const string &target_frame, const pcl::PCLHeader &cloud_header,
+                                    const tf::TransformListener &listener, Eigen::Isometry3f &cloud_to_target) {
+            tf::StampedTransform transform;
+            try {
+                listener.lookupTransform(target_frame, cloud_header.frame_id,
+                                         pcl_conversions::fromPCL(cloud_header).stamp, transform);
+            } catch (tf::TransformException &ex) {
+                ROS_ERROR("%s", ex.what());
+                return false;
+            }
+            Eigen::Affine3d cloud_to_target_d;
+            tf::transformTFToEigen(transform, cloud_to_target_d);
+            cloud_to_target = Eigen::Isometry3f(cloud_to_target_d.matrix().cast<float>());
+            return true;
+        }
+
 
 
     }
@@ -0,0 +1,397 @@
+#include <bwi_manipulation/ArmPositionDB.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+using bwi_manipulation::ArmPositionDB;
+using bwi_manipulation::KDTree;
+
+class ArmPositionDBTest : public testing::Test {
+  protected:
+    virtual void SetUp() {
+      char pattern[] = "/tmp/arm_position_dbXXXXXX";
+      ASSERT_TRUE(mkdtemp(pattern) != NULL);
+      dir = pattern;
+      joints = dir + "/joint_positions.txt";
+      tools = dir + "/tool_positions.txt";
+      binary = dir + "/positions.db";
+
+      write(joints, "3\n"
+                    "home\t-1.5,4.5,1.2,-2.1,1.4,3.0\n"
+                    "ready\t-1.4,4.0,1.0,-2.0,1.3,2.9\n"
+                    "a_name_that_is_quite_a_bit_longer_than_the_eighty_characters_the_old_reader_had_room_for\t"
+                    "0.1,0.2,0.3,0.4,0.5,0.6\n");
+      write(tools, "2\n"
+                   "home\t0.2,-0.3,0.5,0,0,0,2\n"
+                   "side\t0.4,0.1,0.3,0.5,0.5,0.5,0.5\n");
+    }
+
+    virtual void TearDown() {
+      unlink(joints.c_str());
+      unlink(tools.c_str());
+      unlink(binary.c_str());
+      rmdir(dir.c_str());
+    }
+
+    void write(const std::string &filename, const std::string &contents) {
+      std::ofstream out(filename.c_str(), std::ios::binary);
+      out << contents;
+    }
+
+    std::string read(const std::string &filename) {
+      std::ifstream in(filename.c_str(), std::ios::binary);
+      std::stringstream contents;
+      contents << in.rdbuf();
+      return contents.str();
+    }
+
+    // whether loading the text files throws a runtime_error
+    bool textFails() {
+      try {
+        ArmPositionDB db(joints, tools);
+      } catch (const std::runtime_error &) {
+        return true;
+      }
+      return false;
+    }
+
+    bool binaryFails() {
+      try {
+        ArmPositionDB db(binary);
+      } catch (const std::runtime_error &) {
+        return true;
+      }
+      return false;
+    }
+
+    std::string dir, joints, tools, binary;
+};
+
+static geometry_msgs::Pose pose(float x, float y, float z, float qx, float qy, float qz, float qw) {
+  geometry_msgs::Pose p;
+  p.position.x = x;
+  p.position.y = y;
+  p.position.z = z;
+  p.orientation.x = qx;
+  p.orientation.y = qy;
+  p.orientation.z = qz;
+  p.orientation.w = qw;
+  return p;
+}
+
+TEST_F(ArmPositionDBTest, ReadsTextFiles) {
+  ArmPositionDB db(joints, tools);
+  EXPECT_EQ(3u, db.num_joint_positions());
+  EXPECT_EQ(2u, db.num_tool_positions());
+
+  std::vector<float> ready = db.get_joint_position("ready");
+  ASSERT_EQ(6u, ready.size());
+  EXPECT_FLOAT_EQ(-1.4, ready[0]);
+  EXPECT_FLOAT_EQ(2.9, ready[5]);
+  EXPECT_TRUE(db.has_joint_position(
+      "a_name_that_is_quite_a_bit_longer_than_the_eighty_characters_the_old_reader_had_room_for"));
+
+  // orientations are normalized
+  geometry_msgs::Pose home = db.get_tool_position("home");
+  EXPECT_FLOAT_EQ(0.5, home.position.z);
+  EXPECT_FLOAT_EQ(1.0, home.orientation.w);
+  geometry_msgs::PoseStamped side = db.get_tool_position_stamped("side", "arm_base");
+  EXPECT_EQ("arm_base", side.header.frame_id);
+  EXPECT_FLOAT_EQ(0.5, side.pose.orientation.x);
+}
+
+TEST_F(ArmPositionDBTest, UnknownNamesThrowAndAreNotAdded) {
+  ArmPositionDB db(joints, tools);
+  EXPECT_THROW(db.get_joint_position("nowhere"), std::out_of_range);
+  EXPECT_THROW(db.get_tool_position("nowhere"), std::out_of_range);
+  EXPECT_THROW(db.get_tool_position_stamped("nowhere", "arm_base"), std::out_of_range);
+  EXPECT_FALSE(db.has_joint_position("nowhere"));
+  EXPECT_FALSE(db.has_tool_position("nowhere"));
+  EXPECT_EQ(3u, db.num_joint_positions());
+}
+
+TEST_F(ArmPositionDBTest, BinaryRoundTrip) {
+  ArmPositionDB text(joints, tools);
+  text.save_binary(binary);
+  ArmPositionDB loaded(binary);
+
+  ASSERT_EQ(text.num_joint_positions(), loaded.num_joint_positions());
+  ASSERT_EQ(text.num_tool_positions(), loaded.num_tool_positions());
+  const char *joint_names[] = {"home", "ready",
+      "a_name_that_is_quite_a_bit_longer_than_the_eighty_characters_the_old_reader_had_room_for"};
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(text.get_joint_position(joint_names[i]), loaded.get_joint_position(joint_names[i]));
+  }
+  const char *tool_names[] = {"home", "side"};
+  for (int i = 0; i < 2; ++i) {
+    geometry_msgs::Pose a = text.get_tool_position(tool_names[i]), b = loaded.get_tool_position(tool_names[i]);
+    EXPECT_EQ(a.position.x, b.position.x);
+    EXPECT_EQ(a.position.y, b.position.y);
+    EXPECT_EQ(a.position.z, b.position.z);
+    EXPECT_EQ(a.orientation.x, b.orientation.x);
+    EXPECT_EQ(a.orientation.y, b.orientation.y);
+    EXPECT_EQ(a.orientation.z, b.orientation.z);
+    EXPECT_EQ(a.orientation.w, b.orientation.w);
+  }
+
+  // and writing it out again gives the same bytes
+  std::string first = read(binary);
+  loaded.save_binary(binary);
+  EXPECT_EQ(first, read(binary));
+}
+
+TEST_F(ArmPositionDBTest, MalformedTextFiles) {
+  EXPECT_FALSE(textFails());
+  const std::string valid_joints = read(joints);
+
+  const char *bad_joints[] = {
+    "",
+    "three\nhome\t1,2,3,4,5,6\n",
+    "2\nhome\t1,2,3,4,5,6\n",
+    "1\nhome\t1,2,3,4,5,6\nready\t1,2,3,4,5,6\n",
+    "1\nhome\t1,2,3,4,5\n",
+    "1\nhome\t1,2,3,4,5,6,7\n",
+    "1\nhome\t1,2,x,4,5,6\n",
+    "1\nhome\t1,2;3,4,5,6\n",
+    "1\nhome\t1,2,3,4,5,6 extra\n",
+    "2\nhome\t1,2,3,4,5,6\nhome\t1,2,3,4,5,6\n",
+  };
+  for (size_t i = 0; i < sizeof(bad_joints) / sizeof(bad_joints[0]); ++i) {
+    write(joints, bad_joints[i]);
+    EXPECT_TRUE(textFails()) << "\"" << bad_joints[i] << "\"";
+  }
+
+  // blank lines are fine
+  write(joints, "\n2\n\nhome\t1,2,3,4,5,6\n\nready\t1,2,3,4,5,6\n\n");
+  EXPECT_FALSE(textFails());
+
+  write(joints, valid_joints);
+  write(tools, "1\nhome\t0,0,0,0,0,0,0\n");
+  EXPECT_TRUE(textFails());
+  write(tools, "1\nhome\t0,0,0,0,0,1\n");
+  EXPECT_TRUE(textFails());
+
+  unlink(tools.c_str());
+  EXPECT_TRUE(textFails());
+}
+
+TEST_F(ArmPositionDBTest, MalformedBinaryFiles) {
+  ArmPositionDB(joints, tools).save_binary(binary);
+  std::string valid = read(binary);
+  EXPECT_FALSE(binaryFails());
+
+  // every truncation is caught
+  for (size_t length = 0; length < valid.size(); ++length) {
+    write(binary, valid.substr(0, length));
+    EXPECT_TRUE(binaryFails()) << "truncated to " << length << " bytes";
+  }
+
+  write(binary, valid + "x");
+  EXPECT_TRUE(binaryFails());
+
+  std::string bad = valid;
+  bad[0] = 'X';
+  write(binary, bad);
+  EXPECT_TRUE(binaryFails());
+
+  // version
+  bad = valid;
+  bad[8] = 2;
+  write(binary, bad);
+  EXPECT_TRUE(binaryFails());
+
+  // joints per entry
+  bad = valid;
+  bad[12] = 7;
+  write(binary, bad);
+  EXPECT_TRUE(binaryFails());
+
+  // a name length running past the end
+  bad = valid;
+  bad[24] = char(0xff);
+  write(binary, bad);
+  EXPECT_TRUE(binaryFails());
+
+  unlink(binary.c_str());
+  EXPECT_TRUE(binaryFails());
+}
+
+TEST(KDTree, SmallCases) {
+  KDTree empty(std::vector<float>(), 3);
+  float origin[3] = {0, 0, 0};
+  EXPECT_TRUE(empty.nearest(origin, 3).empty());
+
+  std::vector<float> points;
+  for (int i = 0; i < 4; ++i) {
+    points.push_back(i);
+    points.push_back(0);
+    points.push_back(0);
+  }
+  // a duplicate
+  points.push_back(2);
+  points.push_back(0);
+  points.push_back(0);
+  KDTree tree(points, 3);
+  EXPECT_EQ(5u, tree.size());
+  EXPECT_TRUE(tree.nearest(origin, 0).empty());
+
+  std::vector<KDTree::Neighbour> all = tree.nearest(origin, 10);
+  ASSERT_EQ(5u, all.size());
+  EXPECT_EQ(0u, all[0].index);
+  EXPECT_FLOAT_EQ(0, all[0].distance);
+  EXPECT_EQ(1u, all[1].index);
+  EXPECT_FLOAT_EQ(2, all[2].distance);
+  EXPECT_FLOAT_EQ(2, all[3].distance);
+  EXPECT_EQ(3u, all[4].index);
+}
+
+static float uniform(float low, float high) {
+  return low + (high - low) * (rand() / float(RAND_MAX));
+}
+
+TEST(KDTree, MatchesBruteForce) {
+  srand(3);
+  for (size_t dim = 1; dim <= 7; dim += 3) {
+    std::vector<float> points;
+    const size_t n = 700;
+    for (size_t i = 0; i < n * dim; ++i) {
+      // one axis much wider than the others, and clusters of equal coordinates
+      points.push_back((i % dim == 0) ? uniform(-10, 10) : float(rand() % 5));
+    }
+    KDTree tree(points, dim);
+
+    for (int q = 0; q < 100; ++q) {
+      std::vector<float> query(dim);
+      for (size_t d = 0; d < dim; ++d) {
+        query[d] = uniform(-12, 12);
+      }
+      std::vector<float> brute;
+      for (size_t i = 0; i < n; ++i) {
+        float distance = 0;
+        for (size_t d = 0; d < dim; ++d) {
+          distance += (points[i * dim + d] - query[d]) * (points[i * dim + d] - query[d]);
+        }
+        brute.push_back(std::sqrt(distance));
+      }
+      std::sort(brute.begin(), brute.end());
+
+      size_t k = 1 + q % 25;
+      std::vector<KDTree::Neighbour> neighbours = tree.nearest(&query[0], k);
+      ASSERT_EQ(k, neighbours.size());
+      for (size_t i = 0; i < k; ++i) {
+        EXPECT_NEAR(brute[i], neighbours[i].distance, 1e-4) << "dim " << dim << " query " << q << " rank " << i;
+        // and the index really is that far away
+        float distance = 0;
+        for (size_t d = 0; d < dim; ++d) {
+          float diff = points[neighbours[i].index * dim + d] - query[d];
+          distance += diff * diff;
+        }
+        EXPECT_NEAR(std::sqrt(distance), neighbours[i].distance, 1e-4);
+      }
+    }
+  }
+}
+
+TEST_F(ArmPositionDBTest, NearestMatchesBruteForce) {
+  srand(5);
+  const int n = 400;
+  std::ostringstream joint_file, tool_file;
+  joint_file << n << "\n";
+  tool_file << n << "\n";
+  std::vector<std::vector<float> > joint_values(n);
+  for (int i = 0; i < n; ++i) {
+    joint_file << "p" << i << "\t";
+    tool_file << "p" << i << "\t";
+    for (int j = 0; j < 6; ++j) {
+      joint_values[i].push_back(uniform(-3, 3));
+      joint_file << joint_values[i][j] << (j < 5 ? "," : "\n");
+    }
+    tool_file << uniform(-1, 1) << "," << uniform(-1, 1) << "," << uniform(0, 1);
+    for (int j = 0; j < 4; ++j) {
+      tool_file << "," << uniform(-1, 1);
+    }
+    tool_file << "\n";
+  }
+  write(joints, joint_file.str());
+  write(tools, tool_file.str());
+  ArmPositionDB db(joints, tools);
+
+  for (int q = 0; q < 50; ++q) {
+    size_t k = 1 + q % 10;
+
+    std::vector<float> target(6);
+    for (int j = 0; j < 6; ++j) {
+      target[j] = uniform(-3, 3);
+    }
+    std::vector<float> brute;
+    for (int i = 0; i < n; ++i) {
+      std::vector<float> stored = db.get_joint_position("p" + std::to_string(i));
+      float distance = 0;
+      for (int j = 0; j < 6; ++j) {
+        distance += (stored[j] - target[j]) * (stored[j] - target[j]);
+      }
+      brute.push_back(std::sqrt(distance));
+    }
+    std::sort(brute.begin(), brute.end());
+    std::vector<ArmPositionDB::Match> matches = db.nearest_joint_positions(target, k);
+    ASSERT_EQ(k, matches.size());
+    for (size_t i = 0; i < k; ++i) {
+      EXPECT_NEAR(brute[i], matches[i].distance, 1e-4);
+    }
+
+    float weight = (q % 2) ? 1.0 : 0.2;
+    db.set_orientation_weight(weight);
+    geometry_msgs::Pose tool_target = pose(uniform(-1, 1), uniform(-1, 1), uniform(0, 1), uniform(-1, 1),
+                                           uniform(-1, 1), uniform(-1, 1), uniform(-1, 1));
+    double norm = std::sqrt(tool_target.orientation.x * tool_target.orientation.x +
+                            tool_target.orientation.y * tool_target.orientation.y +
+                            tool_target.orientation.z * tool_target.orientation.z +
+                            tool_target.orientation.w * tool_target.orientation.w);
+    brute.clear();
+    for (int i = 0; i < n; ++i) {
+      geometry_msgs::Pose stored = db.get_tool_position("p" + std::to_string(i));
+      double dp = std::pow(stored.position.x - tool_target.position.x, 2) +
+                  std::pow(stored.position.y - tool_target.position.y, 2) +
+                  std::pow(stored.position.z - tool_target.position.z, 2);
+      double same = 0, flipped = 0;
+      double s[4] = {stored.orientation.x, stored.orientation.y, stored.orientation.z, stored.orientation.w};
+      double t[4] = {tool_target.orientation.x / norm, tool_target.orientation.y / norm,
+                     tool_target.orientation.z / norm, tool_target.orientation.w / norm};
+      for (int j = 0; j < 4; ++j) {
+        same += (s[j] - t[j]) * (s[j] - t[j]);
+        flipped += (s[j] + t[j]) * (s[j] + t[j]);
+      }
+      brute.push_back(std::sqrt(dp + weight * weight * std::min(same, flipped)));
+    }
+    std::sort(brute.begin(), brute.end());
+    std::vector<ArmPositionDB::Match> tool_matches = db.nearest_tool_positions(tool_target, k);
+    ASSERT_EQ(k, tool_matches.size());
+    for (size_t i = 0; i < k; ++i) {
+      EXPECT_NEAR(brute[i], tool_matches[i].distance, 1e-4) << "query " << q << " rank " << i;
+    }
+  }
+
+  // a stored pose is its own closest match, whichever sign its quaternion has
+  geometry_msgs::Pose stored = db.get_tool_position("p17");
+  EXPECT_EQ("p17", db.nearest_tool_positions(stored, 1)[0].name);
+  stored.orientation.x = -stored.orientation.x;
+  stored.orientation.y = -stored.orientation.y;
+  stored.orientation.z = -stored.orientation.z;
+  stored.orientation.w = -stored.orientation.w;
+  std::vector<ArmPositionDB::Match> flipped = db.nearest_tool_positions(stored, 1);
+  EXPECT_EQ("p17", flipped[0].name);
+  EXPECT_NEAR(0, flipped[0].distance, 1e-4);
+  EXPECT_EQ("p42", db.nearest_joint_positions(db.get_joint_position("p42"), 1)[0].name);
+  EXPECT_THROW(db.nearest_joint_positions(std::vector<float>(5), 1), std::invalid_argument);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
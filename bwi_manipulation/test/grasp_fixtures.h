@@ -0,0 +1,103 @@
+#pragma once
+
+#include <bwi_manipulation/grasp_utils.h>
+
+#include <pcl/common/common.h>
+#include <pcl/common/transforms.h>
+#include <pcl/point_types.h>
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+typedef pcl::PointCloud<pcl::PointXYZ> Cloud;
+
+// The surface of a box with the given corners, sampled every step
+inline Cloud::Ptr boxCloud(const Eigen::Vector3f &min, const Eigen::Vector3f &max, float step) {
+  Cloud::Ptr cloud(new Cloud);
+  cloud->header.frame_id = "camera";
+  for (float x = min.x(); x <= max.x() + 1e-6; x += step) {
+    for (float y = min.y(); y <= max.y() + 1e-6; y += step) {
+      for (float z = min.z(); z <= max.z() + 1e-6; z += step) {
+        bool surface = x - min.x() < step || max.x() - x < step || y - min.y() < step || max.y() - y < step ||
+                       z - min.z() < step || max.z() - z < step;
+        if (surface) {
+          cloud->points.push_back(pcl::PointXYZ(x, y, z));
+        }
+      }
+    }
+  }
+  cloud->width = cloud->points.size();
+  cloud->height = 1;
+  return cloud;
+}
+
+inline geometry_msgs::Quaternion toMsg(const Eigen::Quaterniond &q) {
+  geometry_msgs::Quaternion msg;
+  tf::quaternionEigenToMsg(q, msg);
+  return msg;
+}
+
+// The grasps as generate_heuristic_grasps used to make them: the cloud moved into the grasp frame
+// (which pcl_ros::transformPointCloud did in place), then poses one at a time.
+inline std::vector<bwi_manipulation::GraspCartesianCommand>
+legacyGrasps(const Cloud::Ptr &target_cloud, const Eigen::Isometry3f &cloud_to_grasp,
+             const geometry_msgs::QuaternionStamped &grasp_x_orientation, double approach_offset,
+             double grasp_offset) {
+  using namespace bwi_manipulation::grasp_utils;
+  std::vector<geometry_msgs::PoseStamped> poses;
+  std::string frame_id = grasp_x_orientation.header.frame_id;
+  Cloud arm_frame;
+  pcl::transformPointCloud(*target_cloud, arm_frame, Eigen::Affine3f(cloud_to_grasp.matrix()));
+  Eigen::Vector4f box_min, box_max;
+  pcl::getMinMax3D(arm_frame, box_min, box_max);
+  Eigen::Vector4f position = box_min + (box_max - box_min) / 2;
+  position.w() = 1;
+
+  tf::Stamped<tf::Quaternion> origin_orientation;
+  tf::quaternionMsgToTF(grasp_x_orientation.quaternion, origin_orientation);
+  origin_orientation.frame_id_ = frame_id;
+  geometry_msgs::QuaternionStamped quat_stamped;
+  tf::Stamped<tf::Quaternion> quat;
+  quat.frame_id_ = frame_id;
+
+  Eigen::Vector4f min = position;
+  min.x() = box_min.x() + grasp_offset;
+  min.z() = box_min.z();
+  Eigen::Vector4f max = min;
+  max.z() = box_max.z();
+  generate_poses_along_line(frame_id, min, max, poses, grasp_x_orientation.quaternion);
+
+  Eigen::Vector4f grasp_point = position;
+  grasp_point.z() = box_max.z() - grasp_offset;
+  quat.setRPY(0.0, M_PI, 0);
+  quat = compose_quaternions(origin_orientation, quat);
+  tf::quaternionStampedTFToMsg(quat, quat_stamped);
+  generate_grasps_varying_orientation(frame_id, quat_stamped.quaternion, 0.25, grasp_point, poses);
+
+  min = position;
+  min.y() = box_min.y() + grasp_offset;
+  min.z() = box_min.z();
+  max = min;
+  max.z() = box_max.z();
+  quat.setRPY(0.0, 0.0, M_PI / 2);
+  quat = compose_quaternions(origin_orientation, quat);
+  tf::quaternionStampedTFToMsg(quat, quat_stamped);
+  generate_poses_along_line(frame_id, min, max, poses, quat_stamped.quaternion);
+
+  min = position;
+  min.y() = box_max.y() - grasp_offset;
+  min.z() = box_min.z();
+  max = min;
+  max.z() = box_max.z();
+  quat.setRPY(0.0, 0.0, -M_PI / 2);
+  quat = compose_quaternions(origin_orientation, quat);
+  tf::quaternionStampedTFToMsg(quat, quat_stamped);
+  generate_poses_along_line(frame_id, min, max, poses, quat_stamped.quaternion);
+
+  std::vector<bwi_manipulation::GraspCartesianCommand> grasp_commands;
+  for (size_t i = 0; i < poses.size(); ++i) {
+    grasp_commands.push_back(bwi_manipulation::GraspCartesianCommand::from_grasp_pose(poses[i], approach_offset));
+  }
+  return grasp_commands;
+}
@@ -0,0 +1,171 @@
+#include <bwi_manipulation/grasp_utils.h>
+#include <gtest/gtest.h>
+
+#include "grasp_fixtures.h"
+
+#include <cmath>
+#include <set>
+
+using namespace bwi_manipulation;
+using namespace bwi_manipulation::grasp_utils;
+
+static void expectSamePose(const geometry_msgs::PoseStamped &expected, const geometry_msgs::PoseStamped &actual,
+                           size_t index) {
+  EXPECT_EQ(expected.header.frame_id, actual.header.frame_id) << "candidate " << index;
+  EXPECT_NEAR(expected.pose.position.x, actual.pose.position.x, 1e-5) << "candidate " << index;
+  EXPECT_NEAR(expected.pose.position.y, actual.pose.position.y, 1e-5) << "candidate " << index;
+  EXPECT_NEAR(expected.pose.position.z, actual.pose.position.z, 1e-5) << "candidate " << index;
+  EXPECT_NEAR(expected.pose.orientation.x, actual.pose.orientation.x, 1e-6) << "candidate " << index;
+  EXPECT_NEAR(expected.pose.orientation.y, actual.pose.orientation.y, 1e-6) << "candidate " << index;
+  EXPECT_NEAR(expected.pose.orientation.z, actual.pose.orientation.z, 1e-6) << "candidate " << index;
+  EXPECT_NEAR(expected.pose.orientation.w, actual.pose.orientation.w, 1e-6) << "candidate " << index;
+}
+
+static void expectSameAsLegacy(const Cloud::Ptr &cloud, const Eigen::Isometry3f &cloud_to_grasp,
+                               const Eigen::Quaterniond &orientation, double approach_offset, double grasp_offset) {
+  geometry_msgs::QuaternionStamped grasp_x_orientation;
+  grasp_x_orientation.header.frame_id = "arm_base";
+  grasp_x_orientation.quaternion = toMsg(orientation);
+  std::vector<GraspCartesianCommand> expected =
+      legacyGrasps(cloud, cloud_to_grasp, grasp_x_orientation, approach_offset, grasp_offset);
+
+  GraspCandidates candidates;
+  generate_heuristic_grasps(*cloud, cloud_to_grasp, orientation, approach_offset, grasp_offset, candidates,
+                            LEGACY_ORIENTATIONS);
+  std::vector<GraspCartesianCommand> actual;
+  to_grasp_commands(candidates, "arm_base", actual);
+
+  ASSERT_EQ(expected.size(), actual.size());
+  ASSERT_EQ(heuristic_grasp_count(), actual.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    expectSamePose(expected[i].grasp_pose, actual[i].grasp_pose, i);
+    expectSamePose(expected[i].approach_pose, actual[i].approach_pose, i);
+  }
+}
+
+TEST(HeuristicGrasps, AxisAlignedBoxMatchesLegacy) {
+  Cloud::Ptr cloud = boxCloud(Eigen::Vector3f(0.4, -0.1, 0.0), Eigen::Vector3f(0.5, 0.1, 0.3), 0.01);
+  expectSameAsLegacy(cloud, Eigen::Isometry3f::Identity(), Eigen::Quaterniond::Identity(), 0.1, 0.02);
+}
+
+TEST(HeuristicGrasps, MovedBoxAndTurnedGripperMatchLegacy) {
+  Cloud::Ptr cloud = boxCloud(Eigen::Vector3f(-0.2, -0.05, 0.6), Eigen::Vector3f(0.05, 0.15, 0.9), 0.02);
+  Eigen::Isometry3f camera_to_arm = Eigen::Isometry3f::Identity();
+  camera_to_arm.rotate(Eigen::AngleAxisf(-M_PI / 2, Eigen::Vector3f::UnitX()));
+  camera_to_arm.rotate(Eigen::AngleAxisf(0.3, Eigen::Vector3f::UnitZ()));
+  camera_to_arm.pretranslate(Eigen::Vector3f(0.3, 0.1, 0.8));
+  Eigen::Quaterniond gripper(Eigen::AngleAxisd(M_PI / 2, Eigen::Vector3d::UnitY()));
+  expectSameAsLegacy(cloud, camera_to_arm, gripper, 0.15, 0.03);
+}
+
+TEST(HeuristicGrasps, CloudIsLeftAlone) {
+  Cloud::Ptr cloud = boxCloud(Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(0.1, 0.1, 0.1), 0.05);
+  Cloud before = *cloud;
+  Eigen::Isometry3f moved = Eigen::Isometry3f::Identity();
+  moved.translate(Eigen::Vector3f(1, 2, 3));
+  GraspCandidates candidates;
+  generate_heuristic_grasps(*cloud, moved, Eigen::Quaterniond::Identity(), 0.1, 0.0, candidates);
+  ASSERT_EQ(before.points.size(), cloud->points.size());
+  for (size_t i = 0; i < before.points.size(); ++i) {
+    EXPECT_EQ(before.points[i].x, cloud->points[i].x);
+    EXPECT_EQ(before.points[i].y, cloud->points[i].y);
+    EXPECT_EQ(before.points[i].z, cloud->points[i].z);
+  }
+  // the front line starts at the minimum of the moved box
+  EXPECT_FLOAT_EQ(1.0, candidates.x[0]);
+  EXPECT_FLOAT_EQ(3.0, candidates.z[0]);
+}
+
+TEST(HeuristicGrasps, NonFinitePointsAreSkipped) {
+  Cloud::Ptr cloud = boxCloud(Eigen::Vector3f(0, 0, 0), Eigen::Vector3f(0.1, 0.1, 0.1), 0.05);
+  Cloud::Ptr with_nans(new Cloud(*cloud));
+  with_nans->points.push_back(pcl::PointXYZ(std::numeric_limits<float>::quiet_NaN(), 5, 5));
+  with_nans->is_dense = false;
+
+  GraspCandidates clean, dirty;
+  generate_heuristic_grasps(*cloud, Eigen::Isometry3f::Identity(), Eigen::Quaterniond::Identity(), 0.1, 0.0, clean);
+  generate_heuristic_grasps(*with_nans, Eigen::Isometry3f::Identity(), Eigen::Quaterniond::Identity(), 0.1, 0.0,
+                            dirty);
+  EXPECT_EQ(clean.z, dirty.z);
+
+  Cloud empty;
+  generate_heuristic_grasps(empty, Eigen::Isometry3f::Identity(), Eigen::Quaterniond::Identity(), 0.1, 0.0, dirty);
+  EXPECT_EQ(0u, dirty.size());
+}
+
+// The orientations of the grasps from above, which come right after the front line, rounded so that
+// equal ones compare equal
+static std::set<std::vector<long> > orientationsFromAbove(const GraspCandidates &candidates) {
+  std::set<std::vector<long> > distinct;
+  const size_t first = HEURISTIC_LINE_POSES;
+  const size_t count = HEURISTIC_ORIENTATION_STEPS * HEURISTIC_ORIENTATION_STEPS * HEURISTIC_ORIENTATION_STEPS;
+  for (size_t i = first; i < first + count; ++i) {
+    Eigen::Quaterniond q(candidates.qw[i], candidates.qx[i], candidates.qy[i], candidates.qz[i]);
+    if (q.w() < 0) {
+      q.coeffs() = -q.coeffs();
+    }
+    std::vector<long> key;
+    key.push_back(std::lround(q.x() * 1e4));
+    key.push_back(std::lround(q.y() * 1e4));
+    key.push_back(std::lround(q.z() * 1e4));
+    key.push_back(std::lround(q.w() * 1e4));
+    distinct.insert(key);
+  }
+  return distinct;
+}
+
+TEST(HeuristicGrasps, DistinctOrientationsFromAbove) {
+  Cloud::Ptr cloud = boxCloud(Eigen::Vector3f(0.4, -0.1, 0.0), Eigen::Vector3f(0.5, 0.1, 0.3), 0.02);
+  GraspCandidates legacy, distinct;
+  generate_heuristic_grasps(*cloud, Eigen::Isometry3f::Identity(), Eigen::Quaterniond::Identity(), 0.1, 0.02,
+                            legacy, LEGACY_ORIENTATIONS);
+  generate_heuristic_grasps(*cloud, Eigen::Isometry3f::Identity(), Eigen::Quaterniond::Identity(), 0.1, 0.02,
+                            distinct);
+  ASSERT_EQ(heuristic_grasp_count(), distinct.size());
+
+  const size_t steps = HEURISTIC_ORIENTATION_STEPS;
+  EXPECT_EQ(steps * steps, orientationsFromAbove(legacy).size());
+  EXPECT_EQ(steps * steps * steps, orientationsFromAbove(distinct).size());
+
+  // only the grasps from above change
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    EXPECT_EQ(legacy.x[i], distinct.x[i]);
+    EXPECT_EQ(legacy.z[i], distinct.z[i]);
+    if (i < HEURISTIC_LINE_POSES || i >= HEURISTIC_LINE_POSES + steps * steps * steps) {
+      EXPECT_EQ(legacy.qw[i], distinct.qw[i]);
+    }
+  }
+}
+
+TEST(HeuristicGrasps, PlaneConflictsMatchTheSingleCheck) {
+  Cloud::Ptr cloud = boxCloud(Eigen::Vector3f(0.4, -0.1, 0.0), Eigen::Vector3f(0.5, 0.1, 0.3), 0.01);
+  GraspCandidates candidates;
+  generate_heuristic_grasps(*cloud, Eigen::Isometry3f::Identity(), Eigen::Quaterniond::Identity(), 0.1, 0.02,
+                            candidates);
+  std::vector<GraspCartesianCommand> commands;
+  to_grasp_commands(candidates, "arm_base", commands);
+
+  // a table just under the box, and a tilted plane through it
+  std::vector<Eigen::Vector4f> planes;
+  planes.push_back(Eigen::Vector4f(0, 0, 1, 0.01));
+  Eigen::Vector3f normal = Eigen::Vector3f(0.3, -0.2, 1).normalized();
+  planes.push_back(Eigen::Vector4f(normal.x(), normal.y(), normal.z(), -0.1));
+
+  for (size_t p = 0; p < planes.size(); ++p) {
+    std::vector<char> clear;
+    checkPlaneConflicts(candidates, planes[p], 0.05, clear);
+    ASSERT_EQ(commands.size(), clear.size());
+    size_t conflicts = 0;
+    for (size_t i = 0; i < commands.size(); ++i) {
+      EXPECT_EQ(checkPlaneConflict(commands[i], planes[p], 0.05), bool(clear[i])) << "candidate " << i;
+      conflicts += !clear[i];
+    }
+    EXPECT_GT(conflicts, 0u);
+    EXPECT_LT(conflicts, commands.size());
+  }
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
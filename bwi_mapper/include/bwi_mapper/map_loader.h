@@ -48,6 +48,13 @@
 
 namespace bwi_mapper {
 
+  /**
+   * \brief   Reads a standard ROS map from a YAML file and the image it
+   *          names, as MapLoader does, but throws std::runtime_error instead
+   *          of exiting if either of them can't be read
+   */
+  void loadMapFile(const std::string& fname, nav_msgs::OccupancyGrid& map);
+
   /**
    * \class MapLoader
    * \brief Base class for reading a standard ROS map from a YAML file and 
@@ -60,7 +67,7 @@ namespace bwi_mapper {
       /**
        * \brief   Constructor. Initializes map_resp_ with the given file
        * \param   fname absolute or relative system file location for the YAML
-       *          file
+       *          file. The process exits if it can't be read.
        */
       MapLoader (const std::string& fname);
 
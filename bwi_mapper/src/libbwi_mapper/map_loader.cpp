@@ -37,6 +37,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <stdexcept>
 #include <stdio.h>
 #include <libgen.h>
 
@@ -58,10 +59,7 @@ namespace YAML {
 
 namespace bwi_mapper {
 
-  /**
-   * \brief   Constructor. Initializes map_resp_ with the given file
-   */
-  MapLoader::MapLoader (const std::string& fname) {
+  void loadMapFile(const std::string& fname, nav_msgs::OccupancyGrid& map) {
 
     std::string mapfname = "";   
     double origin[3];
@@ -72,81 +70,82 @@ namespace bwi_mapper {
     // open supplied yaml file
     std::ifstream fin(fname.c_str());
     if (fin.fail()) {
-      std::cerr << "FATAL: Map_server could not open: " 
-        << fname << std::endl;
-      exit(-1);
+      throw std::runtime_error("Map_server could not open: " + fname);
     }
 
     // Initilize parameters
     YAML::Node doc;
+    try {
 #ifdef HAVE_NEW_YAMLCPP
-    doc = YAML::Load(fin);
+      doc = YAML::Load(fin);
 #else
-    YAML::Parser parser(fin);   
-    parser.GetNextDocument(doc);
+      YAML::Parser parser(fin);   
+      parser.GetNextDocument(doc);
 #endif
+    } catch (const YAML::Exception& e) {
+      throw std::runtime_error("The map " + fname + " is not valid YAML: " + e.what());
+    }
     try { 
       doc["resolution"] >> res; 
-    } catch (YAML::InvalidScalar) { 
-      std::cerr << "FATAL: The map does not contain a resolution tag "
-        << "or it is invalid." << std::endl;
-      exit(-1);
+    } catch (const YAML::Exception&) { 
+      throw std::runtime_error("The map does not contain a resolution tag or it is invalid: " + fname);
     }
     try { 
       doc["negate"] >> negate; 
-    } catch (YAML::InvalidScalar) { 
-      std::cerr << "FATAL: The map does not contain a negate tag "
-        << "or it is invalid." << std::endl;
-      exit(-1);
+    } catch (const YAML::Exception&) { 
+      throw std::runtime_error("The map does not contain a negate tag or it is invalid: " + fname);
     }
     try { 
       doc["occupied_thresh"] >> occ_th; 
-    } catch (YAML::InvalidScalar) { 
-      std::cerr << "FATAL: The map does not contain occupied_thresh tag "
-        << "or it is invalid." << std::endl;
-      exit(-1);
+    } catch (const YAML::Exception&) { 
+      throw std::runtime_error("The map does not contain occupied_thresh tag or it is invalid: " + fname);
     }
     try { 
       doc["free_thresh"] >> free_th; 
-    } catch (YAML::InvalidScalar) { 
-      std::cerr << "FATAL: The map does not contain free_thresh tag "
-        << "or it is invalid." << std::endl;
-      exit(-1);
+    } catch (const YAML::Exception&) { 
+      throw std::runtime_error("The map does not contain free_thresh tag or it is invalid: " + fname);
     }
     try { 
       doc["origin"][0] >> origin[0]; 
       doc["origin"][1] >> origin[1]; 
       doc["origin"][2] >> origin[2]; 
-    } catch (YAML::InvalidScalar) { 
-      std::cerr << "FATAL: The map does not contain origin tag "
-        << "or it is invalid." << std::endl;
-      exit(-1);
+    } catch (const YAML::Exception&) { 
+      throw std::runtime_error("The map does not contain origin tag or it is invalid: " + fname);
     }
 
     // Get image data
     try { 
       doc["image"] >> mapfname; 
-      if(mapfname.size() == 0) {
-        std::cerr << "FATAL: The image tag cannot be an empty string."
-          << std::endl;
-        exit(-1);
-      }
-      if(mapfname[0] != '/') {
-        // dirname can modify what you pass it
-        char* fname_copy = strdup(fname.c_str());
-        mapfname = std::string(dirname(fname_copy)) + '/' + mapfname;
-        free(fname_copy);
-      }
-    } catch (YAML::InvalidScalar) { 
-      std::cerr << "FATAL: The map does not contain an image tag "
-        << "or it is invalid." << std::endl;
-      exit(-1);
+    } catch (const YAML::Exception&) { 
+      throw std::runtime_error("The map does not contain an image tag or it is invalid: " + fname);
+    }
+    if(mapfname.size() == 0) {
+      throw std::runtime_error("The image tag cannot be an empty string: " + fname);
+    }
+    if(mapfname[0] != '/') {
+      // dirname can modify what you pass it
+      char* fname_copy = strdup(fname.c_str());
+      mapfname = std::string(dirname(fname_copy)) + '/' + mapfname;
+      free(fname_copy);
     }
 
     std::cout << "MapLoader: Loading map from image " << mapfname << std::endl;
-    map_server::loadMapFromFile(&map_resp_, mapfname.c_str(), res, negate, 
+    nav_msgs::GetMap::Response map_resp;
+    map_server::loadMapFromFile(&map_resp, mapfname.c_str(), res, negate, 
         free_th, free_th, origin);
+    map = map_resp.map;
+  }
 
+  /**
+   * \brief   Constructor. Initializes map_resp_ with the given file
+   */
+  MapLoader::MapLoader (const std::string& fname) {
+    try {
+      loadMapFile(fname, map_resp_.map);
+    } catch (const std::runtime_error& e) {
+      std::cerr << "FATAL: " << e.what() << std::endl;
+      exit(-1);
+    }
   }
 
   /**
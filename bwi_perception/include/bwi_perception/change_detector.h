@@ -0,0 +1,90 @@
+#ifndef BWI_PERCEPTION_CHANGE_DETECTOR_H
+#define BWI_PERCEPTION_CHANGE_DETECTOR_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <Eigen/Dense>
+
+#include <cstdint>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace bwi_perception {
+
+    struct ChangeDetectorParams {
+        ChangeDetectorParams() : leaf_size(0.01f), min_points_per_voxel(7), persistence(5), background_frames(3),
+                                 min_cluster_voxels(10),
+                                 workspace_min(-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+                                               -std::numeric_limits<float>::max(), 1.f),
+                                 workspace_max(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                                               std::numeric_limits<float>::max(), 1.f) {}
+
+        float leaf_size;
+        // a voxel with fewer points in a frame counts as empty in that frame
+        unsigned int min_points_per_voxel;
+        // how many consecutive frames a voxel has to be newly occupied before it counts as changed
+        unsigned int persistence;
+        // the first frames after a reset make up the background the following ones are compared to
+        unsigned int background_frames;
+        // clusters of fewer changed voxels are dropped as noise
+        size_t min_cluster_voxels;
+        // only points inside this box, in the frame of the input clouds, are looked at
+        Eigen::Vector4f workspace_min;
+        Eigen::Vector4f workspace_max;
+    };
+
+    // Finds what appeared in a scene since the detector was reset. Every frame is cropped to the workspace and
+    // binned into a hashed voxel grid; voxels that are occupied now but weren't in the background collect one hit
+    // per consecutive frame, and the ones with enough hits are grouped into clusters of touching voxels.
+    class ChangeDetector {
+    public:
+        typedef pcl::PointXYZRGB PointT;
+        typedef pcl::PointCloud<PointT> PointCloudT;
+
+        explicit ChangeDetector(const ChangeDetectorParams &params = ChangeDetectorParams());
+
+        const ChangeDetectorParams &params() const {
+            return params_;
+        }
+
+        // Forgets the background and all hits; the next frames are learned as the new background
+        void reset();
+
+        // Processes the next frame. The clusters hold the points of the frame that fall into changed voxels.
+        // Returns false while the background is still being learned.
+        bool update(const PointCloudT &cloud, std::vector<PointCloudT::Ptr> &clusters);
+
+        size_t changedVoxels() const {
+            return changed_.size();
+        }
+
+    private:
+        struct Hits {
+            uint32_t count;
+            uint64_t last_frame;
+        };
+
+        uint64_t key(const PointT &point) const;
+
+        void cluster(const PointCloudT &cloud, std::vector<PointCloudT::Ptr> &clusters);
+
+        ChangeDetectorParams params_;
+        float inverse_leaf_size_;
+        uint64_t frame_;
+
+        std::unordered_set<uint64_t> background_;
+        std::unordered_map<uint64_t, Hits> hits_;
+        std::vector<uint64_t> changed_;
+
+        // reused between frames: the voxel of every point in the workspace, and the points per voxel
+        std::vector<std::pair<uint64_t, int> > point_voxels_;
+        std::unordered_map<uint64_t, uint32_t> occupancy_;
+        std::unordered_map<uint64_t, int> cluster_of_;
+    };
+
+}
+
+#endif //BWI_PERCEPTION_CHANGE_DETECTOR_H
@@ -0,0 +1,88 @@
+#ifndef BWI_PERCEPTION_CLOUD_ACCUMULATOR_H
+#define BWI_PERCEPTION_CLOUD_ACCUMULATOR_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace bwi_perception {
+
+    // Fuses the last few frames of a camera into a single voxelized cloud without keeping the frames around.
+    // Every frame is reduced to per voxel sums when it comes in, which are kept in a ring with one slot per
+    // frame, and added to a running grid. When the ring is full the oldest frame's sums are subtracted again,
+    // so the fused cloud is the average of each voxel over the frames in the ring.
+    class CloudAccumulator {
+    public:
+        typedef pcl::PointXYZRGB PointT;
+        typedef pcl::PointCloud<PointT> PointCloudT;
+
+        CloudAccumulator(size_t capacity, float leaf_size);
+
+        // Reads the points straight out of the message, falling back on pcl::fromROSMsg for clouds without rgb
+        void add(const sensor_msgs::PointCloud2 &cloud_msg);
+
+        void add(const PointCloudT &cloud);
+
+        // True while a call to collect is waiting for frames. Frames added at other times are kept as well,
+        // but subscribers can use this to skip work nobody asked for.
+        bool collecting() const {
+            return collecting_ > 0;
+        }
+
+        // Drops everything accumulated so far, waits for n new frames and writes the fused cloud to out. Only the
+        // last capacity frames make it into the result if n is larger. Returns false if the node shut down first.
+        bool collect(size_t n, PointCloudT &out);
+
+        // The fused cloud of the frames currently in the ring, one point per occupied voxel
+        void fused(PointCloudT &out) const;
+
+        void clear();
+
+    private:
+        struct Voxel {
+            uint64_t key;
+            double x, y, z;
+            double r, g, b;
+            uint32_t count;
+        };
+
+        uint64_t key(float x, float y, float z) const;
+
+        // begin a frame, add its points, then commit it. Called with mutex_ held.
+        void beginFrame();
+
+        void addPoint(float x, float y, float z, uint8_t r, uint8_t g, uint8_t b);
+
+        void commitFrame(const pcl::PCLHeader &header);
+
+        const size_t capacity_;
+        const float inverse_leaf_size_;
+
+        mutable std::mutex mutex_;
+        std::condition_variable frame_cv_;
+        // serializes callers of collect, which clear the accumulator
+        std::mutex collect_mutex_;
+        std::atomic<int> collecting_;
+
+        // per voxel sums of each frame in the ring; head_ is where the next frame goes
+        std::vector<std::vector<Voxel> > ring_;
+        size_t head_;
+        size_t frames_;
+        uint64_t frames_added_;
+
+        // voxel key to position in the current frame's slot
+        std::unordered_map<uint64_t, uint32_t> frame_index_;
+        std::unordered_map<uint64_t, Voxel> grid_;
+        pcl::PCLHeader header_;
+    };
+
+}
+
+#endif //BWI_PERCEPTION_CLOUD_ACCUMULATOR_H
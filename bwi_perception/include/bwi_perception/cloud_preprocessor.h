@@ -0,0 +1,92 @@
+#ifndef BWI_PERCEPTION_CLOUD_PREPROCESSOR_H
+#define BWI_PERCEPTION_CLOUD_PREPROCESSOR_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/filters/crop_box.h>
+#include <pcl/filters/voxel_grid.h>
+#include <tf/transform_listener.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace bwi_perception {
+
+    struct CloudRegion {
+        CloudRegion() : z_min(-std::numeric_limits<float>::max()), z_max(std::numeric_limits<float>::max()),
+                        x_min(-std::numeric_limits<float>::max()), x_max(std::numeric_limits<float>::max()),
+                        leaf_size(0.0025f) {}
+
+        // the region is expressed in this frame, and so are the filtered clouds
+        std::string frame;
+        float z_min;
+        float z_max;
+        float x_min;
+        float x_max;
+        float leaf_size;
+    };
+
+    // Brings incoming clouds into the region frame, crops and voxelizes them on a background thread, the same way
+    // filter_cloud_region does. Only the newest raw cloud is kept: if the camera outpaces the filter, older
+    // frames are dropped rather than queued. The working clouds are allocated once and reused for every frame.
+    // A frame whose transform isn't available within a short timeout is dropped too, so the thread never blocks
+    // on tf for long and notices a shutdown.
+    class CloudPreprocessor {
+    public:
+        typedef pcl::PointXYZRGB PointT;
+        typedef pcl::PointCloud<PointT> PointCloudT;
+
+        CloudPreprocessor(const CloudRegion &region, tf::TransformListener &listener);
+
+        ~CloudPreprocessor();
+
+        const CloudRegion &region() const {
+            return region_;
+        }
+
+        // Hands a raw cloud to the filtering thread. The cloud must not be modified afterwards.
+        void push(const PointCloudT::ConstPtr &raw);
+
+        // Stitches n filtered frames that arrived after the call into out. When more than one frame is stitched
+        // the result is voxelized again, so it has the density of a single frame.
+        // Returns false if the node shut down before enough frames came in.
+        bool waitForClouds(unsigned int n, PointCloudT &out);
+
+    private:
+        void run();
+
+        // false if the cloud couldn't be brought into the region frame, in which case the frame is dropped
+        bool filter(const PointCloudT::ConstPtr &raw);
+
+        CloudRegion region_;
+        tf::TransformListener &listener_;
+
+        std::mutex mutex_;
+        std::condition_variable raw_cv_;
+        std::condition_variable filtered_cv_;
+        bool stop_;
+
+        PointCloudT::ConstPtr raw_;
+        uint64_t raw_count_;
+
+        // the newest filtered frame and the number of the raw frame it came from
+        PointCloudT::Ptr filtered_;
+        uint64_t filtered_source_;
+
+        // only touched by the filtering thread
+        PointCloudT::Ptr transformed_;
+        PointCloudT::Ptr cropped_;
+        PointCloudT::Ptr voxelized_;
+        pcl::CropBox<PointT> crop_;
+        pcl::VoxelGrid<PointT> voxel_grid_;
+
+        std::thread worker_;
+    };
+
+}
+
+#endif //BWI_PERCEPTION_CLOUD_PREPROCESSOR_H
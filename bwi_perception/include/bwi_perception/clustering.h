@@ -0,0 +1,294 @@
+#ifndef BWI_PERCEPTION_CLUSTERING_H
+#define BWI_PERCEPTION_CLUSTERING_H
+
+#include <pcl/point_cloud.h>
+#include <pcl/PointIndices.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace bwi_perception {
+
+    // Disjoint sets over 0..n-1 with union by size and path halving
+    class UnionFind {
+    public:
+        explicit UnionFind(size_t n) : parent_(n), size_(n, 1) {
+            for (size_t i = 0; i < n; i++) {
+                parent_[i] = (int) i;
+            }
+        }
+
+        int find(int i) {
+            while (parent_[i] != i) {
+                parent_[i] = parent_[parent_[i]];
+                i = parent_[i];
+            }
+            return i;
+        }
+
+        void unite(int a, int b) {
+            a = find(a);
+            b = find(b);
+            if (a == b) {
+                return;
+            }
+            if (size_[a] < size_[b]) {
+                std::swap(a, b);
+            }
+            parent_[b] = a;
+            size_[a] += size_[b];
+        }
+
+    private:
+        std::vector<int> parent_;
+        std::vector<size_t> size_;
+    };
+
+    template<typename PointT>
+    inline bool within_distance(const PointT &a, const PointT &b, float squared_tolerance) {
+        float dx = a.x - b.x;
+        float dy = a.y - b.y;
+        float dz = a.z - b.z;
+        return dx * dx + dy * dy + dz * dz <= squared_tolerance;
+    }
+
+    template<typename PointT>
+    inline bool is_finite_point(const PointT &p) {
+        return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z);
+    }
+
+    // Turns the sets of a union-find over the points into clusters of sizes within the bounds, largest first,
+    // the same order EuclideanClusterExtraction gives them in
+    inline void collect_clusters(UnionFind &sets, const std::vector<int> &points, size_t min_cluster_size,
+                                 size_t max_cluster_size, std::vector<pcl::PointIndices> &out) {
+        std::unordered_map<int, size_t> cluster_of_root;
+        std::vector<pcl::PointIndices> clusters;
+        for (size_t i = 0; i < points.size(); i++) {
+            int root = sets.find((int) i);
+            auto inserted = cluster_of_root.emplace(root, clusters.size());
+            if (inserted.second) {
+                clusters.emplace_back();
+            }
+            clusters[inserted.first->second].indices.push_back(points[i]);
+        }
+
+        std::sort(clusters.begin(), clusters.end(), [](const pcl::PointIndices &lhs, const pcl::PointIndices &rhs) {
+            return lhs.indices.size() > rhs.indices.size();
+        });
+        for (auto &cluster : clusters) {
+            if (cluster.indices.size() >= min_cluster_size && cluster.indices.size() <= max_cluster_size) {
+                out.push_back(std::move(cluster));
+            }
+        }
+    }
+
+    // Approximate Euclidean clustering of a dense camera frame, using the image grid as the neighbourhood: points
+    // are connected when they are within window pixels of each other and within tolerance in space. Points that are
+    // close in space but further apart in the image are never connected, so a cluster can come out split where
+    // euclidean_clusters would join it; only use it where that is acceptable.
+    // Only the points in indices are clustered, all finite points if it's empty. Points removed this way keep
+    // their place in the grid, so e.g. the points of a table can be taken out without losing the organization.
+    template<typename PointT>
+    void organized_euclidean_clusters(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices,
+                                      double tolerance, size_t min_cluster_size, size_t max_cluster_size,
+                                      std::vector<pcl::PointIndices> &out, int window = 2) {
+        const int width = (int) cloud.width;
+        const int height = (int) cloud.height;
+        const float squared_tolerance = (float) (tolerance * tolerance);
+
+        // position of every pixel in the list of clustered points, -1 if it isn't clustered
+        std::vector<int> points;
+        std::vector<int> slot(cloud.points.size(), -1);
+        if (indices.empty()) {
+            for (int i = 0; i < (int) cloud.points.size(); i++) {
+                if (is_finite_point(cloud.points[i])) {
+                    slot[i] = (int) points.size();
+                    points.push_back(i);
+                }
+            }
+        } else {
+            for (int i : indices) {
+                if (slot[i] < 0 && is_finite_point(cloud.points[i])) {
+                    slot[i] = (int) points.size();
+                    points.push_back(i);
+                }
+            }
+        }
+
+        UnionFind sets(points.size());
+        for (int v = 0; v < height; v++) {
+            for (int u = 0; u < width; u++) {
+                int i = v * width + u;
+                if (slot[i] < 0) {
+                    continue;
+                }
+                // only look forward in scan order, every pair is visited once
+                for (int dv = 0; dv <= window && v + dv < height; dv++) {
+                    for (int du = dv == 0 ? 1 : -window; du <= window; du++) {
+                        int nu = u + du;
+                        if (nu < 0 || nu >= width) {
+                            continue;
+                        }
+                        int j = (v + dv) * width + nu;
+                        if (slot[j] >= 0 && within_distance(cloud.points[i], cloud.points[j], squared_tolerance)) {
+                            sets.unite(slot[i], slot[j]);
+                        }
+                    }
+                }
+            }
+        }
+
+        collect_clusters(sets, points, min_cluster_size, max_cluster_size, out);
+    }
+
+    // Euclidean clustering of an unorganized, typically voxelized, cloud. Points are hashed into cells small enough
+    // that everything in a cell is within tolerance, so each cell is connected as a whole; neighbouring cells are
+    // then joined as soon as one pair of their points is close enough, and skipped if they already are.
+    // Gives the same clusters as EuclideanClusterExtraction without building a search tree.
+    template<typename PointT>
+    void voxel_euclidean_clusters(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices,
+                                  double tolerance, size_t min_cluster_size, size_t max_cluster_size,
+                                  std::vector<pcl::PointIndices> &out) {
+        const float squared_tolerance = (float) (tolerance * tolerance);
+        // the diagonal of a cell is the tolerance
+        const double cell_size = tolerance / std::sqrt(3.);
+        const double inverse_cell_size = 1. / cell_size;
+
+        std::vector<int> points;
+        if (indices.empty()) {
+            for (int i = 0; i < (int) cloud.points.size(); i++) {
+                if (is_finite_point(cloud.points[i])) {
+                    points.push_back(i);
+                }
+            }
+        } else {
+            for (int i : indices) {
+                if (is_finite_point(cloud.points[i])) {
+                    points.push_back(i);
+                }
+            }
+        }
+
+        // cell coordinates are packed into 21 bits each
+        const int64_t offset = 1 << 20;
+        const uint64_t mask = (1 << 21) - 1;
+        auto pack = [offset, mask](int64_t x, int64_t y, int64_t z) {
+            return ((uint64_t) (x + offset) & mask) << 42 | ((uint64_t) (y + offset) & mask) << 21 |
+                   ((uint64_t) (z + offset) & mask);
+        };
+
+        // the cell of every point, and the points of every cell stored contiguously
+        std::unordered_map<uint64_t, int> cell_of_key;
+        std::vector<int64_t> cell_coordinates;
+        std::vector<int> cell_of_point(points.size());
+        for (size_t p = 0; p < points.size(); p++) {
+            const PointT &point = cloud.points[points[p]];
+            int64_t x = (int64_t) std::floor(point.x * inverse_cell_size);
+            int64_t y = (int64_t) std::floor(point.y * inverse_cell_size);
+            int64_t z = (int64_t) std::floor(point.z * inverse_cell_size);
+            auto inserted = cell_of_key.emplace(pack(x, y, z), (int) cell_of_key.size());
+            if (inserted.second) {
+                cell_coordinates.push_back(x);
+                cell_coordinates.push_back(y);
+                cell_coordinates.push_back(z);
+            }
+            cell_of_point[p] = inserted.first->second;
+        }
+
+        const size_t num_cells = cell_of_key.size();
+        std::vector<int> cell_start(num_cells + 1, 0);
+        for (int cell : cell_of_point) {
+            cell_start[cell + 1]++;
+        }
+        for (size_t c = 0; c < num_cells; c++) {
+            cell_start[c + 1] += cell_start[c];
+        }
+        std::vector<int> cell_points(points.size());
+        {
+            std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+            for (size_t p = 0; p < points.size(); p++) {
+                cell_points[fill[cell_of_point[p]]++] = (int) p;
+            }
+        }
+
+        // union-find over the cells
+        UnionFind cells(num_cells);
+        for (size_t a = 0; a < num_cells; a++) {
+            const int64_t ax = cell_coordinates[3 * a];
+            const int64_t ay = cell_coordinates[3 * a + 1];
+            const int64_t az = cell_coordinates[3 * a + 2];
+            for (int dx = -2; dx <= 2; dx++) {
+                for (int dy = -2; dy <= 2; dy++) {
+                    for (int dz = -2; dz <= 2; dz++) {
+                        // half of the neighbourhood, the other half is visited from the other side
+                        if (dx < 0 || (dx == 0 && (dy < 0 || (dy == 0 && dz <= 0)))) {
+                            continue;
+                        }
+                        // cells whose closest corners are further apart than the tolerance can't touch
+                        double gap_x = std::max(0, std::abs(dx) - 1) * cell_size;
+                        double gap_y = std::max(0, std::abs(dy) - 1) * cell_size;
+                        double gap_z = std::max(0, std::abs(dz) - 1) * cell_size;
+                        if (gap_x * gap_x + gap_y * gap_y + gap_z * gap_z > squared_tolerance) {
+                            continue;
+                        }
+                        auto neighbour = cell_of_key.find(pack(ax + dx, ay + dy, az + dz));
+                        if (neighbour == cell_of_key.end()) {
+                            continue;
+                        }
+                        int b = neighbour->second;
+                        if (cells.find((int) a) == cells.find(b)) {
+                            continue;
+                        }
+                        bool touching = false;
+                        for (int i = cell_start[a]; i < cell_start[a + 1] && !touching; i++) {
+                            const PointT &p = cloud.points[points[cell_points[i]]];
+                            for (int j = cell_start[b]; j < cell_start[b + 1]; j++) {
+                                if (within_distance(p, cloud.points[points[cell_points[j]]], squared_tolerance)) {
+                                    touching = true;
+                                    break;
+                                }
+                            }
+                        }
+                        if (touching) {
+                            cells.unite((int) a, b);
+                        }
+                    }
+                }
+            }
+        }
+
+        // points take the set of their cell
+        UnionFind sets(points.size());
+        for (size_t p = 0; p < points.size(); p++) {
+            sets.unite((int) p, cell_points[cell_start[cells.find(cell_of_point[p])]]);
+        }
+        collect_clusters(sets, points, min_cluster_size, max_cluster_size, out);
+    }
+
+    // Exact Euclidean clustering of any cloud, organized or not. organized_euclidean_clusters has to be asked for
+    // explicitly
+    template<typename PointT>
+    void euclidean_clusters(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices, double tolerance,
+                            size_t min_cluster_size, size_t max_cluster_size, std::vector<pcl::PointIndices> &out) {
+        voxel_euclidean_clusters(cloud, indices, tolerance, min_cluster_size, max_cluster_size, out);
+    }
+
+    // What the segmentation of a scene into objects uses: a frame that is still organized is clustered over the
+    // image grid, where an object split at a gap of missing depth is acceptable, and anything else exactly
+    template<typename PointT>
+    void segmentation_clusters(const pcl::PointCloud<PointT> &cloud, const std::vector<int> &indices,
+                               double tolerance, size_t min_cluster_size, size_t max_cluster_size,
+                               std::vector<pcl::PointIndices> &out) {
+        if (cloud.isOrganized()) {
+            organized_euclidean_clusters(cloud, indices, tolerance, min_cluster_size, max_cluster_size, out);
+        } else {
+            euclidean_clusters(cloud, indices, tolerance, min_cluster_size, max_cluster_size, out);
+        }
+    }
+
+}
+
+#endif //BWI_PERCEPTION_CLUSTERING_H
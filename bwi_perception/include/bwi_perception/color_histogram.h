@@ -0,0 +1,51 @@
+#ifndef BWI_PERCEPTION_COLOR_HISTOGRAM_H
+#define BWI_PERCEPTION_COLOR_HISTOGRAM_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bwi_perception {
+
+    // RGB histogram with dim bins per channel, stored as one contiguous array indexed by (r * dim + g) * dim + b.
+    // Channels are binned through a 256 entry lookup table, which gives the same bins as dividing by 256 / dim.
+    class ColorHistogram {
+    public:
+        explicit ColorHistogram(int dim);
+
+        // Adds the points of the cloud to the histogram. Large clouds are split among threads that fill partial
+        // histograms merged at the end; 0 threads picks the number automatically.
+        void computeHistogram(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, unsigned int threads = 0);
+
+        uint32_t get(int r, int g, int b) const {
+            return bins_[(r * dim_ + g) * dim_ + b];
+        }
+
+        const std::vector<uint32_t> &bins() const {
+            return bins_;
+        }
+
+        int dim() const {
+            return dim_;
+        }
+
+        std::vector<double> toDoubleVector() const;
+
+        // Each bin divided by the number of points added
+        std::vector<double> toDoubleVectorNormalized() const;
+
+    private:
+        void accumulate(const pcl::PointXYZRGB *begin, const pcl::PointXYZRGB *end, uint32_t *bins) const;
+
+        int dim_;
+        size_t cloud_size_;
+        uint16_t lut_[256];
+        std::vector<uint32_t> bins_;
+    };
+
+}
+
+#endif //BWI_PERCEPTION_COLOR_HISTOGRAM_H
@@ -4,6 +4,7 @@
 #include <ros/ros.h>
 #include <bwi_perception/PerceiveTabletopScene.h>
 #include <bwi_perception/PerceiveLargestHorizontalPlane.h>
+#include <bwi_perception/ExtractClusterFeatures.h>
 #include <geometry_msgs/Vector3Stamped.h>
 #include <tf/transform_listener.h>
 #include <Eigen/Dense>
@@ -15,6 +16,13 @@ namespace bwi_perception {
 
     bwi_perception::PerceiveLargestHorizontalPlane::Response perceiveLargestHorizontalPlane(ros::NodeHandle &n);
 
+    // Descriptors of all clusters in one call, e.g. the cloud_clusters of a tabletop scene. color_histogram_bins is
+    // per channel, from 1 to 256
+    bwi_perception::ExtractClusterFeatures::Response extractClusterFeatures(ros::NodeHandle &n,
+                                                                            const std::vector<sensor_msgs::PointCloud2> &clusters,
+                                                                            bool color_histogram, int color_histogram_bins,
+                                                                            bool cvfh, bool fpfh);
+
 
     void quaternion_to_frame(const tf::Stamped<tf::Quaternion> &quaternion, const std::string &target_frame,
                                              tf::Stamped<tf::Quaternion> &out_quaternion, tf::TransformListener &tf_listener);
@@ -57,5 +65,30 @@ namespace bwi_perception {
         }
     }
 
+    // cloud_to_frame for callers that run every frame: it waits at most timeout for the transform and doesn't log.
+    // Returns false, leaving output untouched, if the transform isn't available in time.
+    template <typename PointT>
+    bool try_cloud_to_frame(const typename pcl::PointCloud<PointT>::Ptr &input, const std::string &target_frame,
+                            typename pcl::PointCloud<PointT>::Ptr &output, tf::TransformListener &listener,
+                            const ros::Duration &timeout) {
+        if (input->header.frame_id == target_frame) {
+            output = input;
+            return true;
+        }
+        tf::StampedTransform stamped_transform;
+        try {
+            if (!listener.waitForTransform(target_frame, input->header.frame_id, ros::Time(0), timeout)) {
+                return false;
+            }
+            listener.lookupTransform(target_frame, input->header.frame_id, ros::Time(0), stamped_transform);
+        } catch (tf::TransformException &) {
+            return false;
+        }
+        pcl_ros::transformPointCloud(*input, *output, stamped_transform);
+        output->header.frame_id = target_frame;
+        pcl_conversions::toPCL(ros::Time::now(), output->header.stamp);
+        return true;
+    }
+
 }
 #endif //BWI_PERCEPTION_CONVENIENCE_H
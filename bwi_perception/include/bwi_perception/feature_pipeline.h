@@ -0,0 +1,156 @@
+#ifndef BWI_PERCEPTION_FEATURE_PIPELINE_H
+#define BWI_PERCEPTION_FEATURE_PIPELINE_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/kdtree/kdtree_flann.h>
+#include <pcl/search/kdtree.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace bwi_perception {
+
+    enum FeatureType {
+        CVFH,
+        VFH,
+        FPFH,
+        PFH
+    };
+
+    struct FeatureParams {
+        FeatureParams() : normals_search_radius(0.02), fpfh_neighbor_radius(0.05),
+                          pfh_normals_search_radius(0.03), pfh_neighbor_radius(0.05) {}
+
+        double normals_search_radius;
+        double fpfh_neighbor_radius;
+        double pfh_normals_search_radius;
+        double pfh_neighbor_radius;
+    };
+
+    // A search object of its own over a kd-tree index that is shared with others. PCL estimators may reconfigure
+    // the search object they are given, so every estimator gets one of these, while the index is built once and
+    // only ever queried, which FLANN allows from several threads at once. Pointing it at another cloud, or changing
+    // how results are sorted, gives it a private index instead of touching the shared one.
+    template<typename PointT>
+    class SharedKdTree : public pcl::search::KdTree<PointT> {
+    public:
+        typedef typename pcl::search::KdTree<PointT>::PointCloudConstPtr PointCloudConstPtr;
+        typedef typename pcl::search::KdTree<PointT>::IndicesConstPtr IndicesConstPtr;
+        typedef typename pcl::search::KdTree<PointT>::KdTreePtr KdTreePtr;
+
+        SharedKdTree(const KdTreePtr &index, const PointCloudConstPtr &cloud) {
+            this->tree_ = index;
+            this->input_ = cloud;
+        }
+
+        void setInputCloud(const PointCloudConstPtr &cloud, const IndicesConstPtr &indices = IndicesConstPtr()) {
+            if (cloud == this->input_ && !indices && !this->indices_) {
+                return;
+            }
+            this->tree_.reset(new pcl::KdTreeFLANN<PointT>(this->sorted_results_));
+            pcl::search::KdTree<PointT>::setInputCloud(cloud, indices);
+        }
+
+        void setSortedResults(bool sorted_results) {
+            if (sorted_results == this->sorted_results_) {
+                return;
+            }
+            this->sorted_results_ = sorted_results;
+            this->tree_.reset(new pcl::KdTreeFLANN<PointT>(sorted_results));
+            this->tree_->setInputCloud(this->input_, this->indices_);
+        }
+    };
+
+    // Everything the descriptors of one cloud have in common: the kd-tree index is built once, and the normals
+    // once per search radius. Holding on to a context is what lets follow-up requests for the same cluster reuse
+    // that work.
+    class CloudFeatureContext {
+    public:
+        typedef pcl::PointXYZRGB PointT;
+        typedef pcl::PointCloud<PointT> PointCloudT;
+        typedef boost::shared_ptr<CloudFeatureContext> Ptr;
+
+        explicit CloudFeatureContext(const PointCloudT::Ptr &cloud);
+
+        const PointCloudT::Ptr &cloud() const {
+            return cloud_;
+        }
+
+        // A new search object over the shared index of cloud(), for one estimator. The PCL estimators that are
+        // given both never rebuild it
+        pcl::search::KdTree<PointT>::Ptr search() const;
+
+        pcl::PointCloud<pcl::Normal>::Ptr normals(double search_radius);
+
+    private:
+        PointCloudT::Ptr cloud_;
+        pcl::KdTreeFLANN<PointT>::Ptr index_;
+
+        std::mutex normals_mutex_;
+        std::map<double, pcl::PointCloud<pcl::Normal>::Ptr> normals_;
+    };
+
+    // Computes any set of descriptors for a cloud from a shared context, one thread per descriptor.
+    // Contexts of recently seen clouds are kept, found by a hash of the cloud message and checked against a copy
+    // of its contents.
+    class FeaturePipeline {
+    public:
+        typedef CloudFeatureContext::PointCloudT PointCloudT;
+
+        explicit FeaturePipeline(const FeatureParams &params = FeatureParams(), size_t cache_size = 32);
+
+        // Returns the cached context of an identical cloud if there is one, otherwise builds and caches a new one
+        CloudFeatureContext::Ptr context(const sensor_msgs::PointCloud2 &cloud_msg);
+
+        CloudFeatureContext::Ptr context(const PointCloudT::Ptr &cloud) const;
+
+        std::map<FeatureType, std::vector<double> > compute(const CloudFeatureContext::Ptr &context,
+                                                             const std::set<FeatureType> &features) const;
+
+        std::vector<double> compute(const CloudFeatureContext::Ptr &context, FeatureType feature) const;
+
+        std::vector<double> computeCVFH(const CloudFeatureContext::Ptr &context) const;
+
+        std::vector<double> computeVFH(const CloudFeatureContext::Ptr &context) const;
+
+        std::vector<double> computeFPFH(const CloudFeatureContext::Ptr &context) const;
+
+        std::vector<double> computePFH(const CloudFeatureContext::Ptr &context) const;
+
+    private:
+        // The parts of a cloud message that its context depends on
+        struct CacheKey {
+            size_t hash;
+            uint32_t point_step;
+            std::vector<std::string> field_names;
+            std::vector<uint32_t> field_offsets;
+            std::vector<uint8_t> field_datatypes;
+            std::string frame_id;
+            std::vector<uint8_t> data;
+
+            explicit CacheKey(const sensor_msgs::PointCloud2 &cloud_msg);
+
+            bool matches(const sensor_msgs::PointCloud2 &cloud_msg) const;
+        };
+
+        static size_t hash(const sensor_msgs::PointCloud2 &cloud_msg);
+
+        FeatureParams params_;
+        size_t cache_size_;
+
+        std::mutex cache_mutex_;
+        // most recently used first
+        std::list<std::pair<CacheKey, CloudFeatureContext::Ptr> > cache_;
+    };
+
+}
+
+#endif //BWI_PERCEPTION_FEATURE_PIPELINE_H
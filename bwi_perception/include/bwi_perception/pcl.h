@@ -5,6 +5,9 @@
 #include <pcl/segmentation/extract_clusters.h>
 #include <bwi_perception/convenience.h>
 #include <bwi_perception/comparison.h>
+#include <bwi_perception/clustering.h>
+
+#include <limits>
 
 namespace bwi_perception {
 
@@ -24,25 +27,19 @@ namespace bwi_perception {
     template<typename PointT>
     pcl::PointIndices get_largest_component_indices(const typename pcl::PointCloud<PointT>::Ptr &in, double tolerance,
                                                     size_t min_num_points) {
-        typedef typename pcl::PointCloud<PointT> PointCloudT;
-        typename pcl::search::KdTree<PointT>::Ptr tree(new typename pcl::search::KdTree<PointT>);
-        tree->setInputCloud(in);
         ROS_INFO("point cloud size of 'plane cloud' : %ld", in->size());
 
         //use euclidean cluster extraction to eliminate noise and get largest plane
         std::vector<pcl::PointIndices> cluster_indices;
-        pcl::EuclideanClusterExtraction<PointT> ec;
-        ec.setClusterTolerance(tolerance);
-        ec.setMinClusterSize(min_num_points);
-        ec.setSearchMethod(tree);
-        ec.setInputCloud(in);
-        ec.extract(cluster_indices);
+        euclidean_clusters(*in, std::vector<int>(), tolerance, min_num_points, std::numeric_limits<size_t>::max(),
+                           cluster_indices);
 
         if (cluster_indices.empty()) {
             return pcl::PointIndices();
         }
 
-        return *std::max_element(cluster_indices.begin(), cluster_indices.end(), compare_cluster_size);
+        // the clusters come largest first
+        return cluster_indices.front();
 
     }
 
@@ -63,9 +60,6 @@ namespace bwi_perception {
                      std::vector<typename pcl::PointCloud<PointT>::Ptr> &out,
                      double tolerance, double min_cluster_size = 500, double max_cluster_size = 25000) {
         typedef typename pcl::PointCloud<PointT> PointCloudT;
-        typename pcl::search::KdTree<PointT>::Ptr tree(new typename pcl::search::KdTree<PointT>);
-        tree->setInputCloud(in);
-
         std::vector<pcl::PointIndices> cluster_indices;
         compute_clusters(in, cluster_indices, tolerance, min_cluster_size, max_cluster_size);
 
@@ -78,17 +72,7 @@ namespace bwi_perception {
     void
     compute_clusters(const typename pcl::PointCloud<PointT>::Ptr &in, std::vector<pcl::PointIndices> &out,
                      double tolerance, double min_cluster_size = 500, double max_cluster_size = 25000) {
-        typedef typename pcl::PointCloud<PointT> PointCloudT;
-        typename pcl::search::KdTree<PointT>::Ptr tree(new typename pcl::search::KdTree<PointT>);
-        tree->setInputCloud(in);
-
-        pcl::EuclideanClusterExtraction<PointT> ec;
-        ec.setClusterTolerance(tolerance);
-        ec.setMinClusterSize(min_cluster_size);
-        ec.setMaxClusterSize(max_cluster_size);
-        ec.setSearchMethod(tree);
-        ec.setInputCloud(in);
-        ec.extract(out);
+        euclidean_clusters(*in, std::vector<int>(), tolerance, min_cluster_size, max_cluster_size, out);
     }
 
 
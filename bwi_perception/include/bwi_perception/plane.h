@@ -1,6 +1,16 @@
 #ifndef BWI_PERCEPTION_PLANE_H
 #define BWI_PERCEPTION_PLANE_H
 
+#include <pcl/features/normal_3d_omp.h>
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <future>
+#include <iterator>
+#include <system_error>
+#include <thread>
+
 namespace bwi_perception {
 
     const std::string bounding_box_marker_ns = "horizontal_planes_marker";
@@ -17,6 +27,8 @@ namespace bwi_perception {
 #define IGNORE_FLOOR false // If the input cloud doesn't already have z filtered, we can do it
 #define MIN_Z 0.05 // minimum z-value of point cloud in map frame to be considered
 #define MAX_Z 2.0 // maximum z-value of point cloud in map frame to be considered
+#define NORMAL_SEARCH_RADIUS 0.05 //radius of the neighbourhood normals are estimated from
+#define MAX_NORMAL_ANGLE 0.26 //points whose normal is further from the up axis, in radians, can't be on a horizontal plane
 
     template<typename PointT>
     bool get_largest_plane(const typename pcl::PointCloud<PointT>::Ptr &in, const pcl::PointIndices::Ptr &plane_indices,
@@ -74,17 +86,63 @@ namespace bwi_perception {
     }
 
     template<typename PointT>
-    void extract_horizontal_planes(const typename pcl::PointCloud<PointT>::Ptr in,
-                                   std::vector<typename pcl::PointCloud<PointT>::Ptr> plane_clouds,
-                                   std::vector<float> plane_coefficients, const std::string &up_frame,
+    struct HorizontalPlaneCandidate {
+        typename pcl::PointCloud<PointT>::Ptr cloud;
+        Eigen::Vector4f coefficients;
+        double density;
+    };
+
+    // Keeps the largest connected part of a plane's inliers and measures how densely it fills its bounding box.
+    // The cloud of the candidate is left empty if too little of the plane is connected.
+    template<typename PointT>
+    HorizontalPlaneCandidate<PointT> make_horizontal_plane_candidate(const typename pcl::PointCloud<PointT>::Ptr &in,
+                                                                     const std::vector<int> &inliers,
+                                                                     const Eigen::Vector4f &coefficients) {
+        typedef typename pcl::PointCloud<PointT> PointCloudT;
+        HorizontalPlaneCandidate<PointT> candidate;
+        candidate.coefficients = coefficients;
+        candidate.density = 0.;
+
+        typename PointCloudT::Ptr plane_cloud(new PointCloudT(*in, inliers));
+        // Perform clustering on this plane.
+        // use the largest cluster as the representative points of the plane.
+        plane_cloud = bwi_perception::get_largest_component<PointT>(plane_cloud, CLUSTER_TOL, MIN_NUMBER_PLANE_POINTS);
+        ROS_INFO("    Extracted Plane Cloud Size: %zu", plane_cloud->size());
+        if (plane_cloud->size() < MIN_NUMBER_PLANE_POINTS) {
+            ROS_WARN("Plane contains insufficient points. Discarding");
+            candidate.cloud.reset(new PointCloudT);
+            return candidate;
+        }
+        plane_cloud->header = in->header;
+
+        #if PCL_VERSION_COMPARE(>=, 1, 7, 2)
+        // Use the oriented bounding box for a better estimate of density. Non oriented box
+        // penalizes shelves that don't happen to be perfectly aligned with the map frame
+        const bwi_perception::BoundingBox &bbox_params = bwi_perception::BoundingBox::oriented_from_cloud<PointT>(
+                plane_cloud);
+        #else
+        const bwi_perception::BoundingBox &bbox_params = bwi_perception::BoundingBox::from_cloud<PointT>(plane_cloud);
+        #endif
+        candidate.density = bwi_perception::calculate_density<PointT>(plane_cloud, bbox_params);
+        candidate.cloud = plane_cloud;
+        return candidate;
+    }
+
+    // Finds the horizontal planes in the cloud, sorted by density, with their coefficients flattened four at a
+    // time into plane_coefficients.
+    // Only points whose normal is close to the up axis are considered at all. RANSAC then runs on a shrinking set of
+    // indices into the input, so no pass copies the remaining cloud, and each plane it finds is checked for
+    // connectivity and density on another thread while the search for the next plane goes on. At most one check per
+    // hardware thread runs at a time; the search waits for the oldest before starting another.
+    template<typename PointT>
+    void extract_horizontal_planes(const typename pcl::PointCloud<PointT>::Ptr &in,
+                                   std::vector<typename pcl::PointCloud<PointT>::Ptr> &plane_clouds,
+                                   std::vector<float> &plane_coefficients, const std::string &up_frame,
                                    tf::TransformListener &listener) {
         typedef typename pcl::PointCloud<PointT> PointCloudT;
         //create onjects for use in segmenting
         pcl::ModelCoefficients::Ptr coefficients(new pcl::ModelCoefficients());
         pcl::PointIndices::Ptr inliers(new pcl::PointIndices());
-        typename PointCloudT::Ptr working_cloud(in);
-        typename PointCloudT::Ptr plane_cloud(in);
-        typename PointCloudT::Ptr cloud_remainder(new PointCloudT);
 
         // Create the segmentation object
         pcl::SACSegmentation<PointT> seg;
@@ -110,110 +168,106 @@ namespace bwi_perception {
 
         //set the axis to the transformed vector
         Eigen::Vector3f axis = Eigen::Vector3f(out_vec.vector.x, out_vec.vector.y, out_vec.vector.z);
+        axis.normalize();
         seg.setAxis(axis);
         ROS_INFO("SAC axis value: %f, %f, %f", seg.getAxis()[0], seg.getAxis()[1], seg.getAxis()[2]);
 
-        // Create the filtering object
-        pcl::ExtractIndices<PointT> extract;
+        // Points on a horizontal surface have a normal along the axis, everything else never needs to go into RANSAC
+        typename pcl::search::KdTree<PointT>::Ptr tree(new pcl::search::KdTree<PointT>);
+        pcl::NormalEstimationOMP<PointT, pcl::Normal> ne;
+        ne.setInputCloud(in);
+        ne.setSearchMethod(tree);
+        ne.setRadiusSearch(NORMAL_SEARCH_RADIUS);
+        pcl::PointCloud<pcl::Normal> normals;
+        ne.compute(normals);
+
+        const float min_cosine = std::cos(MAX_NORMAL_ANGLE);
+        pcl::IndicesPtr remaining(new std::vector<int>());
+        remaining->reserve(in->size());
+        for (int i = 0; i < (int) normals.size(); i++) {
+            const pcl::Normal &normal = normals.points[i];
+            if (!pcl::isFinite(normal)) {
+                continue;
+            }
+            float cosine = normal.normal_x * axis.x() + normal.normal_y * axis.y() + normal.normal_z * axis.z();
+            if (std::abs(cosine) >= min_cosine) {
+                remaining->push_back(i);
+            }
+        }
+        ROS_INFO("%zu of %zu points face up", remaining->size(), in->size());
+
+        seg.setInputCloud(in);
 
-        // Prepare object containers for responses
-        std::vector<Eigen::Vector4f> horizontal_plane_coefs;
-        std::vector<std::pair<int, float> > indices_with_densities;
-        int num_planes = 0;
-        size_t num_start_points = working_cloud->points.size();
-        while (working_cloud->points.size() > STOPPING_PERCENTAGE * num_start_points) {
-            // Segment the largest planar component from the remaining cloud
+        const size_t max_checks = std::max(1u, std::thread::hardware_concurrency());
+        std::deque<std::future<HorizontalPlaneCandidate<PointT> > > checking;
+        std::vector<HorizontalPlaneCandidate<PointT> > candidates;
+        std::vector<int> next_remaining;
+        size_t stop_size = (size_t) (STOPPING_PERCENTAGE * remaining->size());
+        while (remaining->size() > stop_size && remaining->size() >= MIN_NUMBER_PLANE_POINTS) {
+            // Segment the largest planar component from the remaining points
             ROS_INFO("Extracting a horizontal plane...");
-            seg.setInputCloud(working_cloud);
-            ROS_INFO("    Number of Points to Process: %zu", working_cloud->size());
-
+            ROS_INFO("    Number of Points to Process: %zu", remaining->size());
+            seg.setIndices(remaining);
             seg.segment(*inliers, *coefficients);
-            if (inliers->indices.empty()) {
-                ROS_WARN("    Could not estimate a planar model for the given dataset.");
+            // RANSAC returns the best plane, so once it is too small to keep, the rest will be too
+            if (inliers->indices.size() < MIN_NUMBER_PLANE_POINTS) {
+                ROS_WARN("    Could not estimate a large enough planar model for the remaining points.");
                 break;
             }
-
             ROS_INFO("    Found a horizontal plane!");
-            // Extract the inliers
-            extract.setInputCloud(in);
-            extract.setIndices(inliers);
-            extract.setNegative(false);
-            extract.filter(*plane_cloud);
-
-
-            // Create the filtering object to extract everything else
-            extract.setNegative(true);
-            extract.filter(*cloud_remainder);
-            working_cloud.swap(cloud_remainder);
 
-            // Perform clustering on this plane.
-            // use the largest cluster as the representative points of the plane.
+            // Take the inliers out of the remaining indices; both are sorted for the difference
+            std::sort(inliers->indices.begin(), inliers->indices.end());
+            next_remaining.clear();
+            std::set_difference(remaining->begin(), remaining->end(), inliers->indices.begin(),
+                                inliers->indices.end(), std::back_inserter(next_remaining));
+            remaining->swap(next_remaining);
 
-            // if no clusters are found, this is an invalid plane extraction
+            //get the plane coefficients
+            Eigen::Vector4f plane_coefs(coefficients->values[0], coefficients->values[1],
+                                        coefficients->values[2], coefficients->values[3]);
+            std::vector<int> plane_inliers(inliers->indices);
+            auto check = [in, plane_inliers, plane_coefs]() {
+                return make_horizontal_plane_candidate<PointT>(in, plane_inliers, plane_coefs);
+            };
+            if (checking.size() >= max_checks) {
+                candidates.push_back(checking.front().get());
+                checking.pop_front();
+            }
+            // If no thread can be started, the check runs here when it is collected
             try {
-                double cluster_extraction_tolerance = CLUSTER_TOL;
-                plane_cloud = bwi_perception::get_largest_component<PointT>(plane_cloud, cluster_extraction_tolerance,
-                                                                            MIN_NUMBER_PLANE_POINTS);
-                ROS_INFO("    Extracted Plane Cloud Size: %zu", plane_cloud->size());
-
-                if (plane_cloud->size() < MIN_NUMBER_PLANE_POINTS) {
-                    ROS_WARN("Plane contains insufficient points. Discarding");
-                    continue;
-                }
+                checking.push_back(std::async(std::launch::async, check));
+            } catch (const std::system_error &) {
+                checking.push_back(std::async(std::launch::deferred, check));
+            }
+        }
+        for (auto &check : checking) {
+            candidates.push_back(check.get());
+        }
 
+        std::vector<HorizontalPlaneCandidate<PointT> > planes;
+        for (const auto &plane : candidates) {
+            if (plane.cloud->empty()) {
+                continue;
             }
-            catch (std::exception &e) {
-                ROS_WARN("No clusters were found. Invalid plane points exist in this iteration.");
+            if (plane.density < MIN_PLANE_DENSITY) {
+                ROS_INFO("Rejecting candidate plane with low density (%f)", plane.density);
                 continue;
             }
-
-            //get the plane coefficients
-            Eigen::Vector4f plane_coefficients;
-            plane_coefficients(0) = coefficients->values[0];
-            plane_coefficients(1) = coefficients->values[1];
-            plane_coefficients(2) = coefficients->values[2];
-            plane_coefficients(3) = coefficients->values[3];
-            horizontal_plane_coefs.push_back(plane_coefficients);
-
-            // Extract the bonding box parameters of this plane
-
-            #if PCL_VERSION_COMPARE(>=, 1, 7, 2)
-            const bwi_perception::BoundingBox &oriented_bbox_params = bwi_perception::BoundingBox::oriented_from_cloud<PointT>(
-                    plane_cloud);
-
-            // Use the oriented bounding box for a better estimate of density. Non oriented box
-            // penalizes shelves that don't happen to be perfectly aligned with the map frame
-            double plane_bounding_box_density = bwi_perception::calculate_density<PointT>(plane_cloud,
-                                                                                          oriented_bbox_params);
-            #else
-            const bwi_perception::BoundingBox &bbox_params = bwi_perception::BoundingBox::from_cloud<PointT>(
-                    plane_cloud);
-            double plane_bounding_box_density = bwi_perception::calculate_density<PointT>(plane_cloud,
-                                                                                          bbox_params);
-            #endif
-
-            plane_clouds.push_back(typename PointCloudT::Ptr(plane_cloud));
-
-            indices_with_densities.emplace_back(num_planes, (float) plane_bounding_box_density);
-            num_planes += 1;
+            planes.push_back(plane);
         }
 
-        std::sort(indices_with_densities.begin(), indices_with_densities.end(), compare_by_second<int, float>);
-
         // Populate the response with planes sorted by density
-        for (auto it = indices_with_densities.begin(); it < indices_with_densities.end(); ++it) {
-            std::pair<int, float> pair = *it;
-            int i = pair.first;
-            float density = pair.second;
-
-            if (density < MIN_PLANE_DENSITY) {
-                ROS_INFO("Rejecting candidate plane with low density (%f)", density);
-                continue;
-            };
-
-
+        std::sort(planes.begin(), planes.end(),
+                  [](const HorizontalPlaneCandidate<PointT> &lhs, const HorizontalPlaneCandidate<PointT> &rhs) {
+                      return lhs.density > rhs.density;
+                  });
+        for (const auto &plane : planes) {
+            plane_clouds.push_back(plane.cloud);
+            for (int i = 0; i < 4; i++) {
+                plane_coefficients.push_back(plane.coefficients(i));
+            }
         }
-
     }
 
 }
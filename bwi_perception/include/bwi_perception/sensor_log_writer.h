@@ -0,0 +1,121 @@
+#ifndef BWI_PERCEPTION_SENSOR_LOG_WRITER_H
+#define BWI_PERCEPTION_SENSOR_LOG_WRITER_H
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/compression/octree_pointcloud_compression.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace bwi_perception {
+
+    enum CloudLogFormat {
+        PCD_ASCII,
+        PCD_BINARY,
+        PCD_BINARY_COMPRESSED,
+        // every cloud of a recording is appended to a single octree compressed stream
+        OCTREE_STREAM
+    };
+
+    // Accepts "ascii", "binary", "binary_compressed" and "octree"
+    bool parse_cloud_log_format(const std::string &name, CloudLogFormat &format);
+
+    // The extension, including the dot, of files written in the format
+    const char *cloud_log_extension(CloudLogFormat format);
+
+    // Writes a single PCD file. Not meant for OCTREE_STREAM, which only makes sense for a sequence of clouds.
+    bool save_cloud(const std::string &filename, const pcl::PointCloud<pcl::PointXYZRGB> &cloud,
+                    CloudLogFormat format);
+
+    // Writes clouds and other sensor data on a background thread so subscriber callbacks never wait on the disk.
+    // At most queue_capacity writes are pending at any time; anything submitted beyond that is dropped and
+    // counted, since falling further and further behind a camera doesn't help anyone.
+    class SensorLogWriter {
+    public:
+        typedef pcl::PointXYZRGB PointT;
+        typedef pcl::PointCloud<PointT> PointCloudT;
+
+        struct Statistics {
+            uint64_t written;
+            uint64_t dropped;
+            uint64_t failed;
+        };
+
+        SensorLogWriter(CloudLogFormat format, size_t queue_capacity = 30,
+                        pcl::io::compression_Profiles_e profile = pcl::io::MED_RES_ONLINE_COMPRESSION_WITH_COLOR);
+
+        // Writes whatever is still queued before returning
+        ~SensorLogWriter();
+
+        CloudLogFormat format() const {
+            return format_;
+        }
+
+        // Queues the cloud to be written to path followed by the extension of the format. With OCTREE_STREAM the
+        // path of the first cloud names the stream, and the following clouds are appended to it until
+        // closeStream. The cloud must not be modified afterwards. Returns false if the cloud was dropped.
+        bool writeCloud(const PointCloudT::ConstPtr &cloud, const std::string &path);
+
+        // Queues any other write, for instance an image. The task returns whether it succeeded.
+        bool write(const std::function<bool()> &task);
+
+        // Ends the current octree stream once the clouds queued before it are written. Never dropped.
+        void closeStream();
+
+        // Blocks until everything queued so far is written
+        void flush();
+
+        Statistics statistics() const;
+
+    private:
+        struct Job {
+            Job() : control(false) {}
+
+            PointCloudT::ConstPtr cloud;
+            std::string path;
+            std::function<bool()> task;
+            // not a write of its own, so only counted when it fails
+            bool control;
+        };
+
+        bool enqueue(Job &&job, bool force);
+
+        void run();
+
+        bool writeCloudNow(const Job &job);
+
+        const CloudLogFormat format_;
+        const size_t queue_capacity_;
+        const pcl::io::compression_Profiles_e profile_;
+
+        std::mutex mutex_;
+        std::condition_variable queue_cv_;
+        std::condition_variable idle_cv_;
+        std::deque<Job> queue_;
+        bool busy_;
+        bool stop_;
+
+        std::atomic<uint64_t> written_;
+        std::atomic<uint64_t> dropped_;
+        std::atomic<uint64_t> failed_;
+
+        // only touched by the writer thread. The encoder is created once per stream: it encodes the clouds
+        // as differences to the previous ones, so a stream has to be decoded from its start.
+        std::unique_ptr<pcl::io::OctreePointCloudCompression<PointT> > encoder_;
+        std::ofstream stream_;
+
+        std::thread writer_;
+    };
+
+}
+
+#endif //BWI_PERCEPTION_SENSOR_LOG_WRITER_H
@@ -10,9 +10,19 @@ namespace bwi_perception {
 
     bool segment_tabletop_scene(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr &in_cloud,
                                 const double cluster_extraction_tolerance, const std::string &up_frame,
-                                pcl::PointCloud<pcl::PointXYZRGB>::Ptr &table_cloud, Eigen::Vector4f plane_coefficients,
+                                pcl::PointCloud<pcl::PointXYZRGB>::Ptr &table_cloud, Eigen::Vector4f &plane_coefficients,
                                 std::vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr> &table_object_clouds,
-                                const double plane_distance_tolerance, const double plane_max_distance_tolerance, double height,
+                                const double plane_distance_tolerance, const double plane_max_distance_tolerance, double &height,
+                                const double min_cluster_size = 250, const double max_cluster_size = 25000);
+
+    // Same as above, but looks up transforms in a listener the caller keeps alive. A new listener starts with an
+    // empty buffer and has to wait for transforms to come in, so long running nodes should prefer this one.
+    bool segment_tabletop_scene(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr &in_cloud,
+                                const double cluster_extraction_tolerance, const std::string &up_frame,
+                                pcl::PointCloud<pcl::PointXYZRGB>::Ptr &table_cloud, Eigen::Vector4f &plane_coefficients,
+                                std::vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr> &table_object_clouds,
+                                const double plane_distance_tolerance, const double plane_max_distance_tolerance, double &height,
+                                tf::TransformListener &tf_listener,
                                 const double min_cluster_size = 250, const double max_cluster_size = 25000);
 
 }
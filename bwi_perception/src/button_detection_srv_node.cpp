@@ -40,6 +40,8 @@
 #include <pcl/kdtree/kdtree.h>
 
 #include "bwi_perception/ButtonDetection.h"
+#include <bwi_perception/cloud_accumulator.h>
+#include <bwi_perception/clustering.h>
 
 /* define what kind of point clouds we're using */
 typedef pcl::PointXYZRGB PointT;
@@ -51,10 +53,12 @@ static int red_min;
 // Select mode
 const bool save_pl_mode = false;
 
-// Mutex: //
-boost::mutex cloud_mutex;
+//how many frames to stitch into a single cloud
+const int num_clouds = 15;
+
+//fuses incoming frames into a voxel grid at the resolution used by the segmentation
+bwi_perception::CloudAccumulator cloud_accumulator(num_clouds, 0.0025f);
 
-bool new_cloud_available_flag = false;
 PointCloudT::Ptr cloud (new PointCloudT);
 PointCloudT::Ptr cloud_aggregated (new PointCloudT);
 PointCloudT::Ptr cloud_plane (new PointCloudT);
@@ -90,17 +94,9 @@ void sig_handler(int sig)
 void
 cloud_cb (const sensor_msgs::PointCloud2ConstPtr& input)
 {
-
-
-	cloud_mutex.lock ();
-
-	//convert to PCL format
-	pcl::fromROSMsg (*input, *cloud);
-
-	//state that a new cloud is available
-	new_cloud_available_flag = true;
-
-	cloud_mutex.unlock ();
+	//frames are only needed while the service is collecting them
+	if (cloud_accumulator.collecting())
+		cloud_accumulator.add(*input);
 }
 
 
@@ -158,27 +154,13 @@ double computeAvgRedValue(PointCloudT::Ptr in){
 
 std::vector<PointCloudT::Ptr > computeClusters(PointCloudT::Ptr in, double tolerance){
 	std::vector<PointCloudT::Ptr > clusters;
-	
-	pcl::search::KdTree<PointT>::Ptr tree (new pcl::search::KdTree<PointT>);
-	tree->setInputCloud (in);
 
 	std::vector<pcl::PointIndices> cluster_indices;
-	pcl::EuclideanClusterExtraction<PointT> ec;
-	ec.setClusterTolerance (tolerance); // 2cm
-	ec.setMinClusterSize (50);
-	ec.setMaxClusterSize (25000);
-	ec.setSearchMethod (tree);
-	ec.setInputCloud (in);
-	ec.extract (cluster_indices);
-
-	int j = 0;
+	bwi_perception::segmentation_clusters(*in, std::vector<int>(), tolerance, 50, 25000, cluster_indices);
+
 	for (std::vector<pcl::PointIndices>::const_iterator it = cluster_indices.begin (); it != cluster_indices.end (); ++it)
 	{
-		PointCloudT::Ptr cloud_cluster (new PointCloudT);
-		for (std::vector<int>::const_iterator pit = it->indices.begin (); pit != it->indices.end (); pit++)
-			cloud_cluster->points.push_back (in->points[*pit]); //*
-		cloud_cluster->width = cloud_cluster->points.size ();
-		cloud_cluster->height = 1;
+		PointCloudT::Ptr cloud_cluster (new PointCloudT(*in, it->indices));
 		cloud_cluster->is_dense = true;
 
 		clusters.push_back(cloud_cluster);
@@ -186,73 +168,27 @@ std::vector<PointCloudT::Ptr > computeClusters(PointCloudT::Ptr in, double toler
 	return clusters;
 }
 
-void waitForCloud(){
-	ros::Rate r(30);
-	
-	while (ros::ok()){
-		ros::spinOnce();
-		
-		r.sleep();
-		
-		if (new_cloud_available_flag){
-			new_cloud_available_flag = false;
-			break;
-		}
-	}
-	
-}
-
 /* collects a cloud by aggregating k successive frames */
-void waitForCloudK(int k){
-	ros::Rate r(30);
-	
-	cloud_aggregated->clear();
-	
-	int counter = 0;
-	
-	while (ros::ok()){
-		ros::spinOnce();
-		
-		r.sleep();
-		
-		if (new_cloud_available_flag){
-			
-			*cloud_aggregated+=*cloud;
-			
-			new_cloud_available_flag = false;
-			
-			counter ++;
-			
-			if (counter >= k){
-				cloud_aggregated->header = cloud->header;
-				break;
-			}
-		}
-	}
-	
+bool waitForCloudK(int k){
+	return cloud_accumulator.collect(k, *cloud_aggregated);
 }
 
 bool seg_cb(bwi_perception::ButtonDetection::Request &req, bwi_perception::ButtonDetection::Response &res)
 {
 	//get the point cloud by aggregating k successive input clouds
-	waitForCloudK(15);
+	if (!waitForCloudK(num_clouds))
+		return false;
 	cloud = cloud_aggregated;
 
-	//**Step 1: z-filter and voxel filter**//
+	//**Step 1: z-filter, the accumulator already voxelized the frames**//
 	
 	// Create the filtering object
+	pcl::PointCloud<PointT>::Ptr cloud_filtered (new pcl::PointCloud<PointT>);
 	pcl::PassThrough<PointT> pass;
 	pass.setInputCloud (cloud);
 	pass.setFilterFieldName ("z");
 	pass.setFilterLimits (0.0, 1.15);
-	pass.filter (*cloud);
-	
-	// Create the filtering object: downsample the dataset using a leaf size of 1cm
-	pcl::VoxelGrid<PointT> vg;
-	pcl::PointCloud<PointT>::Ptr cloud_filtered (new pcl::PointCloud<PointT>);
-	vg.setInputCloud (cloud);
-	vg.setLeafSize (0.0025f, 0.0025f, 0.0025f);
-	vg.filter (*cloud_filtered);
+	pass.filter (*cloud_filtered);
 
 	//publish point cloud for debugging
 	ROS_INFO("Publishing point cloud...");
@@ -327,9 +263,6 @@ bool seg_cb(bwi_perception::ButtonDetection::Request &req, bwi_perception::Butto
 	
 	// if the clousters size == 0 return false
 	if(clusters_on_plane.size() == 0) {
-		
-		cloud_mutex.unlock ();
-
 		res.button_found = false; 
 		return true;
 	}
@@ -394,8 +327,6 @@ bool seg_cb(bwi_perception::ButtonDetection::Request &req, bwi_perception::Butto
 		res.button_found = false;
 		
 	}
-	
-	cloud_mutex.unlock ();
 
 	return true;
 }
@@ -422,16 +353,7 @@ int main (int argc, char** argv)
 	//register ctrl-c
 	signal(SIGINT, sig_handler);
 
-	//refresh rate
-	double ros_rate = 10.0;
-	ros::Rate r(ros_rate);
-
-	// Main loop:
-	while (!g_caught_sigint && ros::ok())
-	{
-		//collect messages
-		ros::spinOnce();
-
-		r.sleep();
-	}
+	//the service waits for frames, so the subscriber needs a thread of its own
+	ros::MultiThreadedSpinner spinner(2);
+	spinner.spin();
 };
@@ -21,7 +21,7 @@
 #include <pcl/io/pcd_io.h>
 #include <boost/lexical_cast.hpp>
 #include <pcl/filters/passthrough.h>
-#include <pcl/compression/octree_pointcloud_compression.h>
+#include <bwi_perception/sensor_log_writer.h>
 
 using namespace std;
 using namespace cv;
@@ -34,13 +34,9 @@ typedef pcl::PointCloud<PointT> PointCloudT;
 
 // General point cloud to store the whole image
 PointCloudT::Ptr image_cloud (new PointCloudT);
-// output pointcloud
-PointCloudT::Ptr image_cloud_compressed (new PointCloudT);
 
-// For point-cloud compression purposes
-pcl::io::OctreePointCloudCompression<PointT>* PointCloudEncoder;
-pcl::io::OctreePointCloudCompression<PointT>* PointCloudDecoder;
-pcl::io::compression_Profiles_e compressionProfile = pcl::io::MED_RES_ONLINE_COMPRESSION_WITH_COLOR;
+// Writes clouds and images off the subscriber threads
+bwi_perception::SensorLogWriter* log_writer;
 		
 //z-filter
 pcl::PassThrough<PointT> pass;
@@ -56,13 +52,25 @@ string generalDepthImageName;
 int image_count = 0;
 int pcd_count = 0;
 
+// drops already reported, so only new ones are warned about
+uint64_t reported_drops = 0;
+
 // function to handle Ctrl-C
 void sig_handler(int sig)
 {
 	g_caught_sigint = true;
-	exit (0);
+	//let ros::spin return so the writer can finish what is queued
+	ros::shutdown();
 };
 
+void report_drops(){
+	uint64_t dropped = log_writer->statistics().dropped;
+	if (dropped > reported_drops){
+		ROS_WARN_THROTTLE(5, "Logging can't keep up, %lu frames dropped so far", (unsigned long) dropped);
+		reported_drops = dropped;
+	}
+}
+
 //callback funtion to store depth images
 void collect_vision_depth_data(const sensor_msgs::PointCloud2ConstPtr& msg){
 	if(recording_samples == true){
@@ -72,6 +80,9 @@ void collect_vision_depth_data(const sensor_msgs::PointCloud2ConstPtr& msg){
 		//convert the msg to PCL format
 		pcl::fromROSMsg (*msg, *image_cloud);
 		
+		//the writer holds on to the filtered cloud until it is on disk
+		PointCloudT::Ptr filtered_cloud (new PointCloudT);
+		
 		//get the start time of recording
 		double begin = ros::Time::now().toSec();
 		string startTime = boost::lexical_cast<std::string>(begin);
@@ -79,36 +90,19 @@ void collect_vision_depth_data(const sensor_msgs::PointCloud2ConstPtr& msg){
 		// append start timestamp with filenames
 		std::stringstream convert;
 		convert << pcd_count;
-		std::string filename = generalDepthImageName+convert.str()+"_"+startTime+".pcd";
+		std::string filename = generalDepthImageName+convert.str()+"_"+startTime;
 		
 		//Before saving, do a z-filter	
 		pass.setInputCloud (image_cloud);
 		pass.setFilterFieldName ("z");
 		pass.setFilterLimits (0.0, 2.15);
-		pass.filter (*image_cloud);
-		
-		// stringstream to store compressed point cloud
-		std::stringstream compressedData;
-		// instantiate point cloud compression for encoding and decoding
-		PointCloudEncoder = new pcl::io::OctreePointCloudCompression<PointT> (compressionProfile, true);
-		PointCloudDecoder = new pcl::io::OctreePointCloudCompression<PointT> ();
-    
-		//ROS_INFO("Starting compression");
-		
-		// compress point cloud
-		PointCloudEncoder->encodePointCloud (image_cloud, compressedData);
-		// decompress point cloud
-		PointCloudDecoder->decodePointCloud (compressedData, image_cloud_compressed);	
-		
-		//ROS_INFO("Saving compressed cloud to file");
+		pass.filter (*filtered_cloud);
 		
-		//Save the cloud to a .pcd file
-		pcl::io::savePCDFileASCII(filename, *image_cloud);
-		ROS_INFO("Saved pcd file %s", filename.c_str());
-		
-		// delete point cloud compression instances
-		delete (PointCloudEncoder);
-		delete (PointCloudDecoder);
+		//Queue the cloud to be saved, in an octree stream this is just the next frame
+		if (log_writer->writeCloud(filtered_cloud, filename))
+			ROS_DEBUG("Queued cloud %s", filename.c_str());
+		else
+			report_drops();
 		
 		pcd_count++;
 	}
@@ -137,8 +131,16 @@ void collect_vision_rgb_data(const sensor_msgs::ImageConstPtr& msg){
 			std::string filename = generalImageFileName+"/test"+convert.str()+"_"+startTime+".jpg";
 			//std::string filename = "./test"+convert.str()+"_"+startTime+".jpg";
 
-			imwrite(filename.c_str(), cv_image->image);
-			ROS_INFO("Saved image %s", filename.c_str());
+			//the image is reference counted, so the writer keeps it alive
+			Mat image = cv_image->image;
+			bool queued = log_writer->write([filename, image]() {
+				bool success = imwrite(filename.c_str(), image);
+				if (!success)
+					ROS_ERROR("Could not write %s", filename.c_str());
+				return success;
+			});
+			if (!queued)
+				report_drops();
 					
 			image_count++;
 		}
@@ -161,6 +163,13 @@ bool vision_service_callback(bwi_perception::ProcessVision::Request &req,
 		recording_samples = false;
 		image_count = 0;
 		pcd_count = 0;
+		
+		//the next recording starts a new stream
+		log_writer->closeStream();
+		bwi_perception::SensorLogWriter::Statistics statistics = log_writer->statistics();
+		ROS_INFO("Logging stopped: %lu written, %lu dropped, %lu failed so far",
+				 (unsigned long) statistics.written, (unsigned long) statistics.dropped,
+				 (unsigned long) statistics.failed);
 	}
 	
 	res.success = true;
@@ -176,6 +185,26 @@ int main (int argc, char** argv)
 	//to store the topic to subscribe to
 	string rgb_topic_;
 	
+	//how clouds are written: ascii, binary, binary_compressed or octree
+	string cloud_format_name;
+	nh.param<std::string>("cloud_format", cloud_format_name, "binary_compressed");
+	bwi_perception::CloudLogFormat cloud_format;
+	if (!bwi_perception::parse_cloud_log_format(cloud_format_name, cloud_format)){
+		ROS_ERROR("Unknown cloud_format %s", cloud_format_name.c_str());
+		return 1;
+	}
+	
+	//frames waiting to be written before new ones are dropped
+	int queue_size;
+	nh.param("log_queue_size", queue_size, 30);
+	if (queue_size < 1){
+		ROS_WARN("log_queue_size must be at least 1, not %d; using 1", queue_size);
+		queue_size = 1;
+	}
+	
+	bwi_perception::SensorLogWriter writer(cloud_format, queue_size);
+	log_writer = &writer;
+	
 	//Set up the service
 	ros::ServiceServer service = nh.advertiseService("image_logger_service", vision_service_callback);
 	
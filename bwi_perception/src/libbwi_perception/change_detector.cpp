@@ -0,0 +1,161 @@
+#include <bwi_perception/change_detector.h>
+
+#include <cmath>
+
+namespace bwi_perception {
+
+    // voxel coordinates are packed into 21 bits each
+    static const int64_t KEY_OFFSET = 1 << 20;
+    static const uint64_t KEY_MASK = (1 << 21) - 1;
+
+    static uint64_t pack(int64_t x, int64_t y, int64_t z) {
+        return ((static_cast<uint64_t>(x + KEY_OFFSET) & KEY_MASK) << 42) |
+               ((static_cast<uint64_t>(y + KEY_OFFSET) & KEY_MASK) << 21) |
+               (static_cast<uint64_t>(z + KEY_OFFSET) & KEY_MASK);
+    }
+
+    static void unpack(uint64_t key, int64_t &x, int64_t &y, int64_t &z) {
+        x = static_cast<int64_t>((key >> 42) & KEY_MASK) - KEY_OFFSET;
+        y = static_cast<int64_t>((key >> 21) & KEY_MASK) - KEY_OFFSET;
+        z = static_cast<int64_t>(key & KEY_MASK) - KEY_OFFSET;
+    }
+
+    ChangeDetector::ChangeDetector(const ChangeDetectorParams &params) :
+            params_(params), inverse_leaf_size_(1.f / params.leaf_size), frame_(0) {}
+
+    void ChangeDetector::reset() {
+        frame_ = 0;
+        background_.clear();
+        hits_.clear();
+        changed_.clear();
+    }
+
+    uint64_t ChangeDetector::key(const PointT &point) const {
+        return pack(static_cast<int64_t>(std::floor(point.x * inverse_leaf_size_)),
+                    static_cast<int64_t>(std::floor(point.y * inverse_leaf_size_)),
+                    static_cast<int64_t>(std::floor(point.z * inverse_leaf_size_)));
+    }
+
+    bool ChangeDetector::update(const PointCloudT &cloud, std::vector<PointCloudT::Ptr> &clusters) {
+        clusters.clear();
+
+        // crop and bin in one pass, without copying the points
+        point_voxels_.clear();
+        occupancy_.clear();
+        const Eigen::Vector4f &lo = params_.workspace_min;
+        const Eigen::Vector4f &hi = params_.workspace_max;
+        for (int i = 0; i < (int) cloud.points.size(); i++) {
+            const PointT &point = cloud.points[i];
+            // comparisons with NaN are false, so this drops invalid points too
+            if (!(point.x >= lo.x() && point.x <= hi.x() && point.y >= lo.y() && point.y <= hi.y() &&
+                  point.z >= lo.z() && point.z <= hi.z())) {
+                continue;
+            }
+            uint64_t k = key(point);
+            point_voxels_.emplace_back(k, i);
+            occupancy_[k]++;
+        }
+
+        uint64_t frame = frame_++;
+
+        if (frame < params_.background_frames) {
+            for (const auto &voxel : occupancy_) {
+                if (voxel.second >= params_.min_points_per_voxel) {
+                    background_.insert(voxel.first);
+                }
+            }
+            return false;
+        }
+
+        changed_.clear();
+        for (const auto &voxel : occupancy_) {
+            if (voxel.second < params_.min_points_per_voxel || background_.count(voxel.first)) {
+                continue;
+            }
+            Hits &hits = hits_[voxel.first];
+            hits.count = hits.count > 0 && hits.last_frame + 1 == frame ? hits.count + 1 : 1;
+            hits.last_frame = frame;
+            if (hits.count >= params_.persistence) {
+                changed_.push_back(voxel.first);
+            }
+        }
+
+        // a voxel that was empty in this frame starts over
+        for (auto voxel = hits_.begin(); voxel != hits_.end();) {
+            if (voxel->second.last_frame != frame) {
+                voxel = hits_.erase(voxel);
+            } else {
+                ++voxel;
+            }
+        }
+
+        cluster(cloud, clusters);
+        return true;
+    }
+
+    void ChangeDetector::cluster(const PointCloudT &cloud, std::vector<PointCloudT::Ptr> &clusters) {
+        // flood fill over the 26-neighbourhood of the changed voxels
+        cluster_of_.clear();
+        for (uint64_t voxel : changed_) {
+            cluster_of_[voxel] = -1;
+        }
+
+        std::vector<size_t> cluster_sizes;
+        std::vector<uint64_t> frontier;
+        for (uint64_t seed : changed_) {
+            if (cluster_of_[seed] != -1) {
+                continue;
+            }
+            int id = (int) cluster_sizes.size();
+            size_t size = 0;
+            cluster_of_[seed] = id;
+            frontier.assign(1, seed);
+            while (!frontier.empty()) {
+                uint64_t voxel = frontier.back();
+                frontier.pop_back();
+                size++;
+
+                int64_t x, y, z;
+                unpack(voxel, x, y, z);
+                for (int dx = -1; dx <= 1; dx++) {
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dz = -1; dz <= 1; dz++) {
+                            auto neighbour = cluster_of_.find(pack(x + dx, y + dy, z + dz));
+                            if (neighbour != cluster_of_.end() && neighbour->second == -1) {
+                                neighbour->second = id;
+                                frontier.push_back(neighbour->first);
+                            }
+                        }
+                    }
+                }
+            }
+            cluster_sizes.push_back(size);
+        }
+
+        // clusters large enough to keep get an output cloud
+        std::vector<int> output_of(cluster_sizes.size(), -1);
+        for (size_t id = 0; id < cluster_sizes.size(); id++) {
+            if (cluster_sizes[id] >= params_.min_cluster_voxels) {
+                output_of[id] = (int) clusters.size();
+                PointCloudT::Ptr cluster_cloud(new PointCloudT);
+                cluster_cloud->header = cloud.header;
+                clusters.push_back(cluster_cloud);
+            }
+        }
+
+        for (const auto &point_voxel : point_voxels_) {
+            auto voxel = cluster_of_.find(point_voxel.first);
+            if (voxel == cluster_of_.end() || output_of[voxel->second] < 0) {
+                continue;
+            }
+            clusters[output_of[voxel->second]]->points.push_back(cloud.points[point_voxel.second]);
+        }
+
+        for (auto &cluster_cloud : clusters) {
+            cluster_cloud->width = (uint32_t) cluster_cloud->points.size();
+            cluster_cloud->height = 1;
+            cluster_cloud->is_dense = true;
+        }
+    }
+
+}
@@ -0,0 +1,197 @@
+#include <bwi_perception/cloud_accumulator.h>
+
+#include <ros/ros.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include <chrono>
+#include <cmath>
+
+namespace bwi_perception {
+
+    // voxel coordinates are packed into 21 bits each, which covers several kilometers at millimeter leaves
+    static const int64_t KEY_OFFSET = 1 << 20;
+    static const uint64_t KEY_MASK = (1 << 21) - 1;
+
+    CloudAccumulator::CloudAccumulator(size_t capacity, float leaf_size) :
+            capacity_(capacity > 0 ? capacity : 1), inverse_leaf_size_(1.f / leaf_size), collecting_(0),
+            ring_(capacity_), head_(0), frames_(0), frames_added_(0) {}
+
+    uint64_t CloudAccumulator::key(float x, float y, float z) const {
+        uint64_t ix = static_cast<uint64_t>(static_cast<int64_t>(std::floor(x * inverse_leaf_size_)) + KEY_OFFSET);
+        uint64_t iy = static_cast<uint64_t>(static_cast<int64_t>(std::floor(y * inverse_leaf_size_)) + KEY_OFFSET);
+        uint64_t iz = static_cast<uint64_t>(static_cast<int64_t>(std::floor(z * inverse_leaf_size_)) + KEY_OFFSET);
+        return ((ix & KEY_MASK) << 42) | ((iy & KEY_MASK) << 21) | (iz & KEY_MASK);
+    }
+
+    void CloudAccumulator::beginFrame() {
+        std::vector<Voxel> &slot = ring_[head_];
+        if (frames_ == capacity_) {
+            // the slot holds the oldest frame, take it out of the grid before reusing it
+            for (const Voxel &voxel : slot) {
+                auto cell = grid_.find(voxel.key);
+                Voxel &sum = cell->second;
+                sum.count -= voxel.count;
+                if (sum.count == 0) {
+                    grid_.erase(cell);
+                    continue;
+                }
+                sum.x -= voxel.x;
+                sum.y -= voxel.y;
+                sum.z -= voxel.z;
+                sum.r -= voxel.r;
+                sum.g -= voxel.g;
+                sum.b -= voxel.b;
+            }
+        }
+        // clear keeps the capacity, so the slot is only allocated for the first few frames
+        slot.clear();
+        frame_index_.clear();
+    }
+
+    void CloudAccumulator::addPoint(float x, float y, float z, uint8_t r, uint8_t g, uint8_t b) {
+        if (!std::isfinite(x) || !std::isfinite(y) || !std::isfinite(z)) {
+            return;
+        }
+
+        std::vector<Voxel> &slot = ring_[head_];
+        uint64_t k = key(x, y, z);
+        auto inserted = frame_index_.emplace(k, static_cast<uint32_t>(slot.size()));
+        if (inserted.second) {
+            slot.push_back(Voxel{k, x, y, z, (double) r, (double) g, (double) b, 1});
+            return;
+        }
+
+        Voxel &voxel = slot[inserted.first->second];
+        voxel.x += x;
+        voxel.y += y;
+        voxel.z += z;
+        voxel.r += r;
+        voxel.g += g;
+        voxel.b += b;
+        voxel.count++;
+    }
+
+    void CloudAccumulator::commitFrame(const pcl::PCLHeader &header) {
+        for (const Voxel &voxel : ring_[head_]) {
+            auto inserted = grid_.emplace(voxel.key, voxel);
+            if (inserted.second) {
+                continue;
+            }
+            Voxel &sum = inserted.first->second;
+            sum.x += voxel.x;
+            sum.y += voxel.y;
+            sum.z += voxel.z;
+            sum.r += voxel.r;
+            sum.g += voxel.g;
+            sum.b += voxel.b;
+            sum.count += voxel.count;
+        }
+
+        head_ = (head_ + 1) % capacity_;
+        if (frames_ < capacity_) {
+            frames_++;
+        }
+        frames_added_++;
+        header_ = header;
+    }
+
+    void CloudAccumulator::add(const sensor_msgs::PointCloud2 &cloud_msg) {
+        bool has_rgb = false;
+        for (const auto &field : cloud_msg.fields) {
+            has_rgb |= field.name == "rgb";
+        }
+        if (!has_rgb) {
+            PointCloudT cloud;
+            pcl::fromROSMsg(cloud_msg, cloud);
+            add(cloud);
+            return;
+        }
+
+        pcl::PCLHeader header;
+        pcl_conversions::toPCL(cloud_msg.header, header);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            beginFrame();
+            sensor_msgs::PointCloud2ConstIterator<float> iter_x(cloud_msg, "x");
+            sensor_msgs::PointCloud2ConstIterator<float> iter_y(cloud_msg, "y");
+            sensor_msgs::PointCloud2ConstIterator<float> iter_z(cloud_msg, "z");
+            // packed as b, g, r in the first three bytes
+            sensor_msgs::PointCloud2ConstIterator<uint8_t> iter_rgb(cloud_msg, "rgb");
+            for (; iter_x != iter_x.end(); ++iter_x, ++iter_y, ++iter_z, ++iter_rgb) {
+                addPoint(*iter_x, *iter_y, *iter_z, iter_rgb[2], iter_rgb[1], iter_rgb[0]);
+            }
+            commitFrame(header);
+        }
+        frame_cv_.notify_all();
+    }
+
+    void CloudAccumulator::add(const PointCloudT &cloud) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            beginFrame();
+            for (const PointT &point : cloud.points) {
+                addPoint(point.x, point.y, point.z, point.r, point.g, point.b);
+            }
+            commitFrame(cloud.header);
+        }
+        frame_cv_.notify_all();
+    }
+
+    bool CloudAccumulator::collect(size_t n, PointCloudT &out) {
+        std::lock_guard<std::mutex> collect_lock(collect_mutex_);
+        clear();
+
+        collecting_++;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // wake up now and then so a shutdown is noticed even when no frames come in
+            while (frames_added_ < n) {
+                if (!ros::ok()) {
+                    collecting_--;
+                    return false;
+                }
+                frame_cv_.wait_for(lock, std::chrono::milliseconds(100));
+            }
+        }
+        collecting_--;
+
+        fused(out);
+        return true;
+    }
+
+    void CloudAccumulator::fused(PointCloudT &out) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        out.header = header_;
+        out.points.resize(grid_.size());
+        size_t i = 0;
+        for (const auto &cell : grid_) {
+            const Voxel &sum = cell.second;
+            const double inverse_count = 1. / sum.count;
+            PointT &point = out.points[i++];
+            point.x = static_cast<float>(sum.x * inverse_count);
+            point.y = static_cast<float>(sum.y * inverse_count);
+            point.z = static_cast<float>(sum.z * inverse_count);
+            point.r = static_cast<uint8_t>(sum.r * inverse_count + 0.5);
+            point.g = static_cast<uint8_t>(sum.g * inverse_count + 0.5);
+            point.b = static_cast<uint8_t>(sum.b * inverse_count + 0.5);
+        }
+        out.width = static_cast<uint32_t>(out.points.size());
+        out.height = 1;
+        out.is_dense = true;
+    }
+
+    void CloudAccumulator::clear() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (auto &slot : ring_) {
+            slot.clear();
+        }
+        grid_.clear();
+        head_ = 0;
+        frames_ = 0;
+        frames_added_ = 0;
+    }
+
+}
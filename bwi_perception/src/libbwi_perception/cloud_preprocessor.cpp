@@ -0,0 +1,114 @@
+#include <bwi_perception/cloud_preprocessor.h>
+#include <bwi_perception/convenience.h>
+
+#include <ros/ros.h>
+
+#include <chrono>
+
+namespace bwi_perception {
+
+    CloudPreprocessor::CloudPreprocessor(const CloudRegion &region, tf::TransformListener &listener) :
+            region_(region), listener_(listener), stop_(false), raw_count_(0), filtered_(new PointCloudT),
+            filtered_source_(0), transformed_(new PointCloudT), cropped_(new PointCloudT),
+            voxelized_(new PointCloudT) {
+        crop_.setMin({region_.x_min, -std::numeric_limits<float>::max(), region_.z_min, 1.f});
+        crop_.setMax({region_.x_max, std::numeric_limits<float>::max(), region_.z_max, 1.f});
+        voxel_grid_.setLeafSize(region_.leaf_size, region_.leaf_size, region_.leaf_size);
+
+        worker_ = std::thread(&CloudPreprocessor::run, this);
+    }
+
+    CloudPreprocessor::~CloudPreprocessor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        raw_cv_.notify_all();
+        filtered_cv_.notify_all();
+        worker_.join();
+    }
+
+    void CloudPreprocessor::push(const PointCloudT::ConstPtr &raw) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            raw_ = raw;
+            raw_count_++;
+        }
+        raw_cv_.notify_one();
+    }
+
+    void CloudPreprocessor::run() {
+        while (true) {
+            PointCloudT::ConstPtr raw;
+            uint64_t source;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                raw_cv_.wait(lock, [this] { return stop_ || raw_; });
+                if (stop_) {
+                    return;
+                }
+                raw.swap(raw_);
+                source = raw_count_;
+            }
+
+            if (!filter(raw)) {
+                continue;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                filtered_.swap(voxelized_);
+                filtered_source_ = source;
+            }
+            filtered_cv_.notify_all();
+        }
+    }
+
+    bool CloudPreprocessor::filter(const PointCloudT::ConstPtr &raw) {
+        // try_cloud_to_frame hands back its input when no transform is needed, so keep our own buffer around
+        PointCloudT::Ptr input = boost::const_pointer_cast<PointCloudT>(raw);
+        PointCloudT::Ptr transformed = transformed_;
+        if (!try_cloud_to_frame<PointT>(input, region_.frame, transformed, listener_, ros::Duration(0.1))) {
+            ROS_WARN_THROTTLE(1, "No transform from %s to %s, dropping the cloud", raw->header.frame_id.c_str(),
+                              region_.frame.c_str());
+            return false;
+        }
+
+        crop_.setInputCloud(transformed);
+        crop_.filter(*cropped_);
+
+        voxel_grid_.setInputCloud(cropped_);
+        voxel_grid_.filter(*voxelized_);
+        return true;
+    }
+
+    bool CloudPreprocessor::waitForClouds(unsigned int n, PointCloudT &out) {
+        out.clear();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t last_seen = raw_count_;
+        for (unsigned int i = 0; i < n; i++) {
+            // wake up now and then so a shutdown is noticed even when no frames come in
+            while (filtered_source_ <= last_seen) {
+                if (stop_ || !ros::ok()) {
+                    return false;
+                }
+                filtered_cv_.wait_for(lock, std::chrono::milliseconds(100));
+            }
+            out += *filtered_;
+            out.header = filtered_->header;
+            last_seen = filtered_source_;
+        }
+        lock.unlock();
+
+        if (n > 1) {
+            PointCloudT::Ptr stitched(new PointCloudT(out));
+            pcl::VoxelGrid<PointT> vg;
+            vg.setInputCloud(stitched);
+            vg.setLeafSize(region_.leaf_size, region_.leaf_size, region_.leaf_size);
+            vg.filter(out);
+        }
+        return true;
+    }
+
+}
@@ -0,0 +1,72 @@
+#include <bwi_perception/color_histogram.h>
+
+#include <algorithm>
+#include <thread>
+
+namespace bwi_perception {
+
+    // Below this many points per thread, starting threads costs more than it saves
+    static const size_t MIN_POINTS_PER_THREAD = 20000;
+
+    ColorHistogram::ColorHistogram(int dim) : dim_(dim), cloud_size_(0), bins_(dim * dim * dim, 0) {
+        // (int)(v / (256 / dim)) == (v * dim) / 256 for v in [0, 255]
+        for (int v = 0; v < 256; v++) {
+            lut_[v] = static_cast<uint16_t>((v * dim) >> 8);
+        }
+    }
+
+    void ColorHistogram::accumulate(const pcl::PointXYZRGB *begin, const pcl::PointXYZRGB *end,
+                                    uint32_t *bins) const {
+        const int dim = dim_;
+        for (const pcl::PointXYZRGB *p = begin; p != end; ++p) {
+            bins[(lut_[p->r] * dim + lut_[p->g]) * dim + lut_[p->b]]++;
+        }
+    }
+
+    void ColorHistogram::computeHistogram(const pcl::PointCloud<pcl::PointXYZRGB> &cloud, unsigned int threads) {
+        const size_t cloud_size = cloud.points.size();
+        const pcl::PointXYZRGB *points = cloud.points.data();
+
+        if (threads == 0) {
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = static_cast<unsigned int>(std::min<size_t>(threads, cloud_size / MIN_POINTS_PER_THREAD));
+
+        if (threads <= 1) {
+            accumulate(points, points + cloud_size, bins_.data());
+        } else {
+            const size_t chunk = (cloud_size + threads - 1) / threads;
+            std::vector<std::vector<uint32_t> > partials(threads, std::vector<uint32_t>(bins_.size(), 0));
+            std::vector<std::thread> workers;
+            for (unsigned int t = 0; t < threads; t++) {
+                const pcl::PointXYZRGB *begin = points + std::min(cloud_size, t * chunk);
+                const pcl::PointXYZRGB *end = points + std::min(cloud_size, (t + 1) * chunk);
+                workers.emplace_back(&ColorHistogram::accumulate, this, begin, end, partials[t].data());
+            }
+            for (auto &worker : workers) {
+                worker.join();
+            }
+            for (const auto &partial : partials) {
+                std::transform(partial.begin(), partial.end(), bins_.begin(), bins_.begin(), std::plus<uint32_t>());
+            }
+        }
+
+        cloud_size_ += cloud_size;
+    }
+
+    std::vector<double> ColorHistogram::toDoubleVector() const {
+        return std::vector<double>(bins_.begin(), bins_.end());
+    }
+
+    std::vector<double> ColorHistogram::toDoubleVectorNormalized() const {
+        std::vector<double> hist_double_vector(bins_.size());
+        if (cloud_size_ == 0) {
+            return hist_double_vector;
+        }
+        for (size_t i = 0; i < bins_.size(); i++) {
+            hist_double_vector[i] = bins_[i] / (double) cloud_size_;
+        }
+        return hist_double_vector;
+    }
+
+}
@@ -33,6 +33,27 @@ bwi_perception::perceiveLargestHorizontalPlane(ros::NodeHandle &n) {
     }
 }
 
+bwi_perception::ExtractClusterFeatures::Response
+bwi_perception::extractClusterFeatures(ros::NodeHandle &n, const std::vector<sensor_msgs::PointCloud2> &clusters,
+                                       bool color_histogram, int color_histogram_bins, bool cvfh, bool fpfh) {
+
+    ros::ServiceClient client_cluster_features = n.serviceClient<bwi_perception::ExtractClusterFeatures>(
+            "/bwi_perception/cluster_features_service");
+
+    bwi_perception::ExtractClusterFeatures srv;
+    srv.request.clusters = clusters;
+    srv.request.compute_color_histogram = color_histogram;
+    srv.request.color_histogram_bins = color_histogram_bins;
+    srv.request.compute_cvfh = cvfh;
+    srv.request.compute_fpfh = fpfh;
+    if (client_cluster_features.call(srv)) {
+        return srv.response;
+    } else {
+        ROS_ERROR("Failed to call cluster_features_service");
+        return srv.response;
+    }
+}
+
 void bwi_perception::quaternion_to_frame(const tf::Stamped<tf::Quaternion> &quaternion, const std::string &target_frame,
                                          tf::Stamped<tf::Quaternion> &out_quaternion,
                                          tf::TransformListener &tf_listener) {
@@ -0,0 +1,258 @@
+#include <bwi_perception/feature_pipeline.h>
+
+#include <ros/ros.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <pcl/features/normal_3d.h>
+#include <pcl/features/pfh.h>
+#include <pcl/features/fpfh.h>
+#include <pcl/features/vfh.h>
+#include <pcl/features/cvfh.h>
+
+#include <future>
+
+namespace bwi_perception {
+
+    typedef CloudFeatureContext::PointT PointT;
+
+    // Descriptors are returned as 308 values normalized to sum to one, taken from the start of the
+    // concatenated signatures. This is the layout the feature services have always produced.
+    static std::vector<double> normalized_histogram(const float *histogram, size_t available, size_t length = 308) {
+        std::vector<double> histogram_double_vector(length, 0.);
+        double histogram_sum = 0.;
+        for (size_t i = 0; i < length && i < available; i++) {
+            histogram_double_vector[i] = histogram[i];
+            histogram_sum += histogram[i];
+        }
+        if (histogram_sum > 0.) {
+            for (double &bin : histogram_double_vector) {
+                bin /= histogram_sum;
+            }
+        }
+        return histogram_double_vector;
+    }
+
+    CloudFeatureContext::CloudFeatureContext(const PointCloudT::Ptr &cloud) :
+            cloud_(cloud), index_(new pcl::KdTreeFLANN<PointT>()) {
+        index_->setInputCloud(cloud_);
+    }
+
+    pcl::search::KdTree<PointT>::Ptr CloudFeatureContext::search() const {
+        return pcl::search::KdTree<PointT>::Ptr(new SharedKdTree<PointT>(index_, cloud_));
+    }
+
+    pcl::PointCloud<pcl::Normal>::Ptr CloudFeatureContext::normals(double search_radius) {
+        std::lock_guard<std::mutex> lock(normals_mutex_);
+
+        auto cached = normals_.find(search_radius);
+        if (cached != normals_.end()) {
+            return cached->second;
+        }
+
+        pcl::NormalEstimation<PointT, pcl::Normal> ne;
+        ne.setInputCloud(cloud_);
+        ne.setSearchMethod(search());
+        ne.setRadiusSearch(search_radius);
+
+        pcl::PointCloud<pcl::Normal>::Ptr cloud_normals(new pcl::PointCloud<pcl::Normal>);
+        ne.compute(*cloud_normals);
+        // Check for undefined values
+        for (int i = 0; i < cloud_normals->points.size(); i++) {
+            if (!pcl::isFinite<pcl::Normal>(cloud_normals->points[i])) {
+                PCL_WARN("normals[%d] is not finite\n", i);
+            }
+        }
+
+        normals_[search_radius] = cloud_normals;
+        return cloud_normals;
+    }
+
+    FeaturePipeline::FeaturePipeline(const FeatureParams &params, size_t cache_size) :
+            params_(params), cache_size_(cache_size) {}
+
+    size_t FeaturePipeline::hash(const sensor_msgs::PointCloud2 &cloud_msg) {
+        // FNV-1a over the point data and the layout of the message
+        size_t h = 14695981039346656037ull;
+        auto mix = [&h](const uint8_t *data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                h ^= data[i];
+                h *= 1099511628211ull;
+            }
+        };
+        mix(cloud_msg.data.data(), cloud_msg.data.size());
+        mix(reinterpret_cast<const uint8_t *>(&cloud_msg.point_step), sizeof(cloud_msg.point_step));
+        mix(reinterpret_cast<const uint8_t *>(cloud_msg.header.frame_id.data()), cloud_msg.header.frame_id.size());
+        return h;
+    }
+
+    FeaturePipeline::CacheKey::CacheKey(const sensor_msgs::PointCloud2 &cloud_msg) :
+            hash(FeaturePipeline::hash(cloud_msg)), point_step(cloud_msg.point_step),
+            frame_id(cloud_msg.header.frame_id), data(cloud_msg.data) {
+        for (const auto &field : cloud_msg.fields) {
+            field_names.push_back(field.name);
+            field_offsets.push_back(field.offset);
+            field_datatypes.push_back(field.datatype);
+        }
+    }
+
+    bool FeaturePipeline::CacheKey::matches(const sensor_msgs::PointCloud2 &cloud_msg) const {
+        if (point_step != cloud_msg.point_step || frame_id != cloud_msg.header.frame_id ||
+            field_names.size() != cloud_msg.fields.size() || data != cloud_msg.data) {
+            return false;
+        }
+        for (size_t i = 0; i < field_names.size(); i++) {
+            const auto &field = cloud_msg.fields[i];
+            if (field_names[i] != field.name || field_offsets[i] != field.offset ||
+                field_datatypes[i] != field.datatype) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    CloudFeatureContext::Ptr FeaturePipeline::context(const sensor_msgs::PointCloud2 &cloud_msg) {
+        size_t key = hash(cloud_msg);
+
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex_);
+            for (auto entry = cache_.begin(); entry != cache_.end(); ++entry) {
+                // the hash only narrows it down, a collision mustn't hand out the features of another cloud
+                if (entry->first.hash == key && entry->first.matches(cloud_msg)) {
+                    cache_.splice(cache_.begin(), cache_, entry);
+                    return cache_.front().second;
+                }
+            }
+        }
+
+        PointCloudT::Ptr cloud(new PointCloudT);
+        pcl::fromROSMsg(cloud_msg, *cloud);
+        CloudFeatureContext::Ptr created = context(cloud);
+
+        std::lock_guard<std::mutex> lock(cache_mutex_);
+        cache_.emplace_front(CacheKey(cloud_msg), created);
+        if (cache_.size() > cache_size_) {
+            cache_.pop_back();
+        }
+        return created;
+    }
+
+    CloudFeatureContext::Ptr FeaturePipeline::context(const PointCloudT::Ptr &cloud) const {
+        return CloudFeatureContext::Ptr(new CloudFeatureContext(cloud));
+    }
+
+    std::map<FeatureType, std::vector<double> > FeaturePipeline::compute(const CloudFeatureContext::Ptr &context,
+                                                                         const std::set<FeatureType> &features) const {
+        std::map<FeatureType, std::future<std::vector<double> > > running;
+        for (FeatureType feature : features) {
+            running[feature] = std::async(std::launch::async, [this, context, feature]() {
+                return compute(context, feature);
+            });
+        }
+
+        std::map<FeatureType, std::vector<double> > computed;
+        for (auto &feature : running) {
+            computed[feature.first] = feature.second.get();
+        }
+        return computed;
+    }
+
+    std::vector<double> FeaturePipeline::compute(const CloudFeatureContext::Ptr &context, FeatureType feature) const {
+        switch (feature) {
+            case CVFH:
+                return computeCVFH(context);
+            case VFH:
+                return computeVFH(context);
+            case FPFH:
+                return computeFPFH(context);
+            case PFH:
+                return computePFH(context);
+        }
+        return std::vector<double>();
+    }
+
+    std::vector<double> FeaturePipeline::computeCVFH(const CloudFeatureContext::Ptr &context) const {
+        pcl::PointCloud<pcl::Normal>::Ptr cloud_normals = context->normals(params_.normals_search_radius);
+        ROS_INFO("Computing CVFH...");
+
+        pcl::CVFHEstimation<PointT, pcl::Normal, pcl::VFHSignature308> cvfh;
+        cvfh.setInputCloud(context->cloud());
+        cvfh.setInputNormals(cloud_normals);
+        cvfh.setSearchMethod(context->search());
+
+        pcl::PointCloud<pcl::VFHSignature308> vfhs;
+        cvfh.compute(vfhs);
+
+        if (vfhs.points.empty()) {
+            return std::vector<double>(308, 0.);
+        }
+        return normalized_histogram(vfhs.points[0].histogram, 308);
+    }
+
+    // http://pointclouds.org/documentation/tutorials/vfh_estimation.php#vfh-estimation
+    std::vector<double> FeaturePipeline::computeVFH(const CloudFeatureContext::Ptr &context) const {
+        pcl::PointCloud<pcl::Normal>::Ptr cloud_normals = context->normals(params_.normals_search_radius);
+        ROS_INFO("Computing VFH...");
+
+        pcl::VFHEstimation<PointT, pcl::Normal, pcl::VFHSignature308> vfh;
+        vfh.setInputCloud(context->cloud());
+        vfh.setInputNormals(cloud_normals);
+        vfh.setSearchMethod(context->search());
+
+        // vfhs.points.size () should be of size 1
+        pcl::PointCloud<pcl::VFHSignature308> vfhs;
+        vfh.compute(vfhs);
+
+        if (vfhs.points.empty()) {
+            return std::vector<double>(308, 0.);
+        }
+        return normalized_histogram(vfhs.points[0].histogram, 308);
+    }
+
+    std::vector<double> FeaturePipeline::computeFPFH(const CloudFeatureContext::Ptr &context) const {
+        pcl::PointCloud<pcl::Normal>::Ptr cloud_normals = context->normals(params_.normals_search_radius);
+        ROS_INFO("Computing FPFH...");
+
+        pcl::FPFHEstimation<PointT, pcl::Normal, pcl::FPFHSignature33> fpfh;
+        fpfh.setInputCloud(context->cloud());
+        fpfh.setInputNormals(cloud_normals);
+        fpfh.setSearchMethod(context->search());
+        // IMPORTANT: the radius used here has to be larger than the radius used to estimate the surface normals!!!
+        fpfh.setRadiusSearch(params_.fpfh_neighbor_radius);
+
+        // one signature per point of the input cloud
+        pcl::PointCloud<pcl::FPFHSignature33> fpfhs;
+        fpfh.compute(fpfhs);
+
+        if (fpfhs.points.empty()) {
+            return std::vector<double>(308, 0.);
+        }
+        // signatures are stored contiguously, so the first 308 values span the first few points
+        return normalized_histogram(fpfhs.points[0].histogram, 33 * fpfhs.points.size());
+    }
+
+    // Point Feature Histograms (PFH) descriptors
+    // pointclouds.org/documentation/tutorials/pfh_estimation.php
+    std::vector<double> FeaturePipeline::computePFH(const CloudFeatureContext::Ptr &context) const {
+        pcl::PointCloud<pcl::Normal>::Ptr cloud_normals = context->normals(params_.pfh_normals_search_radius);
+        ROS_INFO("Computing PFH...");
+
+        pcl::PFHEstimation<PointT, pcl::Normal, pcl::PFHSignature125> pfh;
+        pfh.setInputCloud(context->cloud());
+        pfh.setInputNormals(cloud_normals);
+        pfh.setSearchMethod(context->search());
+        // IMPORTANT: the radius used here has to be larger than the radius used to estimate the surface normals!!!
+        pfh.setRadiusSearch(params_.pfh_neighbor_radius);
+
+        pcl::PointCloud<pcl::PFHSignature125> pfhs;
+        pfh.compute(pfhs);
+
+        // average the per point signatures into a single histogram for the whole cloud
+        std::vector<float> mean(125, 0.f);
+        for (const auto &signature : pfhs.points) {
+            for (size_t i = 0; i < mean.size(); i++) {
+                mean[i] += signature.histogram[i];
+            }
+        }
+        return normalized_histogram(mean.data(), mean.size(), mean.size());
+    }
+
+}
@@ -0,0 +1,178 @@
+#include <bwi_perception/sensor_log_writer.h>
+
+#include <ros/ros.h>
+#include <pcl/io/pcd_io.h>
+
+namespace bwi_perception {
+
+    bool parse_cloud_log_format(const std::string &name, CloudLogFormat &format) {
+        if (name == "ascii") {
+            format = PCD_ASCII;
+        } else if (name == "binary") {
+            format = PCD_BINARY;
+        } else if (name == "binary_compressed") {
+            format = PCD_BINARY_COMPRESSED;
+        } else if (name == "octree") {
+            format = OCTREE_STREAM;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    const char *cloud_log_extension(CloudLogFormat format) {
+        return format == OCTREE_STREAM ? ".octree" : ".pcd";
+    }
+
+    bool save_cloud(const std::string &filename, const pcl::PointCloud<pcl::PointXYZRGB> &cloud,
+                    CloudLogFormat format) {
+        int result = -1;
+        switch (format) {
+            case PCD_ASCII:
+                result = pcl::io::savePCDFileASCII(filename, cloud);
+                break;
+            case PCD_BINARY:
+                result = pcl::io::savePCDFileBinary(filename, cloud);
+                break;
+            case PCD_BINARY_COMPRESSED:
+                result = pcl::io::savePCDFileBinaryCompressed(filename, cloud);
+                break;
+            case OCTREE_STREAM:
+                ROS_ERROR("Octree streams can only be written by a SensorLogWriter");
+                break;
+        }
+        return result == 0;
+    }
+
+    SensorLogWriter::SensorLogWriter(CloudLogFormat format, size_t queue_capacity,
+                                     pcl::io::compression_Profiles_e profile) :
+            format_(format), queue_capacity_(queue_capacity), profile_(profile), busy_(false), stop_(false),
+            written_(0), dropped_(0), failed_(0) {
+        writer_ = std::thread(&SensorLogWriter::run, this);
+    }
+
+    SensorLogWriter::~SensorLogWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        queue_cv_.notify_all();
+        writer_.join();
+    }
+
+    bool SensorLogWriter::writeCloud(const PointCloudT::ConstPtr &cloud, const std::string &path) {
+        Job job;
+        job.cloud = cloud;
+        job.path = path + cloud_log_extension(format_);
+        return enqueue(std::move(job), false);
+    }
+
+    bool SensorLogWriter::write(const std::function<bool()> &task) {
+        Job job;
+        job.task = task;
+        return enqueue(std::move(job), false);
+    }
+
+    void SensorLogWriter::closeStream() {
+        Job job;
+        job.control = true;
+        job.task = [this]() {
+            encoder_.reset();
+            if (!stream_.is_open()) {
+                return true;
+            }
+            // closing flushes whatever is still buffered, which can fail too
+            stream_.close();
+            if (!stream_) {
+                ROS_ERROR("Could not finish the octree stream");
+                stream_.clear();
+                return false;
+            }
+            return true;
+        };
+        enqueue(std::move(job), true);
+    }
+
+    bool SensorLogWriter::enqueue(Job &&job, bool force) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!force && queue_.size() >= queue_capacity_) {
+                dropped_++;
+                return false;
+            }
+            queue_.push_back(std::move(job));
+        }
+        queue_cv_.notify_one();
+        return true;
+    }
+
+    void SensorLogWriter::flush() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        idle_cv_.wait(lock, [this] { return queue_.empty() && !busy_; });
+    }
+
+    SensorLogWriter::Statistics SensorLogWriter::statistics() const {
+        Statistics statistics;
+        statistics.written = written_;
+        statistics.dropped = dropped_;
+        statistics.failed = failed_;
+        return statistics;
+    }
+
+    void SensorLogWriter::run() {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                busy_ = false;
+                if (queue_.empty()) {
+                    idle_cv_.notify_all();
+                }
+                queue_cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+                // whatever was queued before the writer was stopped still gets written
+                if (queue_.empty()) {
+                    return;
+                }
+                job = std::move(queue_.front());
+                queue_.pop_front();
+                busy_ = true;
+            }
+
+            bool success = job.cloud ? writeCloudNow(job) : job.task();
+            // control jobs such as closing a stream don't count as writes, but their failures do
+            if (!success) {
+                failed_++;
+            } else if (!job.control) {
+                written_++;
+            }
+        }
+    }
+
+    bool SensorLogWriter::writeCloudNow(const Job &job) {
+        if (format_ != OCTREE_STREAM) {
+            bool success = save_cloud(job.path, *job.cloud, format_);
+            if (!success) {
+                ROS_ERROR("Could not write %s", job.path.c_str());
+            }
+            return success;
+        }
+
+        if (!stream_.is_open()) {
+            stream_.open(job.path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!stream_) {
+                ROS_ERROR("Could not open %s", job.path.c_str());
+                stream_.close();
+                return false;
+            }
+            encoder_.reset(new pcl::io::OctreePointCloudCompression<PointT>(profile_, false));
+        }
+        encoder_->encodePointCloud(job.cloud, stream_);
+        stream_.flush();
+        if (!stream_) {
+            ROS_ERROR("Could not write to the octree stream %s", job.path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+}
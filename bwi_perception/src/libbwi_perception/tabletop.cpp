@@ -9,6 +9,7 @@
 #include <pcl/filters/extract_indices.h>
 #include <pcl/filters/voxel_grid.h>
 #include <bwi_perception/bwi_perception.h>
+#include <bwi_perception/clustering.h>
 #include <bwi_perception/filter.h>
 #include <bwi_perception/plane.h>
 
@@ -16,21 +17,31 @@ namespace bwi_perception {
 
     bool segment_tabletop_scene(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr &in_cloud,
                                 const double cluster_extraction_tolerance, const std::string &up_frame,
-                                pcl::PointCloud<pcl::PointXYZRGB>::Ptr &table_cloud, Eigen::Vector4f plane_coefficients,
+                                pcl::PointCloud<pcl::PointXYZRGB>::Ptr &table_cloud, Eigen::Vector4f &plane_coefficients,
                                 std::vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr> &table_object_clouds,
-                                const double plane_distance_tolerance, const double plane_max_distance_tolerance, double height,
+                                const double plane_distance_tolerance, const double plane_max_distance_tolerance, double &height,
+                                const double min_cluster_size, const double max_cluster_size) {
+        //create listener for transforms
+        tf::TransformListener tf_listener;
+
+        return segment_tabletop_scene(in_cloud, cluster_extraction_tolerance, up_frame, table_cloud, plane_coefficients,
+                                      table_object_clouds, plane_distance_tolerance, plane_max_distance_tolerance,
+                                      height, tf_listener, min_cluster_size, max_cluster_size);
+    }
+
+    bool segment_tabletop_scene(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr &in_cloud,
+                                const double cluster_extraction_tolerance, const std::string &up_frame,
+                                pcl::PointCloud<pcl::PointXYZRGB>::Ptr &table_cloud, Eigen::Vector4f &plane_coefficients,
+                                std::vector<pcl::PointCloud<pcl::PointXYZRGB>::Ptr> &table_object_clouds,
+                                const double plane_distance_tolerance, const double plane_max_distance_tolerance, double &height,
+                                tf::TransformListener &tf_listener,
                                 const double min_cluster_size, const double max_cluster_size) {
         /* define what kind of point clouds we're using */
         typedef pcl::PointXYZRGB PointT;
         typedef pcl::PointCloud<PointT> PointCloudT;
-        PointCloudT::Ptr cloud_blobs(new PointCloudT);
         PointCloudT::Ptr working(new PointCloudT);
         pcl::PointIndices::Ptr table_indices(new pcl::PointIndices());
 
-
-        //create listener for transforms
-        tf::TransformListener tf_listener;
-
         get_largest_plane<PointT>(in_cloud, table_indices, plane_coefficients, up_frame, tf_listener);
 
         pcl::ExtractIndices<PointT> extract;
@@ -42,20 +53,28 @@ namespace bwi_perception {
 
         filter_plane_selection<PointT>(working, table_cloud, cluster_extraction_tolerance);
 
-        extract.setNegative(true);
-        extract.filter(*cloud_blobs);
-
-        //Step 3: Eucledian Cluster Extraction
-        pcl::PointCloud<pcl::PointXYZ>::Ptr structure_only(new pcl::PointCloud<pcl::PointXYZ>);
-        pcl::copyPointCloud(*cloud_blobs, *structure_only);
+        //Step 3: Eucledian Cluster Extraction, over everything that isn't the plane, taken straight from the input
+        std::vector<bool> in_table(in_cloud->points.size(), false);
+        for (int index : table_indices->indices) {
+            in_table[index] = true;
+        }
+        std::vector<int> blob_indices;
+        blob_indices.reserve(in_cloud->points.size() - table_indices->indices.size());
+        for (int i = 0; i < (int) in_cloud->points.size(); i++) {
+            if (!in_table[i]) {
+                blob_indices.push_back(i);
+            }
+        }
         std::vector<pcl::PointIndices> cluster_indices;
-        bwi_perception::compute_clusters<pcl::PointXYZ>(structure_only, cluster_indices, cluster_extraction_tolerance,
-                                                        min_cluster_size, max_cluster_size);
+        if (!blob_indices.empty()) {
+            bwi_perception::segmentation_clusters<PointT>(*in_cloud, blob_indices, cluster_extraction_tolerance,
+                                                          min_cluster_size, max_cluster_size, cluster_indices);
+        }
 
         std::vector<PointCloudT::Ptr> clusters;
         transform(cluster_indices.begin(), cluster_indices.end(), back_inserter(clusters),
-                  [cloud_blobs](pcl::PointIndices indices) {
-                      return typename PointCloudT::Ptr(new PointCloudT(*cloud_blobs, indices.indices));
+                  [&in_cloud](const pcl::PointIndices &indices) {
+                      return PointCloudT::Ptr(new PointCloudT(*in_cloud, indices.indices));
                   });
         //if true, clouds on the other side of the plane will be rejected
         Eigen::Vector4f plane_centroid;
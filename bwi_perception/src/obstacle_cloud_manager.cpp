@@ -8,15 +8,14 @@
  */ 
 
 #include <signal.h>
+#include <cmath>
 #include <vector>
 #include <string>
 #include <sys/stat.h>
 #include <ros/ros.h>
 #include <ros/package.h>
 
-#include <sensor_msgs/PointCloud.h>
 #include <sensor_msgs/PointCloud2.h>
-#include <sensor_msgs/point_cloud_conversion.h>
 
 #include <tf/transform_listener.h>
 #include <tf/tf.h>
@@ -30,6 +29,8 @@
 #include <pcl/sample_consensus/sac_model_plane.h>
 #include <pcl/common/time.h>
 #include <pcl/common/common.h>
+#include <pcl/common/transforms.h>
+#include <pcl_ros/transforms.h>
 
 #include <pcl/filters/crop_box.h>
 #include <pcl/filters/passthrough.h>
@@ -44,6 +45,7 @@
 
 #include <pcl/kdtree/kdtree.h>
 
+#include "bwi_perception/AppendObstacles.h"
 #include "bwi_perception/SetObstacles.h"
 
 
@@ -60,6 +62,12 @@ ros::Publisher cloud_pub;
 
 tf::TransformListener *tf_listener;
 
+//the obstacles, in DEFAULT_FRAME_ID, and the message they are published as
+boost::mutex obstacles_mutex;
+PointCloudT::Ptr obstacles (new PointCloudT);
+sensor_msgs::PointCloud2 obstacles_ros;
+bool obstacles_set = false;
+
 
 //true if Ctrl-C is pressed
 bool g_caught_sigint=false;
@@ -74,75 +82,102 @@ void sig_handler(int sig)
 };
 
 
-bool set_obstacles_cb(bwi_perception::SetObstacles::Request &req, bwi_perception::SetObstacles::Response &res)
+/* publishes the current obstacles with a fresh stamp */
+void publish_obstacles()
 {
+	sensor_msgs::PointCloud2Ptr output_cloud_ros (new sensor_msgs::PointCloud2);
+	{
+		boost::mutex::scoped_lock lock(obstacles_mutex);
+		if (!obstacles_set)
+			return;
+		*output_cloud_ros = obstacles_ros;
+	}
+	output_cloud_ros->header.stamp = ros::Time::now();
+	cloud_pub.publish(output_cloud_ros);
+}
+
+/* keeps publishing from the timer, so the service never has to wait for it */
+void publish_cb(const ros::TimerEvent &event)
+{
+	publish_obstacles();
+}
+
+/* transforms the cloud into DEFAULT_FRAME_ID, returns false if no transform is available */
+bool transform_to_output_frame(const sensor_msgs::PointCloud2 &in, PointCloudT &out)
+{
+	//convert to PCL format
+	pcl::fromROSMsg (in, out);
 	
-	PointCloudT::Ptr combined_cloud (new PointCloudT);
-	
-	std::string output_frame_id;
+	std::string frame_id = in.header.frame_id;
+	if (frame_id == DEFAULT_FRAME_ID){
+		//input cloud is already in desired frame id
+		return true;
+	}
 	
+	//listen for transform to output frame id
 	tf::StampedTransform transform;
+	try {
+		tf_listener->waitForTransform(DEFAULT_FRAME_ID, frame_id, ros::Time(0.0), ros::Duration(3.0));
+		tf_listener->lookupTransform(DEFAULT_FRAME_ID, frame_id, ros::Time(0.0), transform);
+	}
+	catch (tf::TransformException &ex){
+		ROS_ERROR("%s", ex.what());
+		return false;
+	}
 	
-	for (unsigned int i = 0; i < req.clouds.size(); i ++){
-		
-		
-		
-		std::string frame_id_i = req.clouds[i].header.frame_id; 
-		
-		
-		sensor_msgs::PointCloud2 cloud_i_pc2;
-		
-		if (frame_id_i == DEFAULT_FRAME_ID){
-			//input cloud is already in desired frame id
-			cloud_i_pc2 = req.clouds[i];
-		}
-		else {
-			//convert input cloud to sensor_msgs::PointCloud format
-			sensor_msgs::PointCloud cloud_i_pc1;
-			sensor_msgs::convertPointCloud2ToPointCloud(req.clouds[i],cloud_i_pc1);
-			
-			//listen for transform to output frame id
-			tf_listener->waitForTransform(frame_id_i, DEFAULT_FRAME_ID, ros::Time(0.0), ros::Duration(3.0)); 
-		
-			//transform the converted sensor_msgs::PointCloud to the target frame id
-			sensor_msgs::PointCloud transformed_cloiud_i;
-			tf_listener->transformPointCloud(DEFAULT_FRAME_ID,cloud_i_pc1,transformed_cloiud_i);	
-			
-			//convert back to sensor_msgs::PointCloud2
-			sensor_msgs::convertPointCloudToPointCloud2(transformed_cloiud_i,cloud_i_pc2);
+	//apply it to the points as a matrix, without going through sensor_msgs::PointCloud
+	Eigen::Matrix4f matrix;
+	pcl_ros::transformAsMatrix(transform, matrix);
+	pcl::transformPointCloud(out, out, matrix);
+	out.header.frame_id = DEFAULT_FRAME_ID;
+	return true;
+}
+
+/* transforms the clouds and adds them to the obstacles or replaces the obstacles with them,
+   returns false if some cloud couldn't be transformed */
+bool update_obstacles(const std::vector<sensor_msgs::PointCloud2> &clouds, bool append)
+{
+	PointCloudT::Ptr combined_cloud (new PointCloudT);
+	PointCloudT cloud_i;
+	
+	bool all_transformed = true;
+	for (unsigned int i = 0; i < clouds.size(); i ++){
+		if (!transform_to_output_frame(clouds[i], cloud_i)){
+			all_transformed = false;
+			continue;
 		}
 		
-		
-		//convert to PCL format
-		PointCloudT::Ptr cloud_i (new PointCloudT);
-		pcl::fromROSMsg (cloud_i_pc2, *cloud_i);
-		
 		//concatenate the cloud
-		*combined_cloud+=*cloud_i;
+		*combined_cloud+=cloud_i;
 	}
 	
-	//publish output 
-	double frame_rate = 10.0;
-	double duration = 1.0;
-	ros::Rate r(frame_rate);
-	
-	//convert output cloud to ROS format
-	sensor_msgs::PointCloud2 output_cloud_ros;
-	pcl::toROSMsg(*combined_cloud, output_cloud_ros);
-	output_cloud_ros.header.stamp = ros::Time::now();
-	output_cloud_ros.header.frame_id = DEFAULT_FRAME_ID;
-	
-	double elapsed_time = 0;
-	while (elapsed_time < duration){
-		
-		cloud_pub.publish(output_cloud_ros);
-		
-		r.sleep();
+	{
+		boost::mutex::scoped_lock lock(obstacles_mutex);
+		if (append)
+			*combined_cloud = *obstacles + *combined_cloud;
+		obstacles = combined_cloud;
 		
-		elapsed_time += 1.0/(double)frame_rate;
+		//convert output cloud to ROS format once, publishing only restamps it
+		pcl::toROSMsg(*obstacles, obstacles_ros);
+		obstacles_ros.header.frame_id = DEFAULT_FRAME_ID;
+		obstacles_set = true;
 	}
 	
+	//don't make the caller wait for the next tick
+	publish_obstacles();
 	
+	return all_transformed;
+}
+
+bool set_obstacles_cb(bwi_perception::SetObstacles::Request &req, bwi_perception::SetObstacles::Response &res)
+{
+	res.response = update_obstacles(req.clouds, false);
+	return true;
+}
+
+bool append_obstacles_cb(bwi_perception::AppendObstacles::Request &req, bwi_perception::AppendObstacles::Response &res)
+{
+	res.response = update_obstacles(req.clouds, true);
 	return true;
 }
 
@@ -157,13 +192,26 @@ int main (int argc, char** argv)
 
 	//service
 	ros::ServiceServer service = nh.advertiseService("bwi_perception/set_obstacles", set_obstacles_cb);
+	ros::ServiceServer append_service = nh.advertiseService("bwi_perception/append_obstacles", append_obstacles_cb);
 	
 	//register ctrl-c
 	signal(SIGINT, sig_handler);
 
 	tf_listener =  new tf::TransformListener();
 
-	ros::spin();
+	//publish rate of the obstacle cloud
+	double frame_rate;
+	ros::NodeHandle pnh("~");
+	pnh.param("publish_rate", frame_rate, 10.0);
+	if (!(frame_rate > 0.0) || std::isinf(frame_rate)){
+		ROS_WARN("~publish_rate must be positive, got %f. Publishing at 10 Hz", frame_rate);
+		frame_rate = 10.0;
+	}
+	ros::Timer publish_timer = nh.createTimer(ros::Duration(1.0 / frame_rate), publish_cb);
+
+	//a service call waiting for a transform doesn't hold up publishing
+	ros::MultiThreadedSpinner spinner(2);
+	spinner.spin();
 	
 	//refresh rate
 	/*double ros_rate = 5.0;
@@ -1,4 +1,8 @@
 #include <signal.h>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <string>
 #include <sys/stat.h>
@@ -26,8 +30,6 @@
 #include <pcl/common/time.h>
 #include <pcl/common/common.h>
 
-#include <pcl/octree/octree.h>
-
 #include <pcl/filters/crop_box.h>
 #include <pcl/filters/passthrough.h>
 #include <pcl/filters/voxel_grid.h>
@@ -43,37 +45,36 @@
 
 #include <std_srvs/Empty.h>
 
-#define OCTREE_RESOLUTION 0.01
+#include <bwi_perception/BoundingBox.h>
+#include <bwi_perception/change_detector.h>
 
 /* define what kind of point clouds we're using */
 typedef pcl::PointXYZRGB PointT;
 typedef pcl::PointCloud<PointT> PointCloudT;
 
-// Mutex: //
-boost::mutex cloud_mutex;
-
-bool new_cloud_available_flag = false;
 PointCloudT::Ptr cloud (new PointCloudT);
-PointCloudT::Ptr cloud_aggregated (new PointCloudT);
-PointCloudT::Ptr cloud_plane (new PointCloudT);
-PointCloudT::Ptr cloud_blobs (new PointCloudT);
 //the change cloud
-PointCloudT::Ptr filtered_cloud;
-
+PointCloudT::Ptr filtered_cloud (new PointCloudT);
 
 sensor_msgs::PointCloud2 cloud_ros;
 
-boost::shared_ptr<pcl::octree::OctreePointCloudChangeDetector<PointT>> octree;
-
+bwi_perception::ChangeDetector *detector;
+std::vector<PointCloudT::Ptr> change_clusters;
 
 ros::Publisher cloud_pub;
+ros::Publisher clusters_pub;
 
 //true if Ctrl-C is pressed
 bool g_caught_sigint=false;
 
+//hands frames and requests from the callbacks to the worker; only the newest frame is kept
+std::mutex frame_mutex;
+std::condition_variable frame_cv;
+sensor_msgs::PointCloud2ConstPtr latest_frame;
 //true if change is being computed
 bool computeChange = false;
-bool firstRun = true;
+bool reset_requested = false;
+bool clear_requested = false;
 
 /* what happens when ctr-c is pressed */
 void sig_handler(int sig)
@@ -88,49 +89,88 @@ void sig_handler(int sig)
 void
 cloud_cb (const sensor_msgs::PointCloud2ConstPtr& input)
 {
-	if (computeChange){
-
-		//cloud_mutex.lock ();
-
-		//convert to PCL format
-		pcl::fromROSMsg (*input, *cloud);
-
-		//state that a new cloud is available
-		new_cloud_available_flag = true;
-		
-		// assign point cloud to octree
-		octree->setInputCloud (cloud);
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		if (!computeChange)
+			return;
+		latest_frame = input;
+	}
+	frame_cv.notify_one();
+}
 
-		// add points from cloud to octree
-        octree->addPointsFromInputCloud();
 
+/* publishes a box per cluster, and deletes the boxes of earlier clusters that are gone */
+void publish_markers(const std::string &frame_id, int &published_markers)
+{
+	visualization_msgs::MarkerArray markers;
+	for (int i = 0; i < change_clusters.size(); i++){
+		markers.markers.push_back(bwi_perception::BoundingBox::from_cloud<PointT>(change_clusters[i]).to_marker(i, "change_clusters"));
+	}
+	for (int i = change_clusters.size(); i < published_markers; i++){
+		visualization_msgs::Marker marker;
+		marker.header.frame_id = frame_id;
+		marker.header.stamp = ros::Time::now();
+		marker.ns = "change_clusters";
+		marker.id = i;
+		marker.action = visualization_msgs::Marker::DELETE;
+		markers.markers.push_back(marker);
+	}
+	published_markers = change_clusters.size();
 
-        std::vector<int> newPointIdxVector;
+	if (!markers.markers.empty())
+		clusters_pub.publish(markers);
+}
 
-        // get a vector of new points, which did not exist in previous buffer
 
-        octree->getPointIndicesFromNewVoxels(newPointIdxVector, 7); //the last argument is "noise_filter"
+/* runs the detector and publishes its results, away from the subscriber callback */
+void change_worker()
+{
+	int published_markers = 0;
+	std::string frame_id;
+	while (ros::ok()){
+		sensor_msgs::PointCloud2ConstPtr input;
+		bool reset, clear;
+		{
+			std::unique_lock<std::mutex> lock(frame_mutex);
+			//wake up now and then to notice a shutdown
+			frame_cv.wait_for(lock, std::chrono::milliseconds(100), []{ return latest_frame || reset_requested || clear_requested; });
+			input.swap(latest_frame);
+			reset = reset_requested;
+			clear = clear_requested;
+			reset_requested = false;
+			clear_requested = false;
+		}
 
-		
+		if (reset)
+			detector->reset();
 
-		filtered_cloud.reset (new PointCloudT);
+		if (clear){
+			change_clusters.clear();
+			publish_markers(frame_id, published_markers);
+		}
 
-        filtered_cloud->points.reserve(newPointIdxVector.size());
-        for (int &it : newPointIdxVector)
-            filtered_cloud->points.push_back(cloud->points[it]);
+		if (!input)
+			continue;
 
-		//publish change only after 1st frame
-		if (!firstRun){
+		//convert to PCL format
+		pcl::fromROSMsg (*input, *cloud);
+		frame_id = cloud->header.frame_id;
+
+		//nothing is published while the background is being learned
+		if (!detector->update(*cloud, change_clusters))
+			continue;
+
+		//publish the points of all clusters in one cloud, and a box around each
+		if (cloud_pub.getNumSubscribers() > 0){
+			filtered_cloud->clear();
+			for (int i = 0; i < change_clusters.size(); i++){
+				*filtered_cloud += *change_clusters[i];
+			}
 			pcl::toROSMsg(*filtered_cloud,cloud_ros);
 			cloud_ros.header.frame_id = cloud->header.frame_id;
 			cloud_pub.publish(cloud_ros);
 		}
-		else firstRun = false;
-				
-		// switch buffers - reset tree
-		octree->switchBuffers ();
-
-		//cloud_mutex.unlock ();
+		publish_markers(frame_id, published_markers);
 	}
 }
 
@@ -138,11 +178,15 @@ cloud_cb (const sensor_msgs::PointCloud2ConstPtr& input)
 
 bool start_service_cb(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res)
 {
-    octree = boost::shared_ptr<pcl::octree::OctreePointCloudChangeDetector<PointT>>(
-            new pcl::octree::OctreePointCloudChangeDetector<PointT>(OCTREE_RESOLUTION));
-	
-	computeChange = true;
-	firstRun = true;
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		//the scene as it is now becomes the background
+		reset_requested = true;
+		clear_requested = true;
+		latest_frame.reset();
+		computeChange = true;
+	}
+	frame_cv.notify_one();
 	
 	return true;
 }
@@ -151,8 +195,14 @@ bool start_service_cb(std_srvs::Empty::Request &req, std_srvs::Empty::Response &
 
 bool stop_service_cb(std_srvs::Empty::Request &req, std_srvs::Empty::Response &res)
 {
-	computeChange = false;
-    octree = boost::shared_ptr<pcl::octree::OctreePointCloudChangeDetector<PointT>>();
+	{
+		std::lock_guard<std::mutex> lock(frame_mutex);
+		//the boxes of the last frame no longer mean anything
+		clear_requested = true;
+		latest_frame.reset();
+		computeChange = false;
+	}
+	frame_cv.notify_one();
 	
 	return true;
 }
@@ -162,6 +212,32 @@ int main (int argc, char** argv)
 	// Initialize ROS
 	ros::init (argc, argv, "segbot_arm_table_change_detector");
 	ros::NodeHandle nh;
+	ros::NodeHandle pnh("~");
+
+	bwi_perception::ChangeDetectorParams params;
+	double leaf_size;
+	pnh.param("leaf_size", leaf_size, 0.01);
+	params.leaf_size = leaf_size;
+	int min_points_per_voxel, persistence, background_frames, min_cluster_voxels;
+	//voxels with fewer points in a frame are treated as noise
+	pnh.param("min_points_per_voxel", min_points_per_voxel, 7);
+	pnh.param("persistence", persistence, 5);
+	pnh.param("background_frames", background_frames, 3);
+	pnh.param("min_cluster_voxels", min_cluster_voxels, 10);
+	params.min_points_per_voxel = min_points_per_voxel;
+	params.persistence = persistence;
+	params.background_frames = background_frames;
+	params.min_cluster_voxels = min_cluster_voxels;
+
+	//workspace box in the camera frame, unbounded by default
+	std::vector<double> workspace_min, workspace_max;
+	if (pnh.getParam("workspace_min", workspace_min) && workspace_min.size() == 3)
+		params.workspace_min = Eigen::Vector4f(workspace_min[0], workspace_min[1], workspace_min[2], 1.f);
+	if (pnh.getParam("workspace_max", workspace_max) && workspace_max.size() == 3)
+		params.workspace_max = Eigen::Vector4f(workspace_max[0], workspace_max[1], workspace_max[2], 1.f);
+
+	bwi_perception::ChangeDetector change_detector(params);
+	detector = &change_detector;
 
 	// Create a ROS subscriber for the input point cloud
 	std::string param_topic = "/xtion_camera/depth_registered/points";
@@ -169,6 +245,7 @@ int main (int argc, char** argv)
 
 	//debugging publisher
 	cloud_pub = nh.advertise<sensor_msgs::PointCloud2>("segbot_arm_table_change_detector/cloud", 10);
+	clusters_pub = nh.advertise<visualization_msgs::MarkerArray>("segbot_arm_table_change_detector/clusters", 10);
 
 	//service
 	ros::ServiceServer service_start = nh.advertiseService("segbot_arm_table_change_detector/start", start_service_cb);
@@ -177,10 +254,11 @@ int main (int argc, char** argv)
 	//register ctrl-c
 	signal(SIGINT, sig_handler);
 
-	//create octree structure
-    octree = boost::shared_ptr<pcl::octree::OctreePointCloudChangeDetector<PointT>>(
-            new pcl::octree::OctreePointCloudChangeDetector<PointT>(OCTREE_RESOLUTION));
+	std::thread worker(change_worker);
 
 	ros::spin();
 
+	frame_cv.notify_one();
+	worker.join();
+
 };
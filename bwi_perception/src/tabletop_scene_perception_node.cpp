@@ -28,11 +28,13 @@
 #include "bwi_perception/GetPCD.h"
 #include <bwi_perception/filter.h>
 #include <mutex>
-#include <condition_variable>
 #include <bwi_perception/bwi_perception.h>
 #include <bwi_perception/tabletop.h>
 #include <bwi_perception/plane.h>
 #include <bwi_perception/BoundingBox.h>
+#include <bwi_perception/cloud_preprocessor.h>
+#include <bwi_perception/cloud_accumulator.h>
+#include <bwi_perception/sensor_log_writer.h>
 
 using namespace std;
 //how many frames to stitch into a single cloud
@@ -48,6 +50,12 @@ typedef pcl::PointXYZRGB PointT;
 typedef pcl::PointCloud<PointT> PointCloudT;
 
 ros::NodeHandle *persistent_nh;
+// kept for the lifetime of the node so its transform buffer is already filled when a request comes in
+tf::TransformListener *tf_listener;
+// crops and voxelizes incoming clouds with the default filter region between requests
+bwi_perception::CloudPreprocessor *preprocessor;
+// fuses raw frames for the requests the preprocessor can't serve
+bwi_perception::CloudAccumulator *accumulator;
 ros::Subscriber camera_cloud_sub;
 std::string up_frame;
 string camera_cloud_topic;
@@ -59,10 +67,6 @@ PointCloudT::Ptr cloud(new PointCloudT);
 ros::Publisher objects_cloud_pub;
 ros::Publisher table_cloud_pub;
 
-uint64_t cloud_count = 0;
-mutex cloud_count_lock;
-condition_variable cloud_count_cv;
-
 //true if Ctrl-C is pressed
 bool g_caught_sigint = false;
 
@@ -77,17 +81,17 @@ void sig_handler(int sig) {
 
 void cloud_cb(const sensor_msgs::PointCloud2ConstPtr &input) {
     //convert to PCL format
+    PointCloudT::Ptr converted(new PointCloudT);
+    pcl::fromROSMsg(*input, *converted);
     {
         lock_guard<mutex> guard(cloud_lock);
-        pcl::fromROSMsg(*input, *cloud);
+        cloud = converted;
     }
+    preprocessor->push(converted);
 
-    {
-        lock_guard<mutex> guard(cloud_count_lock);
-        cloud_count++;
+    if (accumulator->collecting()) {
+        accumulator->add(*converted);
     }
-
-    cloud_count_cv.notify_all();
 }
 
 bool get_pcd_cb(bwi_perception::GetPCD::Request &req, bwi_perception::GetPCD::Response &res) {
@@ -99,73 +103,71 @@ bool get_pcd_cb(bwi_perception::GetPCD::Request &req, bwi_perception::GetPCD::Re
     //save file
     std::string filename = req.generalImageFilePath + "/" + startTime + ".pcd";
 
+    //cloud_cb replaces the cloud rather than writing into it, so it can be saved without holding the lock
+    PointCloudT::Ptr latest;
     {
         lock_guard<mutex> guard(cloud_lock);
-        pcl::io::savePCDFileASCII(filename, *cloud);
+        latest = cloud;
     }
 
+    res.success = bwi_perception::save_cloud(filename, *latest, bwi_perception::PCD_BINARY_COMPRESSED);
+    if (res.success) {
+        ROS_INFO("Saved pcd file %s", filename.c_str());
+    } else {
+        ROS_ERROR("Could not save pcd file %s", filename.c_str());
+    }
 
-    ROS_INFO("Saved pcd file %s", filename.c_str());
-
-    res.success = true;
     return true;
 }
 
 
-void wait_for_cloud(uint n = 1) {
-    // Wait until the cloud cb notifies us
-    uint64_t old_cloud_count = cloud_count;
-    unique_lock<std::mutex> unique_lock(cloud_count_lock);
-    cloud_count_cv.wait(unique_lock, [=]{ return old_cloud_count + n <= cloud_count; });
+/* collects a cloud by fusing n + 1 successive frames into a voxel grid */
+bool aggregate_clouds(uint n, PointCloudT::Ptr &out) {
+    return accumulator->collect(n + 1, *out);
 }
 
-/* collects a cloud by aggregating k successive frames */
-void aggregate_clouds(uint n, PointCloudT::Ptr &out) {
-
-    int counter = 0;
-    while (ros::ok()) {
+/* collects a cloud cropped to the requested region, in up_frame */
+bool collect_filtered_cloud(bool override_filter_z, float min_z_value, float max_z_value,
+                            bool apply_x_box_filter, float x_min_value, float x_max_value, PointCloudT::Ptr &out) {
+    ROS_INFO("waiting for cloud...");
+    if (!override_filter_z && !apply_x_box_filter) {
+        // the default region is what the preprocessor has been filtering all along.
+        // aggregate_clouds stitches n + 1 frames, take as many here
+        return preprocessor->waitForClouds(num_clouds + 1, *out);
+    }
 
-        wait_for_cloud();
-        {
-            lock_guard<mutex> guard(cloud_lock);
-            *out += *cloud;
-            if (counter >= n) {
-                out->header = cloud->header;
-                break;
-            }
-        }
-        counter++;
+    PointCloudT::Ptr working(new PointCloudT);
+    if (!aggregate_clouds(num_clouds, working)) {
+        return false;
     }
 
+    float x_min = -std::numeric_limits<float>::max();
+    float x_max = std::numeric_limits<float>::max();
+    float z_min = z_filter_min;
+    float z_max = z_filter_max;
+    if (override_filter_z) {
+        z_min = min_z_value;
+        z_max = max_z_value;
+    }
+    if (apply_x_box_filter) {
+        x_min = x_min_value;
+        x_max = x_max_value;
+    }
+    bwi_perception::filter_cloud_region<PointT>(working, out, up_frame, z_min, z_max, x_min, x_max, *tf_listener);
+    return true;
 }
 
 bool seg_cb(bwi_perception::PerceiveTabletopScene::Request &req, bwi_perception::PerceiveTabletopScene::Response &res) {
     ROS_INFO("Request received...starting pipeline.");
 
-    PointCloudT::Ptr cloud_plane(new PointCloudT);
     PointCloudT::Ptr cloud_blobs(new PointCloudT);
     PointCloudT::Ptr working(new PointCloudT);
 
-    //create listener for transforms
-    tf::TransformListener tf_listener;
-    ROS_INFO("waiting for cloud...");
-    aggregate_clouds(num_clouds, working);
-
-    ROS_INFO("collected cloud success");
-    float x_min = -std::numeric_limits<float>::max();
-    float x_max = std::numeric_limits<float>::max();
-    float z_min = z_filter_min;
-    float z_max = z_filter_max;
-    if (req.override_filter_z) {
-        z_min = req.min_z_value;
-        z_max = req.max_z_value;
+    if (!collect_filtered_cloud(req.override_filter_z, req.min_z_value, req.max_z_value,
+                                req.apply_x_box_filter, req.x_min, req.x_max, working)) {
+        return false;
     }
-    if (req.apply_x_box_filter) {
-        x_min = req.x_min;
-        x_max = req.x_max;
-    }
-    bwi_perception::filter_cloud_region<PointT>(working, cloud_plane, up_frame, z_min, z_max, x_min, x_max, tf_listener);
-    working.swap(cloud_plane);
+    ROS_INFO("collected cloud success");
 
     double height;
     PointCloudT::Ptr table_cloud(new PointCloudT);
@@ -173,7 +175,7 @@ bool seg_cb(bwi_perception::PerceiveTabletopScene::Request &req, bwi_perception:
     vector<PointCloudT::Ptr> table_objects;
     bwi_perception::segment_tabletop_scene(working, cluster_extraction_tolerance, up_frame, table_cloud,
                                            plane_coefficients, table_objects, plane_distance_tolerance,
-                                           plane_max_distance_tolerance, height, 50);
+                                           plane_max_distance_tolerance, height, *tf_listener, 50);
 
     ROS_INFO("Found %i clusters on the plane.", (int) table_objects.size());
 
@@ -227,29 +229,14 @@ bool get_largest_horizontal_plane_cb(bwi_perception::PerceiveLargestHorizontalPl
     PointCloudT::Ptr filtered(new PointCloudT);
 
     pcl::PointIndices::Ptr plane_indices(new pcl::PointIndices());
-    //create listener for transforms
-    tf::TransformListener tf_listener;
-
-    ROS_INFO("waiting for cloud...");
-    aggregate_clouds(num_clouds, working);
 
-    float x_min = -std::numeric_limits<float>::max();
-    float x_max = std::numeric_limits<float>::max();
-    float z_min = z_filter_min;
-    float z_max = z_filter_max;
-    if (req.override_filter_z) {
-        z_min = req.min_z_value;
-        z_max = req.max_z_value;
-    }
-    if (req.apply_x_box_filter) {
-        x_min = req.x_min;
-        x_max = req.x_max;
+    if (!collect_filtered_cloud(req.override_filter_z, req.min_z_value, req.max_z_value,
+                                req.apply_x_box_filter, req.x_min, req.x_max, working)) {
+        return false;
     }
-    bwi_perception::filter_cloud_region<PointT>(working, filtered, up_frame, z_min, z_max, x_min, x_max, tf_listener);
-    working.swap(filtered);
 
     Eigen::Vector4f plane_coefficients;
-    bool success = bwi_perception::get_largest_plane<PointT>(working, plane_indices, plane_coefficients, up_frame, tf_listener);
+    bool success = bwi_perception::get_largest_plane<PointT>(working, plane_indices, plane_coefficients, up_frame, *tf_listener);
 
     if (!success) {
         res.is_plane_found = false;
@@ -283,9 +270,10 @@ bool get_largest_horizontal_plane_cb(bwi_perception::PerceiveLargestHorizontalPl
 bool get_cloud_cb(bwi_perception::GetCloud::Request &req, bwi_perception::GetCloud::Response &res) {
     ROS_INFO("[table_object_detection_node.cpp] retrieving point cloud...");
     PointCloudT::Ptr working(new PointCloudT);
-    aggregate_clouds(15, working);
+    if (!aggregate_clouds(15, working)) {
+        return false;
+    }
     pcl::toROSMsg(*working, res.cloud);
-    res.cloud.header.frame_id = cloud->header.frame_id;
     return true;
 }
 
@@ -323,6 +311,20 @@ int main(int argc, char **argv) {
 
     pnh.param("eps_angle", eps_angle, 0.09);
 
+    tf::TransformListener listener;
+    tf_listener = &listener;
+
+    bwi_perception::CloudRegion region;
+    region.frame = up_frame;
+    region.z_min = z_filter_min;
+    region.z_max = z_filter_max;
+    bwi_perception::CloudPreprocessor cloud_preprocessor(region, listener);
+    preprocessor = &cloud_preprocessor;
+
+    // the same leaf size filter_cloud_region voxelizes with, enough frames for get_aggregated_cloud
+    bwi_perception::CloudAccumulator cloud_accumulator(std::max(num_clouds + 1, 16), 0.0025f);
+    accumulator = &cloud_accumulator;
+
     camera_cloud_sub = persistent_nh->subscribe(camera_cloud_topic, 100, cloud_cb);
 
     //debugging publisher
@@ -0,0 +1,174 @@
+#include <bwi_perception/clustering.h>
+#include <gtest/gtest.h>
+
+#include <pcl/point_types.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/segmentation/extract_clusters.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+typedef pcl::PointXYZ PointT;
+typedef pcl::PointCloud<PointT> PointCloudT;
+
+// clusters as sorted lists of sorted indices, so that equally large clusters compare the same in any order
+static std::vector<std::vector<int> > canonical(const std::vector<pcl::PointIndices> &clusters) {
+  std::vector<std::vector<int> > out;
+  for (size_t i = 0; i < clusters.size(); ++i) {
+    std::vector<int> indices = clusters[i].indices;
+    std::sort(indices.begin(), indices.end());
+    out.push_back(indices);
+  }
+  std::sort(out.begin(), out.end());
+  return out;
+}
+
+static std::vector<pcl::PointIndices> reference_clusters(const PointCloudT::Ptr &cloud, const std::vector<int> &indices,
+                                                        double tolerance, size_t min_size, size_t max_size) {
+  pcl::search::KdTree<PointT>::Ptr tree(new pcl::search::KdTree<PointT>);
+  tree->setInputCloud(cloud, boost::make_shared<std::vector<int> >(indices));
+  pcl::EuclideanClusterExtraction<PointT> ec;
+  ec.setClusterTolerance(tolerance);
+  ec.setMinClusterSize(min_size);
+  ec.setMaxClusterSize(max_size);
+  ec.setSearchMethod(tree);
+  ec.setInputCloud(cloud);
+  ec.setIndices(boost::make_shared<std::vector<int> >(indices));
+  std::vector<pcl::PointIndices> out;
+  ec.extract(out);
+  return out;
+}
+
+// A dense frame looking at a table top with some boxes on it, with holes of missing depth. Every third column of the
+// far box is missing, so that its columns are within the tolerance in space but not neighbours in the image.
+static PointCloudT::Ptr tabletop_frame(int width, int height) {
+  PointCloudT::Ptr cloud(new PointCloudT);
+  cloud->width = width;
+  cloud->height = height;
+  cloud->is_dense = false;
+  cloud->points.resize(width * height);
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int v = 0; v < height; ++v) {
+    for (int u = 0; u < width; ++u) {
+      PointT &p = cloud->points[v * width + u];
+      float x = (u - width / 2) * 0.01f;
+      float y = (v - height / 2) * 0.01f;
+      float z = 1.0f;
+      if (u >= 5 && u < 15 && v >= 5 && v < 15) {
+        z = 0.9f;
+      } else if (u >= 25 && u < 50 && v >= 8 && v < 20) {
+        z = 0.8f;
+        if (u % 3 != 0) {
+          x = y = z = nan;
+        }
+      }
+      if (rand() % 20 == 0) {
+        x = y = z = nan;
+      }
+      p.x = x * z;
+      p.y = y * z;
+      p.z = z;
+    }
+  }
+  return cloud;
+}
+
+static std::vector<int> finite_indices(const PointCloudT &cloud) {
+  std::vector<int> indices;
+  for (int i = 0; i < (int) cloud.points.size(); ++i) {
+    if (bwi_perception::is_finite_point(cloud.points[i])) {
+      indices.push_back(i);
+    }
+  }
+  return indices;
+}
+
+TEST(Clustering, MatchesEuclideanClusterExtractionOnOrganizedClouds) {
+  srand(1);
+  PointCloudT::Ptr cloud = tabletop_frame(64, 48);
+  std::vector<int> all = finite_indices(*cloud);
+
+  const double tolerances[] = {0.005, 0.015, 0.025, 0.06};
+  for (size_t t = 0; t < sizeof(tolerances) / sizeof(tolerances[0]); ++t) {
+    std::vector<pcl::PointIndices> clusters;
+    bwi_perception::euclidean_clusters(*cloud, std::vector<int>(), tolerances[t], 1, cloud->points.size(),
+                                       clusters);
+    EXPECT_EQ(canonical(reference_clusters(cloud, all, tolerances[t], 1, cloud->points.size())),
+              canonical(clusters)) << "tolerance " << tolerances[t];
+  }
+}
+
+TEST(Clustering, MatchesEuclideanClusterExtractionOnIndices) {
+  srand(2);
+  PointCloudT::Ptr cloud = tabletop_frame(64, 48);
+
+  // everything but the table, as the tabletop segmentation clusters it
+  std::vector<int> blobs;
+  for (int i = 0; i < (int) cloud->points.size(); ++i) {
+    if (bwi_perception::is_finite_point(cloud->points[i]) && cloud->points[i].z < 0.95f) {
+      blobs.push_back(i);
+    }
+  }
+  std::vector<pcl::PointIndices> clusters;
+  bwi_perception::euclidean_clusters(*cloud, blobs, 0.025, 10, 1000, clusters);
+  std::vector<pcl::PointIndices> reference = reference_clusters(cloud, blobs, 0.025, 10, 1000);
+  EXPECT_EQ(canonical(reference), canonical(clusters));
+  ASSERT_EQ(2u, clusters.size());
+  // largest first
+  EXPECT_GE(clusters[0].indices.size(), clusters[1].indices.size());
+}
+
+TEST(Clustering, OrganizedPathOnlyJoinsImageNeighbours) {
+  srand(3);
+  PointCloudT::Ptr cloud = tabletop_frame(64, 48);
+  std::vector<int> far_box;
+  for (int i = 0; i < (int) cloud->points.size(); ++i) {
+    if (bwi_perception::is_finite_point(cloud->points[i]) && cloud->points[i].z < 0.85f) {
+      far_box.push_back(i);
+    }
+  }
+
+  // the columns of the far box are three pixels apart, but close enough in space
+  std::vector<pcl::PointIndices> exact, organized;
+  bwi_perception::euclidean_clusters(*cloud, far_box, 0.04, 1, cloud->points.size(), exact);
+  bwi_perception::organized_euclidean_clusters(*cloud, far_box, 0.04, 1, cloud->points.size(), organized);
+  EXPECT_EQ(1u, exact.size());
+  EXPECT_GT(organized.size(), 1u);
+
+  // with a wide enough window they agree again
+  organized.clear();
+  bwi_perception::organized_euclidean_clusters(*cloud, far_box, 0.04, 1, cloud->points.size(), organized, 3);
+  EXPECT_EQ(canonical(exact), canonical(organized));
+}
+
+TEST(Clustering, SegmentationUsesTheGridOnlyForOrganizedClouds) {
+  srand(4);
+  PointCloudT::Ptr cloud = tabletop_frame(64, 48);
+  std::vector<int> far_box;
+  for (int i = 0; i < (int) cloud->points.size(); ++i) {
+    if (bwi_perception::is_finite_point(cloud->points[i]) && cloud->points[i].z < 0.85f) {
+      far_box.push_back(i);
+    }
+  }
+
+  std::vector<pcl::PointIndices> organized, segmented;
+  bwi_perception::organized_euclidean_clusters(*cloud, far_box, 0.04, 1, cloud->points.size(), organized);
+  bwi_perception::segmentation_clusters(*cloud, far_box, 0.04, 1, cloud->points.size(), segmented);
+  EXPECT_EQ(canonical(organized), canonical(segmented));
+
+  // the same points as a list, e.g. after filtering
+  cloud->width = cloud->points.size();
+  cloud->height = 1;
+  std::vector<pcl::PointIndices> exact;
+  segmented.clear();
+  bwi_perception::euclidean_clusters(*cloud, far_box, 0.04, 1, cloud->points.size(), exact);
+  bwi_perception::segmentation_clusters(*cloud, far_box, 0.04, 1, cloud->points.size(), segmented);
+  EXPECT_EQ(canonical(exact), canonical(segmented));
+  EXPECT_EQ(1u, segmented.size());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,100 @@
+
+#include "SceneOrdering.h"
+
+#include <cmath>
+
+float missProbability(const std::vector<float> &belief, int scene, const DetectionModel &model) {
+
+    return belief[scene] * (1.0 - model.true_positive_rate) +
+           (1.0 - belief[scene]) * model.true_negative_rate;
+}
+
+void updateBeliefAfterMiss(std::vector<float> &belief, int scene, const DetectionModel &model) {
+
+    float miss = missProbability(belief, scene, model);
+    if (miss <= 0.0)
+        return;
+
+    belief[scene] = belief[scene] * (1.0 - model.true_positive_rate) / miss;
+
+    float normalizer = 0.0;
+    for (unsigned i = 0; i < belief.size(); i++)
+        normalizer += belief[i];
+
+    for (unsigned i = 0; i < belief.size(); i++)
+        belief[i] = belief[i] / normalizer;
+}
+
+namespace {
+
+struct Lookahead {
+
+    TravelCostOracle *oracle;
+    float analysis_cost;
+    DetectionModel model;
+
+    // best value of the visits still to come, having spent "elapsed" so far and
+    // missed the target with probability "reach"
+    float search(const std::vector<float> &belief, const std::vector<float> &travel, float elapsed,
+                 float reach, int depth, std::vector<int> *order) {
+
+        float best_value = -1.0;
+        std::vector<int> best_order, rest;
+
+        for (unsigned i = 0; i < belief.size(); i++) {
+
+            float value = 0.0;
+            if (!std::isinf(travel[i])) {
+
+                float time = elapsed + travel[i] + analysis_cost;
+                value = reach * belief[i] * model.true_positive_rate / time;
+
+                if (depth > 1) {
+                    std::vector<float> next_belief(belief);
+                    float miss = missProbability(belief, i, model);
+                    updateBeliefAfterMiss(next_belief, i, model);
+                    value += search(next_belief, oracle->sceneCosts(i), time, reach * miss, depth - 1,
+                                    order ? &rest : NULL);
+                }
+            }
+
+            // ties go to the later scene, as they did with the plain ratio
+            if (value >= best_value) {
+                best_value = value;
+                if (order) {
+                    best_order.clear();
+                    best_order.push_back(i);
+                    if (!std::isinf(travel[i]))
+                        best_order.insert(best_order.end(), rest.begin(), rest.end());
+                }
+            }
+            rest.clear();
+        }
+
+        if (order)
+            *order = best_order;
+        return best_value;
+    }
+};
+
+}
+
+int selectSceneLookahead(const std::vector<float> &belief, const std::vector<float> &travel_from_robot,
+                         TravelCostOracle &oracle, float analysis_cost, int depth,
+                         const DetectionModel &model, std::vector<int> *order) {
+
+    if (belief.empty())
+        return -1;
+
+    Lookahead lookahead;
+    lookahead.oracle = &oracle;
+    lookahead.analysis_cost = analysis_cost;
+    lookahead.model = model;
+
+    std::vector<int> best_order;
+    lookahead.search(belief, travel_from_robot, 0.0, 1.0, (depth < 1) ? 1 : depth, &best_order);
+
+    if (order)
+        *order = best_order;
+    return best_order.front();
+}
@@ -0,0 +1,38 @@
+#ifndef SCENEORDERING_H
+#define SCENEORDERING_H
+
+#include <cstddef>
+#include <vector>
+
+#include "TravelCostOracle.h"
+
+// The detector model behind SearchPlanner::updateBelief
+struct DetectionModel {
+
+    DetectionModel() : true_positive_rate(0.95), true_negative_rate(0.95) {}
+
+    float true_positive_rate;
+    float true_negative_rate;
+};
+
+// probability of not detecting anything when analyzing the given scene
+float missProbability(const std::vector<float> &belief, int scene, const DetectionModel &model);
+
+// Bayes update of the belief after analyzing a scene and not finding the target
+void updateBeliefAfterMiss(std::vector<float> &belief, int scene, const DetectionModel &model);
+
+// Chooses the next scene by looking at every sequence of "depth" scene visits.
+// A sequence is worth the sum over its visits of the probability of finding the
+// target on that visit (having missed it on the ones before, as updateBelief
+// would) divided by the time spent until then, taking travel_cost meters plus
+// analysis_cost per scene. With a depth of one this is the belief/distance
+// ratio the planner used to rank scenes by.
+//
+// travel_from_robot holds the travel costs from the robot's position; the costs
+// between scenes come from the oracle. If order isn't NULL it gets the best
+// sequence. Returns -1 if there are no scenes.
+int selectSceneLookahead(const std::vector<float> &belief, const std::vector<float> &travel_from_robot,
+                         TravelCostOracle &oracle, float analysis_cost, int depth,
+                         const DetectionModel &model = DetectionModel(), std::vector<int> *order = NULL);
+
+#endif
@@ -2,7 +2,6 @@
 
 #include <geometry_msgs/Twist.h> 
 #include <nav_msgs/Path.h>
-#include <nav_msgs/GetPlan.h>
 
 #include <tf/LinearMath/Matrix3x3.h>
 #include <tf/LinearMath/Transform.h>
@@ -11,6 +10,7 @@
 
 #include "SearchPlanner.h"
 
+#include <cmath>
 #include <fstream>
 
 #define SCENE_ANALYZATION_COST (60)
@@ -116,8 +116,6 @@ SearchPlanner::SearchPlanner(ros::NodeHandle *node_handle, std::string path_to_y
 
     belief = std::vector<float> (yaml_positions.size(), 1.0/yaml_positions.size()); 
 
-    client_make_plan = nh->serviceClient <nav_msgs::GetPlan> ("move_base/GlobalPlanner/make_plan"); 
-
     pub_simple_goal = nh->advertise<geometry_msgs::PoseStamped>("/move_base_interruptable_simple/goal", 100);
 
     sub_amcl_pose = nh->subscribe("amcl_pose", 100, callbackCurrPos); 
@@ -141,51 +139,70 @@ SearchPlanner::SearchPlanner(ros::NodeHandle *node_handle, std::string path_to_y
 
     }        
 
+    ros::param::param <int> ("~lookahead_depth", lookahead_depth, 3); 
+
+    std::string map_topic; 
+    ros::param::param <std::string> ("~map_topic", map_topic, "level_mux/map"); 
+    sub_map = nh->subscribe(map_topic, 1, &SearchPlanner::callbackMap, this); 
+
     busy = false; 
     setTargetDetection(false); 
     ros::spinOnce(); 
 }
 
-geometry_msgs::PoseStamped SearchPlanner::selectNextScene(const std::vector<float> &belief, int &next_goal_index) {
+void SearchPlanner::callbackMap(const nav_msgs::OccupancyGrid::ConstPtr& msg) {
 
-    geometry_msgs::PoseStamped nextScene; 
+    TravelGrid grid; 
+    grid.width = msg->info.width; 
+    grid.height = msg->info.height; 
+    grid.resolution = msg->info.resolution; 
+    grid.origin_x = msg->info.origin.position.x; 
+    grid.origin_y = msg->info.origin.position.y; 
+    grid.data = msg->data; 
 
-    nav_msgs::GetPlan srv; 
+    std::vector<ScenePoint> scenes; 
+    for (unsigned i=0; i<positions.size(); i++)
+        scenes.push_back(ScenePoint(positions[i].pose.position.x, positions[i].pose.position.y)); 
 
-    std::vector<float> distances(belief.size(), 0.0); 
-    std::vector<float> fitness(belief.size(), 0.0); 
-    
-    for (unsigned i=0; i<positions.size(); i++) {
+    boost::shared_ptr<TravelCostOracle> new_oracle(new TravelCostOracle(grid, scenes, tolerance)); 
 
-        srv.request.tolerance = tolerance; 
-        srv.request.start.header.frame_id = "level_mux_map"; 
-        srv.request.start.pose.position.x = curr_position.pose.pose.position.x; 
-        srv.request.start.pose.position.y = curr_position.pose.pose.position.y; 
+    boost::mutex::scoped_lock lock(oracle_mutex); 
+    oracle = new_oracle; 
+}
 
-        srv.request.goal.header.frame_id = "level_mux_map"; 
-        srv.request.goal.pose.position.x = positions[i].pose.position.x; 
-        srv.request.goal.pose.position.y = positions[i].pose.position.y; 
-    
-        client_make_plan.waitForExistence();
-        if (false == client_make_plan.call(srv))
-            ROS_ERROR("Failed in calling service for making a path"); 
-    
-        distances[i] = srv.response.plan.poses.size();
-    }
-    
-    next_goal_index = -1; 
-    float max_value = -1.0; 
+geometry_msgs::PoseStamped SearchPlanner::selectNextScene(const std::vector<float> &belief, int &next_goal_index) {
 
-    float resolution;
-    ros::param::param <float> ("/move_base/local_costmap/resolution", resolution, 0.05); 
-    
-    for (unsigned i=0; i<positions.size(); i++) {
-        
-        fitness[i] = belief[i] / (distances[i]*resolution + SCENE_ANALYZATION_COST); 
-        next_goal_index = (fitness[i] >= max_value) ? i : next_goal_index; 
-        max_value = (fitness[i] >= max_value) ? fitness[i] : max_value;
+    geometry_msgs::PoseStamped nextScene; 
+
+    ScenePoint robot(curr_position.pose.pose.position.x, curr_position.pose.pose.position.y); 
+    std::vector<float> distances; 
+
+    boost::mutex::scoped_lock lock(oracle_mutex); 
+
+    if (oracle)
+        distances = oracle->costsFrom(robot); 
+
+    bool reachable = false; 
+    for (unsigned i=0; i<distances.size(); i++)
+        reachable = reachable or !std::isinf(distances[i]); 
+
+    if (reachable) {
+        next_goal_index = selectSceneLookahead(belief, distances, *oracle, SCENE_ANALYZATION_COST, 
+                                               lookahead_depth, detection_model); 
+    } else {
+        // without a map, or off of it, rank scenes by their straight line distance alone
+        ROS_WARN("No path to any scene on the static map, using straight line distances"); 
+        std::vector<ScenePoint> scenes; 
+        distances.clear(); 
+        for (unsigned i=0; i<positions.size(); i++) {
+            scenes.push_back(ScenePoint(positions[i].pose.position.x, positions[i].pose.position.y)); 
+            distances.push_back(hypot(scenes[i].x - robot.x, scenes[i].y - robot.y)); 
+        }
+        TravelCostOracle no_map(TravelGrid(), scenes, tolerance); 
+        next_goal_index = selectSceneLookahead(belief, distances, no_map, SCENE_ANALYZATION_COST, 1, 
+                                               detection_model); 
     }
-    
+
     nextScene = positions[next_goal_index]; 
     nextScene.header.frame_id = "level_mux_map";
     return nextScene; 
@@ -247,31 +264,5 @@ void SearchPlanner::analyzeScene(float angle, float angular_vel) {
 
 void SearchPlanner::updateBelief(int next_goal_index) {
     
-    float true_positive_rate, true_negative_rate;
-    true_positive_rate = true_negative_rate = 0.95; 
-
-    std::vector <float> tmp_belief (belief); 
-
-    // if (detected)
-    //     tmp_belief[next_goal_index] = tmp_belief[next_goal_index] * true_positive_rate / 
-    //         ((tmp_belief[next_goal_index] * true_positive_rate) + 
-    //          ((1.0 - tmp_belief[next_goal_index]) * (1.0 - true_negative_rate))); 
-    // else
-    //     tmp_belief[next_goal_index] = tmp_belief[next_goal_index] * (1.0 - true_positive_rate) / 
-    //         ((tmp_belief[next_goal_index] * (1.0 - true_positive_rate)) + 
-    //          ((1.0 - tmp_belief[next_goal_index]) * true_negative_rate)); 
-
-    tmp_belief[next_goal_index] = tmp_belief[next_goal_index] * 
-                                  (1.0 - true_positive_rate) / 
-                                  ( (tmp_belief[next_goal_index] * (1.0 - true_positive_rate)) + 
-                                    ((1.0 - tmp_belief[next_goal_index]) * true_negative_rate)
-                                  ); 
-    float normalizer = 0.0; 
-
-    for (int i = 0; i < tmp_belief.size(); i++)
-        normalizer += tmp_belief[i]; 
-
-    for (int i = 0; i < tmp_belief.size(); i++)
-        belief[i]  = tmp_belief[i] / normalizer; 
+    updateBeliefAfterMiss(belief, next_goal_index, detection_model); 
 }
-
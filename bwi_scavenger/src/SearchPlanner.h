@@ -13,8 +13,13 @@
 #include <move_base_msgs/MoveBaseAction.h>
 #include <actionlib/client/simple_action_client.h>
 #include <actionlib/client/terminal_state.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include "plan_execution/ExecutePlanAction.h"
+#include "SceneOrdering.h"
+#include "TravelCostOracle.h"
 
 #define PI (3.1415926)
 typedef actionlib::SimpleActionClient<plan_execution::ExecutePlanAction> KrClient;
@@ -53,9 +58,9 @@ public:
     std::vector<geometry_msgs::PoseStamped> positions; 
     std::vector<float> belief;
 
-    ros::ServiceClient client_make_plan;
     ros::Publisher pub_simple_goal; 
     ros::Subscriber sub_amcl_pose; 
+    ros::Subscriber sub_map; 
 
     // ros::NodeHandle *nh;
 
@@ -64,6 +69,10 @@ public:
     bool targetDetected; 
     float tolerance; 
 
+    // number of scene visits looked at when choosing the next scene
+    int lookahead_depth; 
+    DetectionModel detection_model; 
+
     void setTargetDetection(bool detected) {
         targetDetected = detected; 
     }
@@ -76,6 +85,14 @@ public:
     void analyzeScene(float angle, float angular_vel); 
     void updateBelief(int ); 
 
+private: 
+
+    // rebuilds the travel cost oracle, dropping its cached costs, whenever the static map changes
+    void callbackMap(const nav_msgs::OccupancyGrid::ConstPtr& msg); 
+
+    boost::shared_ptr<TravelCostOracle> oracle; 
+    boost::mutex oracle_mutex; 
+
 }; 
 
 #endif
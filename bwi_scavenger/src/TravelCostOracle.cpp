@@ -0,0 +1,144 @@
+
+#include "TravelCostOracle.h"
+
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+TravelCostOracle::TravelCostOracle(const TravelGrid &grid, const std::vector<ScenePoint> &scenes,
+                                   float snap_radius, int occupied_threshold) :
+        grid(grid), scenes(scenes), occupied_threshold(occupied_threshold), wavefronts(0) {
+
+    snap_cells = (grid.resolution > 0.0) ? (int) std::ceil(snap_radius / grid.resolution) : 0;
+
+    scene_cells.resize(scenes.size());
+    for (unsigned i = 0; i < scenes.size(); i++)
+        scene_cells[i] = freeCellNear(scenes[i]);
+
+    scene_costs.resize(scenes.size());
+    scene_costs_known.resize(scenes.size(), false);
+}
+
+bool TravelCostOracle::isFree(int x, int y) const {
+
+    if (x < 0 or y < 0 or x >= grid.width or y >= grid.height)
+        return false;
+    int value = grid.data[y * grid.width + x];
+    return value >= 0 and value < occupied_threshold;
+}
+
+int TravelCostOracle::freeCellNear(const ScenePoint &p) const {
+
+    if (grid.width <= 0 or grid.height <= 0)
+        return -1;
+
+    int cx = (int) std::floor((p.x - grid.origin_x) / grid.resolution);
+    int cy = (int) std::floor((p.y - grid.origin_y) / grid.resolution);
+    if (isFree(cx, cy))
+        return cy * grid.width + cx;
+
+    int best = -1;
+    int best_distance = std::numeric_limits<int>::max();
+    for (int dy = -snap_cells; dy <= snap_cells; dy++) {
+        for (int dx = -snap_cells; dx <= snap_cells; dx++) {
+            int d = dx * dx + dy * dy;
+            if (d > snap_cells * snap_cells or d >= best_distance or !isFree(cx + dx, cy + dy))
+                continue;
+            best = (cy + dy) * grid.width + (cx + dx);
+            best_distance = d;
+        }
+    }
+    return best;
+}
+
+void TravelCostOracle::wavefront(int start_cell, std::vector<float> &costs) {
+
+    const float unreachable = std::numeric_limits<float>::infinity();
+    costs.assign(scenes.size(), unreachable);
+    wavefronts++;
+
+    if (start_cell < 0)
+        return;
+
+    // cells that have to be settled before the wavefront can stop
+    if (target_count.size() != grid.data.size())
+        target_count.assign(grid.data.size(), 0);
+    int remaining = 0;
+    for (unsigned i = 0; i < scene_cells.size(); i++) {
+        if (scene_cells[i] >= 0 and target_count[scene_cells[i]]++ == 0)
+            remaining++;
+    }
+
+    distance.assign(grid.data.size(), unreachable);
+
+    typedef std::pair<float, int> Entry;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > open;
+    distance[start_cell] = 0.0;
+    open.push(Entry(0.0, start_cell));
+
+    static const int dxs[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+    static const int dys[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+    const float diagonal = std::sqrt(2.0f);
+
+    while (!open.empty() and remaining > 0) {
+
+        Entry top = open.top();
+        open.pop();
+        int cell = top.second;
+        if (top.first > distance[cell])
+            continue;
+
+        if (target_count[cell] > 0) {
+            target_count[cell] = 0;
+            remaining--;
+        }
+
+        int x = cell % grid.width;
+        int y = cell / grid.width;
+        for (int k = 0; k < 8; k++) {
+            int nx = x + dxs[k];
+            int ny = y + dys[k];
+            if (!isFree(nx, ny))
+                continue;
+            // don't cut corners around obstacles
+            if (k >= 4 and (!isFree(x + dxs[k], y) or !isFree(x, y + dys[k])))
+                continue;
+            int next = ny * grid.width + nx;
+            float d = top.first + ((k < 4) ? 1.0f : diagonal);
+            if (d < distance[next]) {
+                distance[next] = d;
+                open.push(Entry(d, next));
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < scene_cells.size(); i++) {
+        if (scene_cells[i] >= 0) {
+            target_count[scene_cells[i]] = 0;
+            costs[i] = distance[scene_cells[i]] * grid.resolution;
+        }
+    }
+}
+
+std::vector<float> TravelCostOracle::costsFrom(const ScenePoint &start) {
+
+    std::vector<float> costs;
+    wavefront(freeCellNear(start), costs);
+    return costs;
+}
+
+const std::vector<float> &TravelCostOracle::sceneCosts(int from) {
+
+    if (!scene_costs_known[from]) {
+        wavefront(scene_cells[from], scene_costs[from]);
+        scene_costs_known[from] = true;
+    }
+    return scene_costs[from];
+}
+
+float TravelCostOracle::sceneCost(int from, int to) {
+
+    return sceneCosts(from)[to];
+}
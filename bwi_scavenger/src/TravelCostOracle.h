@@ -0,0 +1,84 @@
+#ifndef TRAVELCOSTORACLE_H
+#define TRAVELCOSTORACLE_H
+
+#include <stdint.h>
+#include <vector>
+
+// A static occupancy grid in the layout of nav_msgs/OccupancyGrid: row-major,
+// cell (0, 0) at the origin, values 0-100 or -1 for unknown.
+struct TravelGrid {
+
+    TravelGrid() : width(0), height(0), resolution(0.05), origin_x(0.0), origin_y(0.0) {}
+
+    int width;
+    int height;
+    float resolution;
+    float origin_x;
+    float origin_y;
+    std::vector<int8_t> data;
+};
+
+struct ScenePoint {
+
+    ScenePoint() : x(0.0), y(0.0) {}
+    ScenePoint(float x, float y) : x(x), y(y) {}
+
+    float x;
+    float y;
+};
+
+// Answers "how far is it to every scene" from the static map instead of asking
+// the global planner once per scene. Each question is one wavefront (8-connected
+// Dijkstra) that stops as soon as the last scene cell is settled. Scene-to-scene
+// costs never change for a given map, so each row is computed once and kept.
+//
+// Costs are path lengths in meters; scenes that can't be reached cost infinity.
+class TravelCostOracle {
+
+public:
+
+    // Points that fall on an occupied cell, e.g. a scene pose that is right next
+    // to a wall, are moved to the closest free cell within snap_radius meters.
+    // Cells at or above occupied_threshold and unknown cells are not traversable.
+    TravelCostOracle(const TravelGrid &grid, const std::vector<ScenePoint> &scenes,
+                     float snap_radius, int occupied_threshold = 50);
+
+    // travel cost from a point to every scene, with one wavefront
+    std::vector<float> costsFrom(const ScenePoint &start);
+
+    // travel cost between two scenes, computing the row of "from" on first use
+    float sceneCost(int from, int to);
+
+    const std::vector<float> &sceneCosts(int from);
+
+    int numScenes() const { return scenes.size(); }
+
+    // number of wavefronts run so far
+    int getWavefronts() const { return wavefronts; }
+
+private:
+
+    // index of the closest free cell to p, or -1 if there is none within snap range
+    int freeCellNear(const ScenePoint &p) const;
+
+    bool isFree(int x, int y) const;
+
+    void wavefront(int start_cell, std::vector<float> &costs);
+
+    TravelGrid grid;
+    std::vector<ScenePoint> scenes;
+    std::vector<int> scene_cells;
+    int snap_cells;
+    int occupied_threshold;
+
+    std::vector<std::vector<float> > scene_costs;
+    std::vector<char> scene_costs_known;
+
+    // scratch space for the wavefront, kept between calls to save reallocating a map-sized buffer
+    std::vector<float> distance;
+    std::vector<int> target_count;
+
+    int wavefronts;
+};
+
+#endif
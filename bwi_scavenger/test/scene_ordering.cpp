@@ -0,0 +1,273 @@
+#include "../src/SceneOrdering.h"
+#include "../src/TravelCostOracle.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+// an empty w x h map with 0.5m cells and its origin at (0, 0)
+TravelGrid emptyGrid(int w, int h) {
+  TravelGrid grid;
+  grid.width = w;
+  grid.height = h;
+  grid.resolution = 0.5;
+  grid.data.assign(w * h, 0);
+  return grid;
+}
+
+// marks the cells from (x0, y0) to (x1, y1), both included, as occupied
+void wall(TravelGrid &grid, int x0, int y0, int x1, int y1) {
+  for (int y = y0; y <= y1; ++y) {
+    for (int x = x0; x <= x1; ++x) {
+      grid.data[y * grid.width + x] = 100;
+    }
+  }
+}
+
+// center of a cell in map coordinates
+ScenePoint cell(const TravelGrid &grid, int x, int y) {
+  return ScenePoint((x + 0.5) * grid.resolution, (y + 0.5) * grid.resolution);
+}
+
+// Searches without ever finding the target: moves to the chosen scene, misses,
+// and chooses again from there. Returns the scenes in the order they were visited.
+std::vector<int> visitOrder(TravelCostOracle &oracle, const ScenePoint &start, std::vector<float> belief,
+                            float analysis_cost, int depth, int visits) {
+  std::vector<int> order;
+  std::vector<float> travel = oracle.costsFrom(start);
+  for (int i = 0; i < visits; ++i) {
+    int next = selectSceneLookahead(belief, travel, oracle, analysis_cost, depth);
+    order.push_back(next);
+    updateBeliefAfterMiss(belief, next, DetectionModel());
+    travel = oracle.sceneCosts(next);
+  }
+  return order;
+}
+
+std::vector<int> sequence(int a, int b, int c, int d = -1) {
+  std::vector<int> s;
+  s.push_back(a);
+  s.push_back(b);
+  s.push_back(c);
+  if (d >= 0) {
+    s.push_back(d);
+  }
+  return s;
+}
+
+}
+
+TEST(TravelCostOracle, CostsAreGridPathLengths) {
+  TravelGrid grid = emptyGrid(40, 10);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 10, 2));
+  scenes.push_back(cell(grid, 2, 5));
+  scenes.push_back(cell(grid, 2, 2));
+  TravelCostOracle oracle(grid, scenes, 0.5);
+
+  std::vector<float> costs = oracle.costsFrom(cell(grid, 2, 2));
+  ASSERT_EQ(3u, costs.size());
+  EXPECT_FLOAT_EQ(4.0, costs[0]);
+  EXPECT_FLOAT_EQ(1.5, costs[1]);
+  EXPECT_FLOAT_EQ(0.0, costs[2]);
+  // diagonal steps
+  EXPECT_NEAR(0.5 * (5 + 3 * std::sqrt(2.0)), oracle.sceneCost(0, 1), 1e-4);
+  EXPECT_EQ(2, oracle.getWavefronts());
+}
+
+TEST(TravelCostOracle, WallsAreWalkedAround) {
+  TravelGrid grid = emptyGrid(20, 20);
+  // a wall across the map with a gap at the top
+  wall(grid, 10, 0, 10, 16);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 12, 2));
+  TravelCostOracle oracle(grid, scenes, 0.0);
+
+  // up to the gap and back down
+  EXPECT_GT(oracle.costsFrom(cell(grid, 8, 2))[0], 0.5 * 2 * 15);
+}
+
+TEST(TravelCostOracle, EnclosedScenesAreUnreachable) {
+  TravelGrid grid = emptyGrid(20, 20);
+  wall(grid, 10, 10, 14, 10);
+  wall(grid, 10, 14, 14, 14);
+  wall(grid, 10, 10, 10, 14);
+  wall(grid, 14, 10, 14, 14);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 12, 12));
+  scenes.push_back(cell(grid, 2, 2));
+  TravelCostOracle oracle(grid, scenes, 0.0);
+
+  std::vector<float> costs = oracle.costsFrom(cell(grid, 0, 0));
+  EXPECT_TRUE(std::isinf(costs[0]));
+  EXPECT_NEAR(0.5 * 2 * std::sqrt(2.0), costs[1], 1e-4);
+  // and off the map, nothing is
+  costs = oracle.costsFrom(ScenePoint(-10.0, -10.0));
+  EXPECT_TRUE(std::isinf(costs[0]));
+  EXPECT_TRUE(std::isinf(costs[1]));
+}
+
+TEST(TravelCostOracle, ScenesOnObstaclesAreSnappedToFreeSpace) {
+  TravelGrid grid = emptyGrid(20, 5);
+  wall(grid, 10, 0, 11, 4);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 10, 2));
+  TravelCostOracle near(grid, scenes, 0.5);
+  EXPECT_FLOAT_EQ(0.5 * 7, near.costsFrom(cell(grid, 2, 2))[0]);
+  // too far from free space to be snapped
+  scenes[0] = cell(grid, 11, 2);
+  TravelCostOracle far(grid, scenes, 0.0);
+  EXPECT_TRUE(std::isinf(far.costsFrom(cell(grid, 2, 2))[0]));
+}
+
+TEST(TravelCostOracle, SceneCostsAreComputedOncePerScene) {
+  TravelGrid grid = emptyGrid(30, 30);
+  std::vector<ScenePoint> scenes;
+  for (int i = 0; i < 5; ++i) {
+    scenes.push_back(cell(grid, 5 * i, 3 * i));
+  }
+  TravelCostOracle oracle(grid, scenes, 0.0);
+  std::vector<float> belief(5, 0.2);
+  std::vector<float> travel = oracle.costsFrom(cell(grid, 0, 29));
+  EXPECT_EQ(1, oracle.getWavefronts());
+
+  selectSceneLookahead(belief, travel, oracle, 5.0, 3);
+  EXPECT_EQ(6, oracle.getWavefronts());
+  selectSceneLookahead(belief, travel, oracle, 5.0, 3);
+  EXPECT_EQ(6, oracle.getWavefronts());
+
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 5; ++j) {
+      EXPECT_NEAR(oracle.sceneCost(i, j), oracle.sceneCost(j, i), 1e-4);
+    }
+  }
+}
+
+TEST(SceneOrdering, BeliefUpdateMatchesTheSearchPlanner) {
+  std::vector<float> belief(4, 0.25);
+  updateBeliefAfterMiss(belief, 1, DetectionModel());
+  // the searched scene drops to 0.25 * 0.05 / (0.25 * 0.05 + 0.75 * 0.95), the others keep their ratios
+  float searched = 0.25 * 0.05 / (0.25 * 0.05 + 0.75 * 0.95);
+  float normalizer = searched + 0.75;
+  EXPECT_NEAR(searched / normalizer, belief[1], 1e-6);
+  EXPECT_NEAR(0.25 / normalizer, belief[0], 1e-6);
+  EXPECT_NEAR(belief[0], belief[2], 1e-6);
+  EXPECT_NEAR(1.0, belief[0] + belief[1] + belief[2] + belief[3], 1e-6);
+}
+
+TEST(SceneOrdering, DepthOneIsTheBeliefDistanceRatio) {
+  TravelGrid grid = emptyGrid(60, 60);
+  std::vector<ScenePoint> scenes;
+  srand(7);
+  for (int i = 0; i < 8; ++i) {
+    scenes.push_back(cell(grid, rand() % 60, rand() % 60));
+  }
+  TravelCostOracle oracle(grid, scenes, 0.0);
+
+  for (int trial = 0; trial < 50; ++trial) {
+    std::vector<float> belief(scenes.size());
+    float sum = 0.0;
+    for (size_t i = 0; i < belief.size(); ++i) {
+      belief[i] = (rand() % 100 + 1) / 100.0;
+      sum += belief[i];
+    }
+    for (size_t i = 0; i < belief.size(); ++i) {
+      belief[i] /= sum;
+    }
+    std::vector<float> travel = oracle.costsFrom(cell(grid, rand() % 60, rand() % 60));
+
+    int expected = -1;
+    float max_value = -1.0;
+    for (size_t i = 0; i < belief.size(); ++i) {
+      float fitness = belief[i] / (travel[i] + 60);
+      expected = (fitness >= max_value) ? i : expected;
+      max_value = (fitness >= max_value) ? fitness : max_value;
+    }
+    EXPECT_EQ(expected, selectSceneLookahead(belief, travel, oracle, 60, 1));
+  }
+}
+
+TEST(SceneOrdering, UniformBeliefSweepsDownTheCorridor) {
+  TravelGrid grid = emptyGrid(80, 4);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 60, 2));
+  scenes.push_back(cell(grid, 20, 2));
+  scenes.push_back(cell(grid, 75, 2));
+  scenes.push_back(cell(grid, 40, 2));
+  TravelCostOracle oracle(grid, scenes, 0.0);
+  std::vector<float> belief(4, 0.25);
+
+  for (int depth = 1; depth <= 3; ++depth) {
+    EXPECT_EQ(sequence(1, 3, 0, 2), visitOrder(oracle, cell(grid, 0, 2), belief, 5.0, depth, 4))
+        << "depth " << depth;
+  }
+}
+
+TEST(SceneOrdering, UnlikelyScenesOnTheWayAreSearchedFirst) {
+  TravelGrid grid = emptyGrid(80, 4);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 10, 2));
+  scenes.push_back(cell(grid, 70, 2));
+  std::vector<float> belief;
+  belief.push_back(0.1);
+  belief.push_back(0.9);
+  TravelCostOracle oracle(grid, scenes, 0.0);
+
+  std::vector<float> travel = oracle.costsFrom(cell(grid, 0, 2));
+
+  // greedily, the likely scene is worth the longer walk
+  EXPECT_EQ(1, selectSceneLookahead(belief, travel, oracle, 5.0, 1));
+  // but the other one is passed on the way there
+  std::vector<int> order;
+  EXPECT_EQ(0, selectSceneLookahead(belief, travel, oracle, 5.0, 2, DetectionModel(), &order));
+  ASSERT_EQ(2u, order.size());
+  EXPECT_EQ(0, order[0]);
+  EXPECT_EQ(1, order[1]);
+}
+
+TEST(SceneOrdering, LookaheadFinishesAClusterBeforeCrossingBack) {
+  // the robot is in the middle of a corridor, with one scene a little to the
+  // left and two next to each other a little further to the right
+  TravelGrid grid = emptyGrid(200, 4);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 60, 2));
+  scenes.push_back(cell(grid, 150, 2));
+  scenes.push_back(cell(grid, 154, 2));
+  TravelCostOracle oracle(grid, scenes, 0.0);
+  std::vector<float> belief(3, 1.0 / 3);
+  ScenePoint start = cell(grid, 100, 2);
+
+  // greedily, the closest scene comes first, and then the robot has to cross the corridor
+  EXPECT_EQ(sequence(0, 1, 2), visitOrder(oracle, start, belief, 5.0, 1, 3));
+  // looking ahead, the two scenes on the right are covered first
+  std::vector<int> order;
+  EXPECT_EQ(1, selectSceneLookahead(belief, oracle.costsFrom(start), oracle, 5.0, 3, DetectionModel(), &order));
+  EXPECT_EQ(sequence(1, 2, 0), order);
+  EXPECT_EQ(2, visitOrder(oracle, start, belief, 5.0, 3, 2).back());
+}
+
+TEST(SceneOrdering, UnreachableScenesAreNotChosen) {
+  TravelGrid grid = emptyGrid(20, 20);
+  wall(grid, 10, 0, 10, 19);
+  std::vector<ScenePoint> scenes;
+  scenes.push_back(cell(grid, 5, 5));
+  scenes.push_back(cell(grid, 15, 5));
+  TravelCostOracle oracle(grid, scenes, 0.0);
+  std::vector<float> belief;
+  belief.push_back(0.01);
+  belief.push_back(0.99);
+
+  std::vector<int> order;
+  EXPECT_EQ(0, selectSceneLookahead(belief, oracle.costsFrom(cell(grid, 2, 2)), oracle, 5.0, 3,
+                                    DetectionModel(), &order));
+  EXPECT_EQ(sequence(0, 0, 0), order);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
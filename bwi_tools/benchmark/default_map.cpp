@@ -0,0 +1,39 @@
+#include <bwi_tools/common/DefaultMap.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <map>
+
+// Value function style updates on every DefaultMap backend.
+template <class Storage>
+static double benchmark(const char *name, int states, int updates) {
+  DefaultMap<int,double,Storage> values(0.0);
+  values.reserve(states);
+  boost::random::mt19937 rng(1);
+  boost::random::uniform_int_distribution<int> state(0, states - 1);
+  clock_t start = clock();
+  for (int i = 0; i < updates; ++i)
+    values[state(rng)] += 0.1 * (1.0 - values.get(state(rng)));
+  values.scale(0.9);
+  double seconds = double(clock() - start) / CLOCKS_PER_SEC;
+  std::cout << name << ": " << 1e9 * seconds / updates << " ns per update" << std::endl;
+  return seconds;
+}
+
+// Usage: benchmark_default_map [states] [updates]
+int main(int argc, char **argv) {
+  int states = (argc > 1) ? atoi(argv[1]) : 100000;
+  int updates = (argc > 2) ? atoi(argv[2]) : 5000000;
+  if (states < 1 || updates < 1) {
+    std::cerr << "usage: " << argv[0] << " [states] [updates]" << std::endl;
+    return 1;
+  }
+
+  benchmark<std::map<int,double> >("std::map", states, updates);
+  benchmark<boost::unordered_map<int,double> >("boost::unordered_map", states, updates);
+  benchmark<FlatHashMap<int,double> >("FlatHashMap", states, updates);
+  return 0;
+}
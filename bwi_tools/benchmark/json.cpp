@@ -0,0 +1,52 @@
+#include <bwi_tools/json/json.h>
+
+#include "../test/json_document_generator.h"
+
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+
+// Compares Reader against both FastReader entry points on a large generated document.
+// Usage: benchmark_json [elements] [repetitions]
+int main(int argc, char **argv) {
+  int elements = (argc > 1) ? atoi(argv[1]) : 2000;
+  int repetitions = (argc > 2) ? atoi(argv[2]) : 20;
+  if (elements < 1 || repetitions < 1) {
+    std::cerr << "usage: " << argv[0] << " [elements] [repetitions]" << std::endl;
+    return 1;
+  }
+
+  DocumentGenerator generator(1);
+  std::string text = "[";
+  for (int i = 0; i < elements; ++i) {
+    text += (i > 0 ? "," : "") + generator.generate(6);
+  }
+  text += "]";
+
+  clock_t start = clock();
+  for (int i = 0; i < repetitions; ++i) {
+    Json::Value value;
+    Json::Reader().parse(text, value, false);
+  }
+  double readerSeconds = double(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int i = 0; i < repetitions; ++i) {
+    Json::Document document;
+    Json::FastReader().parse(text, document);
+  }
+  double documentSeconds = double(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int i = 0; i < repetitions; ++i) {
+    Json::Value value;
+    Json::FastReader().parse(text.data(), text.data() + text.size(), value);
+  }
+  double valueSeconds = double(clock() - start) / CLOCKS_PER_SEC;
+
+  std::cout << text.size() / 1024 << " KiB, per parse: Reader " << 1000 * readerSeconds / repetitions
+            << " ms, FastReader to Document " << 1000 * documentSeconds / repetitions
+            << " ms, FastReader to Value " << 1000 * valueSeconds / repetitions << " ms" << std::endl;
+  return 0;
+}
@@ -0,0 +1,68 @@
+#include <bwi_tools/record_writer.h>
+
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using std::string;
+using std::vector;
+using bwi_tools::RecordStreamWriter;
+
+// Writes rows through both RecordStreamWriter entry points and reports their throughput.
+// Usage: benchmark_record_writer [rows]
+int main(int argc, char **argv) {
+  int rows = (argc > 1) ? atoi(argv[1]) : 2000000;
+  if (rows < 1) {
+    std::cerr << "usage: " << argv[0] << " [rows]" << std::endl;
+    return 1;
+  }
+
+  vector<string> columns;
+  columns.push_back("episode");
+  columns.push_back("reward");
+  columns.push_back("steps");
+
+  char filename[] = "/tmp/bwi_tools_records_XXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0) {
+    std::cerr << "could not create a temporary file" << std::endl;
+    return 1;
+  }
+  close(fd);
+
+  RecordStreamWriter::Record r;
+  vector<string> values(3);
+  clock_t start = clock();
+  {
+    RecordStreamWriter writer(filename, RecordStreamWriter::CSV, columns);
+    for (int i = 0; i < rows; ++i) {
+      r["episode"] = boost::lexical_cast<string>(i);
+      r["reward"] = "0.5";
+      r["steps"] = "42";
+      writer.write(r);
+    }
+  }
+  double record_seconds = double(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  {
+    RecordStreamWriter writer(filename, RecordStreamWriter::CSV, columns);
+    for (int i = 0; i < rows; ++i) {
+      values[0] = boost::lexical_cast<string>(i);
+      values[1] = "0.5";
+      values[2] = "42";
+      writer.writeRow(values);
+    }
+  }
+  double row_seconds = double(clock() - start) / CLOCKS_PER_SEC;
+  remove(filename);
+
+  std::cout << rows << " rows: write " << rows / record_seconds << " rows/s, writeRow "
+            << rows / row_seconds << " rows/s" << std::endl;
+  return 0;
+}
@@ -5,38 +5,56 @@
 File: DefaultMap.h
 Author: Samuel Barrett
 Description: a map that returns a default value without inserting when get is called.
+  The storage is a template parameter: std::map (the default), boost::unordered_map or FlatHashMap.
 Created:  2011-08-23
 Modified: 2011-12-13
 */
 
 //#define DEFAULTMAP_USE_BOOST
 
-#ifdef DEFAULTMAP_USE_BOOST
 #include <boost/unordered_map.hpp>
-#else
 #include <map>
-#endif
 
-template <class Key, class T>
-class DefaultMap {
-public:
+#include <bwi_tools/common/FlatHashMap.h>
+
+// How to reserve room in each kind of storage; std::map can't
+template <class Storage>
+struct DefaultMapStorage {
+  static void reserve(Storage &, size_t) {}
+};
+
+template <class Key, class T, class Hash, class Pred, class Alloc>
+struct DefaultMapStorage<boost::unordered_map<Key,T,Hash,Pred,Alloc> > {
+  static void reserve(boost::unordered_map<Key,T,Hash,Pred,Alloc> &vals, size_t count) {
+    vals.rehash(count / vals.max_load_factor() + 1);
+  }
+};
+
+template <class Key, class T, class Hash, class Pred>
+struct DefaultMapStorage<FlatHashMap<Key,T,Hash,Pred> > {
+  static void reserve(FlatHashMap<Key,T,Hash,Pred> &vals, size_t count) {
+    vals.reserve(count);
+  }
+};
+
 #ifdef DEFAULTMAP_USE_BOOST
-  typedef typename boost::unordered_map<Key,T>::const_iterator const_iterator;
-  typedef typename boost::unordered_map<Key,T>::iterator iterator;
+#define DEFAULTMAP_STORAGE boost::unordered_map<Key,T>
 #else
-  typedef typename std::map<Key,T>::const_iterator const_iterator;
-  typedef typename std::map<Key,T>::iterator iterator;
+#define DEFAULTMAP_STORAGE std::map<Key,T>
 #endif
+
+template <class Key, class T, class Storage = DEFAULTMAP_STORAGE>
+class DefaultMap {
+public:
+  typedef typename Storage::const_iterator const_iterator;
+  typedef typename Storage::iterator iterator;
+
   DefaultMap(T defaultValue):
     defaultValue(defaultValue)
   {}
 
   T get(const Key &key) const {
-#ifdef DEFAULTMAP_USE_BOOST
-    typename boost::unordered_map<Key,T>::const_iterator it = vals.find(key);
-#else
-    typename std::map<Key,T>::const_iterator it = vals.find(key);
-#endif
+    const_iterator it = vals.find(key);
     if (it == vals.end())
       return defaultValue;
     else
@@ -44,13 +62,12 @@ public:
   }
 
   T& operator[](const Key &key) {
-    if (vals.count(key) == 0)
-      vals[key] = defaultValue;
-    return vals[key];
+    // a single lookup, that only inserts the default if the key is missing
+    return vals.insert(std::make_pair(key, defaultValue)).first->second;
   }
 
   void set(const Key &key, const T &val) {
-    vals[key] = val;
+    (*this)[key] = val;
   }
 
   void clear() {
@@ -65,33 +82,62 @@ public:
     return vals.erase(key);
   }
 
-  unsigned int size() {
+  unsigned int size() const {
     return vals.size();
   }
 
+  // Makes room for count entries up front, for the storage kinds that can
+  void reserve(size_t count) {
+    DefaultMapStorage<Storage>::reserve(vals, count);
+  }
+
+  // Copies every entry of other, replacing the value of keys already present
+  template <class OtherStorage>
+  void merge(const DefaultMap<Key,T,OtherStorage> &other) {
+    reserve(size() + other.size());
+    for (typename DefaultMap<Key,T,OtherStorage>::const_iterator it = other.begin(); it != other.end(); ++it)
+      (*this)[it->first] = it->second;
+  }
+
+  // Combines every entry of other into this map: value = combine(value, other value), where a missing
+  // value is the default. For instance std::plus<T>() to add up two value functions.
+  template <class OtherStorage, class Combine>
+  void merge(const DefaultMap<Key,T,OtherStorage> &other, Combine combine) {
+    reserve(size() + other.size());
+    for (typename DefaultMap<Key,T,OtherStorage>::const_iterator it = other.begin(); it != other.end(); ++it) {
+      T &val = (*this)[it->first];
+      val = combine(val, it->second);
+    }
+  }
+
+  // Multiplies every stored value by factor. The default value is left as it is.
+  template <class Factor>
+  void scale(const Factor &factor) {
+    for (iterator it = vals.begin(); it != vals.end(); ++it)
+      it->second *= factor;
+  }
+
   const_iterator begin() const {
     return vals.begin();
   }
-  
+
   iterator begin() {
     return vals.begin();
   }
-  
+
   const_iterator end() const {
     return vals.end();
   }
-  
+
   iterator end() {
     return vals.end();
   }
 
 private:
-#ifdef DEFAULTMAP_USE_BOOST
-  boost::unordered_map<Key,T> vals;
-#else
-  std::map<Key,T> vals;
-#endif
+  Storage vals;
   const T defaultValue;
 };
 
+#undef DEFAULTMAP_STORAGE
+
 #endif /* end of include guard: DEFAULTMAP_E8UQ8T6 */
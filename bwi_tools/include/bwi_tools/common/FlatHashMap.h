@@ -0,0 +1,231 @@
+#ifndef FLATHASHMAP_K3V9PQ2
+#define FLATHASHMAP_K3V9PQ2
+
+/*
+File: FlatHashMap.h
+Description: a hash map storing its entries in one array, with linear probing. Erasing shifts the
+  following entries of the probe sequence back instead of leaving tombstones, so lookups never get
+  slower as entries come and go. Keys and values must be default constructible. Inserting a new key
+  or erasing invalidates iterators and references; looking up a key that is already there does not.
+*/
+
+#include <boost/functional/hash.hpp>
+
+#include <cstddef>
+#include <stdint.h>
+#include <functional>
+#include <utility>
+#include <vector>
+
+template <class Key, class T, class Hash = boost::hash<Key>, class Pred = std::equal_to<Key> >
+class FlatHashMap {
+public:
+  typedef Key key_type;
+  typedef T mapped_type;
+  typedef std::pair<Key,T> value_type;
+
+  template <class Map, class Value>
+  class Iterator {
+  public:
+    Iterator(): map(NULL), index(0) {}
+    Iterator(Map *map, size_t index): map(map), index(index) {
+      skipEmpty();
+    }
+    // iterator to const_iterator
+    template <class OtherMap, class OtherValue>
+    Iterator(const Iterator<OtherMap,OtherValue> &other): map(other.map), index(other.index) {}
+
+    Value& operator*() const { return map->slots[index]; }
+    Value* operator->() const { return &map->slots[index]; }
+
+    Iterator& operator++() {
+      ++index;
+      skipEmpty();
+      return *this;
+    }
+
+    Iterator operator++(int) {
+      Iterator old(*this);
+      ++*this;
+      return old;
+    }
+
+    template <class OtherMap, class OtherValue>
+    bool operator==(const Iterator<OtherMap,OtherValue> &other) const { return index == other.index; }
+    template <class OtherMap, class OtherValue>
+    bool operator!=(const Iterator<OtherMap,OtherValue> &other) const { return index != other.index; }
+
+  private:
+    friend class FlatHashMap;
+    template <class OtherMap, class OtherValue> friend class Iterator;
+
+    void skipEmpty() {
+      while (index < map->full.size() && !map->full[index])
+        ++index;
+    }
+
+    Map *map;
+    size_t index;
+  };
+
+  typedef Iterator<FlatHashMap, value_type> iterator;
+  typedef Iterator<const FlatHashMap, const value_type> const_iterator;
+
+  FlatHashMap():
+    numEntries(0)
+  {}
+
+  size_t size() const {
+    return numEntries;
+  }
+
+  bool empty() const {
+    return numEntries == 0;
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, full.size()); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, full.size()); }
+
+  iterator find(const Key &key) {
+    bool found;
+    size_t index = probe(key, found);
+    return found ? iterator(this, index) : end();
+  }
+
+  const_iterator find(const Key &key) const {
+    bool found;
+    size_t index = probe(key, found);
+    return found ? const_iterator(this, index) : end();
+  }
+
+  size_t count(const Key &key) const {
+    bool found;
+    probe(key, found);
+    return found ? 1 : 0;
+  }
+
+  std::pair<iterator,bool> insert(const value_type &entry) {
+    bool found;
+    size_t index = probe(entry.first, found);
+    if (found)
+      return std::make_pair(iterator(this, index), false);
+    // only grow for a new key, so that finding one never moves the entries
+    if (4 * (numEntries + 1) > 3 * full.size()) {
+      rehash(full.empty() ? 8 : 2 * full.size());
+      index = probe(entry.first, found);
+    }
+    slots[index] = entry;
+    full[index] = true;
+    ++numEntries;
+    return std::make_pair(iterator(this, index), true);
+  }
+
+  T& operator[](const Key &key) {
+    return insert(value_type(key, T())).first->second;
+  }
+
+  size_t erase(const Key &key) {
+    bool found;
+    size_t index = probe(key, found);
+    if (!found)
+      return 0;
+    eraseSlot(index);
+    return 1;
+  }
+
+  void erase(iterator position) {
+    eraseSlot(position.index);
+  }
+
+  void clear() {
+    slots.clear();
+    full.clear();
+    numEntries = 0;
+  }
+
+  // Makes room for count entries without growing again
+  void reserve(size_t count) {
+    size_t capacity = 8;
+    while (3 * capacity < 4 * count)
+      capacity *= 2;
+    if (capacity > full.size())
+      rehash(capacity);
+  }
+
+private:
+  size_t mask() const {
+    return full.size() - 1;
+  }
+
+  // boost::hash is the identity for integers, so keys with a power of two stride would share their
+  // low bits. The murmur3 finalizer spreads every bit of the hash over the ones the mask keeps.
+  size_t home(const Key &key) const {
+    uint64_t h = hasher(key);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h) & mask();
+  }
+
+  // Index of the key if found, otherwise of the empty slot where it would go
+  size_t probe(const Key &key, bool &found) const {
+    found = false;
+    if (full.empty())
+      return 0;
+    size_t index = home(key);
+    while (full[index]) {
+      if (equal(slots[index].first, key)) {
+        found = true;
+        return index;
+      }
+      index = (index + 1) & mask();
+    }
+    return index;
+  }
+
+  void eraseSlot(size_t hole) {
+    full[hole] = false;
+    --numEntries;
+    // move back every following entry of the run that may no longer be reachable past the hole
+    for (size_t index = (hole + 1) & mask(); full[index]; index = (index + 1) & mask()) {
+      size_t ideal = home(slots[index].first);
+      // the entry can stay if its home lies cyclically in (hole, index]
+      bool reachable = (hole < index) ? (hole < ideal && ideal <= index) : (hole < ideal || ideal <= index);
+      if (reachable)
+        continue;
+      slots[hole] = slots[index];
+      full[hole] = true;
+      full[index] = false;
+      hole = index;
+    }
+    slots[hole] = value_type();
+  }
+
+  void rehash(size_t capacity) {
+    std::vector<value_type> oldSlots(capacity);
+    std::vector<bool> oldFull(capacity, false);
+    oldSlots.swap(slots);
+    oldFull.swap(full);
+    for (size_t i = 0; i < oldFull.size(); ++i) {
+      if (!oldFull[i])
+        continue;
+      size_t index = home(oldSlots[i].first);
+      while (full[index])
+        index = (index + 1) & mask();
+      slots[index] = oldSlots[i];
+      full[index] = true;
+    }
+  }
+
+  std::vector<value_type> slots;
+  std::vector<bool> full;
+  size_t numEntries;
+  Hash hasher;
+  Pred equal;
+};
+
+#endif /* end of include guard: FLATHASHMAP_K3V9PQ2 */
@@ -8,22 +8,134 @@
 #include <boost/random/mersenne_twister.hpp>
 
 #include <cstdlib>
+#include <limits>
+#include <stdexcept>
+#include <stdint.h>
 #include <vector>
 
-class RNG : public boost::mt19937 {
+/* Samples from a fixed discrete distribution in constant time, using Vose's alias method.
+ * Build it once for a distribution that is sampled repeatedly; RNG::select scans the
+ * probabilities on every draw. The weights don't need to sum to one, but they have to be
+ * finite and non-negative, with a positive sum; otherwise std::invalid_argument is thrown.
+ * A default constructed table is empty and can't be sampled. */
+class AliasTable {
 
   public:
-    RNG (unsigned int seed) : boost::mt19937(seed) {}
+    AliasTable() {}
+
+    explicit AliasTable(const std::vector<float>& weights) : probability_(weights.size()), alias_(weights.size()) {
+      double total = 0;
+      for (unsigned int i = 0; i < weights.size(); ++i) {
+        if (!(weights[i] >= 0) || weights[i] == std::numeric_limits<float>::infinity()) {
+          throw std::invalid_argument("AliasTable: weights must be finite and non-negative");
+        }
+        total += weights[i];
+      }
+      if (!(total > 0)) {
+        throw std::invalid_argument("AliasTable: needs at least one positive weight");
+      }
+      unsigned int n = weights.size();
+      std::vector<double> scaled(n);
+      std::vector<unsigned int> small, large;
+      for (unsigned int i = 0; i < n; ++i) {
+        scaled[i] = weights[i] * n / total;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+      }
+      while (!small.empty() && !large.empty()) {
+        unsigned int less = small.back();
+        small.pop_back();
+        unsigned int more = large.back();
+        probability_[less] = scaled[less];
+        alias_[less] = more;
+        // the large column donates what the small one lacks
+        scaled[more] -= 1.0 - scaled[less];
+        if (scaled[more] < 1.0) {
+          large.pop_back();
+          small.push_back(more);
+        }
+      }
+      // whatever is left is full up to rounding errors
+      for (unsigned int i = 0; i < large.size(); ++i) {
+        probability_[large[i]] = 1.0;
+        alias_[large[i]] = large[i];
+      }
+      for (unsigned int i = 0; i < small.size(); ++i) {
+        probability_[small[i]] = 1.0;
+        alias_[small[i]] = small[i];
+      }
+    }
+
+    inline unsigned int size() const {
+      return probability_.size();
+    }
+
+    /* Maps a uniform value in [0, size()) to an outcome */
+    inline int sample(double u) const {
+      if (probability_.empty()) {
+        throw std::logic_error("AliasTable: sampling an empty table");
+      }
+      unsigned int column = (unsigned int) u;
+      if (column >= probability_.size()) {
+        column = probability_.size() - 1;
+      }
+      return (u - column < probability_[column]) ? column : alias_[column];
+    }
+
+  private:
+    std::vector<double> probability_;
+    std::vector<unsigned int> alias_;
+};
+
+/* A counter based generator: the n-th output is a hash (SplitMix64) of the key and n, so it can jump
+ * to any position in constant time, and generators with different keys are independent. */
+class CounterEngine {
+
+  public:
+    typedef uint32_t result_type;
+    static const bool has_fixed_range = false;
+
+    explicit CounterEngine(uint64_t key = 0, uint64_t position = 0) : key_(key), position_(position) {}
+
+    result_type min() const { return 0; }
+    result_type max() const { return std::numeric_limits<uint32_t>::max(); }
+
+    inline result_type operator()() {
+      return mix(key_ + (++position_) * 0x9E3779B97F4A7C15ULL) >> 32;
+    }
+
+    /* Number of values drawn since position 0 */
+    inline uint64_t position() const { return position_; }
+    inline void seek(uint64_t position) { position_ = position; }
+    inline void discard(uint64_t count) { position_ += count; }
+
+    static inline uint64_t mix(uint64_t z) {
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      return z ^ (z >> 31);
+    }
+
+  private:
+    uint64_t key_;
+    uint64_t position_;
+};
+
+/* The sampling functions, for any boost compatible engine. The fill functions draw exactly the
+ * values the single draw functions would, in the same order, but set up the distribution once. */
+template <class Engine>
+class BasicRNG : public Engine {
+
+  public:
+    BasicRNG(const Engine& engine) : Engine(engine) {}
 
     inline float randomFloat() {
       boost::uniform_real<float> dist;
-      boost::variate_generator<boost::mt19937&, boost::uniform_real<float> > gen(*this, dist);
+      boost::variate_generator<Engine&, boost::uniform_real<float> > gen(*this, dist);
       return gen();
     }
 
     inline int randomInt(int min, int max) {
       boost::uniform_int<int> dist(min, max);
-      boost::variate_generator<boost::mt19937&, boost::uniform_int<int> > gen(*this, dist);
+      boost::variate_generator<Engine&, boost::uniform_int<int> > gen(*this, dist);
       return gen();
     }
 
@@ -33,24 +145,61 @@ class RNG : public boost::mt19937 {
 
     inline int randomUInt(unsigned int max = std::numeric_limits<unsigned int>::max()) {
       boost::uniform_int<unsigned int> dist(0, max);
-      boost::variate_generator<boost::mt19937&, boost::uniform_int<unsigned int> > gen(*this, dist);
+      boost::variate_generator<Engine&, boost::uniform_int<unsigned int> > gen(*this, dist);
       return gen();
     }
 
     inline int poissonInt(int mean) {
       boost::poisson_distribution<int> dist(mean);
-      boost::variate_generator<boost::mt19937&, boost::poisson_distribution<int> > gen(*this, dist);
+      boost::variate_generator<Engine&, boost::poisson_distribution<int> > gen(*this, dist);
       return gen();
     }
 
+    inline void fillUniform(float *out, size_t count) {
+      boost::uniform_real<float> dist;
+      boost::variate_generator<Engine&, boost::uniform_real<float> > gen(*this, dist);
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = gen();
+      }
+    }
+
+    inline void fillUniform(std::vector<float> &out) {
+      if (!out.empty()) fillUniform(&out[0], out.size());
+    }
+
+    inline void fillInt(int *out, size_t count, int min, int max) {
+      boost::uniform_int<int> dist(min, max);
+      boost::variate_generator<Engine&, boost::uniform_int<int> > gen(*this, dist);
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = gen();
+      }
+    }
+
+    inline void fillInt(std::vector<int> &out, int min, int max) {
+      if (!out.empty()) fillInt(&out[0], out.size(), min, max);
+    }
+
+    inline void fillPoisson(int *out, size_t count, int mean) {
+      // drawn from the distribution directly, which is what variate_generator does for it. Copying it into
+      // one copies state that only some means initialize.
+      boost::poisson_distribution<int> dist(mean);
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = dist(*this);
+      }
+    }
+
+    inline void fillPoisson(std::vector<int> &out, int mean) {
+      if (!out.empty()) fillPoisson(&out[0], out.size(), mean);
+    }
+
     inline void randomOrdering(std::vector<unsigned int> &inds) {
       unsigned int j;
       unsigned int temp;
       for (unsigned int i = 0; i < inds.size(); i++) {
         inds[i] = i;
       }
-      for (int i = (int)inds.size() - 1; i >= 0; i--) {
-        j = randomInt(i + 1);
+      for (int i = (int)inds.size() - 1; i > 0; i--) {
+        j = boost::uniform_int<unsigned int>(0, i)(*this);
         temp = inds[i];
         inds[i] = inds[j];
         inds[j] = temp;
@@ -60,12 +209,66 @@ class RNG : public boost::mt19937 {
     inline int select(const std::vector<float>& probabilities) {
       float random_value = randomFloat();
       float prob_sum = probabilities[0];
-      for (int i = 1; i < probabilities.size(); ++i) {
+      for (unsigned int i = 1; i < probabilities.size(); ++i) {
         if (random_value < prob_sum) return i - 1;
         prob_sum += probabilities[i];
       }
       return probabilities.size() - 1;
     }
+
+    inline int select(const AliasTable& table) {
+      return table.sample(uniformIndex(table.size()));
+    }
+
+    inline void fillSelect(int *out, size_t count, const AliasTable& table) {
+      for (size_t i = 0; i < count; ++i) {
+        out[i] = table.sample(uniformIndex(table.size()));
+      }
+    }
+
+    inline void fillSelect(std::vector<int> &out, const AliasTable& table) {
+      if (!out.empty()) fillSelect(&out[0], out.size(), table);
+    }
+
+  private:
+    // uniform in [0, n) from a single 32 bit draw
+    inline double uniformIndex(unsigned int n) {
+      return (Engine::operator()() - (Engine::min)()) * (n / 4294967296.0);
+    }
+};
+
+/* An independent generator from a family of numbered streams, for handing one to every thread or
+ * simulation run: the values only depend on the seed, the stream number and the position. */
+class StreamRNG : public BasicRNG<CounterEngine> {
+
+  public:
+    StreamRNG(unsigned int seed, uint64_t stream, uint64_t position = 0) :
+      BasicRNG<CounterEngine>(CounterEngine(CounterEngine::mix(CounterEngine::mix(seed) ^ stream), position)) {}
+};
+
+class RNG : public BasicRNG<boost::mt19937> {
+
+  public:
+    RNG (unsigned int seed) : BasicRNG<boost::mt19937>(boost::mt19937(seed)), seed_(seed) {}
+
+    /* Reseeding also moves the streams to the family of the new seed. These hide the other
+     * mt19937::seed overloads, which have no single seed to derive the streams from. */
+    inline void seed(unsigned int seed) {
+      boost::mt19937::seed(seed);
+      seed_ = seed;
+    }
+
+    inline void seed() {
+      seed(boost::mt19937::default_seed);
+    }
+
+    /* The given stream of the family belonging to this generator's seed */
+    inline StreamRNG stream(uint64_t stream, uint64_t position = 0) const {
+      return StreamRNG(seed_, stream, position);
+    }
+
+  private:
+    unsigned int seed_;
 };
 
 #endif /* end of include guard: BWI_TOOLS_RNG_H */
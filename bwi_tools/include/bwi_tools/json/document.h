@@ -0,0 +1,210 @@
+#ifndef CPPTL_JSON_DOCUMENT_H_INCLUDED
+# define CPPTL_JSON_DOCUMENT_H_INCLUDED
+
+# include "features.h"
+# include "value.h"
+# include <string>
+# include <vector>
+
+namespace Json {
+
+   /** \brief A read-only file mapped into memory.
+    *
+    * An empty or missing file maps to an empty range; isOpen() tells them apart.
+    */
+   class JSON_API MappedFile
+   {
+   public:
+      explicit MappedFile( const std::string &filename );
+      ~MappedFile();
+
+      bool isOpen() const { return open_; }
+      const char *begin() const { return begin_; }
+      const char *end() const { return begin_ + size_; }
+      size_t size() const { return size_; }
+
+   private:
+      MappedFile( const MappedFile & );
+      MappedFile &operator =( const MappedFile & );
+
+      const char *begin_;
+      size_t size_;
+      bool open_;
+      bool mapped_;
+      // used instead of a mapping for files that can't be mapped, like pipes
+      std::vector<char> buffer_;
+   };
+
+   /** \brief A parsed <a HREF="http://www.json.org">JSON</a> document.
+    *
+    * All nodes of the document are stored in one array, with the children of every array or object
+    * next to each other, and all strings in one character buffer. Member names are interned, so a name
+    * used by many objects is stored, and compared, only once.
+    *
+    * A Document can't be modified. Nodes are visited through Document::Node, and toValue() turns the
+    * document, or any node of it, into a Value for code written against that API.
+    */
+   class JSON_API Document
+   {
+   public:
+      typedef unsigned int Index;
+      static const Index npos = Index(-1);
+
+      /** \brief A node of a Document. Only valid while the Document is alive and not parsed into again.
+       *
+       * Looking up a missing member or index gives a null node, like Value::get() would.
+       */
+      class JSON_API Node
+      {
+      public:
+         Node();
+
+         ValueType type() const;
+         bool isNull() const;
+         bool isBool() const;
+         bool isInt() const;
+         bool isUInt() const;
+         bool isIntegral() const;
+         bool isDouble() const;
+         bool isNumeric() const;
+         bool isString() const;
+         bool isArray() const;
+         bool isObject() const;
+
+         bool asBool() const;
+         Int asInt() const;
+         UInt asUInt() const;
+         double asDouble() const;
+         /// Points into the document; the string is NUL terminated
+         const char *asCString() const;
+         std::string asString() const;
+
+         /// Number of elements in an array or members in an object, 0 otherwise
+         UInt size() const;
+
+         /// Element of an array
+         Node operator[]( UInt index ) const;
+         /// Member of an object; if the name appears more than once the last one is found
+         Node operator[]( const char *key ) const;
+         Node operator[]( const std::string &key ) const;
+         bool isMember( const char *key ) const;
+
+         /// Name of the index-th member of an object
+         const char *memberName( UInt index ) const;
+
+         void toValue( Value &value ) const;
+
+      private:
+         friend class Document;
+         Node( const Document *document, Index index );
+
+         const Document *document_;
+         Index index_;
+      };
+
+      Document();
+
+      Node root() const;
+
+      /// Replaces value by a Value holding the whole document
+      void toValue( Value &value ) const;
+
+      void clear();
+
+   private:
+      friend class FastReader;
+
+      struct NodeData
+      {
+         unsigned char type_;
+         /// Interned member name, npos for the elements of an array and the root
+         Index key_;
+         /// Number of children of an array or object, length of a string
+         Index count_;
+         union
+         {
+            Int int_;
+            UInt uint_;
+            double real_;
+            bool bool_;
+            /// First child of an array or object, first character of a string
+            Index first_;
+         } value_;
+      };
+
+      Index findKey( const char *key, size_t length ) const;
+      Index internKey( const char *key, size_t length );
+      Index hashKey( const char *key, size_t length ) const;
+      void growKeyTable();
+
+      std::vector<NodeData> nodes_;
+      Index root_;
+      std::vector<char> strings_;
+
+      // interned member names: the names, NUL terminated, and an open addressing table of their offsets
+      std::vector<char> keyChars_;
+      std::vector<Index> keyOffsets_;
+      std::vector<Index> keyTable_;
+   };
+
+   /** \brief Parses a <a HREF="http://www.json.org">JSON</a> document in a single pass into a Document.
+    *
+    * Accepts the same documents as Reader and gives the same values, but reads the text in place instead
+    * of copying it, and allocates a handful of buffers instead of a node at a time. Comments are taken
+    * where Reader takes them, so not between a member name and its colon nor in an empty array, and are
+    * skipped, never collected. Parsing stops at the first error.
+    */
+   class JSON_API FastReader
+   {
+   public:
+      FastReader();
+      FastReader( const Features &features );
+
+      bool parse( const char *beginDoc, const char *endDoc, Document &document );
+      bool parse( const std::string &document, Document &root );
+      /// Maps the file into memory and parses it without reading it into a buffer first
+      bool parseFile( const std::string &filename, Document &document );
+
+      /// Parses into a Document and converts it. Document::toValue() can be used instead to keep the document.
+      bool parse( const char *beginDoc, const char *endDoc, Value &root );
+      bool parseFile( const std::string &filename, Value &root );
+
+      /// Same format as Reader::getFormatedErrorMessages()
+      std::string getFormatedErrorMessages() const;
+
+   private:
+      typedef const char *Location;
+
+      bool readValue();
+      bool readObject();
+      bool readArray();
+      bool readString( Location &begin, Location &end );
+      bool decodeString( Location begin, Location end, std::vector<char> &decoded );
+      bool decodeUnicodeCodePoint( Location &current, Location end, unsigned int &unicode );
+      bool decodeUnicodeEscapeSequence( Location &current, Location end, unsigned int &unicode );
+      bool readNumber();
+      bool decodeDouble( Location begin, Location end, double &value );
+      bool match( const char *pattern, int patternLength );
+      bool skipSpaces();
+      /// Skips spaces but not comments, where Reader doesn't take any
+      void skipWhitespace();
+      /// Ends the children collected since mark, moving them from the stack into the document
+      Document::Index commit( size_t mark );
+      bool addError( const std::string &message, Location location, Location extra = 0 );
+
+      Features features_;
+      Document *document_;
+      Location begin_;
+      Location end_;
+      Location current_;
+      // formatted when the error is found, the document may be unmapped by the time it's asked for
+      std::string errors_;
+
+      // children of the arrays and objects being read, innermost last
+      std::vector<Document::NodeData> stack_;
+      std::vector<char> scratch_;
+   };
+
+} // namespace Json
+
+#endif // CPPTL_JSON_DOCUMENT_H_INCLUDED
@@ -12,6 +12,11 @@ namespace Json {
    // reader.h
    class Reader;
 
+   // document.h
+   class MappedFile;
+   class Document;
+   class FastReader;
+
    // features.h
    class Features;
 
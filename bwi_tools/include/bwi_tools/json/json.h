@@ -4,6 +4,7 @@
 # include "autolink.h"
 # include "value.h"
 # include "reader.h"
+# include "document.h"
 # include "writer.h"
 # include "features.h"
 
@@ -1,8 +1,11 @@
 #ifndef BWI_TOOLS_RECORD_WRITER_H
 #define BWI_TOOLS_RECORD_WRITER_H
 
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -46,8 +49,370 @@ namespace bwi_tools {
     }
 
     ofs.close();
+    return true;
   }
 
+  /* Writes records one at a time, without keeping them in memory.
+   *
+   * The columns are either declared up front or taken from the first record. A record with keys
+   * that aren't columns yet adds them; rows already written are fixed up by rewriting the file once
+   * when it is closed. Missing values are written as missing_value. With inferred columns and values
+   * that need no quoting the CSV is byte for byte what writeRecordsAsCSV writes.
+   *
+   * CSV values containing a comma, quote or line break are quoted. JSON_LINES writes one object per
+   * record holding exactly the keys of that record, so it never needs a rewrite.
+   */
+  class RecordStreamWriter {
+    public:
+      enum Format {
+        CSV,
+        JSON_LINES
+      };
+
+      typedef std::map<std::string, std::string> Record;
+
+      RecordStreamWriter(const std::string &filename,
+                         Format format = CSV,
+                         const std::vector<std::string> &columns = std::vector<std::string>(),
+                         const std::string &missing_value = "0") :
+          filename_(filename), format_(format), missing_value_(missing_value),
+          declared_(columns.size()), header_written_(false), written_columns_(0), columnless_rows_(0), rows_(0) {
+        ofs_.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        BOOST_FOREACH(const std::string &column, columns) {
+          addColumn(column);
+        }
+      }
+
+      ~RecordStreamWriter() {
+        close();
+      }
+
+      bool isOpen() const {
+        return ofs_.is_open();
+      }
+
+      const std::vector<std::string>& columns() const {
+        return columns_;
+      }
+
+      size_t rows() const {
+        return rows_;
+      }
+
+      bool write(const Record &record) {
+        if (!ofs_.is_open()) {
+          return false;
+        }
+        if (format_ == JSON_LINES) {
+          line_.clear();
+          line_ += '{';
+          bool first = true;
+          BOOST_FOREACH(const Record::value_type &field, record) {
+            if (!first) {
+              line_ += ',';
+            }
+            first = false;
+            appendJsonString(field.first);
+            line_ += ':';
+            appendJsonString(field.second);
+          }
+          line_ += "}\n";
+          return flushLine();
+        }
+
+        BOOST_FOREACH(const Record::value_type &field, record) {
+          if (column_index_.find(field.first) == column_index_.end()) {
+            addColumn(field.first);
+          }
+        }
+        if (!header_written_) {
+          writeHeader();
+        }
+
+        line_.clear();
+        // only the columns the header was written with; the rest are added by the rewrite in close()
+        Record::const_iterator next = record.begin();
+        for (size_t i = 0; i < written_columns_; ++i) {
+          if (i > 0) {
+            line_ += ',';
+          }
+          // the columns usually come in the same order as the keys of the record, so try the next one first
+          Record::const_iterator value;
+          if (next != record.end() && next->first == columns_[i]) {
+            value = next++;
+          } else {
+            value = record.find(columns_[i]);
+          }
+          if (value == record.end()) {
+            line_ += missing_value_;
+          } else {
+            appendCsvField(value->second);
+          }
+        }
+        // values of columns added since the header was written wait for the rewrite
+        for (size_t i = written_columns_; i < columns_.size(); ++i) {
+          if (i > 0) {
+            line_ += ',';
+          }
+          Record::const_iterator value = record.find(columns_[i]);
+          if (value == record.end()) {
+            line_ += missing_value_;
+          } else {
+            appendCsvField(value->second);
+          }
+        }
+        line_ += '\n';
+        if (columns_.empty()) {
+          ++columnless_rows_;
+        }
+        return flushLine();
+      }
+
+      /* Writes a row of values given in the order of columns(), without looking up any keys */
+      bool writeRow(const std::vector<std::string> &values) {
+        if (!ofs_.is_open() || format_ != CSV || values.size() > columns_.size()) {
+          return false;
+        }
+        if (!header_written_) {
+          writeHeader();
+        }
+        line_.clear();
+        for (size_t i = 0; i < columns_.size(); ++i) {
+          if (i > 0) {
+            line_ += ',';
+          }
+          if (i < values.size()) {
+            appendCsvField(values[i]);
+          } else {
+            line_ += missing_value_;
+          }
+        }
+        line_ += '\n';
+        if (columns_.empty()) {
+          ++columnless_rows_;
+        }
+        return flushLine();
+      }
+
+      /* Finishes the file, rewriting it if columns were added after the header was written */
+      bool close() {
+        if (!ofs_.is_open()) {
+          return false;
+        }
+        if (format_ == CSV && !header_written_) {
+          writeHeader();
+        }
+        ofs_.close();
+        if (ofs_.fail()) {
+          return false;
+        }
+        if (format_ == CSV && (written_columns_ != columns_.size() || !inOutputOrder())) {
+          return rewrite();
+        }
+        return true;
+      }
+
+    private:
+      void addColumn(const std::string &column) {
+        if (column_index_.insert(std::make_pair(column, columns_.size())).second) {
+          columns_.push_back(column);
+        }
+      }
+
+      // Inferred columns come out sorted like writeRecordsAsCSV; declared ones in their given order,
+      // followed by any that turned up later in the order they turned up
+      std::vector<size_t> outputOrder() const {
+        std::vector<size_t> order;
+        for (size_t i = 0; i < columns_.size(); ++i) {
+          order.push_back(i);
+        }
+        if (declared_ == 0) {
+          std::sort(order.begin(), order.end(), ColumnNameLess(columns_));
+        }
+        return order;
+      }
+
+      bool inOutputOrder() const {
+        std::vector<size_t> order = outputOrder();
+        for (size_t i = 0; i < order.size(); ++i) {
+          if (order[i] != i) {
+            return false;
+          }
+        }
+        return true;
+      }
+
+      struct ColumnNameLess {
+        ColumnNameLess(const std::vector<std::string> &columns) : columns(columns) {}
+        bool operator()(size_t a, size_t b) const {
+          return columns[a] < columns[b];
+        }
+        const std::vector<std::string> &columns;
+      };
+
+      void writeHeader() {
+        header_written_ = true;
+        written_columns_ = columns_.size();
+        line_.clear();
+        for (size_t i = 0; i < columns_.size(); ++i) {
+          if (i > 0) {
+            line_ += ',';
+          }
+          appendCsvField(columns_[i]);
+        }
+        line_ += '\n';
+        ofs_.write(line_.data(), line_.size());
+      }
+
+      bool flushLine() {
+        ofs_.write(line_.data(), line_.size());
+        ++rows_;
+        return ofs_.good();
+      }
+
+      void appendCsvField(const std::string &value) {
+        if (value.find_first_of(",\"\r\n") == std::string::npos) {
+          line_ += value;
+          return;
+        }
+        line_ += '"';
+        BOOST_FOREACH(char c, value) {
+          if (c == '"') {
+            line_ += '"';
+          }
+          line_ += c;
+        }
+        line_ += '"';
+      }
+
+      void appendJsonString(const std::string &value) {
+        line_ += '"';
+        BOOST_FOREACH(char c, value) {
+          switch (c) {
+            case '"': line_ += "\\\""; break;
+            case '\\': line_ += "\\\\"; break;
+            case '\n': line_ += "\\n"; break;
+            case '\r': line_ += "\\r"; break;
+            case '\t': line_ += "\\t"; break;
+            default:
+              if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                line_ += escaped;
+              } else {
+                line_ += c;
+              }
+          }
+        }
+        line_ += '"';
+      }
+
+      // Reads one CSV row, honouring quotes, into fields. Returns false at the end of the file.
+      static bool readCsvRow(std::istream &in, std::vector<std::string> &fields) {
+        fields.clear();
+        int c = in.get();
+        if (c == EOF) {
+          return false;
+        }
+        fields.push_back(std::string());
+        bool quoted = false;
+        for (; c != EOF; c = in.get()) {
+          if (quoted) {
+            if (c == '"') {
+              if (in.peek() == '"') {
+                fields.back() += static_cast<char>(in.get());
+              } else {
+                quoted = false;
+              }
+            } else {
+              fields.back() += static_cast<char>(c);
+            }
+          } else if (c == '"') {
+            quoted = true;
+          } else if (c == ',') {
+            fields.push_back(std::string());
+          } else if (c == '\n') {
+            break;
+          } else {
+            fields.back() += static_cast<char>(c);
+          }
+        }
+        return true;
+      }
+
+      // Writes the final header to a sidecar file and streams the rows behind it, padded to the full
+      // set of columns and put in output order, then moves the sidecar over the original file
+      bool rewrite() {
+        std::string sidecar = filename_ + ".tmp";
+        std::ifstream in(filename_.c_str(), std::ios::in | std::ios::binary);
+        ofs_.open(sidecar.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!in.is_open() || !ofs_.is_open()) {
+          ofs_.close();
+          return false;
+        }
+
+        std::vector<size_t> order = outputOrder();
+        line_.clear();
+        for (size_t i = 0; i < order.size(); ++i) {
+          if (i > 0) {
+            line_ += ',';
+          }
+          appendCsvField(columns_[order[i]]);
+        }
+        line_ += '\n';
+        ofs_.write(line_.data(), line_.size());
+
+        std::vector<std::string> fields;
+        // skip the old header
+        readCsvRow(in, fields);
+        for (size_t row = 0; readCsvRow(in, fields); ++row) {
+          // an empty line reads as one empty field, but the rows written before there were any columns have none
+          if (row < columnless_rows_) {
+            fields.clear();
+          }
+          line_.clear();
+          for (size_t i = 0; i < order.size(); ++i) {
+            if (i > 0) {
+              line_ += ',';
+            }
+            if (order[i] < fields.size()) {
+              appendCsvField(fields[order[i]]);
+            } else {
+              line_ += missing_value_;
+            }
+          }
+          line_ += '\n';
+          ofs_.write(line_.data(), line_.size());
+        }
+        in.close();
+        ofs_.close();
+        if (ofs_.fail()) {
+          return false;
+        }
+        written_columns_ = columns_.size();
+        columnless_rows_ = 0;
+        return std::rename(sidecar.c_str(), filename_.c_str()) == 0;
+      }
+
+      std::string filename_;
+      Format format_;
+      std::string missing_value_;
+      size_t declared_;
+
+      std::vector<std::string> columns_;
+      std::map<std::string, size_t> column_index_;
+      bool header_written_;
+      // number of columns in the header at the top of the file
+      size_t written_columns_;
+      // rows written while there were no columns at all, which always come first
+      size_t columnless_rows_;
+      size_t rows_;
+
+      std::ofstream ofs_;
+      // reused for every row, so writing a row doesn't allocate once it has grown large enough
+      std::string line_;
+  };
+
 } /* bwi_tools */
 
 #endif /* end of include guard: BWI_TOOLS_RECORD_WRITER_H */
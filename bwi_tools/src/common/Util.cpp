@@ -64,23 +64,23 @@ void softmax(const std::vector<unsigned int> &vals, float factor, std::vector<fl
 }
 
 bool readJson(const std::string &filename, Json::Value &value) {
-  Json::Reader reader;
-  std::ifstream in(filename.c_str());
-  if (!in.good()) {
+  // parse straight from the mapped file, without building an intermediate Json::Value
+  Json::MappedFile in(filename);
+  if (!in.isOpen()) {
     std::cerr << "readJson: ERROR opening file: " << filename << std::endl;
     return false;
   }
-  Json::Value root;
-  bool parsingSuccessful = reader.parse(in,root);
-  in.close();
+  Json::FastReader reader;
+  Json::Document document;
+  bool parsingSuccessful = reader.parse(in.begin(),in.end(),document);
   if (!parsingSuccessful) {
     std::cerr << "readJson: ERROR parsing file: " << filename << std::endl;
     std::cerr << reader.getFormatedErrorMessages();
     return false;
   }
-  Json::Value::Members members = root.getMemberNames();
-  for (unsigned int i = 0; i < members.size(); i++) {
-    value[members[i]] = root[members[i]];
+  Json::Document::Node root = document.root();
+  for (unsigned int i = 0; root.isObject() && i < root.size(); i++) {
+    root[i].toValue(value[root.memberName(i)]);
   }
 
   return true;
@@ -0,0 +1,1053 @@
+#include <bwi_tools/json/document.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Json {
+
+// Implementation of class MappedFile
+// ////////////////////////////////
+
+MappedFile::MappedFile( const std::string &filename )
+   : begin_( 0 )
+   , size_( 0 )
+   , open_( false )
+   , mapped_( false )
+{
+   int fd = ::open( filename.c_str(), O_RDONLY );
+   if ( fd < 0 )
+      return;
+   open_ = true;
+
+   struct stat status;
+   if ( ::fstat( fd, &status ) == 0  &&  S_ISREG( status.st_mode ) )
+   {
+      if ( status.st_size > 0 )
+      {
+         void *mapping = ::mmap( 0, status.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+         if ( mapping != MAP_FAILED )
+         {
+            begin_ = static_cast<const char *>( mapping );
+            size_ = status.st_size;
+            mapped_ = true;
+         }
+      }
+      else
+      {
+         ::close( fd );
+         return;
+      }
+   }
+
+   if ( !mapped_ )
+   {
+      char chunk[65536];
+      ssize_t count;
+      while ( ( count = ::read( fd, chunk, sizeof(chunk) ) ) > 0 )
+         buffer_.insert( buffer_.end(), chunk, chunk + count );
+      begin_ = buffer_.empty() ? 0 : &buffer_[0];
+      size_ = buffer_.size();
+   }
+   ::close( fd );
+}
+
+
+MappedFile::~MappedFile()
+{
+   if ( mapped_ )
+      ::munmap( const_cast<char *>( begin_ ), size_ );
+}
+
+
+// Implementation of class Document
+// ////////////////////////////////
+
+const Document::Index Document::npos;
+
+Document::Document()
+   : root_( npos )
+{
+}
+
+
+void
+Document::clear()
+{
+   nodes_.clear();
+   root_ = npos;
+   strings_.clear();
+   keyChars_.clear();
+   keyOffsets_.clear();
+   keyTable_.clear();
+}
+
+
+Document::Node
+Document::root() const
+{
+   if ( root_ == npos )
+      return Node();
+   return Node( this, root_ );
+}
+
+
+void
+Document::toValue( Value &value ) const
+{
+   root().toValue( value );
+}
+
+
+Document::Index
+Document::hashKey( const char *key, size_t length ) const
+{
+   // FNV-1a
+   Index hash = 2166136261u;
+   for ( size_t index = 0; index < length; ++index )
+   {
+      hash ^= static_cast<unsigned char>( key[index] );
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+
+Document::Index
+Document::findKey( const char *key, size_t length ) const
+{
+   if ( keyTable_.empty() )
+      return npos;
+   Index mask = Index( keyTable_.size() ) - 1;
+   for ( Index slot = hashKey( key, length ) & mask; ; slot = ( slot + 1 ) & mask )
+   {
+      Index id = keyTable_[slot];
+      if ( id == npos )
+         return npos;
+      const char *candidate = &keyChars_[keyOffsets_[id]];
+      if ( strncmp( candidate, key, length ) == 0  &&  candidate[length] == 0 )
+         return id;
+   }
+}
+
+
+Document::Index
+Document::internKey( const char *key, size_t length )
+{
+   Index id = findKey( key, length );
+   if ( id != npos )
+      return id;
+
+   // keep the table at most half full
+   if ( 2 * ( keyOffsets_.size() + 1 ) > keyTable_.size() )
+      growKeyTable();
+
+   id = Index( keyOffsets_.size() );
+   keyOffsets_.push_back( Index( keyChars_.size() ) );
+   keyChars_.insert( keyChars_.end(), key, key + length );
+   keyChars_.push_back( 0 );
+
+   Index mask = Index( keyTable_.size() ) - 1;
+   Index slot = hashKey( key, length ) & mask;
+   while ( keyTable_[slot] != npos )
+      slot = ( slot + 1 ) & mask;
+   keyTable_[slot] = id;
+   return id;
+}
+
+
+void
+Document::growKeyTable()
+{
+   keyTable_.assign( keyTable_.empty() ? 64 : 2 * keyTable_.size(), npos );
+   Index mask = Index( keyTable_.size() ) - 1;
+   for ( Index id = 0; id < keyOffsets_.size(); ++id )
+   {
+      const char *key = &keyChars_[keyOffsets_[id]];
+      Index slot = hashKey( key, strlen( key ) ) & mask;
+      while ( keyTable_[slot] != npos )
+         slot = ( slot + 1 ) & mask;
+      keyTable_[slot] = id;
+   }
+}
+
+
+// Implementation of class Document::Node
+// ////////////////////////////////
+
+Document::Node::Node()
+   : document_( 0 )
+   , index_( npos )
+{
+}
+
+
+Document::Node::Node( const Document *document, Index index )
+   : document_( document )
+   , index_( index )
+{
+}
+
+
+ValueType
+Document::Node::type() const
+{
+   if ( !document_ )
+      return nullValue;
+   return ValueType( document_->nodes_[index_].type_ );
+}
+
+
+bool Document::Node::isNull() const { return type() == nullValue; }
+bool Document::Node::isBool() const { return type() == booleanValue; }
+bool Document::Node::isInt() const { return type() == intValue; }
+bool Document::Node::isUInt() const { return type() == uintValue; }
+bool Document::Node::isIntegral() const { return isInt()  ||  isUInt()  ||  isBool(); }
+bool Document::Node::isDouble() const { return type() == realValue; }
+bool Document::Node::isNumeric() const { return isIntegral()  ||  isDouble(); }
+bool Document::Node::isString() const { return type() == stringValue; }
+bool Document::Node::isArray() const { return type() == arrayValue; }
+bool Document::Node::isObject() const { return type() == objectValue; }
+
+
+bool
+Document::Node::asBool() const
+{
+   switch ( type() )
+   {
+   case booleanValue:
+      return document_->nodes_[index_].value_.bool_;
+   case intValue:
+      return document_->nodes_[index_].value_.int_ != 0;
+   case uintValue:
+      return document_->nodes_[index_].value_.uint_ != 0;
+   case realValue:
+      return document_->nodes_[index_].value_.real_ != 0.0;
+   case stringValue:
+      return document_->nodes_[index_].count_ != 0;
+   case arrayValue:
+   case objectValue:
+      return size() != 0;
+   default:
+      return false;
+   }
+}
+
+
+Int
+Document::Node::asInt() const
+{
+   switch ( type() )
+   {
+   case booleanValue:
+      return document_->nodes_[index_].value_.bool_ ? 1 : 0;
+   case intValue:
+      return document_->nodes_[index_].value_.int_;
+   case uintValue:
+      return Int( document_->nodes_[index_].value_.uint_ );
+   case realValue:
+      return Int( document_->nodes_[index_].value_.real_ );
+   default:
+      return 0;
+   }
+}
+
+
+UInt
+Document::Node::asUInt() const
+{
+   switch ( type() )
+   {
+   case booleanValue:
+      return document_->nodes_[index_].value_.bool_ ? 1 : 0;
+   case intValue:
+      return UInt( document_->nodes_[index_].value_.int_ );
+   case uintValue:
+      return document_->nodes_[index_].value_.uint_;
+   case realValue:
+      return UInt( document_->nodes_[index_].value_.real_ );
+   default:
+      return 0;
+   }
+}
+
+
+double
+Document::Node::asDouble() const
+{
+   switch ( type() )
+   {
+   case booleanValue:
+      return document_->nodes_[index_].value_.bool_ ? 1.0 : 0.0;
+   case intValue:
+      return document_->nodes_[index_].value_.int_;
+   case uintValue:
+      return document_->nodes_[index_].value_.uint_;
+   case realValue:
+      return document_->nodes_[index_].value_.real_;
+   default:
+      return 0.0;
+   }
+}
+
+
+const char *
+Document::Node::asCString() const
+{
+   if ( !isString() )
+      return "";
+   return &document_->strings_[document_->nodes_[index_].value_.first_];
+}
+
+
+std::string
+Document::Node::asString() const
+{
+   switch ( type() )
+   {
+   case stringValue:
+      {
+         const NodeData &node = document_->nodes_[index_];
+         return std::string( &document_->strings_[node.value_.first_], node.count_ );
+      }
+   case booleanValue:
+      return document_->nodes_[index_].value_.bool_ ? "true" : "false";
+   default:
+      return "";
+   }
+}
+
+
+UInt
+Document::Node::size() const
+{
+   if ( !isArray()  &&  !isObject() )
+      return 0;
+   return document_->nodes_[index_].count_;
+}
+
+
+Document::Node
+Document::Node::operator[]( UInt index ) const
+{
+   if ( index >= size() )
+      return Node();
+   return Node( document_, document_->nodes_[index_].value_.first_ + index );
+}
+
+
+Document::Node
+Document::Node::operator[]( const char *key ) const
+{
+   if ( !isObject() )
+      return Node();
+   Index id = document_->findKey( key, strlen( key ) );
+   if ( id == npos )
+      return Node();
+   const NodeData &node = document_->nodes_[index_];
+   for ( Index child = node.value_.first_ + node.count_; child-- > node.value_.first_; )
+   {
+      if ( document_->nodes_[child].key_ == id )
+         return Node( document_, child );
+   }
+   return Node();
+}
+
+
+Document::Node
+Document::Node::operator[]( const std::string &key ) const
+{
+   return (*this)[ key.c_str() ];
+}
+
+
+bool
+Document::Node::isMember( const char *key ) const
+{
+   return (*this)[ key ].document_ != 0;
+}
+
+
+const char *
+Document::Node::memberName( UInt index ) const
+{
+   if ( !isObject()  ||  index >= size() )
+      return "";
+   Index id = document_->nodes_[document_->nodes_[index_].value_.first_ + index].key_;
+   return &document_->keyChars_[document_->keyOffsets_[id]];
+}
+
+
+void
+Document::Node::toValue( Value &value ) const
+{
+   if ( !document_ )
+   {
+      value = Value();
+      return;
+   }
+   const NodeData &node = document_->nodes_[index_];
+   switch ( node.type_ )
+   {
+   case nullValue:
+      value = Value();
+      break;
+   case intValue:
+      value = Value( node.value_.int_ );
+      break;
+   case uintValue:
+      value = Value( node.value_.uint_ );
+      break;
+   case realValue:
+      value = Value( node.value_.real_ );
+      break;
+   case booleanValue:
+      value = Value( node.value_.bool_ );
+      break;
+   case stringValue:
+      {
+         const char *begin = &document_->strings_[node.value_.first_];
+         value = Value( begin, begin + node.count_ );
+      }
+      break;
+   case arrayValue:
+      value = Value( arrayValue );
+      if ( node.count_ > 0 )
+         value.resize( node.count_ );
+      for ( Index index = 0; index < node.count_; ++index )
+         Node( document_, node.value_.first_ + index ).toValue( value[index] );
+      break;
+   case objectValue:
+      value = Value( objectValue );
+      for ( Index index = 0; index < node.count_; ++index )
+      {
+         Index child = node.value_.first_ + index;
+         const char *key = &document_->keyChars_[document_->keyOffsets_[document_->nodes_[child].key_]];
+         Node( document_, child ).toValue( value[key] );
+      }
+      break;
+   }
+}
+
+
+// Implementation of class FastReader
+// ////////////////////////////////
+
+static inline bool
+isNumberChar( char c )
+{
+   return ( c >= '0'  &&  c <= '9' )  ||  c == '.'  ||  c == 'e'  ||  c == 'E'  ||  c == '+'  ||  c == '-';
+}
+
+
+static void
+appendCodePointAsUTF8( unsigned int cp, std::vector<char> &out )
+{
+   // based on description from http://en.wikipedia.org/wiki/UTF-8
+   if ( cp <= 0x7f )
+   {
+      out.push_back( static_cast<char>( cp ) );
+   }
+   else if ( cp <= 0x7FF )
+   {
+      out.push_back( static_cast<char>( 0xC0 | ( 0x1f & ( cp >> 6 ) ) ) );
+      out.push_back( static_cast<char>( 0x80 | ( 0x3f & cp ) ) );
+   }
+   else if ( cp <= 0xFFFF )
+   {
+      out.push_back( static_cast<char>( 0xE0 | ( 0xf & ( cp >> 12 ) ) ) );
+      out.push_back( static_cast<char>( 0x80 | ( 0x3f & ( cp >> 6 ) ) ) );
+      out.push_back( static_cast<char>( 0x80 | ( 0x3f & cp ) ) );
+   }
+   else if ( cp <= 0x10FFFF )
+   {
+      out.push_back( static_cast<char>( 0xF0 | ( 0x7 & ( cp >> 18 ) ) ) );
+      out.push_back( static_cast<char>( 0x80 | ( 0x3f & ( cp >> 12 ) ) ) );
+      out.push_back( static_cast<char>( 0x80 | ( 0x3f & ( cp >> 6 ) ) ) );
+      out.push_back( static_cast<char>( 0x80 | ( 0x3f & cp ) ) );
+   }
+}
+
+
+static std::string
+locationLineAndColumn( const char *begin, const char *end, const char *location )
+{
+   const char *current = begin;
+   const char *lastLineStart = current;
+   int line = 0;
+   while ( current < location  &&  current != end )
+   {
+      char c = *current++;
+      if ( c == '\r' )
+      {
+         if ( current != end  &&  *current == '\n' )
+            ++current;
+         lastLineStart = current;
+         ++line;
+      }
+      else if ( c == '\n' )
+      {
+         lastLineStart = current;
+         ++line;
+      }
+   }
+   // column & line start at 1
+   char buffer[18+16+16+1];
+   sprintf( buffer, "Line %d, Column %d", line + 1, int( location - lastLineStart ) + 1 );
+   return buffer;
+}
+
+
+FastReader::FastReader()
+   : features_( Features::all() )
+   , document_( 0 )
+   , begin_( 0 )
+   , end_( 0 )
+   , current_( 0 )
+{
+}
+
+
+FastReader::FastReader( const Features &features )
+   : features_( features )
+   , document_( 0 )
+   , begin_( 0 )
+   , end_( 0 )
+   , current_( 0 )
+{
+}
+
+
+bool
+FastReader::parse( const std::string &document, Document &root )
+{
+   return parse( document.data(), document.data() + document.size(), root );
+}
+
+
+bool
+FastReader::parseFile( const std::string &filename, Document &document )
+{
+   MappedFile file( filename );
+   if ( !file.isOpen() )
+   {
+      document.clear();
+      errors_ = "* Could not open " + filename + "\n";
+      return false;
+   }
+   return parse( file.begin(), file.end(), document );
+}
+
+
+bool
+FastReader::parse( const char *beginDoc, const char *endDoc, Value &root )
+{
+   Document document;
+   if ( !parse( beginDoc, endDoc, document ) )
+      return false;
+   document.toValue( root );
+   return true;
+}
+
+
+bool
+FastReader::parseFile( const std::string &filename, Value &root )
+{
+   Document document;
+   if ( !parseFile( filename, document ) )
+      return false;
+   document.toValue( root );
+   return true;
+}
+
+
+bool
+FastReader::parse( const char *beginDoc, const char *endDoc, Document &document )
+{
+   document.clear();
+   document_ = &document;
+   begin_ = beginDoc;
+   end_ = endDoc;
+   current_ = begin_;
+   errors_.clear();
+   stack_.clear();
+
+   // a rough guess that saves most of the reallocations of a typical document
+   size_t length = endDoc - beginDoc;
+   document.nodes_.reserve( length / 16 );
+   document.strings_.reserve( length / 4 );
+
+   bool successful = readValue();
+   if ( successful )
+   {
+      document.root_ = commit( 0 );
+      if ( features_.strictRoot_  &&  !document.root().isArray()  &&  !document.root().isObject() )
+      {
+         addError( "A valid JSON document must be either an array or an object value.", beginDoc );
+         successful = false;
+      }
+   }
+   if ( !successful )
+      document.clear();
+   document_ = 0;
+   return successful;
+}
+
+
+Document::Index
+FastReader::commit( size_t mark )
+{
+   std::vector<Document::NodeData> &nodes = document_->nodes_;
+   Document::Index first = Document::Index( nodes.size() );
+   nodes.insert( nodes.end(), stack_.begin() + mark, stack_.end() );
+   stack_.resize( mark );
+   return first;
+}
+
+
+bool
+FastReader::skipSpaces()
+{
+   while ( current_ != end_ )
+   {
+      char c = *current_;
+      if ( c == ' '  ||  c == '\t'  ||  c == '\r'  ||  c == '\n' )
+      {
+         ++current_;
+      }
+      else if ( c == '/'  &&  features_.allowComments_ )
+      {
+         Location commentBegin = current_++;
+         if ( current_ != end_  &&  *current_ == '*' )
+         {
+            ++current_;
+            while ( current_ != end_  &&  !( *current_ == '*'  &&  current_ + 1 != end_  &&  current_[1] == '/' ) )
+               ++current_;
+            if ( current_ == end_ )
+               return addError( "Unterminated comment.", commentBegin );
+            current_ += 2;
+         }
+         else if ( current_ != end_  &&  *current_ == '/' )
+         {
+            while ( current_ != end_  &&  *current_ != '\r'  &&  *current_ != '\n' )
+               ++current_;
+         }
+         else
+         {
+            return addError( "Syntax error: value, object or array expected.", commentBegin );
+         }
+      }
+      else
+      {
+         break;
+      }
+   }
+   return true;
+}
+
+
+void
+FastReader::skipWhitespace()
+{
+   while ( current_ != end_  &&  ( *current_ == ' '  ||  *current_ == '\t'  ||  *current_ == '\r'  ||  *current_ == '\n' ) )
+      ++current_;
+}
+
+
+bool
+FastReader::match( const char *pattern, int patternLength )
+{
+   if ( end_ - current_ < patternLength )
+      return false;
+   if ( memcmp( current_, pattern, patternLength ) != 0 )
+      return false;
+   current_ += patternLength;
+   return true;
+}
+
+
+bool
+FastReader::readValue()
+{
+   if ( !skipSpaces() )
+      return false;
+   Location start = current_;
+   if ( current_ == end_ )
+      return addError( "Syntax error: value, object or array expected.", start );
+
+   Document::NodeData node;
+   node.key_ = Document::npos;
+   node.count_ = 0;
+   switch ( *current_ )
+   {
+   case '{':
+      ++current_;
+      return readObject();
+   case '[':
+      ++current_;
+      return readArray();
+   case '"':
+      {
+         Location begin, end;
+         if ( !readString( begin, end ) )
+            return false;
+         std::vector<char> &strings = document_->strings_;
+         node.type_ = stringValue;
+         node.value_.first_ = Document::Index( strings.size() );
+         if ( !decodeString( begin, end, strings ) )
+            return false;
+         node.count_ = Document::Index( strings.size() - node.value_.first_ );
+         strings.push_back( 0 );
+      }
+      break;
+   case 't':
+      ++current_;
+      if ( !match( "rue", 3 ) )
+         return addError( "Syntax error: value, object or array expected.", start );
+      node.type_ = booleanValue;
+      node.value_.bool_ = true;
+      break;
+   case 'f':
+      ++current_;
+      if ( !match( "alse", 4 ) )
+         return addError( "Syntax error: value, object or array expected.", start );
+      node.type_ = booleanValue;
+      node.value_.bool_ = false;
+      break;
+   case 'n':
+      ++current_;
+      if ( !match( "ull", 3 ) )
+         return addError( "Syntax error: value, object or array expected.", start );
+      node.type_ = nullValue;
+      break;
+   default:
+      if ( *current_ == '-'  ||  ( *current_ >= '0'  &&  *current_ <= '9' ) )
+         return readNumber();
+      return addError( "Syntax error: value, object or array expected.", start );
+   }
+   stack_.push_back( node );
+   return true;
+}
+
+
+bool
+FastReader::readObject()
+{
+   size_t mark = stack_.size();
+   if ( !skipSpaces() )
+      return false;
+   if ( current_ != end_  &&  *current_ == '}' )
+   {
+      ++current_;
+   }
+   else
+   {
+      while ( true )
+      {
+         if ( current_ == end_  ||  *current_ != '"' )
+            return addError( "Missing '}' or object member name", current_ );
+         Location begin, end;
+         if ( !readString( begin, end ) )
+            return false;
+         scratch_.clear();
+         if ( !decodeString( begin, end, scratch_ ) )
+            return false;
+         Document::Index key = document_->internKey( scratch_.empty() ? "" : &scratch_[0], scratch_.size() );
+
+         // Reader takes no comment between a member name and its colon
+         skipWhitespace();
+         if ( current_ == end_  ||  *current_ != ':' )
+            return addError( "Missing ':' after object member name", current_ );
+         ++current_;
+
+         if ( !readValue() )
+            return false;
+         stack_.back().key_ = key;
+
+         if ( !skipSpaces() )
+            return false;
+         if ( current_ != end_  &&  *current_ == '}' )
+         {
+            ++current_;
+            break;
+         }
+         if ( current_ == end_  ||  *current_ != ',' )
+            return addError( "Missing ',' or '}' in object declaration", current_ );
+         ++current_;
+         if ( !skipSpaces() )
+            return false;
+      }
+   }
+
+   Document::NodeData node;
+   node.type_ = objectValue;
+   node.key_ = Document::npos;
+   node.count_ = Document::Index( stack_.size() - mark );
+   node.value_.first_ = commit( mark );
+   stack_.push_back( node );
+   return true;
+}
+
+
+bool
+FastReader::readArray()
+{
+   size_t mark = stack_.size();
+   // nor in an empty array: a comment here has to be followed by a value
+   skipWhitespace();
+   if ( current_ != end_  &&  *current_ == ']' )
+   {
+      ++current_;
+   }
+   else
+   {
+      while ( true )
+      {
+         if ( !readValue() )
+            return false;
+         if ( !skipSpaces() )
+            return false;
+         if ( current_ != end_  &&  *current_ == ']' )
+         {
+            ++current_;
+            break;
+         }
+         if ( current_ == end_  ||  *current_ != ',' )
+            return addError( "Missing ',' or ']' in array declaration", current_ );
+         ++current_;
+      }
+   }
+
+   Document::NodeData node;
+   node.type_ = arrayValue;
+   node.key_ = Document::npos;
+   node.count_ = Document::Index( stack_.size() - mark );
+   node.value_.first_ = commit( mark );
+   stack_.push_back( node );
+   return true;
+}
+
+
+bool
+FastReader::readString( Location &begin, Location &end )
+{
+   Location start = current_++;
+   begin = current_;
+   while ( current_ != end_ )
+   {
+      char c = *current_;
+      if ( c == '"' )
+      {
+         end = current_++;
+         return true;
+      }
+      current_ += ( c == '\\'  &&  current_ + 1 != end_ ) ? 2 : 1;
+   }
+   return addError( "Missing '\"' at the end of the string", start );
+}
+
+
+bool
+FastReader::decodeString( Location begin, Location end, std::vector<char> &decoded )
+{
+   Location current = begin;
+   while ( current != end )
+   {
+      // copy the plain characters up to the next escape in one go
+      Location plain = current;
+      while ( current != end  &&  *current != '\\' )
+         ++current;
+      decoded.insert( decoded.end(), plain, current );
+      if ( current == end )
+         break;
+
+      ++current;
+      if ( current == end )
+         return addError( "Empty escape sequence in string", begin - 1, current );
+      char escape = *current++;
+      switch ( escape )
+      {
+      case '"': decoded.push_back( '"' ); break;
+      case '/': decoded.push_back( '/' ); break;
+      case '\\': decoded.push_back( '\\' ); break;
+      case 'b': decoded.push_back( '\b' ); break;
+      case 'f': decoded.push_back( '\f' ); break;
+      case 'n': decoded.push_back( '\n' ); break;
+      case 'r': decoded.push_back( '\r' ); break;
+      case 't': decoded.push_back( '\t' ); break;
+      case 'u':
+         {
+            unsigned int unicode;
+            if ( !decodeUnicodeCodePoint( current, end, unicode ) )
+               return false;
+            appendCodePointAsUTF8( unicode, decoded );
+         }
+         break;
+      default:
+         return addError( "Bad escape sequence in string", begin - 1, current );
+      }
+   }
+   return true;
+}
+
+
+bool
+FastReader::decodeUnicodeCodePoint( Location &current, Location end, unsigned int &unicode )
+{
+   if ( !decodeUnicodeEscapeSequence( current, end, unicode ) )
+      return false;
+   if ( unicode >= 0xD800  &&  unicode <= 0xDBFF )
+   {
+      // surrogate pairs
+      if ( end - current < 6 )
+         return addError( "additional six characters expected to parse unicode surrogate pair.", current, current );
+      unsigned int surrogatePair;
+      if ( *(current++) == '\\'  &&  *(current++) == 'u' )
+      {
+         if ( !decodeUnicodeEscapeSequence( current, end, surrogatePair ) )
+            return false;
+         unicode = 0x10000 + ( ( unicode & 0x3FF ) << 10 ) + ( surrogatePair & 0x3FF );
+      }
+      else
+         return addError( "expecting another \\u token to begin the second half of a unicode surrogate pair",
+                          current, current );
+   }
+   return true;
+}
+
+
+bool
+FastReader::decodeUnicodeEscapeSequence( Location &current, Location end, unsigned int &unicode )
+{
+   if ( end - current < 4 )
+      return addError( "Bad unicode escape sequence in string: four digits expected.", current, current );
+   unicode = 0;
+   for ( int index = 0; index < 4; ++index )
+   {
+      char c = *current++;
+      unicode *= 16;
+      if ( c >= '0'  &&  c <= '9' )
+         unicode += c - '0';
+      else if ( c >= 'a'  &&  c <= 'f' )
+         unicode += c - 'a' + 10;
+      else if ( c >= 'A'  &&  c <= 'F' )
+         unicode += c - 'A' + 10;
+      else
+         return addError( "Bad unicode escape sequence in string: hexadecimal digit expected.", current, current );
+   }
+   return true;
+}
+
+
+bool
+FastReader::readNumber()
+{
+   // the same characters, and the same choice between integer and double, as Reader
+   Location start = current_;
+   bool isDouble = false;
+   while ( current_ != end_  &&  isNumberChar( *current_ ) )
+   {
+      char c = *current_;
+      isDouble = isDouble  ||  c == '.'  ||  c == 'e'  ||  c == 'E'  ||  c == '+'  ||  ( c == '-'  &&  current_ != start );
+      ++current_;
+   }
+
+   Document::NodeData node;
+   node.key_ = Document::npos;
+   node.count_ = 0;
+   if ( !isDouble )
+   {
+      Location current = start;
+      bool isNegative = *current == '-';
+      if ( isNegative )
+         ++current;
+      UInt threshold = ( isNegative ? UInt( Value::maxInt ) + 1 : Value::maxUInt ) / 10;
+      UInt value = 0;
+      while ( current < current_  &&  !isDouble )
+      {
+         char c = *current++;
+         if ( value >= threshold )
+            isDouble = true;
+         else
+            value = value * 10 + UInt( c - '0' );
+      }
+      if ( !isDouble )
+      {
+         if ( isNegative )
+         {
+            node.type_ = intValue;
+            node.value_.int_ = -Int( value );
+         }
+         else if ( value <= UInt( Value::maxInt ) )
+         {
+            node.type_ = intValue;
+            node.value_.int_ = Int( value );
+         }
+         else
+         {
+            node.type_ = uintValue;
+            node.value_.uint_ = value;
+         }
+      }
+   }
+   if ( isDouble )
+   {
+      node.type_ = realValue;
+      if ( !decodeDouble( start, current_, node.value_.real_ ) )
+         return false;
+   }
+   stack_.push_back( node );
+   return true;
+}
+
+
+bool
+FastReader::decodeDouble( Location begin, Location end, double &value )
+{
+   // the text isn't NUL terminated, a mapped file may end right after the number
+   const int bufferSize = 32;
+   size_t length = end - begin;
+   char buffer[bufferSize + 1];
+   const char *text = buffer;
+   std::string longText;
+   if ( length <= bufferSize )
+   {
+      memcpy( buffer, begin, length );
+      buffer[length] = 0;
+   }
+   else
+   {
+      longText.assign( begin, end );
+      text = longText.c_str();
+   }
+
+   char *parsed;
+   value = strtod( text, &parsed );
+   if ( parsed == text )
+      return addError( "'" + std::string( begin, end ) + "' is not a number.", begin );
+   return true;
+}
+
+
+bool
+FastReader::addError( const std::string &message, Location location, Location extra )
+{
+   errors_ += "* " + locationLineAndColumn( begin_, end_, location ) + "\n";
+   errors_ += "  " + message + "\n";
+   if ( extra )
+      errors_ += "See " + locationLineAndColumn( begin_, end_, extra ) + " for detail.\n";
+   return false;
+}
+
+
+std::string
+FastReader::getFormatedErrorMessages() const
+{
+   return errors_;
+}
+
+
+} // namespace Json
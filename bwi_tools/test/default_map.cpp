@@ -0,0 +1,166 @@
+#include <bwi_tools/common/DefaultMap.h>
+#include <gtest/gtest.h>
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <functional>
+#include <map>
+#include <string>
+
+// Every storage kind has to behave the same
+template <class Storage>
+class DefaultMapTest : public ::testing::Test {};
+
+typedef ::testing::Types<std::map<int,double>,
+                         boost::unordered_map<int,double>,
+                         FlatHashMap<int,double> > Storages;
+TYPED_TEST_CASE(DefaultMapTest, Storages);
+
+TYPED_TEST(DefaultMapTest, GetDoesNotInsert) {
+  DefaultMap<int,double,TypeParam> map(-1.5);
+  EXPECT_EQ(-1.5, map.get(3));
+  EXPECT_EQ(0u, map.size());
+}
+
+TYPED_TEST(DefaultMapTest, IndexingInsertsTheDefault) {
+  DefaultMap<int,double,TypeParam> map(2.0);
+  EXPECT_EQ(2.0, map[7]);
+  EXPECT_EQ(1u, map.size());
+  map[7] += 1.0;
+  EXPECT_EQ(3.0, map.get(7));
+  map.set(8, 4.0);
+  EXPECT_EQ(4.0, map[8]);
+  EXPECT_EQ(2u, map.size());
+}
+
+TYPED_TEST(DefaultMapTest, EraseAndClear) {
+  DefaultMap<int,double,TypeParam> map(0.0);
+  for (int i = 0; i < 100; ++i)
+    map.set(i, i);
+  EXPECT_EQ(1u, map.erase(50));
+  EXPECT_EQ(0u, map.erase(50));
+  EXPECT_EQ(0.0, map.get(50));
+  map.erase(map.begin());
+  EXPECT_EQ(98u, map.size());
+  map.clear();
+  EXPECT_EQ(0u, map.size());
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+TYPED_TEST(DefaultMapTest, IterationVisitsEveryEntry) {
+  DefaultMap<int,double,TypeParam> map(0.0);
+  map.reserve(1000);
+  for (int i = 0; i < 1000; ++i)
+    map.set(3 * i, i);
+  double sum = 0;
+  unsigned int count = 0;
+  const DefaultMap<int,double,TypeParam> &constMap = map;
+  for (typename DefaultMap<int,double,TypeParam>::const_iterator it = constMap.begin(); it != constMap.end(); ++it) {
+    EXPECT_EQ(it->first / 3, it->second);
+    sum += it->second;
+    ++count;
+  }
+  EXPECT_EQ(1000u, count);
+  EXPECT_EQ(999 * 1000 / 2, sum);
+}
+
+TYPED_TEST(DefaultMapTest, MergeAndScale) {
+  DefaultMap<int,double,TypeParam> values(1.0);
+  values.set(1, 10.0);
+  values.set(2, 20.0);
+
+  DefaultMap<int,double,FlatHashMap<int,double> > update(0.0);
+  update.set(2, 5.0);
+  update.set(3, 7.0);
+
+  DefaultMap<int,double,TypeParam> replaced(values);
+  replaced.merge(update);
+  EXPECT_EQ(10.0, replaced.get(1));
+  EXPECT_EQ(5.0, replaced.get(2));
+  EXPECT_EQ(7.0, replaced.get(3));
+
+  // keys missing on this side start from the default
+  values.merge(update, std::plus<double>());
+  EXPECT_EQ(10.0, values.get(1));
+  EXPECT_EQ(25.0, values.get(2));
+  EXPECT_EQ(8.0, values.get(3));
+
+  values.scale(0.5);
+  EXPECT_EQ(5.0, values.get(1));
+  EXPECT_EQ(12.5, values.get(2));
+  EXPECT_EQ(4.0, values.get(3));
+  EXPECT_EQ(1.0, values.get(4));
+}
+
+TYPED_TEST(DefaultMapTest, MatchesStdMapUnderRandomOperations) {
+  DefaultMap<int,double,TypeParam> map(0.5);
+  std::map<int,double> reference;
+  boost::random::mt19937 rng(17);
+  boost::random::uniform_int_distribution<int> keys(0, 300), ops(0, 3);
+  for (int step = 0; step < 20000; ++step) {
+    int key = keys(rng);
+    switch (ops(rng)) {
+      case 0:
+        map[key] += step;
+        if (reference.count(key) == 0)
+          reference[key] = 0.5;
+        reference[key] += step;
+        break;
+      case 1:
+        map.set(key, step);
+        reference[key] = step;
+        break;
+      case 2:
+        ASSERT_EQ(reference.erase(key), map.erase(key));
+        break;
+      default:
+        ASSERT_EQ(reference.count(key) ? reference[key] : 0.5, map.get(key));
+        break;
+    }
+    ASSERT_EQ(reference.size(), map.size());
+  }
+  for (std::map<int,double>::const_iterator it = reference.begin(); it != reference.end(); ++it)
+    EXPECT_EQ(it->second, map.get(it->first));
+}
+
+TEST(FlatHashMap, WorksWithStringKeys) {
+  FlatHashMap<std::string,int> map;
+  map["a"] = 1;
+  map["b"] = 2;
+  EXPECT_EQ(1u, map.count("a"));
+  EXPECT_EQ(1u, map.erase("a"));
+  EXPECT_EQ(0u, map.count("a"));
+  EXPECT_EQ(2, map.find("b")->second);
+  EXPECT_TRUE(map.find("c") == map.end());
+}
+
+TEST(FlatHashMap, FindingAKeyKeepsReferences) {
+  // six entries fill eight slots up to the load factor, so any new key would grow the table
+  FlatHashMap<int,double> map;
+  for (int key = 0; key < 6; ++key)
+    map[key] = key;
+  double &first = map.find(0)->second;
+  map[1] = map[5];
+  EXPECT_EQ(&first, &map[0]);
+  EXPECT_EQ(5.0, map.find(1)->second);
+  map[6] = 6.0;
+  EXPECT_EQ(7u, map.size());
+  EXPECT_EQ(6.0, map.find(6)->second);
+}
+
+TEST(FlatHashMap, HandlesPowerOfTwoStrides) {
+  FlatHashMap<int,int> map;
+  for (int i = 0; i < 4096; ++i)
+    map[i << 10] = i;
+  EXPECT_EQ(4096u, map.size());
+  for (int i = 0; i < 4096; i += 2)
+    EXPECT_EQ(1u, map.erase(i << 10));
+  for (int i = 0; i < 4096; ++i)
+    EXPECT_EQ(i % 2, (int) map.count(i << 10));
+  EXPECT_EQ(4095, map.find(4095 << 10)->second);
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
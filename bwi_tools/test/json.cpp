@@ -0,0 +1,130 @@
+#include <bwi_tools/json/json.h>
+#include <gtest/gtest.h>
+
+#include "json_document_generator.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using std::string;
+
+static void expectSameAsReader(const string &text) {
+  Json::Value expected;
+  Json::Reader reader;
+  ASSERT_TRUE(reader.parse(text, expected, false)) << text;
+
+  Json::Value actual;
+  Json::FastReader fastReader;
+  ASSERT_TRUE(fastReader.parse(text.data(), text.data() + text.size(), actual))
+    << fastReader.getFormatedErrorMessages() << text;
+
+  EXPECT_TRUE(expected == actual) << text;
+  Json::FastWriter writer;
+  EXPECT_EQ(writer.write(expected), writer.write(actual));
+}
+
+TEST(FastReader, MatchesReaderOnGeneratedDocuments) {
+  DocumentGenerator generator(42);
+  for (int i = 0; i < 500; ++i) {
+    expectSameAsReader(generator.generate(1 + i % 6));
+  }
+}
+
+TEST(FastReader, MatchesReaderOnScalars) {
+  const char *documents[] = {"0", "-1", "2147483648", "4294967296", "-2147483649", "1.5", "\"text\"", "true",
+                             "null", "  [ ] ", "{}", "{\"a\": 1, \"a\": 2}", "[1, [2, [3, {\"b\": []}]]]"};
+  for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); ++i) {
+    expectSameAsReader(documents[i]);
+  }
+}
+
+TEST(FastReader, RejectsMalformedDocuments) {
+  const char *documents[] = {"", "{", "[1, 2", "[1,]", "{\"a\" 1}", "{\"a\": 1,}", "{\"a\": 1 \"b\": 2}",
+                             "\"unterminated", "\"bad \\q escape\"", "\"\\u12\"", "tru", "nul", "/* open",
+                             "{1: 2}", "@"};
+  Json::FastReader reader;
+  for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); ++i) {
+    const string text = documents[i];
+    Json::Document document;
+    EXPECT_FALSE(reader.parse(text, document)) << text;
+    EXPECT_FALSE(reader.getFormatedErrorMessages().empty()) << text;
+    EXPECT_TRUE(document.root().isNull());
+
+    Json::Value ignored;
+    EXPECT_FALSE(Json::Reader().parse(text, ignored, false)) << text;
+  }
+}
+
+TEST(FastReader, TakesCommentsWhereReaderDoes) {
+  expectSameAsReader("{ /* c */ \"a\" : /* c */ 1 /* c */ , // c\n \"b\": [ /* c */ 2 /* c */ ] }");
+  expectSameAsReader("{ /* c */ }");
+
+  const char *documents[] = {"{\"a\" /* c */ : 1}", "{\"a\" // c\n : 1}", "[/* c */]", "[ // c\n ]"};
+  Json::FastReader reader;
+  for (size_t i = 0; i < sizeof(documents) / sizeof(documents[0]); ++i) {
+    const string text = documents[i];
+    Json::Document document;
+    EXPECT_FALSE(reader.parse(text, document)) << text;
+
+    Json::Value ignored;
+    EXPECT_FALSE(Json::Reader().parse(text, ignored, false)) << text;
+  }
+}
+
+TEST(FastReader, StrictModeRules) {
+  Json::FastReader reader(Json::Features::strictMode());
+  Json::Document document;
+  EXPECT_FALSE(reader.parse("1", document));
+  EXPECT_FALSE(reader.parse("[1 /* comment */]", document));
+  EXPECT_TRUE(reader.parse("[1]", document));
+}
+
+TEST(Document, NodeAccess) {
+  const string text = "{\"name\": \"robot\", \"size\": [1, 2.5, -3], \"nested\": {\"on\": true}, \"name\": \"bot\"}";
+  Json::FastReader reader;
+  Json::Document document;
+  ASSERT_TRUE(reader.parse(text, document));
+
+  Json::Document::Node root = document.root();
+  ASSERT_TRUE(root.isObject());
+  EXPECT_EQ(4u, root.size());
+  EXPECT_STREQ("size", root.memberName(1));
+  // the last of a repeated member wins, as in Value
+  EXPECT_EQ("bot", root["name"].asString());
+  EXPECT_EQ(3u, root["size"].size());
+  EXPECT_EQ(1, root["size"][0u].asInt());
+  EXPECT_DOUBLE_EQ(2.5, root["size"][1u].asDouble());
+  EXPECT_EQ(-3, root["size"][2u].asInt());
+  EXPECT_TRUE(root["nested"]["on"].asBool());
+  EXPECT_TRUE(root["missing"].isNull());
+  EXPECT_TRUE(root["size"][7u].isNull());
+  EXPECT_FALSE(root.isMember("missing"));
+}
+
+TEST(FastReader, ParsesMappedFiles) {
+  DocumentGenerator generator(7);
+  const string text = generator.generate(5);
+  char filename[] = "/tmp/bwi_tools_json_XXXXXX";
+  int fd = mkstemp(filename);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  std::ofstream(filename) << text;
+
+  Json::Value expected;
+  ASSERT_TRUE(Json::Reader().parse(text, expected, false));
+  Json::Value actual;
+  Json::FastReader reader;
+  EXPECT_TRUE(reader.parseFile(filename, actual)) << reader.getFormatedErrorMessages();
+  EXPECT_TRUE(expected == actual);
+  remove(filename);
+
+  EXPECT_FALSE(reader.parseFile(filename, actual));
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,140 @@
+#ifndef BWI_TOOLS_TEST_JSON_DOCUMENT_GENERATOR_H
+#define BWI_TOOLS_TEST_JSON_DOCUMENT_GENERATOR_H
+
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_int_distribution.hpp>
+#include <boost/random/uniform_real_distribution.hpp>
+#include <cstdio>
+#include <sstream>
+#include <string>
+
+// Writes random documents using everything Reader understands: comments, odd spacing, escapes,
+// surrogate pairs, integers on both sides of the Int/UInt limits and doubles in every notation
+class DocumentGenerator {
+public:
+  explicit DocumentGenerator(unsigned int seed) : rng(seed) {}
+
+  std::string generate(int depth) {
+    std::ostringstream out;
+    space(out);
+    writeValue(out, depth, true);
+    space(out);
+    return out.str();
+  }
+
+private:
+  int uniform(int min, int max) {
+    return boost::random::uniform_int_distribution<int>(min, max)(rng);
+  }
+
+  // Reader doesn't take comments everywhere: not between a member name and its colon, nor in an empty array
+  void space(std::ostringstream &out, bool comments = true) {
+    int kind = uniform(0, 7);
+    if (!comments && (kind == 1 || kind == 2)) {
+      kind = 0;
+    }
+    switch (kind) {
+      case 0: out << "\n  "; break;
+      case 1: out << " /* block\n comment */ "; break;
+      case 2: out << " // line comment\n"; break;
+      case 3: out << "\t\r\n"; break;
+      default: break;
+    }
+  }
+
+  void writeString(std::ostringstream &out, bool key) {
+    static const char *escapes[] = {"\\\"", "\\\\", "\\/", "\\b", "\\f", "\\n", "\\r", "\\t", "\\u00e9",
+                                    "\\u20AC", "\\ud83d\\ude00", "\\u0041"};
+    // a small vocabulary of keys, so they repeat across objects the way they do in real files
+    if (key && uniform(0, 3) > 0) {
+      out << "\"key" << uniform(0, 20) << "\"";
+      return;
+    }
+    out << '"';
+    int length = uniform(0, 12);
+    for (int i = 0; i < length; ++i) {
+      if (uniform(0, 5) == 0) {
+        out << escapes[uniform(0, 11)];
+      } else {
+        out << (char) uniform('a', 'z');
+      }
+    }
+    out << '"';
+  }
+
+  void writeNumber(std::ostringstream &out) {
+    static const char *edges[] = {"2147483647", "2147483648", "-2147483648", "-2147483649", "4294967295",
+                                  "4294967296", "0", "-0", "1e3", "1E-3", "-2.5e+10", "0.1", "123456789012345678901"};
+    char buffer[64];
+    switch (uniform(0, 3)) {
+      case 0:
+        out << edges[uniform(0, 12)];
+        break;
+      case 1:
+        out << uniform(-100000, 100000);
+        break;
+      case 2:
+        sprintf(buffer, "%.17g", boost::random::uniform_real_distribution<double>(-1e6, 1e6)(rng));
+        out << buffer;
+        break;
+      default:
+        sprintf(buffer, "%.6e", boost::random::uniform_real_distribution<double>(-1, 1)(rng));
+        out << buffer;
+        break;
+    }
+  }
+
+  void writeValue(std::ostringstream &out, int depth, bool container) {
+    int kind = container ? uniform(0, 1) : uniform(depth > 0 ? 0 : 2, 7);
+    switch (kind) {
+      case 0: {
+        out << '{';
+        space(out);
+        int members = uniform(0, 6);
+        for (int i = 0; i < members; ++i) {
+          if (i > 0) {
+            out << ',';
+            space(out);
+          }
+          writeString(out, true);
+          space(out, false);
+          out << ':';
+          space(out);
+          writeValue(out, depth - 1, false);
+          space(out);
+        }
+        out << '}';
+        break;
+      }
+      case 1: {
+        out << '[';
+        int elements = uniform(0, 6);
+        space(out, elements > 0);
+        for (int i = 0; i < elements; ++i) {
+          if (i > 0) {
+            out << ',';
+            space(out);
+          }
+          writeValue(out, depth - 1, false);
+          space(out);
+        }
+        out << ']';
+        break;
+      }
+      case 2:
+        writeString(out, false);
+        break;
+      case 3:
+      case 4:
+        writeNumber(out);
+        break;
+      case 5: out << "true"; break;
+      case 6: out << "false"; break;
+      default: out << "null"; break;
+    }
+  }
+
+  boost::random::mt19937 rng;
+};
+
+#endif /* end of include guard: BWI_TOOLS_TEST_JSON_DOCUMENT_GENERATOR_H */
@@ -0,0 +1,157 @@
+#include <bwi_tools/record_writer.h>
+#include <gtest/gtest.h>
+
+#include <boost/lexical_cast.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+
+using std::string;
+using std::vector;
+using bwi_tools::RecordStreamWriter;
+
+typedef std::map<string, string> Record;
+
+static string temporaryFile() {
+  char filename[] = "/tmp/bwi_tools_records_XXXXXX";
+  int fd = mkstemp(filename);
+  close(fd);
+  return filename;
+}
+
+static string readFile(const string &filename) {
+  std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+  std::ostringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+static Record record(const char *keys[], const char *values[], int count) {
+  Record result;
+  for (int i = 0; i < count; ++i) {
+    result[keys[i]] = values[i];
+  }
+  return result;
+}
+
+static void expectSameAsWriteRecordsAsCSV(const vector<Record> &records) {
+  string expected_file = temporaryFile();
+  ASSERT_TRUE(bwi_tools::writeRecordsAsCSV(expected_file, records));
+
+  string actual_file = temporaryFile();
+  {
+    RecordStreamWriter writer(actual_file);
+    ASSERT_TRUE(writer.isOpen());
+    for (size_t i = 0; i < records.size(); ++i) {
+      EXPECT_TRUE(writer.write(records[i]));
+    }
+    EXPECT_TRUE(writer.close());
+    EXPECT_EQ(records.size(), writer.rows());
+  }
+
+  EXPECT_EQ(readFile(expected_file), readFile(actual_file));
+  remove(expected_file.c_str());
+  remove(actual_file.c_str());
+}
+
+TEST(RecordStreamWriter, MatchesWriteRecordsAsCSVWithFixedColumns) {
+  vector<Record> records;
+  for (int i = 0; i < 100; ++i) {
+    Record r;
+    r["episode"] = boost::lexical_cast<string>(i);
+    r["reward"] = boost::lexical_cast<string>(i * 0.5);
+    r["steps"] = boost::lexical_cast<string>(3 * i);
+    records.push_back(r);
+  }
+  expectSameAsWriteRecordsAsCSV(records);
+}
+
+TEST(RecordStreamWriter, MatchesWriteRecordsAsCSVWithLateAndMissingColumns) {
+  const char *first_keys[] = {"m", "z"};
+  const char *first_values[] = {"1", "2"};
+  const char *late_keys[] = {"a", "m", "q", "z"};
+  const char *late_values[] = {"3", "4", "5", "6"};
+  const char *sparse_keys[] = {"q"};
+  const char *sparse_values[] = {"7"};
+
+  vector<Record> records;
+  records.push_back(record(first_keys, first_values, 2));
+  records.push_back(record(late_keys, late_values, 4));
+  records.push_back(record(sparse_keys, sparse_values, 1));
+  records.push_back(Record());
+  records.push_back(record(first_keys, first_values, 2));
+  expectSameAsWriteRecordsAsCSV(records);
+}
+
+TEST(RecordStreamWriter, MatchesWriteRecordsAsCSVWithEmptyFirstRecords) {
+  const char *keys[] = {"a", "b"};
+  const char *values[] = {"1", ""};
+
+  vector<Record> records;
+  records.push_back(Record());
+  records.push_back(Record());
+  records.push_back(record(keys, values, 2));
+  records.push_back(record(keys + 1, values + 1, 1));
+  expectSameAsWriteRecordsAsCSV(records);
+
+  // an empty value in the only column is not a row without columns
+  records.clear();
+  records.push_back(record(keys + 1, values + 1, 1));
+  records.push_back(record(keys, values, 2));
+  expectSameAsWriteRecordsAsCSV(records);
+}
+
+TEST(RecordStreamWriter, MatchesWriteRecordsAsCSVWithoutRecords) {
+  expectSameAsWriteRecordsAsCSV(vector<Record>());
+}
+
+TEST(RecordStreamWriter, DeclaredColumnsKeepTheirOrder) {
+  vector<string> columns;
+  columns.push_back("time");
+  columns.push_back("action");
+  string filename = temporaryFile();
+  {
+    RecordStreamWriter writer(filename, RecordStreamWriter::CSV, columns, "NA");
+    Record first;
+    first["action"] = "goto";
+    first["time"] = "1.5";
+    writer.write(first);
+
+    vector<string> values;
+    values.push_back("2.0");
+    writer.writeRow(values);
+
+    // an undeclared column goes after the declared ones
+    Record late;
+    late["action"] = "open, then enter";
+    late["door"] = "d3_414a1";
+    writer.write(late);
+    EXPECT_TRUE(writer.close());
+  }
+  EXPECT_EQ("time,action,door\n"
+            "1.5,goto,NA\n"
+            "2.0,NA,NA\n"
+            "NA,\"open, then enter\",d3_414a1\n", readFile(filename));
+  remove(filename.c_str());
+}
+
+TEST(RecordStreamWriter, WritesJsonLines) {
+  string filename = temporaryFile();
+  {
+    RecordStreamWriter writer(filename, RecordStreamWriter::JSON_LINES);
+    Record first;
+    first["name"] = "say \"hi\"\n";
+    first["count"] = "3";
+    writer.write(first);
+    writer.write(Record());
+  }
+  EXPECT_EQ("{\"count\":\"3\",\"name\":\"say \\\"hi\\\"\\n\"}\n{}\n", readFile(filename));
+  remove(filename.c_str());
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
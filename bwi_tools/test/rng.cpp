@@ -0,0 +1,190 @@
+#include <bwi_tools/common/RNG.h>
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+using std::vector;
+
+TEST(RNG, FillMatchesSingleDraws) {
+  RNG single(7), batch(7);
+
+  vector<float> uniform(1000);
+  batch.fillUniform(uniform);
+  for (size_t i = 0; i < uniform.size(); ++i) {
+    ASSERT_EQ(single.randomFloat(), uniform[i]);
+  }
+
+  vector<int> ints(1000);
+  batch.fillInt(ints, -5, 17);
+  for (size_t i = 0; i < ints.size(); ++i) {
+    ASSERT_EQ(single.randomInt(-5, 17), ints[i]);
+  }
+
+  vector<int> poisson(1000);
+  batch.fillPoisson(poisson, 4);
+  for (size_t i = 0; i < poisson.size(); ++i) {
+    ASSERT_EQ(single.poissonInt(4), poisson[i]);
+  }
+}
+
+TEST(RNG, BatchStatistics) {
+  RNG rng(11);
+  const int n = 200000;
+
+  vector<float> uniform(n);
+  rng.fillUniform(uniform);
+  double sum = 0;
+  for (int i = 0; i < n; ++i) {
+    ASSERT_GE(uniform[i], 0.0f);
+    ASSERT_LT(uniform[i], 1.0f);
+    sum += uniform[i];
+  }
+  EXPECT_NEAR(0.5, sum / n, 0.005);
+
+  // every value of a small range about equally often
+  vector<int> ints(n);
+  rng.fillInt(ints, 0, 9);
+  vector<int> counts(10, 0);
+  for (int i = 0; i < n; ++i) {
+    ASSERT_GE(ints[i], 0);
+    ASSERT_LE(ints[i], 9);
+    counts[ints[i]]++;
+  }
+  for (int value = 0; value < 10; ++value) {
+    EXPECT_NEAR(n / 10, counts[value], n / 100);
+  }
+
+  vector<int> poisson(n);
+  rng.fillPoisson(poisson, 3);
+  sum = 0;
+  for (int i = 0; i < n; ++i) {
+    sum += poisson[i];
+  }
+  EXPECT_NEAR(3.0, sum / n, 0.03);
+}
+
+TEST(AliasTable, MatchesTheDistribution) {
+  vector<float> weights;
+  weights.push_back(1);
+  weights.push_back(0);
+  weights.push_back(5);
+  weights.push_back(2);
+  weights.push_back(0.5);
+  AliasTable table(weights);
+  ASSERT_EQ(weights.size(), table.size());
+
+  RNG rng(3);
+  const int n = 400000;
+  vector<int> draws(n);
+  rng.fillSelect(draws, table);
+  vector<int> counts(weights.size(), 0);
+  for (int i = 0; i < n; ++i) {
+    counts[draws[i]]++;
+  }
+  EXPECT_EQ(0, counts[1]);
+  for (size_t i = 0; i < weights.size(); ++i) {
+    EXPECT_NEAR(weights[i] / 8.5, double(counts[i]) / n, 0.005) << i;
+  }
+
+  EXPECT_EQ(0, AliasTable(vector<float>(1, 1.0f)).sample(0.999));
+}
+
+TEST(AliasTable, RejectsDegenerateWeights) {
+  EXPECT_THROW(AliasTable(vector<float>()), std::invalid_argument);
+  EXPECT_THROW(AliasTable(vector<float>(3, 0.0f)), std::invalid_argument);
+  EXPECT_THROW(AliasTable(vector<float>(2, -1.0f)), std::invalid_argument);
+  EXPECT_THROW(AliasTable(vector<float>(1, std::numeric_limits<float>::quiet_NaN())), std::invalid_argument);
+  EXPECT_THROW(AliasTable(vector<float>(1, std::numeric_limits<float>::infinity())), std::invalid_argument);
+  EXPECT_THROW(AliasTable().sample(0.5), std::logic_error);
+}
+
+TEST(RNG, RandomOrderingIsAPermutation) {
+  RNG rng(5);
+  vector<unsigned int> inds(100);
+  for (int round = 0; round < 100; ++round) {
+    rng.randomOrdering(inds);
+    vector<unsigned int> sorted(inds);
+    std::sort(sorted.begin(), sorted.end());
+    for (unsigned int i = 0; i < sorted.size(); ++i) {
+      ASSERT_EQ(i, sorted[i]);
+    }
+  }
+}
+
+TEST(StreamRNG, StreamsAreReproducibleAndSeekable) {
+  RNG rng(42);
+  StreamRNG a = rng.stream(3), b(42, 3), other = rng.stream(4);
+  vector<float> first(100), second(100), third(100);
+  a.fillUniform(first);
+  b.fillUniform(second);
+  other.fillUniform(third);
+  EXPECT_EQ(first, second);
+  EXPECT_NE(first, third);
+
+  // jumping ahead gives the same values as drawing up to there
+  StreamRNG seeker = rng.stream(3);
+  seeker.seek(50);
+  for (int i = 50; i < 100; ++i) {
+    EXPECT_EQ(first[i], seeker.randomFloat());
+  }
+  EXPECT_EQ(100u, seeker.position());
+
+  // streams aren't correlated with each other
+  double sum = 0, products = 0;
+  const int n = 100000;
+  for (int i = 0; i < n; ++i) {
+    double x = rng.stream(i).randomFloat() - 0.5, y = rng.stream(i + 1).randomFloat() - 0.5;
+    sum += x;
+    products += x * y;
+  }
+  EXPECT_NEAR(0.0, sum / n, 0.005);
+  EXPECT_NEAR(0.0, products / n, 0.001);
+}
+
+TEST(StreamRNG, ReseedingMovesTheStreams) {
+  RNG rng(1), expected(42);
+  rng.randomFloat();
+  rng.seed(42);
+  EXPECT_EQ(expected.randomFloat(), rng.randomFloat());
+
+  vector<float> reseeded(100), direct(100);
+  rng.stream(3).fillUniform(reseeded);
+  StreamRNG(42, 3).fillUniform(direct);
+  EXPECT_EQ(direct, reseeded);
+
+  rng.seed();
+  RNG fallback(boost::mt19937::default_seed);
+  EXPECT_EQ(fallback.randomFloat(), rng.randomFloat());
+  rng.stream(3).fillUniform(reseeded);
+  StreamRNG(boost::mt19937::default_seed, 3).fillUniform(direct);
+  EXPECT_EQ(direct, reseeded);
+}
+
+static void drawStream(unsigned int stream, vector<int> *out) {
+  StreamRNG rng(9, stream);
+  rng.fillInt(*out, 0, 1000);
+}
+
+TEST(StreamRNG, ThreadsGetDeterministicResults) {
+  const unsigned int threads = 4;
+  vector<vector<int> > concurrent(threads, vector<int>(10000)), sequential(threads, vector<int>(10000));
+  vector<std::thread> group;
+  for (unsigned int i = 0; i < threads; ++i) {
+    group.push_back(std::thread(drawStream, i, &concurrent[i]));
+  }
+  for (unsigned int i = 0; i < threads; ++i) {
+    group[i].join();
+  }
+  for (unsigned int i = 0; i < threads; ++i) {
+    drawStream(i, &sequential[i]);
+    EXPECT_EQ(sequential[i], concurrent[i]);
+  }
+}
+
+int main(int argc, char **argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
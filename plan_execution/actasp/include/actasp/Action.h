@@ -3,6 +3,8 @@
 #include <actasp/AspFluent.h>
 #include <actasp/ResourceManager.h>
 
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 #include <boost/shared_ptr.hpp>
@@ -49,6 +51,8 @@ private:
 
 typedef std::function<std::unique_ptr<actasp::Action>(const actasp::AspFluent &, actasp::ResourceManager &)> ActionFactory;
 
+typedef std::deque<std::unique_ptr<actasp::Action>> ActionPlan;
+
 
 }
 
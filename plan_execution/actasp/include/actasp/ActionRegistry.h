@@ -0,0 +1,54 @@
+#pragma once
+
+#include <actasp/Action.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace actasp {
+
+class AspFluent;
+
+//Maps action names to dense ids and their factories.
+//Built once from an action map, it resolves the action of a fluent by hashing
+//the name in place, so instantiating a plan does not allocate a string per fluent.
+class ActionRegistry {
+public:
+
+  static const unsigned int NOT_AN_ACTION;
+
+  explicit ActionRegistry(const std::map<std::string, ActionFactory> &actionMap);
+
+  //the id of the action the fluent is an instance of, or NOT_AN_ACTION
+  unsigned int idOf(const AspFluent &fluent) const noexcept;
+
+  unsigned int idOf(const std::string &name) const noexcept;
+
+  const std::string &name(unsigned int id) const {
+    return names[id];
+  }
+
+  const ActionFactory &factory(unsigned int id) const {
+    return factories[id];
+  }
+
+  unsigned int size() const noexcept {
+    return names.size();
+  }
+
+private:
+
+  unsigned int find(const char *name, std::size_t length) const noexcept;
+
+  static std::size_t hash(const char *name, std::size_t length) noexcept;
+
+  std::vector<std::string> names;
+  std::vector<ActionFactory> factories;
+
+  //open addressing table of ids, with NOT_AN_ACTION marking empty slots
+  std::vector<unsigned int> table;
+  std::size_t mask;
+};
+
+}
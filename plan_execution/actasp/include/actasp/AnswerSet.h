@@ -14,6 +14,7 @@
 namespace actasp {
 
 class Action;
+class ActionRegistry;
 
 class AnswerSet {
 
@@ -32,11 +33,12 @@ public:
 
   bool contains(const actasp::AspFluent &fluent) const noexcept;
 
-  std::list<std::unique_ptr<Action>> instantiateActions(const std::map<std::string, actasp::ActionFactory> &actionMap,
-                                                        actasp::ResourceManager &resourceManager) const noexcept(false);
+  //build the registry once from the action map and reuse it for every plan
+  ActionPlan instantiateActions(const actasp::ActionRegistry &registry,
+                                actasp::ResourceManager &resourceManager) const noexcept(false);
 
   // DEPRECATED
-  std::list<std::unique_ptr<Action>>
+  ActionPlan
   instantiateActions(const std::map<std::string, actasp::Action *> &actionMap) const noexcept(false);
 
   const FluentSet &getFluents() const noexcept { return fluents; }
@@ -10,6 +10,8 @@ namespace actasp {
 
 class ActionComparator;
 class ActionEquality;
+class ActionHash;
+class ActionRegistry;
   
 class AspFluent {
 public:
@@ -42,6 +44,8 @@ private:
 	
 	friend class ActionComparator;
   friend class ActionEquality;
+  friend class ActionHash;
+  friend class ActionRegistry;
 
 };
 
@@ -57,6 +61,12 @@ struct ActionEquality : public std::binary_function<const AspFluent&, const AspF
  }
 };
 
+struct ActionHash {
+ std::size_t operator()(const AspFluent& fluent) const {
+   return std::hash<std::string>()(fluent.cachedBase);
+ }
+};
+
 struct TimeStepComparator : public std::binary_function<const AspFluent&, const AspFluent&, bool>{
  bool operator()(const AspFluent& first, const AspFluent& second) const {
    return first.getTimeStep() < second.getTimeStep();
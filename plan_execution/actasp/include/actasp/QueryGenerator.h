@@ -20,6 +20,26 @@ struct QueryGenerator {
                                          unsigned int  max_plan_length,
                                          unsigned int answerset_number) const noexcept = 0;
                                          
+  //minimal plans for several goals from the same initial state, one list per goal in the same order.
+  //Up to maxConcurrentQueries() goals are planned at the same time, each with its own query file.
+  //Goals that can't get a thread are planned on the calling thread instead.
+  virtual std::vector< std::list<actasp::AnswerSet> > minimalPlanQueries(const std::vector< std::vector<actasp::AspRule> >& goals,
+                                         bool filterActions,
+                                         unsigned int  max_plan_length,
+                                         unsigned int answerset_number) const noexcept;
+
+  //minimalPlanQuery, writing its query and output under the given file name
+  virtual std::list<actasp::AnswerSet> minimalPlanQuery(const std::vector<actasp::AspRule>& goalRules,
+                                         bool filterActions,
+                                         unsigned int  max_plan_length,
+                                         unsigned int answerset_number,
+                                         const std::string& fileName) const noexcept;
+
+  //how many queries with different file names can run side by side
+  virtual unsigned int maxConcurrentQueries() const noexcept {
+    return 1;
+  }
+
   virtual std::list<actasp::AnswerSet> lengthRangePlanQuery(const std::vector<actasp::AspRule>& goalRules,
                                          bool filterActions, 
                                          unsigned int min_plan_length,
@@ -34,7 +34,7 @@ struct IsAnAction : public std::unary_function<const AspFluent &, bool> {
   std::set<std::string> actionNames;
 };
 
-AnswerSet planToAnswerSet(const std::list<std::unique_ptr<Action>> &plan);
+AnswerSet planToAnswerSet(const ActionPlan &plan);
 
 // DEPRECATED
 ActionSet actionMapToSet(const std::map<std::string, Action *> &actionMap);
@@ -60,7 +60,7 @@ private:
   bool hasFailed;
   std::map<std::string, Action *> actionMap;
 
-  std::list<std::unique_ptr<Action>> plan;
+  ActionPlan plan;
   unsigned int actionCounter;
   bool newAction;
 
@@ -6,6 +6,7 @@
 #include <list>
 #include <map>
 #include <actasp/Action.h>
+#include <actasp/ActionRegistry.h>
 
 namespace actasp {
 
@@ -57,9 +58,9 @@ private:
   std::vector<actasp::AspRule> goalRules;
   bool isGoalReached;
   bool hasFailed;
-  std::map<std::string, ActionFactory> actionMap;
+  ActionRegistry actionRegistry;
 
-  std::list<std::unique_ptr<Action>> plan;
+  ActionPlan plan;
   unsigned int actionCounter;
   bool newAction;
   unsigned int failureCount;
@@ -131,4 +131,10 @@ static std::vector<boost::filesystem::path> populateDirectory(const boost::files
   return outFilePaths;
 }
 
+//getQueryDirectory and populateDirectory in one step, so that queries running side by side
+//don't set up the same directory at the same time. queryDir is set to the directory.
+std::vector<boost::filesystem::path> setUpQueryDirectory(const std::vector<std::string> &linkFiles,
+                                                         const std::vector<std::string> &copyFiles,
+                                                         boost::filesystem::path &queryDir);
+
 }
\ No newline at end of file
@@ -20,6 +20,15 @@ struct Clingo5_2 : public FilteringQueryGenerator {
       unsigned int  max_plan_length,
       unsigned int answerset_number) const noexcept;
 
+  std::list<actasp::AnswerSet> minimalPlanQuery(const std::vector<actasp::AspRule>& goalRules,
+      bool filterActions,
+      unsigned int  max_plan_length,
+      unsigned int answerset_number,
+      const std::string& fileName) const noexcept;
+
+  //every query has its own files, and clingo only reads those
+  unsigned int maxConcurrentQueries() const noexcept;
+
   std::list<actasp::AnswerSet> lengthRangePlanQuery(const std::vector<actasp::AspRule>& goalRules,
       bool filterActions,
       unsigned int min_plan_length,
@@ -21,6 +21,10 @@ struct Reasoner : public AspKR {
 
   AnswerSet computePlan(const std::vector<actasp::AspRule>& goal) const noexcept(false) override;
   
+  //a minimal plan for each goal, all from the current state. The plan for goals[i] is at position i,
+  //unsatisfied if that goal cannot be reached; its number of actions is its cost.
+  std::vector< AnswerSet > computePlans(const std::vector< std::vector<actasp::AspRule> >& goals) const noexcept(false);
+
   std::vector< AnswerSet > computeAllPlans(const std::vector<actasp::AspRule>& goal, double suboptimality) const noexcept(false) override;
 
   AnswerSet computeOptimalPlan(const std::vector<actasp::AspRule>& goal, bool filterActions, double suboptimality, bool minimum) const noexcept(false);
@@ -0,0 +1,82 @@
+#include <actasp/ActionRegistry.h>
+
+#include <actasp/AspFluent.h>
+
+#include <limits>
+
+using namespace std;
+
+namespace actasp {
+
+const unsigned int ActionRegistry::NOT_AN_ACTION = numeric_limits<unsigned int>::max();
+
+ActionRegistry::ActionRegistry(const std::map<std::string, ActionFactory> &actionMap) :
+    names(),
+    factories(),
+    table(),
+    mask(0) {
+
+  names.reserve(actionMap.size());
+  factories.reserve(actionMap.size());
+
+  //keep the load factor at most one half
+  size_t capacity = 4;
+  while (capacity < 2 * actionMap.size())
+    capacity *= 2;
+
+  table.assign(capacity, NOT_AN_ACTION);
+  mask = capacity - 1;
+
+  for (const auto &pair: actionMap) {
+    unsigned int id = names.size();
+    names.push_back(pair.first);
+    factories.push_back(pair.second);
+
+    size_t slot = hash(pair.first.data(), pair.first.size()) & mask;
+    while (table[slot] != NOT_AN_ACTION)
+      slot = (slot + 1) & mask;
+
+    table[slot] = id;
+  }
+}
+
+size_t ActionRegistry::hash(const char *name, std::size_t length) noexcept {
+  //FNV-1a
+  size_t h = 2166136261u;
+  for (size_t i = 0; i < length; ++i) {
+    h ^= static_cast<unsigned char>(name[i]);
+    h *= 16777619u;
+  }
+  return h;
+}
+
+unsigned int ActionRegistry::find(const char *name, std::size_t length) const noexcept {
+
+  size_t slot = hash(name, length) & mask;
+
+  while (table[slot] != NOT_AN_ACTION) {
+    const string &candidate = names[table[slot]];
+    if (candidate.size() == length && candidate.compare(0, length, name, length) == 0)
+      return table[slot];
+
+    slot = (slot + 1) & mask;
+  }
+
+  return NOT_AN_ACTION;
+}
+
+unsigned int ActionRegistry::idOf(const AspFluent &fluent) const noexcept {
+  const string &base = fluent.cachedBase;
+  size_t nameLength = base.find_first_of('(');
+
+  if (nameLength == string::npos)
+    nameLength = base.size();
+
+  return find(base.data(), nameLength);
+}
+
+unsigned int ActionRegistry::idOf(const std::string &name) const noexcept {
+  return find(name.data(), name.size());
+}
+
+}
@@ -1,5 +1,7 @@
 #include <actasp/AnswerSet.h>
 
+#include <actasp/ActionRegistry.h>
+
 #include <iterator>
 #include <sstream>
 #include <actasp/action_utils.h>
@@ -27,43 +29,45 @@ bool AnswerSet::contains(const actasp::AspFluent& fluent) const noexcept {
 }
 
 
-std::list<std::unique_ptr<Action>> AnswerSet::instantiateActions(const map<string, actasp::ActionFactory> &actionMap,
-                                                                 ResourceManager &resourceManager) const
+static void throwMissingAction(const ActionPlan &plan) {
+  //print the actions directly, there is no need for a whole answer set just to show them
+  unsigned int timeStep = 0;
+  for (const auto &action: plan)
+    std::cout << action->toASP(timeStep++) << " ";
+  std::cout << std::endl;
+
+  throw logic_error(
+      "AnswerSet: the plan is missing an action for some time step. Check the list of actions shown in the plan query.");
+}
+
+ActionPlan AnswerSet::instantiateActions(const ActionRegistry &registry,
+                                         ResourceManager &resourceManager) const
 noexcept(false) {
 
-  list<std::unique_ptr<Action>> plan;
+  ActionPlan plan;
   unsigned int maxTimeStep = 0;
 
-
   for (const auto &fluent: fluents) {
 
-    auto actIt = actionMap.find(fluent.getName());
+    unsigned int id = registry.idOf(fluent);
 
-    if (actIt != actionMap.end()) {
-      plan.emplace_back(actIt->second(fluent, resourceManager));
+    if (id != ActionRegistry::NOT_AN_ACTION) {
+      plan.emplace_back(registry.factory(id)(fluent, resourceManager));
       maxTimeStep = std::max(maxTimeStep,fluent.getTimeStep());
     }
     //if a fluent is not a known action, just ignore it.
   }
 
-  if (maxTimeStep > 0 && maxTimeStep > plan.size()) {
-    AnswerSet as = planToAnswerSet(plan);
-    stringstream planStream;
-    copy(as.getFluents().begin(), as.getFluents().end(), ostream_iterator<string>(planStream, " "));
-    std::cout << planStream.str() << std::endl;
-    // Wipe out instances
-    plan.clear();
-    throw logic_error(
-        "AnswerSet: the plan is missing an action for some time step. Check the list of actions shown in the plan query.");
-  }
+  if (maxTimeStep > 0 && maxTimeStep > plan.size())
+    throwMissingAction(plan);
 
   return plan;
 }
 
-std::list<unique_ptr<Action>> AnswerSet::instantiateActions(const map<string, actasp::Action *> &actionMap) const
+ActionPlan AnswerSet::instantiateActions(const map<string, actasp::Action *> &actionMap) const
 									noexcept(false) {
 
-  list<unique_ptr<Action>> plan;
+  ActionPlan plan;
 	unsigned int maxTimeStep = 0;
 
     auto fluentIt = fluents.begin();
@@ -79,15 +83,8 @@ std::list<unique_ptr<Action>> AnswerSet::instantiateActions(const map<string, ac
 		//if a fluent is not a known action, just ignore it.
 	}
 
-    if (maxTimeStep > 0 && maxTimeStep > plan.size()) {
-        AnswerSet as = planToAnswerSet(plan);
-        stringstream planStream;
-        copy(as.getFluents().begin(), as.getFluents().end(), ostream_iterator<string>(planStream, " "));
-        std::cout << planStream.str() << std::endl;
-      plan.clear();
-        throw logic_error(
-                "AnswerSet: the plan is missing an action for some time step. Check the list of actions shown in the plan query.");
-	}
+    if (maxTimeStep > 0 && maxTimeStep > plan.size())
+        throwMissingAction(plan);
 
 	return plan;
 }
@@ -0,0 +1,68 @@
+#include <actasp/QueryGenerator.h>
+
+#include <actasp/AnswerSet.h>
+
+#include <algorithm>
+#include <future>
+#include <sstream>
+#include <system_error>
+
+using namespace std;
+
+namespace actasp {
+
+std::vector< std::list<actasp::AnswerSet> > QueryGenerator::minimalPlanQueries(const std::vector< std::vector<actasp::AspRule> >& goals,
+    bool filterActions,
+    unsigned int  max_plan_length,
+    unsigned int answerset_number) const noexcept {
+
+  vector< list<AnswerSet> > results(goals.size());
+
+  const size_t workers = max(1u, maxConcurrentQueries());
+
+  if (workers == 1) {
+    for (size_t i = 0; i < goals.size(); ++i)
+      results[i] = minimalPlanQuery(goals[i],filterActions,max_plan_length,answerset_number);
+    return results;
+  }
+
+  //every goal gets its own query and output file, so that a clingo process per goal can run at the same time
+  for (size_t first = 0; first < goals.size(); first += workers) {
+    const size_t last = min(goals.size(), first + workers);
+
+    vector< future< list<AnswerSet> > > running;
+    for (size_t i = first; i < last; ++i) {
+      stringstream fileName;
+      fileName << "planQuery_" << i;
+      const string name = fileName.str();
+      const vector<AspRule> &goal = goals[i];
+
+      auto query = [this, &goal, filterActions, max_plan_length, answerset_number, name]() {
+        return minimalPlanQuery(goal,filterActions,max_plan_length,answerset_number,name);
+      };
+
+      //async throws if no thread can be started; then this goal is planned on the calling thread in get()
+      try {
+        running.push_back(async(launch::async, query));
+      } catch (const system_error &) {
+        running.push_back(async(launch::deferred, query));
+      }
+    }
+
+    for (size_t i = first; i < last; ++i)
+      results[i] = running[i - first].get();
+  }
+
+  return results;
+}
+
+std::list<actasp::AnswerSet> QueryGenerator::minimalPlanQuery(const std::vector<actasp::AspRule>& goalRules,
+    bool filterActions,
+    unsigned int  max_plan_length,
+    unsigned int answerset_number,
+    const std::string& fileName) const noexcept {
+
+  return minimalPlanQuery(goalRules,filterActions,max_plan_length,answerset_number);
+}
+
+}
@@ -23,12 +23,13 @@ bool IsAnAction::operator()(const AspFluent& fluent) const {
   return actionNames.find(fluent.getName()) != actionNames.end();
 }
 
-AnswerSet planToAnswerSet(const std::list<std::unique_ptr<Action>> &plan) {
+AnswerSet planToAnswerSet(const ActionPlan &plan) {
   auto actIt = plan.begin();
-  set<AspFluent> fluents;
+  vector<AspFluent> fluents;
+  fluents.reserve(plan.size());
 
   for (int timeStep=0; actIt != plan.end(); ++actIt, ++timeStep) {
-    fluents.insert((*actIt)->toFluent(timeStep));
+    fluents.push_back((*actIt)->toFluent(timeStep));
   }
 
   return AnswerSet(fluents.begin(), fluents.end());
@@ -20,7 +20,7 @@ ReplanningPlanExecutor::ReplanningPlanExecutor(AspKR &reasoner,
     goalRules(),
     isGoalReached(true),
     hasFailed(false),
-    actionMap(actionMap),
+    actionRegistry(actionMap),
     plan(),
     actionCounter(0),
     newAction(true),
@@ -50,7 +50,7 @@ void ReplanningPlanExecutor::computePlan() {
   isGoalReached = kr.currentStateQuery(goalRules).isSatisfied();
 
   if (!isGoalReached) {
-    plan = planner.computePlan(goalRules).instantiateActions(actionMap, resourceManager);
+    plan = planner.computePlan(goalRules).instantiateActions(actionRegistry, resourceManager);
     actionCounter = 0;
   } else {
     return;
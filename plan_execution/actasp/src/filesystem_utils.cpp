@@ -0,0 +1,19 @@
+#include <actasp/filesystem_utils.h>
+
+#include <mutex>
+
+using namespace std;
+
+namespace actasp {
+
+vector<boost::filesystem::path> setUpQueryDirectory(const vector<string> &linkFiles,
+                                                    const vector<string> &copyFiles,
+                                                    boost::filesystem::path &queryDir) {
+  static mutex directoryMutex;
+  lock_guard<mutex> directoryLock(directoryMutex);
+
+  queryDir = getQueryDirectory(linkFiles, copyFiles);
+  return populateDirectory(queryDir, linkFiles, copyFiles);
+}
+
+}
@@ -12,6 +12,7 @@
 #include <cstdlib>
 #include <iostream>
 #include <limits>
+#include <thread>
 
 #include <ros/ros.h>
 #include <boost/filesystem.hpp>
@@ -346,9 +347,18 @@ std::list<actasp::AnswerSet> Clingo5_2::minimalPlanQuery(const std::vector<actas
     unsigned int  max_plan_length,
     unsigned int answerset_number) const noexcept {
 
+  return minimalPlanQuery(goalRules,filterActions,max_plan_length,answerset_number,"planQuery");
+}
+
+std::list<actasp::AnswerSet> Clingo5_2::minimalPlanQuery(const std::vector<actasp::AspRule>& goalRules,
+    bool filterActions,
+    unsigned int  max_plan_length,
+    unsigned int answerset_number,
+    const std::string& fileName) const noexcept {
+
   string planquery = generatePlanQuery(goalRules);
 
-  list<AnswerSet> answers = genericQuery(planquery,0,max_plan_length,"planQuery",answerset_number);
+  list<AnswerSet> answers = genericQuery(planquery,0,max_plan_length,fileName,answerset_number);
 
   if (filterActions)
     return filterPlans(answers,allActions);
@@ -357,6 +367,10 @@ std::list<actasp::AnswerSet> Clingo5_2::minimalPlanQuery(const std::vector<actas
 
 }
 
+unsigned int Clingo5_2::maxConcurrentQueries() const noexcept {
+  return max(1u, thread::hardware_concurrency());
+}
+
 struct MaxTimeStepLessThan5_2 {
 
   MaxTimeStepLessThan5_2(unsigned int initialTimeStep) : initialTimeStep(initialTimeStep) {}
@@ -510,8 +524,8 @@ std::string Clingo5_2::makeQuery(const std::string &query, unsigned int initialT
     copyFiles.clear();
   }
 
-  path queryDir = getQueryDirectory(linkFiles, copyFiles);
-  auto queryDirFiles = populateDirectory(queryDir, linkFiles, copyFiles);
+  path queryDir;
+  auto queryDirFiles = setUpQueryDirectory(linkFiles, copyFiles, queryDir);
 
   const path queryPath = (queryDir / fileName).string() + ".asp";
 
@@ -71,6 +71,18 @@ AnswerSet Reasoner::computePlan(const std::vector<actasp::AspRule>& goal) const
   else return *(plans.begin()); //it's really at most one
 }
 
+std::vector< AnswerSet > Reasoner::computePlans(const std::vector< std::vector<actasp::AspRule> >& goals) const noexcept(false) {
+  vector< list<AnswerSet> > plans = clingo->minimalPlanQueries(goals,true,max_n,1);
+
+  vector<AnswerSet> firstPlans;
+  firstPlans.reserve(plans.size());
+
+  for (const auto &goalPlans : plans)
+    firstPlans.push_back(goalPlans.empty() ? AnswerSet() : goalPlans.front());
+
+  return firstPlans;
+}
+
 struct AnswerSetToList {
   list <AspFluentRef> operator()(const AnswerSet& aset) const {
 
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <string>
 #include <actasp/reasoners/Clingo.h>
+#include <actasp/ActionRegistry.h>
 #include <gtest/gtest.h>
 #include <ros/package.h>
 
@@ -48,12 +49,71 @@ TEST(AspRule, EqualityWorks) {
   EXPECT_EQ("fluent(1, 2)"_f, "fluent(1, 2)"_f);
 }
 
+struct NamedAction : public Action {
+  explicit NamedAction(const AspFluent &fluent) : name(fluent.getName()), params(fluent.getParameters()) {}
+  int paramNumber() const override { return params.size(); }
+  std::string getName() const override { return name; }
+  void run() override {}
+  bool hasFinished() const override { return true; }
+  Action *cloneAndInit(const AspFluent &fluent) const override { return new NamedAction(fluent); }
+  Action *clone() const override { return new NamedAction(*this); }
+  std::vector<std::string> getParameters() const override { return params; }
+  std::string name;
+  std::vector<std::string> params;
+};
+
+static std::unique_ptr<Action> makeNamedAction(const AspFluent &fluent, ResourceManager &) {
+  return std::unique_ptr<Action>(new NamedAction(fluent));
+}
+
+TEST(ActionRegistry, ResolvesFluentsByName) {
+  std::map<std::string, ActionFactory> actionMap = {{"goto", makeNamedAction}, {"open", makeNamedAction},
+                                                    {"gotoo", makeNamedAction}};
+  ActionRegistry registry(actionMap);
+
+  EXPECT_EQ(registry.size(), 3);
+  EXPECT_EQ(registry.name(registry.idOf("goto(l1,1)"_f)), "goto");
+  EXPECT_EQ(registry.name(registry.idOf("gotoo(l1,1)"_f)), "gotoo");
+  EXPECT_EQ(registry.idOf("got(l1,1)"_f), ActionRegistry::NOT_AN_ACTION);
+  EXPECT_EQ(registry.idOf("at(l1,1)"_f), ActionRegistry::NOT_AN_ACTION);
+}
+
+TEST(AnswerSet, InstantiateActionsSkipsFluentsAndKeepsOrder) {
+  std::map<std::string, ActionFactory> actionMap = {{"goto", makeNamedAction}, {"open", makeNamedAction}};
+  ResourceManager resourceManager;
+  std::vector<AspFluent> fluents = {"at(l1,0)"_f, "open(d1,1)"_f, "goto(l2,2)"_f, "at(l2,2)"_f};
+  AnswerSet answer(fluents.begin(), fluents.end());
+
+  ActionRegistry registry(actionMap);
+  ActionPlan plan = answer.instantiateActions(registry, resourceManager);
+
+  ASSERT_EQ(plan.size(), 2);
+  EXPECT_EQ(plan[0]->toASP(1), "open(d1,1)");
+  EXPECT_EQ(plan[1]->toASP(2), "goto(l2,2)");
+
+  std::vector<AspFluent> missing = {"goto(l2,3)"_f};
+  EXPECT_ANY_THROW(AnswerSet(missing.begin(), missing.end()).instantiateActions(registry, resourceManager));
+}
+
 TEST_F(ClingoTest, MinimalPlanQueryWorks) {
   std::vector<AspRule> goal = {AspRule({},{"not bit_on(1,n)"_f})};
   auto plan = query_generator->minimalPlanQuery(goal, false,2,0);
   EXPECT_TRUE(plan.size() > 0);
 }
 
+TEST_F(ClingoTest, MinimalPlanQueriesMatchesOneQueryPerGoal) {
+  std::vector<std::vector<AspRule>> goals = {{AspRule({},{"not bit_on(1,n)"_f})},
+                                             {AspRule({},{"not bit_off(1,n)"_f})}};
+  auto batched = query_generator->minimalPlanQueries(goals, true, 2, 1);
+  ASSERT_EQ(batched.size(), goals.size());
+  for (size_t i = 0; i < goals.size(); ++i) {
+    auto single = query_generator->minimalPlanQuery(goals[i], true, 2, 1);
+    ASSERT_EQ(batched[i].size(), single.size());
+    if (!single.empty()) {
+      EXPECT_EQ(batched[i].front().getFluents(), single.front().getFluents());
+    }
+  }
+}
 
 // Run all the tests
 int main(int argc, char **argv) {